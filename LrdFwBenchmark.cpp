@@ -0,0 +1,502 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwBenchmark.cpp
+**
+** Notes:   Microbenchmarks of the per packet code paths of the update engine
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwBenchmark.h"
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QDebug>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+//Appends a command with its header to a generated upgrade file
+static void
+AppendUwfCommand(
+    QByteArray *pbaData,
+    char nCmdID,
+    const QByteArray &baPayload
+    )
+{
+    pbaData->append(nCmdID);
+    pbaData->append((char)0);
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY((*pbaData), (uint32_t)baPayload.length());
+    pbaData->append(baPayload);
+}
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwBenchmark::LrdFwBenchmark(
+    QObject *parent
+    ) : LrdFwUpd(parent)
+{
+    //Own settings are used so that no persistent configuration is touched, the port is never opened
+    LrdSettings *pSettings = new LrdSettings(this);
+    MallocFailCheck(pSettings);
+    SetSettingsObject(pSettings);
+    nSink = 0;
+
+    connect(this, SIGNAL(CurrentAction(uint32_t,uint32_t,QString)), this, SLOT(ActionReceived(uint32_t,uint32_t,QString)));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwBenchmark::~LrdFwBenchmark(
+    )
+{
+    disconnect(this, SIGNAL(CurrentAction(uint32_t,uint32_t,QString)), this, SLOT(ActionReceived(uint32_t,uint32_t,QString)));
+}
+
+//=============================================================================
+// Runs all of the benchmarks and writes the results to a CSV file, returns
+// false if the results could not be written
+//=============================================================================
+bool
+LrdFwBenchmark::Run(
+    QString strFilename
+    )
+{
+    lstResults.clear();
+    BenchmarkUwfScan();
+    BenchmarkDataPacket();
+    BenchmarkResponseHandling();
+    BenchmarkWriteAlignment();
+    BenchmarkSettings();
+    BenchmarkCurrentAction();
+
+    return WriteResults(strFilename);
+}
+
+//=============================================================================
+// Times a benchmark body. The iteration count is doubled until the first run
+// takes at least BENCHMARK_MINIMUM_TIME_NS, then the same count is run again
+// and the fastest run is kept as it has the least interference from the rest
+// of the system
+//=============================================================================
+void
+LrdFwBenchmark::Measure(
+    QString strName,
+    quint32 nItemsPerIteration,
+    const std::function<void()> &fnBody
+    )
+{
+    BenchmarkResultStruct sResult;
+    sResult.strName = strName;
+    sResult.nIterations = 1;
+    sResult.dNSPerIteration = 0;
+    sResult.nItemsPerIteration = nItemsPerIteration;
+
+    QElapsedTimer elptmrRun;
+    uint8_t nRun = 0;
+    while (nRun < BENCHMARK_RUNS)
+    {
+        elptmrRun.start();
+        quint64 i = 0;
+        while (i < sResult.nIterations)
+        {
+            fnBody();
+            ++i;
+        }
+        qint64 nElapsedNS = elptmrRun.nsecsElapsed();
+
+        if (nRun == 0 && nElapsedNS < BENCHMARK_MINIMUM_TIME_NS)
+        {
+            //Too short to time accurately, try again with more iterations
+            sResult.nIterations *= 2;
+            continue;
+        }
+
+        double dNSPerIteration = (double)nElapsedNS / sResult.nIterations;
+        if (nRun == 0 || dNSPerIteration < sResult.dNSPerIteration)
+        {
+            sResult.dNSPerIteration = dNSPerIteration;
+        }
+        ++nRun;
+    }
+
+    lstResults.append(sResult);
+    qDebug().noquote() << QString(strName).append(": ").append(QString::number(sResult.dNSPerIteration, 'f', 1)).append("ns per iteration, ").append(QString::number(sResult.dNSPerIteration / nItemsPerIteration, 'f', 1)).append("ns per item");
+}
+
+//=============================================================================
+// Generates an upgrade file with a single device and BENCHMARK_UWF_WRITE_BLOCKS
+// write blocks of non-erased data
+//=============================================================================
+QByteArray
+LrdFwBenchmark::BuildUpgradeData(
+    )
+{
+    QByteArray baData;
+    QByteArray baPayload;
+
+    //Target platform
+    baPayload.fill('\x5a', UWF_TARGET_PLATFORM_LENGTH);
+    AppendUwfCommand(&baData, UWF_COMMAND_TARGET_PLATFORM, baPayload);
+
+    //Register and select flash device 0 at address 0
+    baPayload.fill('\0', UWF_REGISTER_DEVICE_LENGTH);
+    baPayload[UWF_OFFSET_REGISTER_BANKS] = 1;
+    AppendUwfCommand(&baData, UWF_COMMAND_REGISTER, baPayload);
+    baPayload.fill('\0', UWF_SELECT_DEVICE_LENGTH);
+    AppendUwfCommand(&baData, UWF_COMMAND_SELECT, baPayload);
+
+    //Sector map covering the written data
+    baPayload.clear();
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)BENCHMARK_UWF_WRITE_BLOCKS);
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)BENCHMARK_UWF_WRITE_BLOCK_SIZE);
+    AppendUwfCommand(&baData, UWF_COMMAND_SECTOR_MAP, baPayload);
+
+    //Erase everything which is written
+    baPayload.clear();
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)0);
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)(BENCHMARK_UWF_WRITE_BLOCKS * BENCHMARK_UWF_WRITE_BLOCK_SIZE));
+    AppendUwfCommand(&baData, UWF_COMMAND_ERASE, baPayload);
+
+    uint32_t i = 0;
+    while (i < BENCHMARK_UWF_WRITE_BLOCKS)
+    {
+        //Write block, offset and flags followed by the data
+        baPayload.clear();
+        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)(i * BENCHMARK_UWF_WRITE_BLOCK_SIZE));
+        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baPayload, (uint32_t)0);
+        uint32_t n = 0;
+        while (n < BENCHMARK_UWF_WRITE_BLOCK_SIZE)
+        {
+            baPayload.append((char)((i + n) & 0x7f));
+            ++n;
+        }
+        AppendUwfCommand(&baData, UWF_COMMAND_WRITE, baPayload);
+        ++i;
+    }
+
+    //Unregister the device
+    baPayload.fill('\0', UWF_UNREGISTER_DEVICE_LENGTH);
+    AppendUwfCommand(&baData, UWF_COMMAND_UNREGISTER, baPayload);
+
+    return baData;
+}
+
+//=============================================================================
+// Parsing of the command headers of an upgrade file, with and without
+// validation, per command
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkUwfScan(
+    )
+{
+    QByteArray baData = BuildUpgradeData();
+    quint32 nPackets = LrdFwUpd::ScanUpgradeData(baData, true).lstPackets.count();
+
+    Measure("uwf_scan", nPackets, [&]() { nSink += LrdFwUpd::ScanUpgradeData(baData, false).lstPackets.count(); });
+    Measure("uwf_scan_validate", nPackets, [&]() { nSink += LrdFwUpd::ScanUpgradeData(baData, true).lstPackets.count(); });
+}
+
+//=============================================================================
+// Handling of the acknowledgement to a write address command, which builds
+// and sends the data command with its checksum, for each checksum width
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkDataPacket(
+    )
+{
+    QByteArray baAcknowledge(FUP_RESPONSE_LENGTH_ACKNOWLEDGE, FUP_RESPONSE_ACKNOWLEDGE);
+    QByteArray baChunk = BuildUpgradeData().right(BENCHMARK_WRITE_SIZE);
+
+    SetMode(MODE_WRITE_COMMAND);
+    bVerifyActive = true;
+    baPendingChunk = baChunk;
+    nDataSize = baChunk.length();
+    nWriteWholeSize = baChunk.length();
+
+    const uint8_t nWidths[] = {FUP_LENGTH_1BYTE, FUP_LENGTH_2BYTE, FUP_LENGTH_4BYTE};
+    uint8_t i = 0;
+    while (i < sizeof(nWidths))
+    {
+        nActiveChecksumLengthCmd = nWidths[i];
+        Measure(QString("data_packet_checksum_").append(QString::number(nWidths[i])), baChunk.length(), [&]()
+        {
+            CSubMode = SUBMODE_WRITE_DATA;
+            nWriteStart = 0;
+            nWriteSize = nDataSize;
+            nVerifySize = 0;
+            ModuleDataReceived(&baAcknowledge);
+        });
+        ++i;
+    }
+
+    //Only the chunk checksum, to separate it from the packet construction
+    Measure("chunk_checksum", baChunk.length(), [&]() { nSink += LrdFwUpd::ChunkChecksum(baChunk); });
+
+    StopCommandTimeout();
+    SetMode(MODE_IDLE);
+    CSubMode = SUBMODE_NONE;
+    bVerifyActive = false;
+    baPendingChunk.clear();
+}
+
+//=============================================================================
+// Handling of the acknowledgement to a data command, which reads the next
+// chunk from the upgrade file and builds and sends the write address command
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkResponseHandling(
+    )
+{
+    QByteArray baAcknowledge(FUP_RESPONSE_LENGTH_ACKNOWLEDGE, FUP_RESPONSE_ACKNOWLEDGE);
+    QByteArray baData = BuildUpgradeData();
+    qint64 nDataOffset = baData.length() - (UWF_COMMAND_HEADER_LENGTH + UWF_UNREGISTER_DEVICE_LENGTH) - BENCHMARK_UWF_WRITE_BLOCK_SIZE;
+
+    //Same options as an update with page aligned writes which skips erased chunks
+    pUwfData->SetImageData(baData);
+    if (pUwfData->Open() == false)
+    {
+        return;
+    }
+    nFileSize = pUwfData->TotalSize();
+    nActiveWriteSize = BENCHMARK_WRITE_SIZE;
+    nActiveWriteLengthCmd = FUP_LENGTH_2BYTE;
+    bSkipErasedChunks = true;
+    bAlignWrites = true;
+    nConfigPageSize = BENCHMARK_UWF_WRITE_BLOCK_SIZE;
+    bVerifyActive = false;
+    bDeferredVerify = false;
+    SetMode(MODE_WRITE_COMMAND);
+
+    Measure("write_address_response", BENCHMARK_WRITE_SIZE, [&]()
+    {
+        CSubMode = SUBMODE_WRITE_ADDRESS;
+        nWriteStart = 0;
+        nWriteSize = BENCHMARK_WRITE_SIZE;
+        nWriteWholeSize = BENCHMARK_WRITE_SIZE;
+        pUwfData->Seek(SEEK_FROM_BEGINNING, nDataOffset);
+        ModuleDataReceived(&baAcknowledge);
+    });
+
+    StopCommandTimeout();
+    SetMode(MODE_IDLE);
+    CSubMode = SUBMODE_NONE;
+    baPendingChunk.clear();
+    elptmrWritePacket.invalidate();
+    pUwfData->Close();
+    pUwfData->SetImageData(QByteArray());
+}
+
+//=============================================================================
+// Settings lookups of the kind which used to be made per packet, and their
+// replacements
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkSettings(
+    )
+{
+    Measure("settings_lookup", 2, [&]()
+    {
+        nSink += pSettingsHandle->GetConfigOption(ACTIVE_BAUD).toULongLong();
+        nSink += pSettingsHandle->GetConfigOption(VERIFY_DATA).toBool();
+    });
+
+    //The same values from the session configuration, which is what the per packet code uses
+    QSharedPointer<const SessionConfigStruct> pConfig = pSettingsHandle->CreateSessionConfig(pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString());
+    Measure("session_config_lookup", 2, [&]()
+    {
+        nSink += pDevice->ActiveBaud();
+        nSink += pConfig->bVerifyData;
+    });
+}
+
+//=============================================================================
+// Formatting and emitting a per packet status message
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkCurrentAction(
+    )
+{
+    uint32_t nAddress = 0x27000;
+    Measure("current_action_format", 1, [&]()
+    {
+        emit CurrentAction(MODULE_UPDATE, 0, QString("SubMode ").append(QString::number(SUBMODE_WRITE_ADDRESS)).append(", ").append(QString::number(BENCHMARK_WRITE_SIZE)).append(", ").append(QString::number(nAddress)).append(", ").append(QString::number(nAddress + BENCHMARK_WRITE_SIZE)));
+        nAddress += BENCHMARK_WRITE_SIZE;
+    });
+}
+
+//=============================================================================
+// Planning of the write blocks of an upgrade file whose blocks start part way
+// into a flash page, with and without page aligned writes. The packet count of
+// each case is the items per iteration, and the estimated time on the wire of
+// the write commands is added as a separate result for each case
+//=============================================================================
+void
+LrdFwBenchmark::BenchmarkWriteAlignment(
+    )
+{
+    QByteArray baData = BuildUpgradeData();
+    QList<UwfPacketStruct> lstPackets = LrdFwUpd::ScanUpgradeData(baData, true).lstPackets;
+
+    pUwfData->SetImageData(baData);
+    if (pUwfData->Open() == false)
+    {
+        return;
+    }
+    nFileSize = pUwfData->TotalSize();
+    nActiveWriteSize = BENCHMARK_WRITE_SIZE;
+    nActiveWriteLengthCmd = FUP_LENGTH_2BYTE;
+    nActiveChecksumLengthCmd = FUP_LENGTH_4BYTE;
+    nConfigPageSize = BENCHMARK_UWF_WRITE_BLOCK_SIZE;
+    nEstimateBaud = BENCHMARK_ESTIMATE_BAUD;
+    nEstimateRoundTripUS = BENCHMARK_ESTIMATE_ROUND_TRIP_US;
+    nEstimateBitsPerByte = DEFAULT_CONFIG_DRY_RUN_BITS_PER_BYTE;
+    nEstimateEraseUSPerKB = DEFAULT_CONFIG_DRY_RUN_ERASE_US_PER_KB;
+    nEstimateProgramUSPerKB = DEFAULT_CONFIG_DRY_RUN_PROGRAM_US_PER_KB;
+    bSkipErasedChunks = false;
+    bVerifyActive = false;
+    bDeferredVerify = false;
+
+    uint8_t i = 0;
+    while (i < 2)
+    {
+        bAlignWrites = (i == 1);
+        QString strCase = (bAlignWrites == true ? "aligned" : "unaligned");
+
+        UpdateEstimateStruct sEstimate = {};
+        quint32 nPackets = PlanWriteBlocks(lstPackets, &sEstimate);
+        Measure(QString("write_plan_").append(strCase), nPackets, [&]()
+        {
+            UpdateEstimateStruct sRun = {};
+            nSink += PlanWriteBlocks(lstPackets, &sRun);
+        });
+        AddEstimateResult(QString("write_wire_estimate_").append(strCase), nPackets, sEstimate.nWriteTimeUS);
+        ++i;
+    }
+
+    baPendingChunk.clear();
+    pUwfData->Close();
+    pUwfData->SetImageData(QByteArray());
+}
+
+//=============================================================================
+// Plans every write block in the upgrade file, with each block starting
+// BENCHMARK_UNALIGNED_OFFSET bytes into a flash page, and adds the write
+// commands to an estimate. Returns the number of data packets
+//=============================================================================
+quint32
+LrdFwBenchmark::PlanWriteBlocks(
+    const QList<UwfPacketStruct> &lstPackets,
+    UpdateEstimateStruct *pEstimate
+    )
+{
+    uint32_t nWriteCommandLength = QByteArray(COMMAND_WRITE_SECTION).length() + FUP_LENGTH_4BYTE + nActiveWriteLengthCmd;
+    uint32_t nDataCommandLength = QByteArray(COMMAND_DATA_SECTION).length() + nActiveChecksumLengthCmd;
+    quint32 nPackets = 0;
+    quint64 nAddress = BENCHMARK_UNALIGNED_OFFSET;
+
+    int i = 0;
+    while (i < lstPackets.count())
+    {
+        if (lstPackets.at(i).nCmdID == UWF_COMMAND_WRITE)
+        {
+            nWriteStart = nAddress;
+            nWriteSize = lstPackets.at(i).nLength - UWF_WRITE_BLOCK_LENGTH;
+            pUwfData->Seek(SEEK_FROM_BEGINNING, lstPackets.at(i).nFileOffset + UWF_WRITE_BLOCK_LENGTH);
+            nAddress += nWriteSize;
+
+            //Only writes are planned as skipping erased chunks and verification are disabled
+            while (PlanNextWriteStep() == WRITE_STEP_WRITE)
+            {
+                ++nPackets;
+                pEstimate->nWriteTimeUS += EstimateCommandTime(nWriteCommandLength, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate) + EstimateCommandTime(nDataCommandLength + nDataSize, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate);
+                CompleteWriteChunk();
+            }
+        }
+        ++i;
+    }
+
+    return nPackets;
+}
+
+//=============================================================================
+// Adds an estimated (not measured) time as a result with a single iteration
+//=============================================================================
+void
+LrdFwBenchmark::AddEstimateResult(
+    QString strName,
+    quint32 nItems,
+    quint64 nTimeUS
+    )
+{
+    BenchmarkResultStruct sResult;
+    sResult.strName = strName;
+    sResult.nIterations = 1;
+    sResult.dNSPerIteration = (double)nTimeUS * 1000;
+    sResult.nItemsPerIteration = nItems;
+
+    lstResults.append(sResult);
+    qDebug().noquote() << QString(strName).append(": ").append(QString::number(nItems)).append(" packets, ").append(QString::number(nTimeUS / 1000)).append("ms estimated at ").append(QString::number(BENCHMARK_ESTIMATE_BAUD)).append(" baud");
+}
+
+//=============================================================================
+// Receives status messages from the update code
+//=============================================================================
+void
+LrdFwBenchmark::ActionReceived(
+    uint32_t,
+    uint32_t,
+    QString strActionName
+    )
+{
+    nSink += strActionName.length();
+}
+
+//=============================================================================
+// Writes the results as CSV, one benchmark per line
+//=============================================================================
+bool
+LrdFwBenchmark::WriteResults(
+    QString strFilename
+    )
+{
+    QByteArray baOutput = "benchmark,iterations,ns_per_iteration,items_per_iteration,ns_per_item\n";
+    int i = 0;
+    while (i < lstResults.count())
+    {
+        const BenchmarkResultStruct &sResult = lstResults.at(i);
+        baOutput.append(sResult.strName.toUtf8()).append(',').append(QByteArray::number(sResult.nIterations)).append(',').append(QByteArray::number(sResult.dNSPerIteration, 'f', 1)).append(',').append(QByteArray::number(sResult.nItemsPerIteration)).append(',').append(QByteArray::number(sResult.dNSPerIteration / sResult.nItemsPerIteration, 'f', 3)).append('\n');
+        ++i;
+    }
+
+    QSaveFile fileOutput(strFilename);
+    if (!fileOutput.open(QIODevice::WriteOnly) || fileOutput.write(baOutput) != baOutput.length())
+    {
+        //Unable to write the results
+        fileOutput.cancelWriting();
+        return false;
+    }
+
+    return fileOutput.commit();
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
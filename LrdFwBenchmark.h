@@ -0,0 +1,151 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwBenchmark.h
+**
+** Notes:   Microbenchmarks of the per packet code paths of the update engine,
+**          built as UwFlashXBenchmark. Results are written as CSV so
+**          that they can be compared between builds to catch regressions
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWBENCHMARK_H
+#define LRDFWBENCHMARK_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QList>
+#include <functional>
+#include "LrdFwCommon.h"
+#include "LrdSettings.h"
+#include "LrdFwUpd.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+//Minimum time of each run, the iteration count is doubled until the first run reaches this
+#define BENCHMARK_MINIMUM_TIME_NS                     100000000
+
+//Number of times each benchmark is measured, the fastest is reported
+#define BENCHMARK_RUNS                                5
+
+//Number of write blocks in the generated upgrade file, and the size of each
+#define BENCHMARK_UWF_WRITE_BLOCKS                    256
+#define BENCHMARK_UWF_WRITE_BLOCK_SIZE                4096
+
+//Write size used for the data packets, as negotiated with a newer bootloader
+#define BENCHMARK_WRITE_SIZE                          1024
+
+//Offset into a flash page at which the write blocks start for the write alignment comparison
+#define BENCHMARK_UNALIGNED_OFFSET                    512
+
+//Link used for the estimated time on the wire of the write alignment comparison
+#define BENCHMARK_ESTIMATE_BAUD                       115200
+#define BENCHMARK_ESTIMATE_ROUND_TRIP_US              DEFAULT_CONFIG_DRY_RUN_ROUND_TRIP_US
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold the result of a single benchmark
+typedef struct
+{
+    QString strName;              //Name of the benchmark
+    quint64 nIterations;          //Iterations in the fastest run
+    double  dNSPerIteration;      //Time per iteration in ns
+    quint32 nItemsPerIteration;   //Items (packets, lookups or bytes) processed per iteration
+} BenchmarkResultStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwBenchmark : public LrdFwUpd
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwBenchmark(
+        QObject *parent = nullptr
+        );
+    ~LrdFwBenchmark(
+        );
+    bool
+    Run(
+        QString strFilename
+        );
+
+private slots:
+    void
+    ActionReceived(
+        uint32_t nModule,
+        uint32_t nActionID,
+        QString strActionName
+        );
+
+private:
+    void
+    Measure(
+        QString strName,
+        quint32 nItemsPerIteration,
+        const std::function<void()> &fnBody
+        );
+    static QByteArray
+    BuildUpgradeData(
+        );
+    void
+    BenchmarkUwfScan(
+        );
+    void
+    BenchmarkDataPacket(
+        );
+    void
+    BenchmarkResponseHandling(
+        );
+    void
+    BenchmarkWriteAlignment(
+        );
+    quint32
+    PlanWriteBlocks(
+        const QList<UwfPacketStruct> &lstPackets,
+        UpdateEstimateStruct *pEstimate
+        );
+    void
+    AddEstimateResult(
+        QString strName,
+        quint32 nItems,
+        quint64 nTimeUS
+        );
+    void
+    BenchmarkSettings(
+        );
+    void
+    BenchmarkCurrentAction(
+        );
+    bool
+    WriteResults(
+        QString strFilename
+        );
+
+    QList<BenchmarkResultStruct> lstResults;          //Results of the benchmarks which have been run
+    quint64                      nSink;               //Accumulates results so that the measured code is not optimised out
+};
+
+#endif // LRDFWBENCHMARK_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
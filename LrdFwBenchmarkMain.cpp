@@ -0,0 +1,61 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwBenchmarkMain.cpp
+**
+** Notes:   Entry point of the update engine benchmark application
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwBenchmark.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+//=============================================================================
+//=============================================================================
+int
+main(
+    int argc,
+    char *argv[]
+    )
+{
+    QCoreApplication a(argc, argv);
+
+    if (argc != 2)
+    {
+        //The results file is required
+        qDebug().noquote() << "Usage: UwFlashXBenchmark <results CSV file>";
+        return EXIT_CODE_BENCHMARK_OUTPUT_FAILED;
+    }
+
+    //Run the engine microbenchmarks and write the results to the supplied file
+    LrdFwBenchmark bmkEngine;
+    if (bmkEngine.Run(QString::fromLocal8Bit(argv[1])) == false)
+    {
+        //Results could not be written
+        return EXIT_CODE_BENCHMARK_OUTPUT_FAILED;
+    }
+
+    return EXIT_CODE_SUCCESS;
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
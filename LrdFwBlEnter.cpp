@@ -31,8 +31,204 @@
 #include <QSerialPortInfo>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QMap>
 #include <QDebug>
 
+#if !defined(SKIPFTDI) && defined(__linux__)
+/******************************************************************************/
+// Local Variables
+/******************************************************************************/
+//These are shared between all bootloader entrance objects so that many adapters
+//can be reset at the same time without re-initialising libusb/libftdi each time,
+//they are kept until the last entrance object is destroyed
+static QMutex mtxSharedContext;                                 //Protects the shared objects below
+static libusb_context *usbSharedContext = NULL;                 //Shared libusb context
+static uint16_t nSharedContextUsers = 0;                        //Number of entrance objects using the shared context
+static QList<struct ftdi_context *> lstFreeFtdiContexts;        //Pool of libftdi contexts which are not in use
+static QMap<QByteArray, QString> mapUsbSerialNumbers;           //Cached FTDI serial numbers, keyed by USB location
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Takes a reference to the shared objects for an entrance object
+//=============================================================================
+static void
+AddSharedContextUser(
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    ++nSharedContextUsers;
+}
+
+//=============================================================================
+// Creates the shared libusb context if it has not been created yet
+//=============================================================================
+static bool
+InitSharedContext(
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    if (usbSharedContext == NULL)
+    {
+        if (libusb_init(&usbSharedContext) != LIBUSB_SUCCESS)
+        {
+            //libusb initialisation failed
+            usbSharedContext = NULL;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Releases the reference held by an entrance object, the libusb context, pool
+// of libftdi contexts and serial number cache are freed once the last one has
+// gone
+//=============================================================================
+static void
+RemoveSharedContextUser(
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    if (nSharedContextUsers == 0)
+    {
+        return;
+    }
+
+    --nSharedContextUsers;
+    if (nSharedContextUsers == 0)
+    {
+        while (lstFreeFtdiContexts.count() > 0)
+        {
+            ftdi_free(lstFreeFtdiContexts.takeLast());
+        }
+        mapUsbSerialNumbers.clear();
+        if (usbSharedContext != NULL)
+        {
+            libusb_exit(usbSharedContext);
+            usbSharedContext = NULL;
+        }
+    }
+}
+
+//=============================================================================
+// Takes a libftdi context from the pool or creates a new one if it is empty
+//=============================================================================
+static struct ftdi_context *
+TakeFtdiContext(
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    if (lstFreeFtdiContexts.count() > 0)
+    {
+        return lstFreeFtdiContexts.takeLast();
+    }
+
+    return ftdi_new();
+}
+
+//=============================================================================
+// Returns a (closed) libftdi context to the pool
+//=============================================================================
+static void
+ReturnFtdiContext(
+    struct ftdi_context *pContext
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    lstFreeFtdiContexts.append(pContext);
+}
+
+//=============================================================================
+// Returns a key which identifies where a USB device is connected
+//=============================================================================
+static QByteArray
+UsbDeviceLocation(
+    libusb_device *pDevice
+    )
+{
+    uint8_t baPortNumbers[8];
+    int nPortNumbers = libusb_get_port_numbers(pDevice, baPortNumbers, sizeof(baPortNumbers));
+    QByteArray baLocation;
+
+    baLocation.append((char)libusb_get_bus_number(pDevice));
+    if (nPortNumbers > 0)
+    {
+        baLocation.append((const char *)baPortNumbers, nPortNumbers);
+    }
+    baLocation.append((char)libusb_get_device_address(pDevice));
+
+    return baLocation;
+}
+
+//=============================================================================
+// Searches the shared context for the FTDI device with the provided serial
+// number, devices which have been seen before are not re-opened to read
+// their serial number. The returned device must be unreferenced by the caller
+//=============================================================================
+static libusb_device *
+FindSharedDevice(
+    QString strSerial
+    )
+{
+    QMutexLocker lckContext(&mtxSharedContext);
+    libusb_device **usbdDevice = NULL;
+    libusb_device *usbdFound = NULL;
+    ssize_t nDevicesFound = libusb_get_device_list(usbSharedContext, &usbdDevice);
+
+    for (ssize_t idx = 0; idx < nDevicesFound && usbdFound == NULL; ++idx)
+    {
+        libusb_device *device = usbdDevice[idx];
+        struct libusb_device_descriptor desc;
+
+        if (libusb_get_device_descriptor(device, &desc) != LIBUSB_SUCCESS || desc.idVendor != FTDI_DEVICE_VENDOR_ID || desc.idProduct != FTDI_DEVICE_PRODUCT_ID)
+        {
+            //Not an FTDI adapter
+            continue;
+        }
+
+        QByteArray baLocation = UsbDeviceLocation(device);
+        if (!mapUsbSerialNumbers.contains(baLocation))
+        {
+            //Device has not been seen before, read the serial number
+            libusb_device_handle *handle = NULL;
+            unsigned char strSerialNumber[FTDI_DEVICE_SERIAL_NUMBER_MAX_SIZE];
+            int nStatus;
+
+            if (libusb_open(device, &handle) != LIBUSB_SUCCESS)
+            {
+                //Failed to open USB device, this is likely not the device being searched for
+                continue;
+            }
+
+            nStatus = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, strSerialNumber, sizeof(strSerialNumber)-1);
+            libusb_close(handle);
+            if (nStatus < LIBUSB_SUCCESS)
+            {
+                continue;
+            }
+            mapUsbSerialNumbers.insert(baLocation, QString::fromLatin1((const char *)strSerialNumber, nStatus));
+        }
+
+        if (mapUsbSerialNumbers.value(baLocation) == strSerial)
+        {
+            //Found the USB device
+            usbdFound = libusb_ref_device(device);
+        }
+    }
+
+    if (nDevicesFound >= 0)
+    {
+        libusb_free_device_list(usbdDevice, 1);
+    }
+
+    return usbdFound;
+}
+#endif
+
 //=============================================================================
 // Constructor
 //=============================================================================
@@ -42,6 +238,11 @@ LrdFwBlEnter::LrdFwBlEnter(
     ) : QObject(parent)
 {
     pSettingsHandle = pSettings;
+    nEntranceType = ENTER_BOOTLOADER_NONE;
+    nEntranceStep = ENTER_BOOTLOADER_STEP_IDLE;
+#if !defined(SKIPFTDI) && defined(__linux__)
+    AddSharedContextUser();
+#endif
 }
 
 //=============================================================================
@@ -50,7 +251,11 @@ LrdFwBlEnter::LrdFwBlEnter(
 LrdFwBlEnter::~LrdFwBlEnter(
     )
 {
-
+    //Release the device if an entrance sequence is still running
+    CancelEnterBootloader();
+#if !defined(SKIPFTDI) && defined(__linux__)
+    RemoveSharedContextUser();
+#endif
 }
 
 //=============================================================================
@@ -64,6 +269,34 @@ LrdFwBlEnter::SetSettingsObject(
     pSettingsHandle = pSettings;
 }
 
+//=============================================================================
+// Returns true if a bootloader entrance sequence is in progress
+//=============================================================================
+bool
+LrdFwBlEnter::IsEnteringBootloader(
+    )
+{
+    return (tmrStepTimer != NULL);
+}
+
+//=============================================================================
+// Shows a message to the user through whatever is connected to UserPrompt()
+// with a direct connection, as the update core has no GUI of its own. Returns
+// true if a question was accepted, false if it was declined or if nothing is
+// connected to ask the user
+//=============================================================================
+bool
+LrdFwBlEnter::Prompt(
+    uint8_t nType,
+    QString strTitle,
+    QString strMessage
+    )
+{
+    bool bAccepted = false;
+    emit UserPrompt(nType, strTitle, strMessage, &bAccepted);
+    return bAccepted;
+}
+
 #if !defined(SKIPFTDI) && !defined(TARGET_OS_MAC)
 //=============================================================================
 // Workaround for issue with FTDI library
@@ -103,21 +336,19 @@ LrdFwBlEnter::IsValidSerial(
 }
 
 //=============================================================================
-// Enters bootloader mode on the target module via FTDI functionality
+// Asks for confirmation and shows the setup messages for entering bootloader
+// mode via FTDI functionality (through UserPrompt()), this must be called
+// before starting the entrance sequence as the sequence itself never prompts
 //=============================================================================
 bool
-LrdFwBlEnter::EnterBootloader(
+LrdFwBlEnter::ConfirmEnterBootloader(
     uint8_t nType,
     QString strSerialPort,
     QString strFTDIOverride,
-#ifdef __linux__
-    QString *pNewSerialPort,
-#endif
     bool bSkipWarning,
-    bool
+    bool bSkipError
     )
 {
-    //Enters bootloader mode
     if (nType != ENTER_BOOTLOADER_BL654_USB && nType != ENTER_BOOTLOADER_PINNACLE100)
     {
         //Invalid type specified
@@ -127,476 +358,564 @@ LrdFwBlEnter::EnterBootloader(
 #ifdef _WIN32
 #ifdef _MSC_VER
     QSerialPortInfo spiSerialInfo(strSerialPort);
-    if (spiSerialInfo.isValid() && spiSerialInfo.manufacturer().indexOf(FTDI_MANUFACTURER_NAME) != -1)
+    if (spiSerialInfo.isNull() || spiSerialInfo.manufacturer().indexOf(FTDI_MANUFACTURER_NAME) == -1)
     {
-        //Valid FTDI device, proceed
-        if (bSkipWarning == false)
-        {
-            if (QMessageBox::question(NULL, "Continue?", QString("This feature allows automatically entering the bootloader on certain modules, please be sure that you have selected the correct device before continuing as using it with the wrong device may cause unforeseen issues and potential hardware damage which Laird Connectivity claims no responsibility and accepts no liability for.\r\n\r\nAre you sure ").append(strSerialPort).append(" is the correct port and '").append(spiSerialInfo.description()).append("' (").append(spiSerialInfo.manufacturer()).append(") [").append(spiSerialInfo.serialNumber()).append("] the correct description for your device?"), QMessageBox::Yes, QMessageBox::No) != QMessageBox::Yes)
-            {
-                //Cancel operation
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_CANCELLED);
-                return false;
-            }
-        }
-
-        //Windows, MSVC build
-        FT_STATUS ftsStatus;
-        FT_HANDLE fthHandle;
-
-        //Check that the serial number is valid
-        QString strFTDISerial = spiSerialInfo.serialNumber().left(FTDI_DEVICE_SERIAL_NUMBER_SIZE);
-        if (!strFTDIOverride.isNull() && !strFTDIOverride.isEmpty())
-        {
-            //User provided FTDI ID over-ride
-            strFTDISerial = strFTDIOverride;
-        }
-        else
-        {
-            if (IsValidSerial(&strFTDISerial) == false)
-            {
-                //Serial number is not valid
-                if (bSkipError == false)
-                {
-                    QMessageBox::critical(NULL, "Error retrieving FTDI serial number", QString("There was an error retrieving the serial number for your FTDI device, please open a bug report on the UwFlashX github page (link can be clicked from the 'About' tab) and provide the following details:\r\n\r\nPort: ").append(strSerialPort).append("\r\nManufacturer: ").append(spiSerialInfo.manufacturer()).append("\r\nFull serial number: ").append(spiSerialInfo.serialNumber()).append("\r\nTrucated serial number: ").append(strFTDISerial).append("\r\nVendor ID: ").append(QString::number(spiSerialInfo.vendorIdentifier())).append("\r\nProduct ID: ").append(QString::number(spiSerialInfo.productIdentifier())).append("\r\nDescription: ").append(spiSerialInfo.description()).append("\r\nSystem Location: ").append(spiSerialInfo.systemLocation()).append("\r\n\r\nAnd also download and run FT_PROG from the FTDI website, click 'Devices' -> 'Scan and Parse' and attach a screenshot of the utility."));
-                }
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_SERIAL_NUMBER_NOT_VALID);
-                return false;
-            }
-        }
-
-        //Open device in D2xx mode
-        ftsStatus = FT_OpenEx((void*)strFTDISerial.toStdString().c_str(), FT_OPEN_BY_SERIAL_NUMBER, &fthHandle);
-        if (ftsStatus == FT_OK)
-        {
-            //Opened successfully
-            char baTxBuffer;
-            DWORD unBytesWritten;
-
-            //Set a bit bang baud rate
-            ftsStatus = FT_SetBaudRate(fthHandle, FT_BAUD_1200);
-
-            //Enable syncronous bit bang mode
-            if (nType == ENTER_BOOTLOADER_BL654_USB)
-            {
-                ftsStatus = FT_SetBitMode(fthHandle, (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_BL654_AUTORUN_DIO), FT_BITMODE_ASYNC_BITBANG);
-            }
-            else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-            {
-                ftsStatus = FT_SetBitMode(fthHandle, (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_PINNACLE100_ENTER_BL_DIO | FTDI_USB_NRESET_DIO), FT_BITMODE_ASYNC_BITBANG);
-            }
-
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to set bitbang mode
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED);
-                return false;
-            }
-
-            //Disable autorun
-            if (nType == ENTER_BOOTLOADER_BL654_USB)
-            {
-                baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-            {
-                baTxBuffer = FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            ftsStatus = FT_Write(fthHandle, &baTxBuffer, sizeof(baTxBuffer), &unBytesWritten);
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to write data to port
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-                return false;
-            }
-            Sleep(FTDI_USB_RESET_DELAY_WINDOWS_MS);
-
-            //Reset module
-            if (nType == ENTER_BOOTLOADER_BL654_USB)
-            {
-                baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-            {
-                baTxBuffer = FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            ftsStatus = FT_Write(fthHandle, &baTxBuffer, sizeof(baTxBuffer), &unBytesWritten);
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to write data to port
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-                return false;
-            }
-            Sleep(FTDI_USB_RESET_DELAY_WINDOWS_MS);
-
-            //Stay out of autorun
-            if (nType == ENTER_BOOTLOADER_BL654_USB)
-            {
-                baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-            {
-                baTxBuffer = FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-            }
-            ftsStatus = FT_Write(fthHandle, &baTxBuffer, sizeof(baTxBuffer), &unBytesWritten);
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to write data to port
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-                return false;
-            }
-            Sleep(FTDI_USB_RESET_DELAY_WINDOWS_MS);
-
-            //Exit bit bang mode
-            ftsStatus = FT_SetBitMode(fthHandle, FTDI_LIBUSB_INTERFACE_NUMBER, FT_BITMODE_RESET);
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to reset port (disable bitbang)
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-                return false;
-            }
+        //Invalid or non-FTDI device
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_INVALID_DEVICE);
+        return false;
+    }
 
-            //Close direct FTDI access
-            ftsStatus = FT_Close(fthHandle);
-            if (ftsStatus != FT_OK)
-            {
-                //Failed to close port
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_CLOSE_FAILED);
-                return false;
-            }
-        }
-        else
+    //Valid FTDI device, proceed
+    if (bSkipWarning == false)
+    {
+        if (Prompt(ENTER_BOOTLOADER_PROMPT_QUESTION, "Continue?", QString("This feature allows automatically entering the bootloader on certain modules, please be sure that you have selected the correct device before continuing as using it with the wrong device may cause unforeseen issues and potential hardware damage which Laird Connectivity claims no responsibility and accepts no liability for.\r\n\r\nAre you sure ").append(strSerialPort).append(" is the correct port and '").append(spiSerialInfo.description()).append("' (").append(spiSerialInfo.manufacturer()).append(") [").append(spiSerialInfo.serialNumber()).append("] the correct description for your device?")) == false)
         {
-            //Failed to open device
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED);
+            //Cancel operation
+            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_CANCELLED);
             return false;
         }
     }
-    else
+
+    //Check that the serial number is valid
+    QString strFTDISerial = spiSerialInfo.serialNumber().left(FTDI_DEVICE_SERIAL_NUMBER_SIZE);
+    if ((strFTDIOverride.isNull() || strFTDIOverride.isEmpty()) && IsValidSerial(&strFTDISerial) == false)
     {
-        //Invalid or non-FTDI device
-        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_INVALID_DEVICE);
+        //Serial number is not valid
+        if (bSkipError == false)
+        {
+            Prompt(ENTER_BOOTLOADER_PROMPT_ERROR, "Error retrieving FTDI serial number", QString("There was an error retrieving the serial number for your FTDI device, please open a bug report on the UwFlashX github page (link can be clicked from the 'About' tab) and provide the following details:\r\n\r\nPort: ").append(strSerialPort).append("\r\nManufacturer: ").append(spiSerialInfo.manufacturer()).append("\r\nFull serial number: ").append(spiSerialInfo.serialNumber()).append("\r\nTrucated serial number: ").append(strFTDISerial).append("\r\nVendor ID: ").append(QString::number(spiSerialInfo.vendorIdentifier())).append("\r\nProduct ID: ").append(QString::number(spiSerialInfo.productIdentifier())).append("\r\nDescription: ").append(spiSerialInfo.description()).append("\r\nSystem Location: ").append(spiSerialInfo.systemLocation()).append("\r\n\r\nAnd also download and run FT_PROG from the FTDI website, click 'Devices' -> 'Scan and Parse' and attach a screenshot of the utility."));
+        }
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_SERIAL_NUMBER_NOT_VALID);
         return false;
     }
+
+    return true;
 #else
     //Windows, MinGW (or other) build
+    Q_UNUSED(strSerialPort);
+    Q_UNUSED(strFTDIOverride);
+    Q_UNUSED(bSkipWarning);
     if (bSkipError == false)
     {
-        QMessageBox::information(NULL, "MinGW builds not supported", "Due to FTDI drivers only being provided for visual studio, MinGW builds of UwFlashX are unable to use this functionality, please either use a MSVC version of UwFlashX or build the application manually from source using visual studio.", QMessageBox::Ok);
+        Prompt(ENTER_BOOTLOADER_PROMPT_INFORMATION, "MinGW builds not supported", "Due to FTDI drivers only being provided for visual studio, MinGW builds of UwFlashX are unable to use this functionality, please either use a MSVC version of UwFlashX or build the application manually from source using visual studio.");
     }
     emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_WRONG_COMPILER);
     return false;
 #endif
 #else
     //Linux
+    Q_UNUSED(strFTDIOverride);
+    Q_UNUSED(bSkipError);
     QSerialPortInfo spiSerialInfo(strSerialPort);
-    QString strOldSerialPortSerialNumber;
-    if (!spiSerialInfo.isNull() && spiSerialInfo.manufacturer().indexOf(FTDI_MANUFACTURER_NAME) != -1)
+    if (spiSerialInfo.isNull() || spiSerialInfo.manufacturer().indexOf(FTDI_MANUFACTURER_NAME) == -1)
+    {
+        //Invalid or non-FTDI device
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_INVALID_DEVICE);
+        return false;
+    }
+
+    if (bSkipWarning == false)
     {
         //Valid FTDI device, proceed
-        if (bSkipWarning == false)
+        if (Prompt(ENTER_BOOTLOADER_PROMPT_QUESTION, "Continue?", QString("This feature allows automatically entering the bootloader on certain modules, please be sure that you have selected the correct device before continuing as using it with the wrong device may cause unforeseen issues and potential hardware damage which Laird Connectivity claims no responsibility and accepts no liability for.\r\n\r\nAre you sure ").append(strSerialPort).append(" is the correct port and '").append(QString(spiSerialInfo.description()).append("' (").append(spiSerialInfo.manufacturer()).append(") [").append(spiSerialInfo.serialNumber()).append("] the correct description for your device?\r\n\r\nNote that you require libftdi and libusb (version 1.0) for this to work."))) == false)
         {
-            if (QMessageBox::question(NULL, "Continue?", QString("This feature allows automatically entering the bootloader on certain modules, please be sure that you have selected the correct device before continuing as using it with the wrong device may cause unforeseen issues and potential hardware damage which Laird Connectivity claims no responsibility and accepts no liability for.\r\n\r\nAre you sure ").append(strSerialPort).append(" is the correct port and '").append(QString(spiSerialInfo.description()).append("' (").append(spiSerialInfo.manufacturer()).append(") [").append(spiSerialInfo.serialNumber()).append("] the correct description for your device?\r\n\r\nNote that you require libftdi and libusb (version 1.0) for this to work.")), QMessageBox::Yes, QMessageBox::No) != QMessageBox::Yes)
-            {
-                //Cancel operation
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_CANCELLED);
-                return false;
-            }
+            //Cancel operation
+            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_CANCELLED);
+            return false;
         }
 
-        //Exit autorun mode
-        strOldSerialPortSerialNumber = spiSerialInfo.serialNumber();
-        struct ftdi_context *ftContext;
-        int nStatus = 0;
-        unsigned char baTxBuffer;
-        libusb_context *usbContext = NULL;
-        libusb_device **usbdDevice = NULL;
-        ssize_t nDevicesFound = 0;
-        unsigned char strSerialNumber[FTDI_DEVICE_SERIAL_NUMBER_MAX_SIZE];
-
-        if (bSkipWarning == false)
+        //Show setup warning message
+        bool bStopProcess = false;
+        pSettingsHandle->OpenPersistentConfig(APP_NAME);
+        QVariant varShowNonRootWarning = pSettingsHandle->GetPersistentConfigOption("LinuxShownNonRootUSBWarning", false);
+        if (varShowNonRootWarning.isNull() || varShowNonRootWarning == false)
         {
-            //Show setup warning message
-            bool bStopProcess = false;
-            pSettingsHandle->OpenPersistentConfig(APP_NAME);
-            QVariant varShowNonRootWarning = pSettingsHandle->GetPersistentConfigOption("LinuxShownNonRootUSBWarning", false);
-            if (varShowNonRootWarning.isNull() || varShowNonRootWarning == false)
+            //Show warning
+            if (Prompt(ENTER_BOOTLOADER_PROMPT_WARNING, "Confirm Linux Setup", "Have you followed the instructions on the UwTerminalX wiki page for setting up udev rules for USB devices for non-root users? Without this setup stage being completed, the process for exiting autorun may fail.\r\n\r\nClick 'no' to be taken to the UwTerminalX Linux setup wiki page. This message will only be displayed once.") == false)
             {
-                //Show warning
-                if (QMessageBox::warning(NULL, "Confirm Linux Setup", "Have you followed the instructions on the UwTerminalX wiki page for setting up udev rules for USB devices for non-root users? Without this setup stage being completed, the process for exiting autorun may fail.\r\n\r\nClick 'no' to be taken to the UwTerminalX Linux setup wiki page. This message will only be displayed once.", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+                //Open web page with Linux non-root user setup instructions
+                bStopProcess = true;
+                pSettingsHandle->SetPersistentConfigOption("LinuxShownNonRootUSBWarning", true);
+                if (QDesktopServices::openUrl(QUrl(gstrURLLinuxNonRootSetup)) == false)
                 {
-                    //Open web page with Linux non-root user setup instructions
-                    bStopProcess = true;
-                    pSettingsHandle->SetPersistentConfigOption("LinuxShownNonRootUSBWarning", true);
-                    if (QDesktopServices::openUrl(QUrl(gstrURLLinuxNonRootSetup)) == false)
-                    {
-                        //Failed to open URL
-                        QMessageBox::critical(NULL, "Failed to open URL", QString("An error occured whilst attempting to open a web browser, please ensure you have a web browser installed and configured. URL: ").append(gstrURLLinuxNonRootSetup), QMessageBox::Ok);
-                    }
+                    //Failed to open URL
+                    Prompt(ENTER_BOOTLOADER_PROMPT_ERROR, "Failed to open URL", QString("An error occured whilst attempting to open a web browser, please ensure you have a web browser installed and configured. URL: ").append(gstrURLLinuxNonRootSetup));
                 }
             }
-            pSettingsHandle->ClosePersistentConfig();
-
-            if (bStopProcess == true)
-            {
-                //Prevent opening the port until the user has configured their system
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_SETUP_REQUIRED);
-                return false;
-            }
         }
+        pSettingsHandle->ClosePersistentConfig();
 
-        if ((ftContext = ftdi_new()) == NULL)
+        if (bStopProcess == true)
         {
-            //Failed to initialise libftdi
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_LIBFTDI_INIT_FAILED);
+            //Prevent opening the port until the user has configured their system
+            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_SETUP_REQUIRED);
             return false;
         }
+    }
 
-        //Check that the serial number is valid
-        QString strFTDISerial = spiSerialInfo.serialNumber().left(FTDI_DEVICE_SERIAL_NUMBER_SIZE);
-        if (!strFTDIOverride.isNull() && !strFTDIOverride.isEmpty())
-        {
-            //User provided FTDI ID over-ride
-            strFTDISerial = strFTDIOverride;
-        }
-
-        //Open the serial device
-        nStatus = ftdi_usb_open_desc(ftContext, FTDI_DEVICE_VENDOR_ID, FTDI_DEVICE_PRODUCT_ID, NULL, strFTDISerial.toStdString().c_str());
+    return true;
+#endif
+}
 
-        if (nStatus < LIBFTDI_ERROR_CODE_USB_OPEN_DESC_SUCCESS && nStatus != LIBFTDI_ERROR_CODE_USB_OPEN_DESC_UNABLE_TO_CLAIM)
-        {
-            //Failed to open FTDI device
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED);
-            return false;
-        }
+//=============================================================================
+// Starts entering bootloader mode on the target module via FTDI
+// functionality. The sequence is driven by a timer so does not block, and
+// EnterBootloaderFinished is emitted when it completes if this returns true
+//=============================================================================
+bool
+LrdFwBlEnter::StartEnterBootloader(
+    uint8_t nType,
+    QString strSerialPort,
+    QString strFTDIOverride
+    )
+{
+    if (nType != ENTER_BOOTLOADER_BL654_USB && nType != ENTER_BOOTLOADER_PINNACLE100)
+    {
+        //Invalid type specified
+        return false;
+    }
 
-        //Enable bitbang mode
-        if (nType == ENTER_BOOTLOADER_BL654_USB)
-        {
-            nStatus = ftdi_set_bitmode(ftContext, (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_BL654_AUTORUN_DIO), BITMODE_BITBANG);
-        }
-        else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-        {
-            nStatus = ftdi_set_bitmode(ftContext, (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_PINNACLE100_ENTER_BL_DIO | FTDI_USB_NRESET_DIO), BITMODE_BITBANG);
-        }
+    if (tmrStepTimer != NULL)
+    {
+        //Entrance sequence is already running
+        return false;
+    }
 
-        if (nStatus != LIBFTDI_ERROR_CODE_SET_BITMODE_SUCCESS)
-        {
-            //Failed to set bitbang mode
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED);
-            return false;
-        }
+#if defined(_WIN32) && !defined(_MSC_VER)
+    //Windows, MinGW (or other) build
+    Q_UNUSED(strSerialPort);
+    Q_UNUSED(strFTDIOverride);
+    emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_WRONG_COMPILER);
+    return false;
+#else
+    QSerialPortInfo spiSerialInfo(strSerialPort);
+    if (spiSerialInfo.isNull() || spiSerialInfo.manufacturer().indexOf(FTDI_MANUFACTURER_NAME) == -1)
+    {
+        //Invalid or non-FTDI device
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_INVALID_DEVICE);
+        return false;
+    }
 
-        //Set writes to 1 byte chunks
-        nStatus = ftdi_write_data_set_chunksize(ftContext, sizeof(baTxBuffer));
-        if (nStatus != LIBFTDI_ERROR_CODE_SET_CHUNKSIZE_SUCCESS)
-        {
-            //Failed to set chunk size
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_CHUNK_SIZE_SET_FAILED);
-            return false;
-        }
+    nEntranceType = nType;
+    strEntrancePort = strSerialPort;
+    strEntrancePortSerial = spiSerialInfo.serialNumber();
+    strEntranceFTDISerial = spiSerialInfo.serialNumber().left(FTDI_DEVICE_SERIAL_NUMBER_SIZE);
+    if (!strFTDIOverride.isNull() && !strFTDIOverride.isEmpty())
+    {
+        //User provided FTDI ID over-ride
+        strEntranceFTDISerial = strFTDIOverride;
+    }
+#ifdef _WIN32
+    else if (IsValidSerial(&strEntranceFTDISerial) == false)
+    {
+        //Serial number is not valid
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_SERIAL_NUMBER_NOT_VALID);
+        return false;
+    }
+#endif
 
-        //Disable autorun
-        if (nType == ENTER_BOOTLOADER_BL654_USB)
-        {
-            baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-        }
-        else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-        {
-            baTxBuffer = FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-        }
-        nStatus = ftdi_write_data(ftContext, &baTxBuffer, sizeof(baTxBuffer));
-        if (nStatus <= LIBFTDI_ERROR_CODE_WRITE_DATA_USB_BULK_WRITE_ERROR)
+    //Open the device and disable autorun
+    int32_t nStatus = OpenEntranceDevice();
+    if (nStatus == EXIT_CODE_SUCCESS)
+    {
+        nEntranceStep = ENTER_BOOTLOADER_STEP_DISABLE_AUTORUN;
+        if (WriteEntrancePins(EntrancePins(nEntranceStep)) == false)
         {
             //Failed to write data
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-            return false;
+            nStatus = EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED;
         }
-        usleep(FTDI_USB_RESET_DELAY_LINUX_US);
+    }
 
-        //Reset module
-        if (nType == ENTER_BOOTLOADER_BL654_USB)
-        {
-            baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-        }
-        else if (nType == ENTER_BOOTLOADER_PINNACLE100)
-        {
-            baTxBuffer = FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
-        }
-        nStatus = ftdi_write_data(ftContext, &baTxBuffer, sizeof(baTxBuffer));
-        if (nStatus <= LIBFTDI_ERROR_CODE_WRITE_DATA_USB_BULK_WRITE_ERROR)
-        {
-            //Failed to write data
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-            return false;
-        }
-        usleep(FTDI_USB_RESET_DELAY_LINUX_US);
+    if (nStatus != EXIT_CODE_SUCCESS)
+    {
+        CancelEnterBootloader();
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, nStatus);
+        return false;
+    }
+
+    //Each following step happens after the reset delay has elapsed
+    tmrStepTimer = new QTimer();
+    MallocFailCheck(tmrStepTimer);
+    tmrStepTimer->setInterval(FTDI_USB_RESET_DELAY_MS);
+    tmrStepTimer->setSingleShot(false);
+    connect(tmrStepTimer, SIGNAL(timeout()), this, SLOT(StepTimerTimeout()));
+    tmrStepTimer->start();
 
-        //Exit reset
-        if (nType == ENTER_BOOTLOADER_BL654_USB)
+    return true;
+#endif
+}
+
+//=============================================================================
+// Stops an entrance sequence which is in progress without emitting any
+// signals, the device is released
+//=============================================================================
+void
+LrdFwBlEnter::CancelEnterBootloader(
+    )
+{
+    if (tmrStepTimer != NULL)
+    {
+        //Clear up step timer
+        tmrStepTimer->stop();
+        disconnect(tmrStepTimer, SIGNAL(timeout()), this, SLOT(StepTimerTimeout()));
+        delete tmrStepTimer;
+        tmrStepTimer = NULL;
+    }
+
+    CloseEntranceDevice(false);
+    nEntranceStep = ENTER_BOOTLOADER_STEP_IDLE;
+}
+
+//=============================================================================
+// Callback when the delay for the current entrance step has elapsed
+//=============================================================================
+void
+LrdFwBlEnter::StepTimerTimeout(
+    )
+{
+    ++nEntranceStep;
+    if (nEntranceStep == ENTER_BOOTLOADER_STEP_RESET || nEntranceStep == ENTER_BOOTLOADER_STEP_EXIT_RESET)
+    {
+        //Reset the module or take it out of reset
+        if (WriteEntrancePins(EntrancePins(nEntranceStep)) == false)
         {
-            baTxBuffer = FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
+            //Failed to write data
+            FinishEntrance(EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
         }
-        else if (nType == ENTER_BOOTLOADER_PINNACLE100)
+    }
+    else if (nEntranceStep == ENTER_BOOTLOADER_STEP_RESTORE_DRIVER)
+    {
+        //Exit bitbang mode and give the device back to the UART driver
+        int32_t nStatus = CloseEntranceDevice(true);
+        if (nStatus == EXIT_CODE_SUCCESS)
         {
-            baTxBuffer = FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO;
+            nStatus = RestoreEntranceDriver();
         }
-        nStatus = ftdi_write_data(ftContext, &baTxBuffer, sizeof(baTxBuffer));
-        if (nStatus <= LIBFTDI_ERROR_CODE_WRITE_DATA_USB_BULK_WRITE_ERROR)
+
+#ifdef __linux__
+        if (nStatus != EXIT_CODE_SUCCESS)
         {
-            //Failed to write data
-            ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED);
-            return false;
+            FinishEntrance(nStatus);
         }
-        usleep(FTDI_USB_RESET_DELAY_LINUX_US);
+#else
+        FinishEntrance(nStatus);
+#endif
+    }
+    else
+    {
+        //Device has had time to reset
+        FinishEntrance(EXIT_CODE_SUCCESS);
+    }
+}
+
+//=============================================================================
+// Returns the pin states to output for a step of the entrance sequence
+//=============================================================================
+uint8_t
+LrdFwBlEnter::EntrancePins(
+    uint8_t nStep
+    )
+{
+    if (nStep == ENTER_BOOTLOADER_STEP_RESET)
+    {
+        //Module held in reset
+        return (nEntranceType == ENTER_BOOTLOADER_BL654_USB ? (FTDI_USB_BL654_VSP_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO) : (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO));
+    }
+
+    //Module out of reset with autorun disabled
+    return (nEntranceType == ENTER_BOOTLOADER_BL654_USB ? (FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO) : (FTDI_USB_NRESET_DIO | FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO));
+}
+
+//=============================================================================
+// Opens the FTDI device for the entrance sequence and enables bitbang mode
+//=============================================================================
+int32_t
+LrdFwBlEnter::OpenEntranceDevice(
+    )
+{
+    uint8_t nBitMask = (nEntranceType == ENTER_BOOTLOADER_BL654_USB ? (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_BL654_VSP_DIO | FTDI_USB_NRESET_DIO | FTDI_USB_BL654_AUTORUN_DIO) : (FTDI_USB_RX_DIO | FTDI_USB_RTS_DIO | FTDI_USB_PINNACLE100_ENTER_BL_DIO | FTDI_USB_NRESET_DIO));
+
+#if defined(_WIN32) && defined(_MSC_VER)
+    //Open device in D2xx mode
+    if (FT_OpenEx((void*)strEntranceFTDISerial.toStdString().c_str(), FT_OPEN_BY_SERIAL_NUMBER, &fthHandle) != FT_OK)
+    {
+        //Failed to open device
+        fthHandle = NULL;
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED;
+    }
 
-        //Exit bitbang mode
-        nStatus = ftdi_set_bitmode(ftContext, LIBFTDI_BITMODE_BITMASK_RESET, BITMODE_RESET);
-        if (nStatus != LIBFTDI_ERROR_CODE_SET_BITMODE_SUCCESS)
+    //Set a bit bang baud rate and enable asyncronous bit bang mode
+    FT_SetBaudRate(fthHandle, FT_BAUD_1200);
+    if (FT_SetBitMode(fthHandle, nBitMask, FT_BITMODE_ASYNC_BITBANG) != FT_OK)
+    {
+        //Failed to set bitbang mode
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED;
+    }
+#elif defined(__linux__)
+    int nStatus;
+    libusb_device *usbdDevice;
+
+    if (InitSharedContext() == false)
+    {
+        //libusb initialisation failed
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_LIBFTDI_INIT_FAILED;
+    }
+
+    usbdDevice = FindSharedDevice(strEntranceFTDISerial);
+    if (usbdDevice == NULL)
+    {
+        //Device was not found
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_DEVICE_NOT_FOUND;
+    }
+
+    ftContext = TakeFtdiContext();
+    if (ftContext == NULL)
+    {
+        //Failed to initialise libftdi
+        libusb_unref_device(usbdDevice);
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_LIBFTDI_INIT_FAILED;
+    }
+
+    //Open the serial device
+    nStatus = ftdi_usb_open_dev(ftContext, usbdDevice);
+    libusb_unref_device(usbdDevice);
+    if (nStatus < LIBFTDI_ERROR_CODE_USB_OPEN_DESC_SUCCESS)
+    {
+        //Failed to open FTDI device, libftdi will have closed it
+        ReturnFtdiContext(ftContext);
+        ftContext = NULL;
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED;
+    }
+
+    //Enable bitbang mode
+    if (ftdi_set_bitmode(ftContext, nBitMask, BITMODE_BITBANG) != LIBFTDI_ERROR_CODE_SET_BITMODE_SUCCESS)
+    {
+        //Failed to set bitbang mode
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED;
+    }
+
+    //Set writes to 1 byte chunks
+    if (ftdi_write_data_set_chunksize(ftContext, sizeof(uint8_t)) != LIBFTDI_ERROR_CODE_SET_CHUNKSIZE_SUCCESS)
+    {
+        //Failed to set chunk size
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_CHUNK_SIZE_SET_FAILED;
+    }
+#else
+    Q_UNUSED(nBitMask);
+    return EXIT_CODE_BOOTLOADER_ENTRANCE_WRONG_COMPILER;
+#endif
+
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Outputs pin states on the open FTDI device
+//=============================================================================
+bool
+LrdFwBlEnter::WriteEntrancePins(
+    uint8_t nPins
+    )
+{
+#if defined(_WIN32) && defined(_MSC_VER)
+    char baTxBuffer = (char)nPins;
+    DWORD unBytesWritten;
+
+    return (FT_Write(fthHandle, &baTxBuffer, sizeof(baTxBuffer), &unBytesWritten) == FT_OK);
+#elif defined(__linux__)
+    unsigned char baTxBuffer = nPins;
+
+    return (ftdi_write_data(ftContext, &baTxBuffer, sizeof(baTxBuffer)) > LIBFTDI_ERROR_CODE_WRITE_DATA_USB_BULK_WRITE_ERROR);
+#else
+    Q_UNUSED(nPins);
+    return false;
+#endif
+}
+
+//=============================================================================
+// Closes the FTDI device, if bGraceful is set then bitbang mode is exited
+// and the device is reset first
+//=============================================================================
+int32_t
+LrdFwBlEnter::CloseEntranceDevice(
+    bool bGraceful
+    )
+{
+    int32_t nResult = EXIT_CODE_SUCCESS;
+
+#if defined(_WIN32) && defined(_MSC_VER)
+    if (fthHandle == NULL)
+    {
+        return EXIT_CODE_SUCCESS;
+    }
+
+    if (bGraceful == true && FT_SetBitMode(fthHandle, FTDI_LIBUSB_INTERFACE_NUMBER, FT_BITMODE_RESET) != FT_OK)
+    {
+        //Failed to reset port (disable bitbang)
+        nResult = EXIT_CODE_BOOTLOADER_ENTRANCE_DATA_WRITE_FAILED;
+    }
+
+    //Close direct FTDI access
+    if (FT_Close(fthHandle) != FT_OK && nResult == EXIT_CODE_SUCCESS)
+    {
+        //Failed to close port
+        nResult = EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_CLOSE_FAILED;
+    }
+    fthHandle = NULL;
+#elif defined(__linux__)
+    if (ftContext == NULL)
+    {
+        return EXIT_CODE_SUCCESS;
+    }
+
+    if (bGraceful == true)
+    {
+        //Exit bitbang mode and reset the FTDI device
+        if (ftdi_set_bitmode(ftContext, LIBFTDI_BITMODE_BITMASK_RESET, BITMODE_RESET) != LIBFTDI_ERROR_CODE_SET_BITMODE_SUCCESS)
         {
             //Failed to reset bitbang mode
             ftdi_usb_reset(ftContext);
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED);
-            return false;
+            nResult = EXIT_CODE_BOOTLOADER_ENTRANCE_BITBANG_MODE_FAILED;
         }
-
-        //Reset the FTDI device
-        nStatus = ftdi_usb_reset(ftContext);
-        if (nStatus != LIBFTDI_ERROR_CODE_RESET_SUCCESS)
+        else if (ftdi_usb_reset(ftContext) != LIBFTDI_ERROR_CODE_RESET_SUCCESS)
         {
             //Failed to reset device
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_USB_RESET_FAILED);
-            return false;
-        }
-        nStatus = ftdi_usb_close(ftContext);
-        if (nStatus != LIBFTDI_ERROR_CODE_CLOSE_SUCCESS)
-        {
-            //Failed to close port
-            ftdi_free(ftContext);
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_CLOSE_FAILED);
-            return false;
+            nResult = EXIT_CODE_BOOTLOADER_ENTRANCE_USB_RESET_FAILED;
         }
+    }
+    else
+    {
+        //Sequence was aborted
+        ftdi_usb_reset(ftContext);
+    }
 
-        //Free the FTDI context
-        ftdi_free(ftContext);
+    if (ftdi_usb_close(ftContext) != LIBFTDI_ERROR_CODE_CLOSE_SUCCESS && nResult == EXIT_CODE_SUCCESS)
+    {
+        //Failed to close port
+        nResult = EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_CLOSE_FAILED;
+    }
 
-        //Initialise libusb to reset driver
-        nStatus = libusb_init(&usbContext);
-        if (nStatus != LIBUSB_SUCCESS)
-        {
-            //libusb initialisation failed
-            emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_LIBFTDI_INIT_FAILED);
-            return false;
-        }
+    //Keep the context for the next entrance sequence
+    ReturnFtdiContext(ftContext);
+    ftContext = NULL;
+#else
+    Q_UNUSED(bGraceful);
+#endif
 
-        //Search for the target device
-        nDevicesFound = libusb_get_device_list(usbContext, &usbdDevice);
-        for (ssize_t idx = 0; idx < nDevicesFound; ++idx)
-        {
-            libusb_device *device = usbdDevice[idx];
-            struct libusb_device_descriptor desc;
+    return nResult;
+}
 
-            nStatus = libusb_get_device_descriptor(device, &desc);
-            if (nStatus != LIBUSB_SUCCESS)
-            {
-                //Failed to get device descriptor
-                emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DEVICE_DESCRIPTOR_FETCH_FAILED);
-                return false;
-            }
+//=============================================================================
+// Hands the FTDI device back to the kernel UART driver (Linux only)
+//=============================================================================
+int32_t
+LrdFwBlEnter::RestoreEntranceDriver(
+    )
+{
+#ifdef __linux__
+    libusb_device *usbdDevice = FindSharedDevice(strEntranceFTDISerial);
+    libusb_device_handle *handle = NULL;
+    int nStatus;
 
-            //Check device is an FTDI adapter
-            if (desc.idVendor == FTDI_DEVICE_VENDOR_ID && desc.idProduct == FTDI_DEVICE_PRODUCT_ID)
-            {
-                //FTDI device, check serial number
-                libusb_device_handle *handle = NULL;
-                nStatus = libusb_open(device, &handle);
-                if (nStatus != LIBUSB_SUCCESS)
-                {
-                    //Failed to open USB device
-                    libusb_exit(usbContext);
-                    emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED);
-                    return false;
-                }
+    if (usbdDevice == NULL)
+    {
+        //Device was not found
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_DEVICE_NOT_FOUND;
+    }
 
-                nStatus = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, strSerialNumber, sizeof(strSerialNumber)-1);
-                if (nStatus < LIBUSB_SUCCESS)
-                {
-                    libusb_close(handle);
-                    libusb_exit(usbContext);
-                    emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_STRING_DESCRIPTOR_FAILED);
-                    return false;
-                }
+    nStatus = libusb_open(usbdDevice, &handle);
+    libusb_unref_device(usbdDevice);
+    if (nStatus != LIBUSB_SUCCESS)
+    {
+        //Failed to open USB device
+        return EXIT_CODE_BOOTLOADER_ENTRANCE_PORT_OPEN_FAILED;
+    }
 
-                if (strcmp((char *)strSerialNumber, (char *)strFTDISerial.toStdString().c_str()) == 0)
-                {
-                    //Found the USB device
-                    if (libusb_kernel_driver_active(handle, FTDI_LIBUSB_INTERFACE_NUMBER))
-                    {
-                        //Relinquish FTDI bitbang driver
-                        nStatus = libusb_detach_kernel_driver(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
-                    }
-                    nStatus = libusb_claim_interface(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
-                    nStatus = libusb_release_interface(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
-
-                    //Revert to default (UART) driver
-                    nStatus = libusb_attach_kernel_driver(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
-
-                    //Clean up and finish
-                    libusb_close(handle);
-                    libusb_exit(usbContext);
-
-                    if (pNewSerialPort != NULL)
-                    {
-                        //Return the new serial port name as it might be different from the orignal if devices have been reordered or plugged in/out during the process
-                        foreach (const QSerialPortInfo &info, QSerialPortInfo::availablePorts())
-                        {
-                            if (info.serialNumber() == strOldSerialPortSerialNumber)
-                            {
-                                *pNewSerialPort = info.portName();
-                            }
-                        }
-                    }
-
-                    //Wait for device to reset
-                    usleep(FTDI_USB_RESET_DELAY_LINUX_US);
-
-                    //Finished
-                    return true;
-                }
+    if (libusb_kernel_driver_active(handle, FTDI_LIBUSB_INTERFACE_NUMBER))
+    {
+        //Relinquish FTDI bitbang driver
+        libusb_detach_kernel_driver(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
+    }
+    libusb_claim_interface(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
+    libusb_release_interface(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
+
+    //Revert to default (UART) driver
+    libusb_attach_kernel_driver(handle, FTDI_LIBUSB_INTERFACE_NUMBER);
+    libusb_close(handle);
+#endif
 
-                //Close device
-                libusb_close(handle);
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Ends the entrance sequence and notifies the owner of the result
+//=============================================================================
+void
+LrdFwBlEnter::FinishEntrance(
+    int32_t nErrorCode
+    )
+{
+    QString strNewSerialPort;
+
+    CancelEnterBootloader();
+
+#ifdef __linux__
+    if (nErrorCode == EXIT_CODE_SUCCESS)
+    {
+        //Return the new serial port name as it might be different from the orignal if devices have been reordered or plugged in/out during the process
+        foreach (const QSerialPortInfo &info, QSerialPortInfo::availablePorts())
+        {
+            if (info.serialNumber() == strEntrancePortSerial)
+            {
+                strNewSerialPort = info.portName();
             }
         }
-
-        //Device was not found
-        libusb_exit(usbContext);
-        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_DEVICE_NOT_FOUND);
-        return false;
     }
-    else
+#endif
+
+    if (nErrorCode != EXIT_CODE_SUCCESS)
     {
-        //Invalid or non-FTDI device
-        emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_INVALID_DEVICE);
-        return false;
+        emit Error(MODULE_BOOTLOADER_ENTRANCE, nErrorCode);
     }
-#endif
+    emit EnterBootloaderFinished((nErrorCode == EXIT_CODE_SUCCESS), strNewSerialPort);
+}
+#else
+//=============================================================================
+// FTDI functionality has not been compiled in
+//=============================================================================
+bool
+LrdFwBlEnter::ConfirmEnterBootloader(
+    uint8_t,
+    QString,
+    QString,
+    bool,
+    bool
+    )
+{
     return true;
 }
+
+bool
+LrdFwBlEnter::StartEnterBootloader(
+    uint8_t,
+    QString,
+    QString
+    )
+{
+    emit Error(MODULE_BOOTLOADER_ENTRANCE, EXIT_CODE_BOOTLOADER_ENTRANCE_NOT_SUPPORTED);
+    return false;
+}
+
+void
+LrdFwBlEnter::CancelEnterBootloader(
+    )
+{
+}
+
+void
+LrdFwBlEnter::StepTimerTimeout(
+    )
+{
+}
 #endif
 
 #endif
@@ -28,7 +28,8 @@
 // Include Files
 /******************************************************************************/
 #include <QObject>
-#include <QMessageBox>
+#include <QTimer>
+#include <QMutex>
 #include "LrdFwCommon.h"
 #include "LrdSettings.h"
 #if !defined(TARGET_OS_MAC)
@@ -59,6 +60,25 @@ enum ENTER_BOOTLOADER_TYPES
     ENTER_BOOTLOADER_PINNACLE100
 };
 
+//Types of message shown to the user by the bootloader entrance checks
+enum ENTER_BOOTLOADER_PROMPT_TYPES
+{
+    ENTER_BOOTLOADER_PROMPT_QUESTION,     //Yes/no question, accepted if yes
+    ENTER_BOOTLOADER_PROMPT_WARNING,      //Yes/no warning, accepted if yes
+    ENTER_BOOTLOADER_PROMPT_ERROR,        //Error message
+    ENTER_BOOTLOADER_PROMPT_INFORMATION   //Information message
+};
+
+enum ENTER_BOOTLOADER_STEPS
+{
+    ENTER_BOOTLOADER_STEP_IDLE,
+    ENTER_BOOTLOADER_STEP_DISABLE_AUTORUN,
+    ENTER_BOOTLOADER_STEP_RESET,
+    ENTER_BOOTLOADER_STEP_EXIT_RESET,
+    ENTER_BOOTLOADER_STEP_RESTORE_DRIVER,
+    ENTER_BOOTLOADER_STEP_WAIT_FOR_PORT
+};
+
 /******************************************************************************/
 // Constants
 /******************************************************************************/
@@ -71,8 +91,7 @@ const uint8_t  FTDI_USB_NRESET_DIO
 const uint8_t  FTDI_USB_BL654_AUTORUN_DIO                                           = 128;
 const uint8_t  FTDI_USB_PINNACLE100_ENTER_BL_DIO                                    = 128;
 
-const uint32_t FTDI_USB_RESET_DELAY_WINDOWS_MS                                      = 400;     //Delay after completing reset in ms (Windows)
-const uint32_t FTDI_USB_RESET_DELAY_LINUX_US                                        = 400000;  //Delay after completing reset in us (Linux)
+const uint32_t FTDI_USB_RESET_DELAY_MS                                              = 400;     //Delay between each step of the entrance sequence in ms
 
 const uint16_t FTDI_DEVICE_VENDOR_ID                                                = 0x0403;
 const uint16_t FTDI_DEVICE_PRODUCT_ID                                               = 0x6001;
@@ -142,16 +161,25 @@ public:
         LrdSettings *pSettings
         );
     bool
-    EnterBootloader(
+    ConfirmEnterBootloader(
         uint8_t nType,
         QString strSerialPort,
         QString strFTDIOverride,
-#ifdef __linux__
-        QString *pNewSerialPort,
-#endif
         bool bSkipWarning,
         bool bSkipError
         );
+    bool
+    StartEnterBootloader(
+        uint8_t nType,
+        QString strSerialPort,
+        QString strFTDIOverride
+        );
+    void
+    CancelEnterBootloader(
+        );
+    bool
+    IsEnteringBootloader(
+        );
 
 signals:
     void
@@ -159,14 +187,72 @@ signals:
         uint32_t nModule,
         int32_t nErrorCode
         );
+    void
+    EnterBootloaderFinished(
+        bool bSuccess,
+        QString strNewSerialPort
+        );
+    void
+    UserPrompt(
+        uint8_t nType,
+        QString strTitle,
+        QString strMessage,
+        bool *pbAccepted
+        );
+
+private slots:
+    void
+    StepTimerTimeout(
+        );
 
 private:
     bool
+    Prompt(
+        uint8_t nType,
+        QString strTitle,
+        QString strMessage
+        );
+    bool
     IsValidSerial(
         QString *pSerial
         );
+    uint8_t
+    EntrancePins(
+        uint8_t nStep
+        );
+    int32_t
+    OpenEntranceDevice(
+        );
+    bool
+    WriteEntrancePins(
+        uint8_t nPins
+        );
+    int32_t
+    CloseEntranceDevice(
+        bool bGraceful
+        );
+    int32_t
+    RestoreEntranceDriver(
+        );
+    void
+    FinishEntrance(
+        int32_t nErrorCode
+        );
 
     LrdSettings *pSettingsHandle = NULL; //Contains the handle for the settings object
+    QTimer      *tmrStepTimer = NULL;    //Timer which advances the entrance sequence
+    uint8_t     nEntranceType;           //Bootloader entrance type in progress
+    uint8_t     nEntranceStep;           //Current step of the entrance sequence
+    QString     strEntrancePort;         //Serial port the entrance sequence is running on
+    QString     strEntrancePortSerial;   //USB serial number of the serial port (used to find it again after the USB reset)
+    QString     strEntranceFTDISerial;   //FTDI serial number used to open the device
+#if !defined(SKIPFTDI)
+#if defined(_WIN32) && defined(_MSC_VER)
+    FT_HANDLE   fthHandle = NULL;        //D2XX handle of the open device
+#elif defined(__linux__)
+    struct ftdi_context *ftContext = NULL; //Pooled libftdi context of the open device
+#endif
+#endif
 };
 
 #endif
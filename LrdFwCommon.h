@@ -176,9 +176,24 @@ enum MODULES
 enum EXIT_CODES
 {
     //Always leave this element here and decrement it when a new error code is added
-    EXIT_CODE_BOTTOM_COUNT = -46,
+    EXIT_CODE_BOTTOM_COUNT = -61,
 
     //Add new error codes below here at the top
+    EXIT_CODE_SESSION_START_FAILED,
+    EXIT_CODE_BENCHMARK_OUTPUT_FAILED,
+    EXIT_CODE_DRY_RUN_PARAMETER_INVALID,
+    EXIT_CODE_REPLAY_MISMATCH,
+    EXIT_CODE_SERIAL_PORT_TRANSMIT_STALLED,
+    EXIT_CODE_DAEMON_JOB_NOT_VALID,
+    EXIT_CODE_DAEMON_LISTEN_FAILED,
+    EXIT_CODE_SESSION_ALREADY_ACTIVE,
+    EXIT_CODE_LIBRARY_NOT_INITIALISED,
+    EXIT_CODE_INVALID_SETTINGS_NAME,
+    EXIT_CODE_READBACK_COMPARE_FAILED,
+    EXIT_CODE_READBACK_RANGE_NOT_VALID,
+    EXIT_CODE_READBACK_FILE_FAILED,
+    EXIT_CODE_BOOTLOADER_READ_NOT_SUPPORTED,
+    EXIT_CODE_JOB_MANIFEST_NOT_VALID,
     EXIT_CODE_ERASE_SECTOR_MAPPING_NOT_FOUND,
     EXIT_CODE_BOOTLOADER_UNLOCK_KEY_INVALID_SIZE,
     EXIT_CODE_BOOTLOADER_ENTRANCE_STRING_DESCRIPTOR_FAILED,
@@ -234,6 +249,21 @@ COMPILE_ASSERT(EXIT_CODE_SUCCESS == 0);
 //EXIT_CODE_BOTTOM_COUNT is not part of this list and neither is EXIT_CODE_ERROR_CODE_BASE
 //The last description should be for EXIT_CODE_SUCCESS, this list is in descending order
 static QString pErrorStrings[] = {
+    "Update session failed to start",
+    "Benchmark results could not be written",
+    "Dry run parameter is not valid",
+    "Data transmitted does not match the replayed capture",
+    "Serial port transmit stalled",
+    "Daemon job is not valid",
+    "Failed to listen on daemon socket",
+    "Session is already active",
+    "Library has not been initialised",
+    "Invalid setting name",
+    "Data read back from module does not match upgrade file",
+    "Readback address range is not valid",
+    "Failed to open or write to readback file",
+    "Bootloader does not support reading flash",
+    "Job manifest file is not valid",
     "A sector mapping was not found when attempting to erase sector data",
     "Specified bootloader unlock key length is not valid",
     "USB get string descriptor failed",
@@ -288,6 +318,9 @@ COMPILE_ASSERT((sizeof(pErrorStrings)/sizeof(pErrorStrings[0])) == (-EXIT_CODE_B
 // Defines
 /******************************************************************************/
 
+//Application and library version
+#define APP_VERSION                                   "1.02"
+
 //Verbosity levels
 #define VERBOSITY_NONE                                0
 #define VERBOSITY_MODES                               1
@@ -299,6 +332,7 @@ COMPILE_ASSERT((sizeof(pErrorStrings)/sizeof(pErrorStrings[0])) == (-EXIT_CODE_B
 #define FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET      1
 #define FUNCTION_RETURN_CODE_INVALID_LENGTH           -2
 #define FUNCTION_RETURN_CODE_SECTOR_MAPPING_NOT_FOUND -3
+#define FUNCTION_RETURN_CODE_DEVICE_NOT_REGISTERED    -4
 
 //The period in ms in which a command is considered timed out
 #define COMMAND_TIMEOUT_PERIOD_MS                     2000
@@ -318,10 +352,10 @@ COMPILE_ASSERT((sizeof(pErrorStrings)/sizeof(pErrorStrings[0])) == (-EXIT_CODE_B
 //Period used for delayed exit timer in ms
 #define DELAYED_EXIT_TIME_MS                          5
 
-//Maximum size of a valid uwf file, 16MB
-#define UWF_FILE_MAX_SIZE_BYTES                       16777216
+//Number of bytes in a MB, used for the maximum uwf file size setting
+#define UWF_FILE_SIZE_MB_BYTES                        1048576
 
-//Maximum size of a single packet, 10MB
+//Maximum size of a single packet other than a write (which is streamed), 10MB
 #define UWF_FILE_MAX_PACKET_SIZE_BYTES                10485760
 
 //BREAK on time used when optionally resetting a module
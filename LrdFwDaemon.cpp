@@ -0,0 +1,539 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwDaemon.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwDaemon.h"
+#include <QJsonDocument>
+#include <QJsonValue>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwDaemon::LrdFwDaemon(
+    QObject *parent
+    ) : QObject(parent)
+{
+    pServer = new QLocalServer();
+    MallocFailCheck(pServer);
+    connect(pServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+
+    pImageCache = new LrdFwImageCache();
+    MallocFailCheck(pImageCache);
+
+    pErrHandler = new LrdErr();
+    MallocFailCheck(pErrHandler);
+
+    nJobsSucceeded = 0;
+    nJobsFailed = 0;
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwDaemon::~LrdFwDaemon(
+    )
+{
+    disconnect(this, SLOT(NewConnection()));
+    pServer->close();
+
+    QMap<QString, DaemonPortStruct *>::iterator itPort = mapPorts.begin();
+    while (itPort != mapPorts.end())
+    {
+        //Sessions use the image cache so must be removed first
+        delete itPort.value()->pSession;
+        delete itPort.value();
+        ++itPort;
+    }
+    mapPorts.clear();
+
+    delete pServer;
+    delete pImageCache;
+    delete pErrHandler;
+}
+
+//=============================================================================
+// Starts listening for clients, any stale socket with the same name is removed
+//=============================================================================
+bool
+LrdFwDaemon::Listen(
+    QString strName
+    )
+{
+    QLocalServer::removeServer(strName);
+    return pServer->listen(strName);
+}
+
+//=============================================================================
+// Slot for a new client connection
+//=============================================================================
+void
+LrdFwDaemon::NewConnection(
+    )
+{
+    while (pServer->hasPendingConnections())
+    {
+        QLocalSocket *pClient = pServer->nextPendingConnection();
+        connect(pClient, SIGNAL(readyRead()), this, SLOT(ClientReadyRead()));
+        connect(pClient, SIGNAL(disconnected()), this, SLOT(ClientDisconnected()));
+        mapClientBuffers.insert(pClient, QByteArray());
+    }
+}
+
+//=============================================================================
+// Slot for data from a client, requests are newline terminated
+//=============================================================================
+void
+LrdFwDaemon::ClientReadyRead(
+    )
+{
+    QLocalSocket *pClient = qobject_cast<QLocalSocket *>(sender());
+    if (pClient == NULL || !mapClientBuffers.contains(pClient))
+    {
+        return;
+    }
+
+    mapClientBuffers[pClient].append(pClient->readAll());
+    qsizetype nNewline = mapClientBuffers[pClient].indexOf('\n');
+    while (nNewline >= 0)
+    {
+        QByteArray baRequest = mapClientBuffers[pClient].left(nNewline);
+        mapClientBuffers[pClient].remove(0, nNewline + 1);
+        ProcessRequest(pClient, baRequest.trimmed());
+        nNewline = mapClientBuffers[pClient].indexOf('\n');
+    }
+
+    if (mapClientBuffers[pClient].length() > DAEMON_MAX_REQUEST_LENGTH)
+    {
+        //Request is too long, drop the client
+        pClient->disconnectFromServer();
+    }
+}
+
+//=============================================================================
+// Slot for a client disconnecting, jobs it queued which have not started are
+// discarded and the job it is running stops reporting to it
+//=============================================================================
+void
+LrdFwDaemon::ClientDisconnected(
+    )
+{
+    QLocalSocket *pClient = qobject_cast<QLocalSocket *>(sender());
+    if (pClient == NULL)
+    {
+        return;
+    }
+
+    QMap<QString, DaemonPortStruct *>::iterator itPort = mapPorts.begin();
+    while (itPort != mapPorts.end())
+    {
+        if (itPort.value()->sActiveJob.pClient == pClient)
+        {
+            //The running job carries on but has nobody to report to
+            itPort.value()->sActiveJob.pClient = nullptr;
+        }
+
+        qsizetype i = itPort.value()->lstQueue.count() - 1;
+        while (i >= 0)
+        {
+            if (itPort.value()->lstQueue.at(i).pClient == pClient)
+            {
+                itPort.value()->lstQueue.removeAt(i);
+            }
+            --i;
+        }
+        ++itPort;
+    }
+
+    mapClientBuffers.remove(pClient);
+    pClient->deleteLater();
+}
+
+//=============================================================================
+// Handles a single request from a client
+//=============================================================================
+void
+LrdFwDaemon::ProcessRequest(
+    QLocalSocket *pClient,
+    QByteArray baRequest
+    )
+{
+    if (baRequest.isEmpty())
+    {
+        return;
+    }
+
+    QJsonParseError jpeError;
+    QJsonDocument jdRequest = QJsonDocument::fromJson(baRequest, &jpeError);
+    if (jpeError.error != QJsonParseError::NoError || !jdRequest.isObject())
+    {
+        //Not a JSON object
+        QJsonObject jsoResponse;
+        jsoResponse["event"] = "rejected";
+        jsoResponse["error"] = EXIT_CODE_DAEMON_JOB_NOT_VALID;
+        jsoResponse["errorString"] = QString("Request is not a JSON object: ").append(jpeError.errorString());
+        SendMessage(pClient, jsoResponse);
+        return;
+    }
+
+    QJsonObject jsoRequest = jdRequest.object();
+    QString strCommand = jsoRequest.value("command").toString("job");
+    if (strCommand == "status")
+    {
+        //Daemon status
+        qsizetype nActive = 0;
+        qsizetype nQueued = 0;
+        QMap<QString, DaemonPortStruct *>::const_iterator itPort = mapPorts.constBegin();
+        while (itPort != mapPorts.constEnd())
+        {
+            nActive += (itPort.value()->bActive == true ? 1 : 0);
+            nQueued += itPort.value()->lstQueue.count();
+            ++itPort;
+        }
+
+        QJsonObject jsoResponse;
+        jsoResponse["event"] = "status";
+        jsoResponse["version"] = APP_VERSION;
+        jsoResponse["ports"] = (qint64)mapPorts.count();
+        jsoResponse["active"] = (qint64)nActive;
+        jsoResponse["queued"] = (qint64)nQueued;
+        jsoResponse["succeeded"] = (qint64)nJobsSucceeded;
+        jsoResponse["failed"] = (qint64)nJobsFailed;
+        jsoResponse["cachedImages"] = (qint64)pImageCache->Count();
+        jsoResponse["cachedBytes"] = pImageCache->TotalSize();
+        jsoResponse["cacheHits"] = (qint64)pImageCache->Hits();
+        SendMessage(pClient, jsoResponse);
+        return;
+    }
+    else if (strCommand == "clearcache")
+    {
+        //Drop all cached upgrade files, e.g. after files have been replaced in place
+        pImageCache->Clear();
+        QJsonObject jsoResponse;
+        jsoResponse["event"] = "cacheCleared";
+        SendMessage(pClient, jsoResponse);
+        return;
+    }
+
+    DaemonJobStruct sJob;
+    sJob.strID = jsoRequest.value("id").toString();
+    sJob.strPort = jsoRequest.value("port").toString();
+    sJob.strImage = jsoRequest.value("image").toString();
+    sJob.jsoOptions = jsoRequest.value("options").toObject();
+    sJob.bLog = jsoRequest.value("log").toBool(false);
+    sJob.pClient = pClient;
+
+    //Check the job before queuing it so that mistakes are reported straight away
+    int32_t nError = EXIT_CODE_SUCCESS;
+    QString strError;
+    if (strCommand != "job" || sJob.strPort.isEmpty() || sJob.strImage.isEmpty())
+    {
+        nError = EXIT_CODE_DAEMON_JOB_NOT_VALID;
+        strError = "Jobs require a port and an image";
+    }
+    else
+    {
+        QJsonObject::const_iterator itOption = sJob.jsoOptions.constBegin();
+        while (itOption != sJob.jsoOptions.constEnd())
+        {
+            CONFIG_TYPES cnfType;
+            if (LrdSettings::ConfigTypeFromName(itOption.key(), &cnfType) == false)
+            {
+                nError = EXIT_CODE_INVALID_SETTINGS_NAME;
+                strError = QString("Unknown option: ").append(itOption.key());
+                break;
+            }
+            ++itOption;
+        }
+    }
+
+    if (nError != EXIT_CODE_SUCCESS)
+    {
+        QJsonObject jsoResponse;
+        jsoResponse["event"] = "rejected";
+        jsoResponse["id"] = sJob.strID;
+        jsoResponse["error"] = nError;
+        jsoResponse["errorString"] = strError;
+        SendMessage(pClient, jsoResponse);
+        return;
+    }
+
+    DaemonPortStruct *pPort = mapPorts.value(sJob.strPort, nullptr);
+    if (pPort == NULL)
+    {
+        //First job for this port, the session is kept for later jobs
+        pPort = new DaemonPortStruct();
+        MallocFailCheck(pPort);
+        pPort->pSession = new LrdFwSession();
+        MallocFailCheck(pPort->pSession);
+        pPort->pSession->SetImageCache(pImageCache);
+        pPort->bActive = false;
+        pPort->nLastOverall = -1;
+        connect(pPort->pSession, SIGNAL(Progress(int8_t,int8_t)), this, SLOT(SessionProgress(int8_t,int8_t)));
+        connect(pPort->pSession, SIGNAL(Log(QString)), this, SLOT(SessionLog(QString)));
+        connect(pPort->pSession, SIGNAL(Completed(bool,int32_t,qint64)), this, SLOT(SessionCompleted(bool,int32_t,qint64)));
+        mapPorts.insert(sJob.strPort, pPort);
+    }
+
+    pPort->lstQueue.append(sJob);
+
+    QJsonObject jsoResponse;
+    jsoResponse["event"] = "queued";
+    jsoResponse["id"] = sJob.strID;
+    jsoResponse["port"] = sJob.strPort;
+    jsoResponse["position"] = (qint64)(pPort->lstQueue.count() - 1 + (pPort->bActive == true ? 1 : 0));
+    SendMessage(pClient, jsoResponse);
+
+    StartNextJob(pPort);
+}
+
+//=============================================================================
+// Starts the next queued job on a port if it is idle
+//=============================================================================
+void
+LrdFwDaemon::StartNextJob(
+    DaemonPortStruct *pPort
+    )
+{
+    while (pPort->bActive == false && !pPort->lstQueue.isEmpty())
+    {
+        DaemonJobStruct sJob = pPort->lstQueue.takeFirst();
+        int32_t nError = ApplyJobSettings(pPort->pSession, sJob);
+        if (nError != EXIT_CODE_SUCCESS)
+        {
+            //An option value is not valid for the setting
+            QJsonObject jsoResponse;
+            jsoResponse["event"] = "finished";
+            jsoResponse["id"] = sJob.strID;
+            jsoResponse["port"] = sJob.strPort;
+            jsoResponse["success"] = false;
+            jsoResponse["error"] = nError;
+            jsoResponse["errorString"] = pErrHandler->ErrorCodeToString(nError, false);
+            jsoResponse["timeMS"] = 0;
+            SendMessage(sJob.pClient, jsoResponse);
+            ++nJobsFailed;
+            continue;
+        }
+
+        pPort->sActiveJob = sJob;
+        pPort->bActive = true;
+        pPort->nLastOverall = -1;
+
+        QJsonObject jsoResponse;
+        jsoResponse["event"] = "started";
+        jsoResponse["id"] = sJob.strID;
+        jsoResponse["port"] = sJob.strPort;
+        SendMessage(sJob.pClient, jsoResponse);
+
+        //A failure to start is reported through the completed signal, which starts the following job
+        pPort->pSession->Start();
+        return;
+    }
+}
+
+//=============================================================================
+// Applies the settings for a job to a session, starting from the defaults
+//=============================================================================
+int32_t
+LrdFwDaemon::ApplyJobSettings(
+    LrdFwSession *pSession,
+    const DaemonJobStruct &sJob
+    )
+{
+    pSession->ResetSettings();
+
+    QJsonObject::const_iterator itOption = sJob.jsoOptions.constBegin();
+    while (itOption != sJob.jsoOptions.constEnd())
+    {
+        CONFIG_TYPES cnfType;
+        QString strValue;
+        if (LrdSettings::ConfigTypeFromName(itOption.key(), &cnfType) == false)
+        {
+            return EXIT_CODE_INVALID_SETTINGS_NAME;
+        }
+
+        if (itOption.value().isBool())
+        {
+            strValue = (itOption.value().toBool() == true ? "1" : "0");
+        }
+        else if (itOption.value().isDouble())
+        {
+            strValue = QString::number(itOption.value().toInteger());
+        }
+        else
+        {
+            strValue = itOption.value().toString();
+        }
+
+        int32_t nError = pSession->Settings()->SetConfigOptionFromString(cnfType, strValue);
+        if (nError != EXIT_CODE_SUCCESS)
+        {
+            return nError;
+        }
+        ++itOption;
+    }
+
+    //Port and image from the job take priority over options
+    pSession->Settings()->SetConfigOption(OUTPUT_DEVICE, sJob.strPort);
+    pSession->Settings()->SetConfigOption(FIRMWARE_FILE, sJob.strImage);
+
+    //The daemon has no GUI, so bootloader entrance dialogs stay disabled whatever the job options are
+    pSession->Settings()->SetConfigOption(BOOTLOADER_ENTRANCE_WARNINGS_DISABLED, true);
+    pSession->Settings()->SetConfigOption(BOOTLOADER_ENTRANCE_ERRORS_DISABLED, true);
+
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Returns the port which a session belongs to
+//=============================================================================
+DaemonPortStruct *
+LrdFwDaemon::PortForSession(
+    QObject *pSession
+    )
+{
+    QMap<QString, DaemonPortStruct *>::const_iterator itPort = mapPorts.constBegin();
+    while (itPort != mapPorts.constEnd())
+    {
+        if (itPort.value()->pSession == pSession)
+        {
+            return itPort.value();
+        }
+        ++itPort;
+    }
+
+    return NULL;
+}
+
+//=============================================================================
+// Slot for session progress, only changes of the overall percentage are sent
+//=============================================================================
+void
+LrdFwDaemon::SessionProgress(
+    int8_t nCurrentTaskPercent,
+    int8_t nOverallPercent
+    )
+{
+    DaemonPortStruct *pPort = PortForSession(sender());
+    if (pPort == NULL || pPort->bActive == false || nOverallPercent < 0 || nOverallPercent == pPort->nLastOverall)
+    {
+        return;
+    }
+
+    pPort->nLastOverall = nOverallPercent;
+    QJsonObject jsoResponse;
+    jsoResponse["event"] = "progress";
+    jsoResponse["id"] = pPort->sActiveJob.strID;
+    jsoResponse["port"] = pPort->sActiveJob.strPort;
+    jsoResponse["task"] = nCurrentTaskPercent;
+    jsoResponse["overall"] = nOverallPercent;
+    SendMessage(pPort->sActiveJob.pClient, jsoResponse);
+}
+
+//=============================================================================
+// Slot for session status messages, sent if the job requested them
+//=============================================================================
+void
+LrdFwDaemon::SessionLog(
+    QString strMessage
+    )
+{
+    DaemonPortStruct *pPort = PortForSession(sender());
+    if (pPort == NULL || pPort->bActive == false || pPort->sActiveJob.bLog == false)
+    {
+        return;
+    }
+
+    QJsonObject jsoResponse;
+    jsoResponse["event"] = "log";
+    jsoResponse["id"] = pPort->sActiveJob.strID;
+    jsoResponse["port"] = pPort->sActiveJob.strPort;
+    jsoResponse["message"] = strMessage;
+    SendMessage(pPort->sActiveJob.pClient, jsoResponse);
+}
+
+//=============================================================================
+// Slot for session completion, reports the result and starts the next job
+//=============================================================================
+void
+LrdFwDaemon::SessionCompleted(
+    bool bSuccessful,
+    int32_t nErrorCode,
+    qint64 nUpgradeTimeMS
+    )
+{
+    DaemonPortStruct *pPort = PortForSession(sender());
+    if (pPort == NULL || pPort->bActive == false)
+    {
+        return;
+    }
+
+    if (bSuccessful == true)
+    {
+        ++nJobsSucceeded;
+    }
+    else
+    {
+        ++nJobsFailed;
+    }
+
+    QJsonObject jsoResponse;
+    jsoResponse["event"] = "finished";
+    jsoResponse["id"] = pPort->sActiveJob.strID;
+    jsoResponse["port"] = pPort->sActiveJob.strPort;
+    jsoResponse["success"] = bSuccessful;
+    jsoResponse["error"] = nErrorCode;
+    jsoResponse["errorString"] = pErrHandler->ErrorCodeToString(nErrorCode, false);
+    jsoResponse["timeMS"] = nUpgradeTimeMS;
+    SendMessage(pPort->sActiveJob.pClient, jsoResponse);
+
+    pPort->bActive = false;
+    pPort->sActiveJob.pClient = nullptr;
+    StartNextJob(pPort);
+}
+
+//=============================================================================
+// Sends a single line JSON message to a client if it is still connected
+//=============================================================================
+void
+LrdFwDaemon::SendMessage(
+    QLocalSocket *pClient,
+    QJsonObject jsoMessage
+    )
+{
+    if (pClient == NULL || pClient->state() != QLocalSocket::ConnectedState)
+    {
+        return;
+    }
+
+    pClient->write(QJsonDocument(jsoMessage).toJson(QJsonDocument::Compact).append('\n'));
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
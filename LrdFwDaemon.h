@@ -0,0 +1,154 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwDaemon.h
+**
+** Notes:   Resident job server, accepts update jobs over a local socket
+**          (named pipe on Windows) and streams progress and results back.
+**          Requests and responses are single line JSON objects, e.g.
+**          {"id": "1", "port": "/dev/ttyUSB0", "image": "fw.uwf",
+**           "options": {"BOOTLOADER_BAUD": 1000000}, "log": false}
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWDAEMON_H
+#define LRDFWDAEMON_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QJsonObject>
+#include <QMap>
+#include "LrdFwCommon.h"
+#include "LrdFwSession.h"
+#include "LrdFwImageCache.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define DAEMON_MAX_REQUEST_LENGTH                     65536
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold a single job
+typedef struct
+{
+    QString                strID;         //Client supplied job identifier
+    QString                strPort;       //Serial port
+    QString                strImage;      //Upgrade file
+    QJsonObject            jsoOptions;    //Settings for this job, by setting name
+    bool                   bLog;          //True if status messages should be sent to the client
+    QPointer<QLocalSocket> pClient;       //Client which submitted the job
+} DaemonJobStruct;
+
+//Structure to hold the state of a single serial port
+typedef struct
+{
+    LrdFwSession           *pSession;     //Update session, kept between jobs
+    QList<DaemonJobStruct> lstQueue;      //Jobs waiting for the port
+    DaemonJobStruct        sActiveJob;    //Job currently running
+    bool                   bActive;       //True if a job is running
+    int8_t                 nLastOverall;  //Last overall percentage sent to the client
+} DaemonPortStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwDaemon(
+        QObject *parent = nullptr
+        );
+    ~LrdFwDaemon(
+        );
+    bool
+    Listen(
+        QString strName
+        );
+
+private slots:
+    void
+    NewConnection(
+        );
+    void
+    ClientReadyRead(
+        );
+    void
+    ClientDisconnected(
+        );
+    void
+    SessionProgress(
+        int8_t nCurrentTaskPercent,
+        int8_t nOverallPercent
+        );
+    void
+    SessionLog(
+        QString strMessage
+        );
+    void
+    SessionCompleted(
+        bool bSuccessful,
+        int32_t nErrorCode,
+        qint64 nUpgradeTimeMS
+        );
+
+private:
+    void
+    ProcessRequest(
+        QLocalSocket *pClient,
+        QByteArray baRequest
+        );
+    void
+    StartNextJob(
+        DaemonPortStruct *pPort
+        );
+    int32_t
+    ApplyJobSettings(
+        LrdFwSession *pSession,
+        const DaemonJobStruct &sJob
+        );
+    DaemonPortStruct *
+    PortForSession(
+        QObject *pSession
+        );
+    void
+    SendMessage(
+        QLocalSocket *pClient,
+        QJsonObject jsoMessage
+        );
+
+    QLocalServer *pServer = NULL;               //Socket server
+    LrdFwImageCache *pImageCache = NULL;        //Upgrade files cached between jobs
+    LrdErr *pErrHandler = NULL;                 //Error code to string conversion
+    QMap<QString, DaemonPortStruct *> mapPorts; //Serial ports which have been used, by port name
+    QMap<QLocalSocket *, QByteArray> mapClientBuffers; //Partially received requests, by client
+    quint64 nJobsSucceeded;                     //Number of successful jobs
+    quint64 nJobsFailed;                        //Number of failed jobs
+};
+
+#endif // LRDFWDAEMON_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
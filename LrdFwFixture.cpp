@@ -0,0 +1,383 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwFixture.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwFixture.h"
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwFixture::LrdFwFixture(
+    LrdFwUpd *pUpdate,
+    LrdSettings *pSettings,
+    QObject *parent
+    ) : QObject(parent)
+{
+    pFwUpd = pUpdate;
+    pSettingsHandle = pSettings;
+    nState = FIXTURE_STATE_IDLE;
+    nDetectMethod = FIXTURE_DETECT_CTS;
+    nSettleTimeMS = 0;
+    bLastPresent = false;
+    bVersionResponse = false;
+    bPollPresent = false;
+    nUnits = 0;
+    nUnitsFailed = 0;
+    nTotalUpdateTimeMS = 0;
+    nTotalCycleTimeMS = 0;
+    nCycles = 0;
+
+    pImageCache = new LrdFwImageCache();
+    MallocFailCheck(pImageCache);
+
+    tmrPoll.setInterval(FIXTURE_POLL_PERIOD_MS);
+    tmrPoll.setSingleShot(false);
+    connect(&tmrPoll, SIGNAL(timeout()), this, SLOT(PollTimerTimeout()));
+    connect(&spWatchPort, SIGNAL(readyRead()), this, SLOT(SerialRead()));
+    connect(pFwUpd, SIGNAL(Finished(bool,qint64)), this, SLOT(UpgradeFinished(bool,qint64)));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwFixture::~LrdFwFixture(
+    )
+{
+    Stop();
+    disconnect(this, SLOT(PollTimerTimeout()));
+    disconnect(this, SLOT(SerialRead()));
+    disconnect(this, SLOT(UpgradeFinished(bool,qint64)));
+    delete pImageCache;
+}
+
+//=============================================================================
+// Starts the fixture loop with an update of the module currently in the
+// fixture
+//=============================================================================
+void
+LrdFwFixture::Start(
+    )
+{
+    if (nState != FIXTURE_STATE_IDLE)
+    {
+        //Already running
+        return;
+    }
+
+    nDetectMethod = pSettingsHandle->GetConfigOption(FIXTURE_DETECT).toUInt();
+    nSettleTimeMS = pSettingsHandle->GetConfigOption(FIXTURE_SETTLE_MS).toUInt();
+    nUnits = 0;
+    nUnitsFailed = 0;
+    nTotalUpdateTimeMS = 0;
+    nTotalCycleTimeMS = 0;
+    nCycles = 0;
+    elptmrCycleTime.invalidate();
+    elptmrRunTime.start();
+
+    //The upgrade file is read and parsed once for all units
+    pFwUpd->SetImageCache(pImageCache);
+
+    if (nDetectMethod == FIXTURE_DETECT_POLL)
+    {
+        //Modules answering the version request are already in bootloader mode, this only applies to updates started by the fixture
+        strOverridePort = pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString();
+        pSettingsHandle->SetPortConfigOption(strOverridePort, BOOTLOADER_PROBE_FIRST, true);
+    }
+
+    emit Status(QString("Fixture mode started, modules are detected by ").append(nDetectMethod == FIXTURE_DETECT_POLL ? "version request" : (nDetectMethod == FIXTURE_DETECT_DSR ? "DSR" : "CTS")));
+    StartNextUnit();
+}
+
+//=============================================================================
+// Stops the fixture loop, an update in progress is allowed to complete
+//=============================================================================
+void
+LrdFwFixture::Stop(
+    )
+{
+    if (nState == FIXTURE_STATE_IDLE)
+    {
+        return;
+    }
+
+    tmrPoll.stop();
+    ClosePort();
+    nState = FIXTURE_STATE_IDLE;
+    if (!strOverridePort.isNull())
+    {
+        //Remove the probe override so the user's setting applies again
+        pSettingsHandle->ClearPortConfigOption(strOverridePort, BOOTLOADER_PROBE_FIRST);
+        strOverridePort = QString();
+    }
+    pFwUpd->SetImageCache(NULL);
+    pImageCache->Clear();
+    emit Status(QString("Fixture mode stopped. ").append(Summary()));
+}
+
+//=============================================================================
+// Returns true if the fixture loop is running
+//=============================================================================
+bool
+LrdFwFixture::IsRunning(
+    )
+{
+    return (nState != FIXTURE_STATE_IDLE);
+}
+
+//=============================================================================
+// Returns the unit count and throughput
+//=============================================================================
+QString
+LrdFwFixture::Summary(
+    )
+{
+    qint64 nRunTimeMS = (elptmrRunTime.isValid() ? elptmrRunTime.elapsed() : 0);
+    QString strSummary = QString::number(nUnits).append(" units (").append(QString::number(nUnits - nUnitsFailed)).append(" passed, ").append(QString::number(nUnitsFailed)).append(" failed) in ").append(QString::number(nRunTimeMS / 1000)).append("s");
+
+    if (nUnits > 0 && nRunTimeMS > 0)
+    {
+        strSummary.append(", ").append(QString::number((double)nUnits * 3600000.0 / (double)nRunTimeMS, 'f', 1)).append(" units/hour, average update ").append(QString::number(nTotalUpdateTimeMS / nUnits)).append("ms");
+    }
+
+    if (nCycles > 0)
+    {
+        strSummary.append(", average cycle ").append(QString::number(nTotalCycleTimeMS / nCycles)).append("ms");
+    }
+
+    return strSummary;
+}
+
+//=============================================================================
+// Slot for an update finishing, starts watching for the module to be replaced
+//=============================================================================
+void
+LrdFwFixture::UpgradeFinished(
+    bool bSuccessful,
+    qint64 nUpgradeTimeMS
+    )
+{
+    if (nState != FIXTURE_STATE_UPDATING)
+    {
+        return;
+    }
+
+    ++nUnits;
+    if (bSuccessful == false)
+    {
+        ++nUnitsFailed;
+    }
+    nTotalUpdateTimeMS += nUpgradeTimeMS;
+
+    emit Status(QString("Unit ").append(QString::number(nUnits)).append(bSuccessful == true ? " passed" : " failed").append(", ").append(Summary()).append(". Waiting for the module to be removed"));
+    nState = FIXTURE_STATE_WAIT_REMOVAL;
+    StartWatching();
+}
+
+//=============================================================================
+// Starts an update of the module in the fixture
+//=============================================================================
+void
+LrdFwFixture::StartNextUnit(
+    )
+{
+    tmrPoll.stop();
+    ClosePort();
+
+    if (elptmrCycleTime.isValid())
+    {
+        //Time from the start of the previous unit, includes handling time
+        nTotalCycleTimeMS += elptmrCycleTime.elapsed();
+        ++nCycles;
+    }
+    elptmrCycleTime.start();
+
+    nState = FIXTURE_STATE_UPDATING;
+    if (pFwUpd->StartUpdate() == false)
+    {
+        //Update did not start, so will not finish either
+        ++nUnits;
+        ++nUnitsFailed;
+        emit Status(QString("Unit ").append(QString::number(nUnits)).append(" failed to start. Waiting for the module to be removed"));
+        nState = FIXTURE_STATE_WAIT_REMOVAL;
+        StartWatching();
+    }
+}
+
+//=============================================================================
+// Opens the port and starts checking for the module
+//=============================================================================
+void
+LrdFwFixture::StartWatching(
+    )
+{
+    //The module is assumed to still be present after an update
+    bLastPresent = true;
+    bVersionResponse = false;
+    bPollPresent = true;
+    elptmrVersionPoll.invalidate();
+    elptmrStateChange.start();
+    OpenPort();
+    tmrPoll.start();
+}
+
+//=============================================================================
+// Opens the port for watching the module
+//=============================================================================
+bool
+LrdFwFixture::OpenPort(
+    )
+{
+    if (spWatchPort.isOpen())
+    {
+        return true;
+    }
+
+    spWatchPort.setPortName(pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString());
+    spWatchPort.setBaudRate(pSettingsHandle->GetConfigOption(BOOTLOADER_BAUD).toULongLong());
+    spWatchPort.setDataBits(QSerialPort::Data8);
+    spWatchPort.setStopBits(QSerialPort::OneStop);
+    spWatchPort.setParity(QSerialPort::NoParity);
+    spWatchPort.setFlowControl(nDetectMethod == FIXTURE_DETECT_POLL ? QSerialPort::HardwareControl : QSerialPort::NoFlowControl);
+    baReceivedData.clear();
+
+    //This is retried on each poll if it fails, the port may briefly disappear whilst the module is changed
+    return spWatchPort.open(QSerialPort::ReadWrite);
+}
+
+//=============================================================================
+// Closes the port used for watching the module
+//=============================================================================
+void
+LrdFwFixture::ClosePort(
+    )
+{
+    if (spWatchPort.isOpen())
+    {
+        spWatchPort.close();
+    }
+}
+
+//=============================================================================
+// Returns true if a module is present in the fixture
+//=============================================================================
+bool
+LrdFwFixture::IsModulePresent(
+    )
+{
+    if (nDetectMethod == FIXTURE_DETECT_CTS)
+    {
+        return ((spWatchPort.pinoutSignals() & QSerialPort::ClearToSendSignal) != 0);
+    }
+    else if (nDetectMethod == FIXTURE_DETECT_DSR)
+    {
+        return ((spWatchPort.pinoutSignals() & QSerialPort::DataSetReadySignal) != 0);
+    }
+
+    if (!elptmrVersionPoll.isValid() || elptmrVersionPoll.elapsed() >= FIXTURE_VERSION_POLL_PERIOD_MS)
+    {
+        //Result of the previous request, then send another
+        if (elptmrVersionPoll.isValid())
+        {
+            bPollPresent = bVersionResponse;
+        }
+        bVersionResponse = false;
+        baReceivedData.clear();
+        spWatchPort.write(COMMAND_BOOTLOADER_VERSION);
+        elptmrVersionPoll.start();
+    }
+
+    return bPollPresent;
+}
+
+//=============================================================================
+// Slot for periodic module presence checks
+//=============================================================================
+void
+LrdFwFixture::PollTimerTimeout(
+    )
+{
+    if (!spWatchPort.isOpen() && OpenPort() == false)
+    {
+        //Port is not available yet
+        return;
+    }
+
+    bool bPresent = IsModulePresent();
+    if (bPresent != bLastPresent)
+    {
+        //Presence has changed, wait for it to settle
+        bLastPresent = bPresent;
+        elptmrStateChange.start();
+        return;
+    }
+
+    if (elptmrStateChange.elapsed() < nSettleTimeMS)
+    {
+        //Not settled yet
+        return;
+    }
+
+    if (nState == FIXTURE_STATE_WAIT_REMOVAL && bPresent == false)
+    {
+        //Module has been removed
+        nState = FIXTURE_STATE_WAIT_PLACEMENT;
+        emit Status("Module removed, waiting for the next module");
+    }
+    else if (nState == FIXTURE_STATE_WAIT_PLACEMENT && bPresent == true)
+    {
+        //Next module has been placed
+        emit Status("Module placed, starting update");
+        StartNextUnit();
+    }
+}
+
+//=============================================================================
+// Slot for data received in response to version requests
+//=============================================================================
+void
+LrdFwFixture::SerialRead(
+    )
+{
+    baReceivedData.append(spWatchPort.readAll());
+    if (!baReceivedData.isEmpty() && baReceivedData[FUP_OFFSET_PACKET_TYPE] != FUP_RESPONSE_VERSION)
+    {
+        //Not a version response
+        baReceivedData.clear();
+    }
+    else if (baReceivedData.length() >= FUP_RESPONSE_LENGTH_VERSION)
+    {
+        //Module is present and in bootloader mode
+        bVersionResponse = true;
+        baReceivedData.clear();
+    }
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,157 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwFixture.h
+**
+** Notes:   Fixture loop mode, watches the serial port after an update for the
+**          module being replaced and then starts the next update
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWFIXTURE_H
+#define LRDFWFIXTURE_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "LrdFwCommon.h"
+#include "LrdFwUpd.h"
+#include "LrdFwImageCache.h"
+#include "LrdSettings.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define FIXTURE_POLL_PERIOD_MS                        100
+#define FIXTURE_VERSION_POLL_PERIOD_MS                250
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Module detection methods (FIXTURE_DETECT)
+enum FIXTURE_DETECT_METHODS
+{
+    FIXTURE_DETECT_CTS = 0,
+    FIXTURE_DETECT_DSR,
+    FIXTURE_DETECT_POLL
+};
+
+//Fixture states
+enum FIXTURE_STATES
+{
+    FIXTURE_STATE_IDLE,
+    FIXTURE_STATE_UPDATING,
+    FIXTURE_STATE_WAIT_REMOVAL,
+    FIXTURE_STATE_WAIT_PLACEMENT
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwFixture : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwFixture(
+        LrdFwUpd *pUpdate,
+        LrdSettings *pSettings,
+        QObject *parent = nullptr
+        );
+    ~LrdFwFixture(
+        );
+    void
+    Start(
+        );
+    void
+    Stop(
+        );
+    bool
+    IsRunning(
+        );
+    QString
+    Summary(
+        );
+
+signals:
+    void
+    Status(
+        QString strMessage
+        );
+
+private slots:
+    void
+    UpgradeFinished(
+        bool bSuccessful,
+        qint64 nUpgradeTimeMS
+        );
+    void
+    PollTimerTimeout(
+        );
+    void
+    SerialRead(
+        );
+
+private:
+    bool
+    OpenPort(
+        );
+    void
+    ClosePort(
+        );
+    bool
+    IsModulePresent(
+        );
+    void
+    StartNextUnit(
+        );
+    void
+    StartWatching(
+        );
+
+    LrdFwUpd       *pFwUpd = NULL;          //Update object which is started for each unit
+    LrdSettings    *pSettingsHandle = NULL; //Settings object
+    LrdFwImageCache *pImageCache = NULL;    //Keeps the upgrade file parsed between units
+    QString        strOverridePort;         //Port the probe setting is overridden for whilst running (null if none)
+    QSerialPort    spWatchPort;             //Port used to watch for the module between updates
+    QTimer         tmrPoll;                 //Timer used to check for the module
+    QElapsedTimer  elptmrStateChange;       //Time since the module presence last changed
+    QElapsedTimer  elptmrRunTime;           //Time since the fixture loop was started
+    QElapsedTimer  elptmrCycleTime;         //Time since the previous unit started
+    QElapsedTimer  elptmrVersionPoll;       //Time since the last version request was sent
+    QByteArray     baReceivedData;          //Data received in response to version requests
+    FIXTURE_STATES nState;                  //Current state
+    uint8_t        nDetectMethod;           //Module detection method
+    quint32        nSettleTimeMS;           //Time the module presence must be stable for
+    bool           bLastPresent;            //Module presence at the last check
+    bool           bVersionResponse;        //True if a version response has been received since the last request
+    bool           bPollPresent;            //True if the last version request was responded to
+    quint32        nUnits;                  //Number of units updated
+    quint32        nUnitsFailed;            //Number of units which failed
+    qint64         nTotalUpdateTimeMS;      //Sum of the update times of all units
+    qint64         nTotalCycleTimeMS;       //Sum of the time between starting consecutive units
+    quint32        nCycles;                 //Number of cycle times in nTotalCycleTimeMS
+};
+
+#endif // LRDFWFIXTURE_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,227 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwImageCache.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwImageCache.h"
+#include <QFile>
+#include <QFileInfo>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwImageCache::LrdFwImageCache(
+    QObject *parent
+    ) : QObject(parent)
+{
+    nUseCounter = 0;
+    nHits = 0;
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwImageCache::~LrdFwImageCache(
+    )
+{
+    mapImages.clear();
+}
+
+//=============================================================================
+// Returns the contents of a file, from the cache if the file has not changed
+// since it was read. Returns false if the file cannot be read or is too large
+// to keep in memory
+//=============================================================================
+bool
+LrdFwImageCache::Load(
+    QString strFilename,
+    QByteArray *pData
+    )
+{
+    QFileInfo fiImage(strFilename);
+    if (!fiImage.exists())
+    {
+        //File does not exist
+        return false;
+    }
+
+    QString strKey = fiImage.absoluteFilePath();
+    ++nUseCounter;
+    if (mapImages.contains(strKey))
+    {
+        if (mapImages[strKey].dtModified == fiImage.lastModified() && mapImages[strKey].baData.length() == fiImage.size())
+        {
+            //Cached copy is current
+            mapImages[strKey].nLastUsed = nUseCounter;
+            *pData = mapImages[strKey].baData;
+            ++nHits;
+            return true;
+        }
+
+        //File has changed
+        mapImages.remove(strKey);
+    }
+
+    QFile fileImage(strKey);
+    if (!fileImage.open(QFile::ReadOnly))
+    {
+        //Cannot get read only access
+        return false;
+    }
+
+    if (fileImage.size() > IMAGE_CACHE_MAX_FILE_SIZE_BYTES)
+    {
+        //Too large to keep in memory, the file is streamed from disk instead
+        fileImage.close();
+        return false;
+    }
+
+    if (mapImages.count() >= IMAGE_CACHE_MAX_ENTRIES)
+    {
+        //Remove the least recently used file
+        QMap<QString, ImageCacheEntryStruct>::iterator itOldest = mapImages.begin();
+        QMap<QString, ImageCacheEntryStruct>::iterator itImage = mapImages.begin();
+        while (itImage != mapImages.end())
+        {
+            if (itImage.value().nLastUsed < itOldest.value().nLastUsed)
+            {
+                itOldest = itImage;
+            }
+            ++itImage;
+        }
+        mapImages.erase(itOldest);
+    }
+
+    ImageCacheEntryStruct sEntry;
+    sEntry.baData = fileImage.readAll();
+    sEntry.dtModified = fiImage.lastModified();
+    sEntry.bScanned = false;
+    sEntry.bValidated = false;
+    sEntry.nLastUsed = nUseCounter;
+    fileImage.close();
+    mapImages.insert(strKey, sEntry);
+
+    *pData = sEntry.baData;
+    return true;
+}
+
+//=============================================================================
+// Returns the cached parse result of a file, a validated result can be used
+// when validation is not required
+//=============================================================================
+bool
+LrdFwImageCache::GetScan(
+    QString strFilename,
+    bool bValidate,
+    UwfScanStruct *pScan
+    )
+{
+    QString strKey = QFileInfo(strFilename).absoluteFilePath();
+    if (!mapImages.contains(strKey) || mapImages[strKey].bScanned == false || (bValidate == true && mapImages[strKey].bValidated == false))
+    {
+        //Not parsed yet
+        return false;
+    }
+
+    *pScan = mapImages[strKey].sScan;
+    return true;
+}
+
+//=============================================================================
+// Stores the parse result of a cached file
+//=============================================================================
+void
+LrdFwImageCache::SetScan(
+    QString strFilename,
+    bool bValidate,
+    UwfScanStruct sScan
+    )
+{
+    QString strKey = QFileInfo(strFilename).absoluteFilePath();
+    if (!mapImages.contains(strKey) || sScan.nErrorCode != EXIT_CODE_SUCCESS)
+    {
+        //Only successful parses of cached files are kept
+        return;
+    }
+
+    mapImages[strKey].sScan = sScan;
+    mapImages[strKey].bScanned = true;
+    mapImages[strKey].bValidated = bValidate;
+}
+
+//=============================================================================
+// Removes all cached files
+//=============================================================================
+void
+LrdFwImageCache::Clear(
+    )
+{
+    mapImages.clear();
+}
+
+//=============================================================================
+// Returns the number of cached files
+//=============================================================================
+qsizetype
+LrdFwImageCache::Count(
+    )
+{
+    return mapImages.count();
+}
+
+//=============================================================================
+// Returns the total size of all cached files
+//=============================================================================
+qint64
+LrdFwImageCache::TotalSize(
+    )
+{
+    qint64 nTotal = 0;
+    QMap<QString, ImageCacheEntryStruct>::const_iterator itImage = mapImages.constBegin();
+    while (itImage != mapImages.constEnd())
+    {
+        nTotal += itImage.value().baData.length();
+        ++itImage;
+    }
+
+    return nTotal;
+}
+
+//=============================================================================
+// Returns the number of loads which were satisfied from the cache
+//=============================================================================
+quint64
+LrdFwImageCache::Hits(
+    )
+{
+    return nHits;
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,111 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwImageCache.h
+**
+** Notes:   Keeps upgrade files and their parse results in memory so that
+**          repeated updates with the same file do not re-read or re-parse it
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWIMAGECACHE_H
+#define LRDFWIMAGECACHE_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QMap>
+#include <QDateTime>
+#include "LrdFwCommon.h"
+#include "LrdFwUwf.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define IMAGE_CACHE_MAX_ENTRIES                       16
+
+//Maximum size of a file to keep in memory, larger files are read from disk, 16MB
+#define IMAGE_CACHE_MAX_FILE_SIZE_BYTES               16777216
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold a single cached upgrade file
+typedef struct
+{
+    QByteArray    baData;        //Contents of the file
+    QDateTime     dtModified;    //Modification time of the file when it was read
+    bool          bScanned;      //True if sScan is valid
+    bool          bValidated;    //True if sScan was produced with validation enabled
+    UwfScanStruct sScan;         //Parse result of the file
+    quint64       nLastUsed;     //Use counter value when the file was last used
+} ImageCacheEntryStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwImageCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwImageCache(
+        QObject *parent = nullptr
+        );
+    ~LrdFwImageCache(
+        );
+    bool
+    Load(
+        QString strFilename,
+        QByteArray *pData
+        );
+    bool
+    GetScan(
+        QString strFilename,
+        bool bValidate,
+        UwfScanStruct *pScan
+        );
+    void
+    SetScan(
+        QString strFilename,
+        bool bValidate,
+        UwfScanStruct sScan
+        );
+    void
+    Clear(
+        );
+    qsizetype
+    Count(
+        );
+    qint64
+    TotalSize(
+        );
+    quint64
+    Hits(
+        );
+
+private:
+    QMap<QString, ImageCacheEntryStruct> mapImages; //Cached files, keyed by absolute filename
+    quint64 nUseCounter;                             //Incremented on each use, for removing the least recently used file
+    quint64 nHits;                                   //Number of loads satisfied from the cache
+};
+
+#endif // LRDFWIMAGECACHE_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,375 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwLinkHealth.cpp
+**
+** Notes:   Link health scoring, keeps a rolling baseline of each port's sessions
+**          in the persistent configuration and reports when a session drifts away
+**          from it (e.g. a worn fixture pin or a bad cable)
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwLinkHealth.h"
+#include <algorithm>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+//Returns the nearest-rank percentile of a sorted list
+static qint64
+Percentile(
+    const QList<quint32> &lstSorted,
+    uint8_t nPercent
+    )
+{
+    if (lstSorted.isEmpty())
+    {
+        return 0;
+    }
+
+    qsizetype nRank = (lstSorted.count() * nPercent + 99) / 100;
+    return lstSorted.at(nRank > 0 ? nRank - 1 : 0);
+}
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwLinkHealth::LrdFwLinkHealth(
+    QObject *parent
+    ) : QObject(parent)
+{
+    Start();
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwLinkHealth::~LrdFwLinkHealth(
+    )
+{
+}
+
+//=============================================================================
+// Clears the statistics for a new session
+//=============================================================================
+void
+LrdFwLinkHealth::Start(
+    )
+{
+    sStats.bSuccessful = false;
+    sStats.nErrorCode = EXIT_CODE_SUCCESS;
+    sStats.nRoundTrips = 0;
+    sStats.nRoundTripP50US = 0;
+    sStats.nRoundTripP95US = 0;
+    sStats.nRoundTripP99US = 0;
+    sStats.nRetries = 0;
+    sStats.nModuleErrors = 0;
+    sStats.nVerifyFailures = 0;
+    sStats.nBaudFallbacks = 0;
+    sStats.nProbeBaudIndex = 0;
+    sStats.nBytesWritten = 0;
+    sStats.nWriteTimeUS = 0;
+    sStats.nScore = 0;
+}
+
+//=============================================================================
+// Returns the statistics of the current session so that they can be updated
+//=============================================================================
+LinkSessionStatsStruct *
+LrdFwLinkHealth::Stats(
+    )
+{
+    return &sStats;
+}
+
+//=============================================================================
+// Sets the round trip percentiles from the individual round trip times
+//=============================================================================
+void
+LrdFwLinkHealth::SetRoundTrips(
+    const QList<quint32> &lstRoundTripsUS
+    )
+{
+    QList<quint32> lstSorted = lstRoundTripsUS;
+    std::sort(lstSorted.begin(), lstSorted.end());
+
+    sStats.nRoundTrips = lstSorted.count();
+    sStats.nRoundTripP50US = Percentile(lstSorted, 50);
+    sStats.nRoundTripP95US = Percentile(lstSorted, 95);
+    sStats.nRoundTripP99US = Percentile(lstSorted, 99);
+}
+
+//=============================================================================
+// Returns the write throughput of a session in bytes per second (0 if no
+// data was written)
+//=============================================================================
+qint64
+LrdFwLinkHealth::BytesPerSecond(
+    const LinkSessionStatsStruct *pStats
+    )
+{
+    if (pStats->nBytesWritten == 0 || pStats->nWriteTimeUS == 0)
+    {
+        return 0;
+    }
+
+    return pStats->nBytesWritten * 1000000 / pStats->nWriteTimeUS;
+}
+
+//=============================================================================
+// Calculates the health score of the session from 0 (bad) to 100 (good)
+//=============================================================================
+quint8
+LrdFwLinkHealth::Score(
+    )
+{
+    qint32 nScore = 100;
+
+    if (sStats.bSuccessful == false)
+    {
+        nScore -= LINK_HEALTH_DEDUCT_FAILED;
+    }
+    nScore -= qMin((qint32)sStats.nRetries * LINK_HEALTH_DEDUCT_RETRY, LINK_HEALTH_DEDUCT_RETRY_MAX);
+    nScore -= qMin((qint32)sStats.nModuleErrors * LINK_HEALTH_DEDUCT_MODULE_ERROR, LINK_HEALTH_DEDUCT_MODULE_ERROR_MAX);
+    nScore -= qMin((qint32)sStats.nVerifyFailures * LINK_HEALTH_DEDUCT_VERIFY_FAILURE, LINK_HEALTH_DEDUCT_VERIFY_FAILURE_MAX);
+    nScore -= qMin((qint32)sStats.nBaudFallbacks * LINK_HEALTH_DEDUCT_BAUD_FALLBACK, LINK_HEALTH_DEDUCT_BAUD_FALLBACK_MAX);
+    if (sStats.nRoundTripP50US > 0 && sStats.nRoundTripP95US > sStats.nRoundTripP50US * LINK_HEALTH_JITTER_RATIO)
+    {
+        //Round trip times vary a lot
+        nScore -= LINK_HEALTH_DEDUCT_JITTER;
+    }
+
+    return (nScore < 0 ? 0 : (quint8)nScore);
+}
+
+//=============================================================================
+// Scores the session and compares the most recent sessions of the port,
+// including this one, against the baseline of the port. Sessions are only
+// added to the baseline if the link was not reported as degraded, so that a
+// lasting drop in the link is not absorbed into it. Returns true if the link
+// has degraded, with the reasons added to pWarnings
+//=============================================================================
+bool
+LrdFwLinkHealth::Assess(
+    LrdSettings *pSettings,
+    QString strPort,
+    QStringList *pWarnings
+    )
+{
+    QString strKey = QString(PERSISTENT_KEY_LINK_HEALTH).append(strPort.replace('/', '_').replace('\\', '_'));
+    qint64 nBytesPerSecond = BytesPerSecond(&sStats);
+    double dWeight;
+    bool bWasOpen = pSettings->IsPersistentConfigOpen();
+    LinkRecentSessionStruct sSession;
+
+    sStats.nScore = Score();
+    if (bWasOpen == false)
+    {
+        pSettings->OpenPersistentConfig(APP_NAME);
+    }
+
+    LinkBaselineStruct sBaseline = LoadBaseline(pSettings, strKey);
+    QList<LinkRecentSessionStruct> lstRecent = LoadRecentSessions(pSettings, strKey);
+
+    //Add the session to the recent sessions, dropping the oldest
+    sSession.nScore = sStats.nScore;
+    sSession.nBytesPerSecond = nBytesPerSecond;
+    sSession.bFailed = !sStats.bSuccessful;
+    lstRecent.append(sSession);
+    while (lstRecent.count() > LINK_HEALTH_RECENT_SESSIONS)
+    {
+        lstRecent.removeFirst();
+    }
+
+    if (sBaseline.nSessions >= LINK_HEALTH_MIN_BASELINE_SESSIONS)
+    {
+        //Average the recent sessions
+        double dRecentScore = 0.0;
+        double dRecentBytesPerSecond = 0.0;
+        quint32 nThroughputSessions = 0;
+        quint32 nFailures = 0;
+        qsizetype i = 0;
+        while (i < lstRecent.count())
+        {
+            dRecentScore += lstRecent.at(i).nScore;
+            if (lstRecent.at(i).nBytesPerSecond > 0)
+            {
+                dRecentBytesPerSecond += lstRecent.at(i).nBytesPerSecond;
+                ++nThroughputSessions;
+            }
+            if (lstRecent.at(i).bFailed == true)
+            {
+                ++nFailures;
+            }
+            ++i;
+        }
+        dRecentScore /= lstRecent.count();
+        double dRecentErrorRate = (double)nFailures / lstRecent.count();
+        if (nThroughputSessions > 0)
+        {
+            dRecentBytesPerSecond /= nThroughputSessions;
+        }
+
+        if (dRecentBytesPerSecond > 0.0 && sBaseline.dBytesPerSecond > 0.0 && dRecentBytesPerSecond * 100 < sBaseline.dBytesPerSecond * (100 - LINK_HEALTH_THROUGHPUT_DRIFT_PERCENT))
+        {
+            //Throughput has dropped
+            pWarnings->append(QString("Recent write throughput of ").append(QString::number((qint64)dRecentBytesPerSecond)).append(" bytes/s is ").append(QString::number(100 - (int)(dRecentBytesPerSecond * 100 / sBaseline.dBytesPerSecond))).append("% below the baseline of ").append(QString::number((qint64)sBaseline.dBytesPerSecond)).append(" bytes/s"));
+        }
+
+        if (nFailures >= LINK_HEALTH_MIN_RECENT_FAILURES && (dRecentErrorRate - sBaseline.dErrorRate) * 100 >= LINK_HEALTH_ERROR_RATE_DRIFT_PERCENT)
+        {
+            //Failures are becoming more frequent
+            pWarnings->append(QString("Failed session rate has risen from ").append(QString::number(sBaseline.dErrorRate * 100, 'f', 1)).append("% to ").append(QString::number(dRecentErrorRate * 100, 'f', 1)).append("% over the last ").append(QString::number(lstRecent.count())).append(" sessions"));
+        }
+
+        if (dRecentScore + LINK_HEALTH_SCORE_DRIFT < sBaseline.dScore)
+        {
+            //Recent sessions were much worse than usual
+            pWarnings->append(QString("Recent health score of ").append(QString::number(dRecentScore, 'f', 0)).append(" is below the baseline of ").append(QString::number(sBaseline.dScore, 'f', 0)));
+        }
+    }
+
+    if (pWarnings->isEmpty())
+    {
+        //Add the session to the baseline, a rolling average is used once there are enough sessions, before then each session has an equal weight
+        dWeight = qMax(1.0 / (sBaseline.nSessions + 1), LINK_HEALTH_BASELINE_WEIGHT_PERCENT / 100.0);
+        sBaseline.dScore += dWeight * (sStats.nScore - sBaseline.dScore);
+        sBaseline.dErrorRate += dWeight * ((sStats.bSuccessful == true ? 0.0 : 1.0) - sBaseline.dErrorRate);
+        if (nBytesPerSecond > 0)
+        {
+            sBaseline.dBytesPerSecond = (sBaseline.dBytesPerSecond > 0.0 ? sBaseline.dBytesPerSecond + dWeight * (nBytesPerSecond - sBaseline.dBytesPerSecond) : nBytesPerSecond);
+        }
+        ++sBaseline.nSessions;
+    }
+    SaveBaseline(pSettings, strKey, &sBaseline, !pWarnings->isEmpty());
+    SaveRecentSessions(pSettings, strKey, lstRecent);
+
+    if (bWasOpen == false)
+    {
+        pSettings->ClosePersistentConfig();
+    }
+
+    return !pWarnings->isEmpty();
+}
+
+//=============================================================================
+// Returns a one line summary of the session statistics
+//=============================================================================
+QString
+LrdFwLinkHealth::Summary(
+    )
+{
+    return QString("Link health score ").append(QString::number(sStats.nScore)).append(", round trip p50/p95/p99: ").append(QString::number(sStats.nRoundTripP50US)).append("/").append(QString::number(sStats.nRoundTripP95US)).append("/").append(QString::number(sStats.nRoundTripP99US)).append("us over ").append(QString::number(sStats.nRoundTrips)).append(" commands, retries: ").append(QString::number(sStats.nRetries)).append(", module errors: ").append(QString::number(sStats.nModuleErrors)).append(", verify failures: ").append(QString::number(sStats.nVerifyFailures)).append(", baud fallbacks: ").append(QString::number(sStats.nBaudFallbacks)).append(", write throughput: ").append(QString::number(BytesPerSecond(&sStats))).append(" bytes/s");
+}
+
+//=============================================================================
+// Reads the baseline of a port from the persistent configuration
+//=============================================================================
+LinkBaselineStruct
+LrdFwLinkHealth::LoadBaseline(
+    LrdSettings *pSettings,
+    QString strKey
+    )
+{
+    LinkBaselineStruct sBaseline;
+
+    sBaseline.nSessions = pSettings->GetPersistentConfigOption(QString(strKey).append("/Sessions"), (quint32)0).toUInt();
+    sBaseline.dScore = pSettings->GetPersistentConfigOption(QString(strKey).append("/Score"), 0.0).toDouble();
+    sBaseline.dBytesPerSecond = pSettings->GetPersistentConfigOption(QString(strKey).append("/BytesPerSecond"), 0.0).toDouble();
+    sBaseline.dErrorRate = pSettings->GetPersistentConfigOption(QString(strKey).append("/ErrorRate"), 0.0).toDouble();
+
+    return sBaseline;
+}
+
+//=============================================================================
+// Writes the baseline of a port to the persistent configuration
+//=============================================================================
+void
+LrdFwLinkHealth::SaveBaseline(
+    LrdSettings *pSettings,
+    QString strKey,
+    const LinkBaselineStruct *pBaseline,
+    bool bDegraded
+    )
+{
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/Sessions"), pBaseline->nSessions);
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/Score"), pBaseline->dScore);
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/BytesPerSecond"), pBaseline->dBytesPerSecond);
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/ErrorRate"), pBaseline->dErrorRate);
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/LastScore"), sStats.nScore);
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/Degraded"), bDegraded);
+}
+
+//=============================================================================
+// Reads the most recent sessions of a port from the persistent configuration,
+// each is stored as "<score>,<bytes per second>,<failed>"
+//=============================================================================
+QList<LinkRecentSessionStruct>
+LrdFwLinkHealth::LoadRecentSessions(
+    LrdSettings *pSettings,
+    QString strKey
+    )
+{
+    QList<LinkRecentSessionStruct> lstRecent;
+    QStringList lstEntries = pSettings->GetPersistentConfigOption(QString(strKey).append("/Recent"), QStringList()).toStringList();
+    qsizetype i = 0;
+
+    while (i < lstEntries.count())
+    {
+        QStringList lstFields = lstEntries.at(i).split(',');
+        if (lstFields.count() == 3)
+        {
+            LinkRecentSessionStruct sSession;
+            sSession.nScore = (quint8)lstFields.at(0).toUInt();
+            sSession.nBytesPerSecond = lstFields.at(1).toLongLong();
+            sSession.bFailed = (lstFields.at(2).toUInt() != 0);
+            lstRecent.append(sSession);
+        }
+        ++i;
+    }
+
+    return lstRecent;
+}
+
+//=============================================================================
+// Writes the most recent sessions of a port to the persistent configuration
+//=============================================================================
+void
+LrdFwLinkHealth::SaveRecentSessions(
+    LrdSettings *pSettings,
+    QString strKey,
+    const QList<LinkRecentSessionStruct> &lstRecent
+    )
+{
+    QStringList lstEntries;
+    qsizetype i = 0;
+
+    while (i < lstRecent.count())
+    {
+        lstEntries.append(QString::number(lstRecent.at(i).nScore).append(",").append(QString::number(lstRecent.at(i).nBytesPerSecond)).append(",").append(lstRecent.at(i).bFailed == true ? "1" : "0"));
+        ++i;
+    }
+
+    pSettings->SetPersistentConfigOption(QString(strKey).append("/Recent"), lstEntries);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
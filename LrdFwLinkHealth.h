@@ -0,0 +1,188 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwLinkHealth.h
+**
+** Notes:   Link health scoring, keeps a rolling baseline of each port's sessions
+**          in the persistent configuration and reports when a session drifts away
+**          from it (e.g. a worn fixture pin or a bad cable)
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWLINKHEALTH_H
+#define LRDFWLINKHEALTH_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include "LrdFwCommon.h"
+#include "LrdSettings.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+//Persistent configuration key prefix for link health baselines
+#define PERSISTENT_KEY_LINK_HEALTH                    "LinkHealth/"
+
+//Weight (in percent) of each session in the rolling baseline
+#define LINK_HEALTH_BASELINE_WEIGHT_PERCENT           10
+
+//Number of sessions in the baseline before drift is reported
+#define LINK_HEALTH_MIN_BASELINE_SESSIONS             5
+
+//Number of most recent sessions which are compared against the baseline
+#define LINK_HEALTH_RECENT_SESSIONS                   5
+
+//Drop (in percent) of the recent write throughput below the baseline which is reported
+#define LINK_HEALTH_THROUGHPUT_DRIFT_PERCENT          20
+
+//Rise (in percentage points) of the recent failed session rate above the baseline which is reported
+#define LINK_HEALTH_ERROR_RATE_DRIFT_PERCENT          10
+
+//Number of failed sessions in the recent sessions needed before a rise in the failure rate is reported
+#define LINK_HEALTH_MIN_RECENT_FAILURES               2
+
+//Drop of the health score below the baseline which is reported
+#define LINK_HEALTH_SCORE_DRIFT                       15
+
+//Score deductions, each with a cap on the total deduction for that statistic
+#define LINK_HEALTH_DEDUCT_FAILED                     40
+#define LINK_HEALTH_DEDUCT_RETRY                      5
+#define LINK_HEALTH_DEDUCT_RETRY_MAX                  20
+#define LINK_HEALTH_DEDUCT_MODULE_ERROR               10
+#define LINK_HEALTH_DEDUCT_MODULE_ERROR_MAX           30
+#define LINK_HEALTH_DEDUCT_VERIFY_FAILURE             10
+#define LINK_HEALTH_DEDUCT_VERIFY_FAILURE_MAX         30
+#define LINK_HEALTH_DEDUCT_BAUD_FALLBACK              5
+#define LINK_HEALTH_DEDUCT_BAUD_FALLBACK_MAX          15
+#define LINK_HEALTH_DEDUCT_JITTER                     10
+#define LINK_HEALTH_JITTER_RATIO                      3   //p95 round trip time above this multiple of p50 counts as jitter
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold the link statistics of a single session
+typedef struct
+{
+    bool    bSuccessful;          //True if the session succeeded
+    int32_t nErrorCode;           //Error code the session failed with (EXIT_CODE_SUCCESS if it succeeded)
+    quint32 nRoundTrips;          //Number of command round trips measured
+    qint64  nRoundTripP50US;      //Median round trip time in us
+    qint64  nRoundTripP95US;      //95th percentile round trip time in us
+    qint64  nRoundTripP99US;      //99th percentile round trip time in us
+    quint32 nRetries;             //Commands which had to be sent again
+    quint32 nModuleErrors;        //Error responses from the module (i.e. write checksum failures)
+    quint32 nVerifyFailures;      //Verify commands which did not match
+    quint32 nBaudFallbacks;       //Baud rates tried before the module responded
+    quint32 nProbeBaudIndex;      //Index of the probed baud rate the module was found in bootloader mode at (not scored, a later index is the last negotiated baud rate rather than a fallback)
+    qint64  nBytesWritten;        //Bytes of data written
+    qint64  nWriteTimeUS;         //Time taken by the write commands in us
+    quint8  nScore;               //Health score from 0 (bad) to 100 (good)
+} LinkSessionStatsStruct;
+
+//Structure to hold the rolling baseline of a port, sessions which were reported as degraded are not included
+typedef struct
+{
+    quint32 nSessions;            //Number of sessions in the baseline
+    double  dScore;               //Average health score
+    double  dBytesPerSecond;      //Average write throughput (sessions which wrote data)
+    double  dErrorRate;           //Fraction of sessions which failed
+} LinkBaselineStruct;
+
+//Structure to hold one of the most recent sessions of a port
+typedef struct
+{
+    quint8  nScore;               //Health score of the session
+    qint64  nBytesPerSecond;      //Write throughput of the session (0 if no data was written)
+    bool    bFailed;              //True if the session failed
+} LinkRecentSessionStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwLinkHealth : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwLinkHealth(
+        QObject *parent = nullptr
+        );
+    ~LrdFwLinkHealth(
+        );
+    void
+    Start(
+        );
+    LinkSessionStatsStruct *
+    Stats(
+        );
+    void
+    SetRoundTrips(
+        const QList<quint32> &lstRoundTripsUS
+        );
+    static qint64
+    BytesPerSecond(
+        const LinkSessionStatsStruct *pStats
+        );
+    bool
+    Assess(
+        LrdSettings *pSettings,
+        QString strPort,
+        QStringList *pWarnings
+        );
+    QString
+    Summary(
+        );
+
+private:
+    quint8
+    Score(
+        );
+    LinkBaselineStruct
+    LoadBaseline(
+        LrdSettings *pSettings,
+        QString strKey
+        );
+    void
+    SaveBaseline(
+        LrdSettings *pSettings,
+        QString strKey,
+        const LinkBaselineStruct *pBaseline,
+        bool bDegraded
+        );
+    QList<LinkRecentSessionStruct>
+    LoadRecentSessions(
+        LrdSettings *pSettings,
+        QString strKey
+        );
+    void
+    SaveRecentSessions(
+        LrdSettings *pSettings,
+        QString strKey,
+        const QList<LinkRecentSessionStruct> &lstRecent
+        );
+
+    LinkSessionStatsStruct sStats; //Statistics of the current session
+};
+
+#endif // LRDFWLINKHEALTH_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,491 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwMetrics.cpp
+**
+** Notes:   Session metrics in the Prometheus text exposition format, written to a
+**          file (for the node exporter textfile collector) and/or served over HTTP
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwMetrics.h"
+#include <QSaveFile>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+LrdFwMetrics *LrdFwMetrics::pInstance = NULL;
+QMutex LrdFwMetrics::mtxInstance;
+
+//Histogram bucket upper bounds in seconds
+static const QList<double> lstPhaseBounds = {0.5, 1, 2, 5, 10, 20, 30, 60, 120, 300, 600};
+static const QList<double> lstRoundTripBounds = {0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1};
+
+//Sets up an empty histogram
+static void
+InitHistogram(
+    MetricsHistogramStruct *pHistogram,
+    const QList<double> *pBounds
+    )
+{
+    pHistogram->pBounds = pBounds;
+    pHistogram->lstBuckets.fill(0, pBounds->count() + 1);
+    pHistogram->nCount = 0;
+    pHistogram->dSum = 0.0;
+}
+
+//Adds an observation to a histogram
+static void
+Observe(
+    MetricsHistogramStruct *pHistogram,
+    double dValue
+    )
+{
+    qsizetype i = 0;
+    while (i < pHistogram->pBounds->count() && dValue > pHistogram->pBounds->at(i))
+    {
+        ++i;
+    }
+    ++pHistogram->lstBuckets[i];
+    ++pHistogram->nCount;
+    pHistogram->dSum += dValue;
+}
+
+//Escapes a label value
+static QString
+Label(
+    QString strValue
+    )
+{
+    return strValue.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+}
+
+//Adds the help and type lines of a metric
+static void
+AppendHeader(
+    QString *pOut,
+    const char *pName,
+    const char *pHelp,
+    const char *pType
+    )
+{
+    pOut->append("# HELP " METRICS_PREFIX).append(pName).append(" ").append(pHelp).append("\n");
+    pOut->append("# TYPE " METRICS_PREFIX).append(pName).append(" ").append(pType).append("\n");
+}
+
+//Adds the samples of a histogram, strLabels is either empty or a label list with a trailing comma
+static void
+AppendHistogram(
+    QString *pOut,
+    const char *pName,
+    QString strLabels,
+    const MetricsHistogramStruct *pHistogram
+    )
+{
+    quint64 nCumulative = 0;
+    qsizetype i = 0;
+    while (i < pHistogram->lstBuckets.count())
+    {
+        nCumulative += pHistogram->lstBuckets.at(i);
+        pOut->append(METRICS_PREFIX).append(pName).append("_bucket{").append(strLabels).append("le=\"").append(i < pHistogram->pBounds->count() ? QString::number(pHistogram->pBounds->at(i)) : QString("+Inf")).append("\"} ").append(QString::number(nCumulative)).append("\n");
+        ++i;
+    }
+
+    //Remove the trailing comma for the sum and count
+    strLabels.chop(1);
+    QString strBraced = (strLabels.isEmpty() ? QString() : QString("{").append(strLabels).append("}"));
+    pOut->append(METRICS_PREFIX).append(pName).append("_sum").append(strBraced).append(" ").append(QString::number(pHistogram->dSum, 'g', 12)).append("\n");
+    pOut->append(METRICS_PREFIX).append(pName).append("_count").append(strBraced).append(" ").append(QString::number(pHistogram->nCount)).append("\n");
+}
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwMetrics::LrdFwMetrics(
+    ) : QObject(nullptr)
+{
+    pServer = NULL;
+    InitHistogram(&sRoundTrips, &lstRoundTripBounds);
+
+    //Phases are always present so that they can be graphed before an update has run
+    InitHistogram(&mapPhases["erase"], &lstPhaseBounds);
+    InitHistogram(&mapPhases["write"], &lstPhaseBounds);
+    InitHistogram(&mapPhases["verify"], &lstPhaseBounds);
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwMetrics::~LrdFwMetrics(
+    )
+{
+    if (pServer != NULL)
+    {
+        pServer->close();
+        delete pServer;
+        pServer = NULL;
+    }
+}
+
+//=============================================================================
+// Returns the metrics shared by all sessions, they are kept for the life of
+// the process so that counters only ever increase
+//=============================================================================
+LrdFwMetrics *
+LrdFwMetrics::Instance(
+    )
+{
+    QMutexLocker lckInstance(&mtxInstance);
+
+    if (pInstance == NULL)
+    {
+        pInstance = new LrdFwMetrics();
+        MallocFailCheck(pInstance);
+    }
+
+    return pInstance;
+}
+
+//=============================================================================
+// Adds a file which the metrics are written to whenever they change
+//=============================================================================
+void
+LrdFwMetrics::AddFile(
+    QString strFilename
+    )
+{
+    QMutexLocker lckMetrics(&mtxMetrics);
+    if (!setFiles.contains(strFilename))
+    {
+        setFiles.insert(strFilename);
+        WriteFiles();
+    }
+}
+
+//=============================================================================
+// Starts serving the metrics over HTTP on an address and port. Returns true if
+// they are being served there, false if the address is not valid, the port
+// could not be listened on or they are already being served elsewhere
+//=============================================================================
+bool
+LrdFwMetrics::Listen(
+    QString strAddress,
+    quint16 nPort
+    )
+{
+    QHostAddress hstAddress;
+    if (hstAddress.setAddress(strAddress) == false)
+    {
+        //Not an IP address
+        return false;
+    }
+
+    QMutexLocker lckMetrics(&mtxMetrics);
+    if (pServer != NULL)
+    {
+        return (pServer->serverAddress() == hstAddress && pServer->serverPort() == nPort);
+    }
+
+    pServer = new QTcpServer(this);
+    MallocFailCheck(pServer);
+    connect(pServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+    if (pServer->listen(hstAddress, nPort) == false)
+    {
+        //Port is in use or not allowed
+        delete pServer;
+        pServer = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Counts a session as started and running on a port
+//=============================================================================
+void
+LrdFwMetrics::SessionStarted(
+    QString strPort
+    )
+{
+    QMutexLocker lckMetrics(&mtxMetrics);
+    if (!mapPorts.contains(strPort))
+    {
+        MetricsPortStruct sPort;
+        sPort.nStarted = 0;
+        sPort.nSucceeded = 0;
+        sPort.nBytesWritten = 0;
+        sPort.nActive = 0;
+        mapPorts.insert(strPort, sPort);
+    }
+
+    MetricsPortStruct *pPort = &mapPorts[strPort];
+    ++pPort->nStarted;
+    ++pPort->nActive;
+    WriteFiles();
+}
+
+//=============================================================================
+// Counts a session on a port as finished with a result (EXIT_CODE_SUCCESS if
+// it succeeded) and adds the amount of data it wrote
+//=============================================================================
+void
+LrdFwMetrics::SessionFinished(
+    QString strPort,
+    int32_t nErrorCode,
+    qint64 nBytesWritten
+    )
+{
+    QMutexLocker lckMetrics(&mtxMetrics);
+    if (!mapPorts.contains(strPort))
+    {
+        //Session was not started
+        return;
+    }
+
+    MetricsPortStruct *pPort = &mapPorts[strPort];
+    if (nErrorCode == EXIT_CODE_SUCCESS)
+    {
+        ++pPort->nSucceeded;
+    }
+    else
+    {
+        ++pPort->mapFailed[nErrorCode];
+    }
+    pPort->nBytesWritten += nBytesWritten;
+    if (pPort->nActive > 0)
+    {
+        --pPort->nActive;
+    }
+    WriteFiles();
+}
+
+//=============================================================================
+// Adds the time a session spent in a phase (erase, write or verify)
+//=============================================================================
+void
+LrdFwMetrics::ObservePhase(
+    QString strPhase,
+    qint64 nTimeUS
+    )
+{
+    QMutexLocker lckMetrics(&mtxMetrics);
+    if (!mapPhases.contains(strPhase))
+    {
+        InitHistogram(&mapPhases[strPhase], &lstPhaseBounds);
+    }
+    Observe(&mapPhases[strPhase], (double)nTimeUS / 1000000.0);
+}
+
+//=============================================================================
+// Adds the command round trip times of a session
+//=============================================================================
+void
+LrdFwMetrics::ObserveRoundTrips(
+    const QList<quint32> &lstRoundTripsUS
+    )
+{
+    QMutexLocker lckMetrics(&mtxMetrics);
+    qsizetype i = 0;
+    while (i < lstRoundTripsUS.count())
+    {
+        Observe(&sRoundTrips, (double)lstRoundTripsUS.at(i) / 1000000.0);
+        ++i;
+    }
+}
+
+//=============================================================================
+// Returns the metrics in the Prometheus text format, the metrics mutex must be
+// held by the caller
+//=============================================================================
+QByteArray
+LrdFwMetrics::Render(
+    )
+{
+    QString strOut;
+    QMap<QString, MetricsPortStruct>::const_iterator itPort;
+
+    AppendHeader(&strOut, "sessions_started_total", "Firmware update sessions started.", "counter");
+    for (itPort = mapPorts.constBegin(); itPort != mapPorts.constEnd(); ++itPort)
+    {
+        strOut.append(METRICS_PREFIX "sessions_started_total{port=\"").append(Label(itPort.key())).append("\"} ").append(QString::number(itPort.value().nStarted)).append("\n");
+    }
+
+    AppendHeader(&strOut, "sessions_succeeded_total", "Firmware update sessions which succeeded.", "counter");
+    for (itPort = mapPorts.constBegin(); itPort != mapPorts.constEnd(); ++itPort)
+    {
+        strOut.append(METRICS_PREFIX "sessions_succeeded_total{port=\"").append(Label(itPort.key())).append("\"} ").append(QString::number(itPort.value().nSucceeded)).append("\n");
+    }
+
+    AppendHeader(&strOut, "sessions_failed_total", "Firmware update sessions which failed, by exit code (negative) or module error code (positive).", "counter");
+    for (itPort = mapPorts.constBegin(); itPort != mapPorts.constEnd(); ++itPort)
+    {
+        QMap<int32_t, quint64>::const_iterator itFailed;
+        for (itFailed = itPort.value().mapFailed.constBegin(); itFailed != itPort.value().mapFailed.constEnd(); ++itFailed)
+        {
+            strOut.append(METRICS_PREFIX "sessions_failed_total{port=\"").append(Label(itPort.key())).append("\",exit_code=\"").append(QString::number(itFailed.key())).append("\"} ").append(QString::number(itFailed.value())).append("\n");
+        }
+    }
+
+    AppendHeader(&strOut, "bytes_written_total", "Bytes of firmware data written to modules.", "counter");
+    for (itPort = mapPorts.constBegin(); itPort != mapPorts.constEnd(); ++itPort)
+    {
+        strOut.append(METRICS_PREFIX "bytes_written_total{port=\"").append(Label(itPort.key())).append("\"} ").append(QString::number(itPort.value().nBytesWritten)).append("\n");
+    }
+
+    AppendHeader(&strOut, "active_sessions", "Firmware update sessions currently running.", "gauge");
+    for (itPort = mapPorts.constBegin(); itPort != mapPorts.constEnd(); ++itPort)
+    {
+        strOut.append(METRICS_PREFIX "active_sessions{port=\"").append(Label(itPort.key())).append("\"} ").append(QString::number(itPort.value().nActive)).append("\n");
+    }
+
+    AppendHeader(&strOut, "phase_duration_seconds", "Time spent by a session in each update phase.", "histogram");
+    QMap<QString, MetricsHistogramStruct>::const_iterator itPhase;
+    for (itPhase = mapPhases.constBegin(); itPhase != mapPhases.constEnd(); ++itPhase)
+    {
+        AppendHistogram(&strOut, "phase_duration_seconds", QString("phase=\"").append(Label(itPhase.key())).append("\","), &itPhase.value());
+    }
+
+    AppendHeader(&strOut, "command_round_trip_seconds", "Time from sending a command to receiving its response.", "histogram");
+    AppendHistogram(&strOut, "command_round_trip_seconds", QString(), &sRoundTrips);
+
+    return strOut.toUtf8();
+}
+
+//=============================================================================
+// Replaces the metrics files, each is written to a temporary file and renamed
+// so that a scraper never reads a partial file. The metrics mutex must be
+// held by the caller
+//=============================================================================
+void
+LrdFwMetrics::WriteFiles(
+    )
+{
+    if (setFiles.isEmpty())
+    {
+        return;
+    }
+
+    QByteArray baMetrics = Render();
+    QSet<QString>::const_iterator itFile;
+    for (itFile = setFiles.constBegin(); itFile != setFiles.constEnd(); ++itFile)
+    {
+        QSaveFile fileMetrics(*itFile);
+        if (fileMetrics.open(QIODevice::WriteOnly))
+        {
+            fileMetrics.write(baMetrics);
+            fileMetrics.commit();
+        }
+    }
+}
+
+//=============================================================================
+// Accepts HTTP clients, each has a timer so that clients which never send a
+// complete request line (or never read the response) do not stay open
+//=============================================================================
+void
+LrdFwMetrics::NewConnection(
+    )
+{
+    while (pServer != NULL && pServer->hasPendingConnections())
+    {
+        QTcpSocket *pClient = pServer->nextPendingConnection();
+        connect(pClient, SIGNAL(readyRead()), this, SLOT(ClientReadyRead()));
+        connect(pClient, SIGNAL(disconnected()), pClient, SLOT(deleteLater()));
+
+        //Timer is owned by the client so is removed with it
+        QTimer *tmrClient = new QTimer(pClient);
+        MallocFailCheck(tmrClient);
+        tmrClient->setSingleShot(true);
+        connect(tmrClient, SIGNAL(timeout()), this, SLOT(ClientTimeout()));
+        tmrClient->start(METRICS_HTTP_CLIENT_TIMEOUT_MS);
+    }
+}
+
+//=============================================================================
+// Closes a HTTP client which has not finished within the timeout
+//=============================================================================
+void
+LrdFwMetrics::ClientTimeout(
+    )
+{
+    QTimer *tmrClient = qobject_cast<QTimer *>(sender());
+    if (tmrClient == NULL)
+    {
+        return;
+    }
+
+    QTcpSocket *pClient = qobject_cast<QTcpSocket *>(tmrClient->parent());
+    if (pClient != NULL)
+    {
+        //Disconnected signal is emitted which removes the client
+        pClient->abort();
+    }
+}
+
+//=============================================================================
+// Answers a HTTP request once the request line has been received, only
+// GET /metrics is supported and the connection is closed after the response
+//=============================================================================
+void
+LrdFwMetrics::ClientReadyRead(
+    )
+{
+    QTcpSocket *pClient = qobject_cast<QTcpSocket *>(sender());
+    if (pClient == NULL)
+    {
+        return;
+    }
+
+    if (!pClient->canReadLine())
+    {
+        if (pClient->bytesAvailable() > METRICS_HTTP_MAX_REQUEST_LINE)
+        {
+            //Not a HTTP request
+            pClient->abort();
+        }
+        return;
+    }
+
+    //The headers of the request are not needed
+    disconnect(pClient, SIGNAL(readyRead()), this, SLOT(ClientReadyRead()));
+    QList<QByteArray> lstRequest = pClient->readLine(METRICS_HTTP_MAX_REQUEST_LINE).trimmed().split(' ');
+    QByteArray baStatus;
+    QByteArray baBody;
+    if (lstRequest.count() >= 2 && lstRequest.at(0) == "GET" && lstRequest.at(1).split('?').at(0) == METRICS_HTTP_PATH)
+    {
+        QMutexLocker lckMetrics(&mtxMetrics);
+        baStatus = "200 OK";
+        baBody = Render();
+    }
+    else
+    {
+        baStatus = "404 Not Found";
+        baBody = "Not found\n";
+    }
+
+    QByteArray baResponse = QByteArray("HTTP/1.1 ").append(baStatus).append("\r\nContent-Type: " METRICS_CONTENT_TYPE "\r\nContent-Length: ").append(QByteArray::number(baBody.length())).append("\r\nConnection: close\r\n\r\n").append(baBody);
+    pClient->write(baResponse);
+    pClient->disconnectFromHost();
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
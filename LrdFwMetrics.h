@@ -0,0 +1,150 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwMetrics.h
+**
+** Notes:   Session metrics in the Prometheus text exposition format, written to a
+**          file (for the node exporter textfile collector) and/or served over HTTP
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWMETRICS_H
+#define LRDFWMETRICS_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include "LrdFwCommon.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define METRICS_PREFIX                                "uwflashx_"
+#define METRICS_HTTP_PATH                             "/metrics"
+#define METRICS_HTTP_MAX_REQUEST_LINE                 1024
+//Clients are closed if they have not sent a request and received the response within this time
+#define METRICS_HTTP_CLIENT_TIMEOUT_MS                5000
+#define METRICS_CONTENT_TYPE                          "text/plain; version=0.0.4; charset=utf-8"
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold a histogram, lstBuckets holds the (non-cumulative) count of each bucket with the last entry for +Inf
+typedef struct
+{
+    const QList<double> *pBounds; //Upper bounds of the buckets
+    QList<quint64> lstBuckets;    //Observations in each bucket
+    quint64        nCount;        //Total number of observations
+    double         dSum;          //Sum of all observations
+} MetricsHistogramStruct;
+
+//Structure to hold the metrics of one port
+typedef struct
+{
+    quint64                  nStarted;        //Sessions started
+    quint64                  nSucceeded;      //Sessions which succeeded
+    QMap<int32_t, quint64>   mapFailed;       //Sessions which failed, by error code
+    quint64                  nBytesWritten;   //Bytes of data written
+    qint32                   nActive;         //Sessions currently running
+} MetricsPortStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwMetrics : public QObject
+{
+    Q_OBJECT
+public:
+    static LrdFwMetrics *
+    Instance(
+        );
+    void
+    AddFile(
+        QString strFilename
+        );
+    bool
+    Listen(
+        QString strAddress,
+        quint16 nPort
+        );
+    void
+    SessionStarted(
+        QString strPort
+        );
+    void
+    SessionFinished(
+        QString strPort,
+        int32_t nErrorCode,
+        qint64 nBytesWritten
+        );
+    void
+    ObservePhase(
+        QString strPhase,
+        qint64 nTimeUS
+        );
+    void
+    ObserveRoundTrips(
+        const QList<quint32> &lstRoundTripsUS
+        );
+
+private slots:
+    void
+    NewConnection(
+        );
+    void
+    ClientReadyRead(
+        );
+    void
+    ClientTimeout(
+        );
+
+private:
+    explicit
+    LrdFwMetrics(
+        );
+    ~LrdFwMetrics(
+        );
+    QByteArray
+    Render(
+        );
+    void
+    WriteFiles(
+        );
+
+    static LrdFwMetrics *pInstance;                         //Metrics shared by all sessions in the process
+    static QMutex mtxInstance;                              //Protects pInstance
+
+    QMutex                                mtxMetrics;       //Protects the metrics and file list
+    QMap<QString, MetricsPortStruct>      mapPorts;         //Metrics of each port
+    QMap<QString, MetricsHistogramStruct> mapPhases;        //Durations of each update phase
+    MetricsHistogramStruct                sRoundTrips;      //Command round trip times
+    QSet<QString>                         setFiles;         //Files the metrics are written to after each change
+    QTcpServer                            *pServer;         //HTTP server for scraping (NULL if not listening)
+};
+
+#endif // LRDFWMETRICS_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
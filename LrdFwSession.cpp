@@ -0,0 +1,252 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwSession.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwSession.h"
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwSession::LrdFwSession(
+    QObject *parent
+    ) : QObject(parent)
+{
+    //Create settings
+    pSettingsHandle = new LrdSettings();
+    MallocFailCheck(pSettingsHandle);
+    ResetSettings();
+
+    //Create firmware update object
+    pFwUpd = new LrdFwUpd();
+    MallocFailCheck(pFwUpd);
+    pFwUpd->SetSettingsObject(pSettingsHandle);
+
+    //Create error object
+    pErrHandler = new LrdErr();
+    MallocFailCheck(pErrHandler);
+
+    nErrorCode = EXIT_CODE_SUCCESS;
+
+    //Setup signals
+    connect(pFwUpd, SIGNAL(CurrentAction(uint32_t,uint32_t,QString)), this, SLOT(CurrentAction(uint32_t,uint32_t,QString)));
+    connect(pFwUpd, SIGNAL(PercentComplete(int8_t,int8_t)), this, SLOT(ProgressUpdate(int8_t,int8_t)));
+    connect(pFwUpd, SIGNAL(Error(uint32_t,int32_t)), this, SLOT(ModuleError(uint32_t,int32_t)));
+    connect(pFwUpd, SIGNAL(Finished(bool,qint64)), this, SLOT(UpgradeFinished(bool,qint64)));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwSession::~LrdFwSession(
+    )
+{
+    disconnect(this, SLOT(CurrentAction(uint32_t,uint32_t,QString)));
+    disconnect(this, SLOT(ProgressUpdate(int8_t,int8_t)));
+    disconnect(this, SLOT(ModuleError(uint32_t,int32_t)));
+    disconnect(this, SLOT(UpgradeFinished(bool,qint64)));
+
+    //Update object must be removed before the settings it uses
+    delete pFwUpd;
+    delete pSettingsHandle;
+    delete pErrHandler;
+}
+
+//=============================================================================
+// Returns the settings object used by this session
+//=============================================================================
+LrdSettings *
+LrdFwSession::Settings(
+    )
+{
+    return pSettingsHandle;
+}
+
+//=============================================================================
+// Returns the settings to their defaults, sessions have no user present so
+// bootloader entrance dialogs are disabled
+//=============================================================================
+void
+LrdFwSession::ResetSettings(
+    )
+{
+    pSettingsHandle->SetConfigDefaults();
+    pSettingsHandle->SetConfigOption(BOOTLOADER_ENTRANCE_WARNINGS_DISABLED, true);
+    pSettingsHandle->SetConfigOption(BOOTLOADER_ENTRANCE_ERRORS_DISABLED, true);
+}
+
+//=============================================================================
+// Copies all settings (including per-port settings) from another settings
+// object, bootloader entrance dialogs remain disabled
+//=============================================================================
+void
+LrdFwSession::CopySettings(
+    LrdSettings *pSource
+    )
+{
+    uint16_t i = CONFIG_ID_MIN + 1;
+    while (i < CONFIG_ID_MAX)
+    {
+        QVariant varValue = pSource->GetConfigOption((CONFIG_TYPES)i);
+        if (varValue.isValid())
+        {
+            pSettingsHandle->SetConfigOption((CONFIG_TYPES)i, varValue);
+        }
+        ++i;
+    }
+    pSettingsHandle->CopyPortConfigOptions(pSource);
+
+    pSettingsHandle->SetConfigOption(BOOTLOADER_ENTRANCE_WARNINGS_DISABLED, true);
+    pSettingsHandle->SetConfigOption(BOOTLOADER_ENTRANCE_ERRORS_DISABLED, true);
+}
+
+//=============================================================================
+// Sets a cache which keeps upgrade files in memory between updates
+//=============================================================================
+void
+LrdFwSession::SetImageCache(
+    LrdFwImageCache *pCache
+    )
+{
+    pFwUpd->SetImageCache(pCache);
+}
+
+//=============================================================================
+// Starts a firmware update with the current settings
+//=============================================================================
+bool
+LrdFwSession::Start(
+    )
+{
+    if (pFwUpd->IsUpdateInProgress())
+    {
+        //Already running
+        nErrorCode = EXIT_CODE_SESSION_ALREADY_ACTIVE;
+        return false;
+    }
+
+    nErrorCode = EXIT_CODE_SUCCESS;
+    if (pFwUpd->StartUpdate() == false)
+    {
+        //Update failed to start, no finished signal will be raised for this so report it here
+        if (nErrorCode == EXIT_CODE_SUCCESS)
+        {
+            //No error was emitted for the failure
+            nErrorCode = EXIT_CODE_SESSION_START_FAILED;
+        }
+        emit Completed(false, nErrorCode, 0);
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Returns true if a firmware update is in progress
+//=============================================================================
+bool
+LrdFwSession::IsActive(
+    )
+{
+    return pFwUpd->IsUpdateInProgress();
+}
+
+//=============================================================================
+// Returns the last error code reported
+//=============================================================================
+int32_t
+LrdFwSession::GetLastErrorCode(
+    )
+{
+    return nErrorCode;
+}
+
+//=============================================================================
+// Returns the description of an error code
+//=============================================================================
+QString
+LrdFwSession::ErrorCodeToString(
+    int32_t nErrorCode
+    )
+{
+    return pErrHandler->ErrorCodeToString(nErrorCode, false);
+}
+
+//=============================================================================
+// Slot for errors from the update object
+//=============================================================================
+void
+LrdFwSession::ModuleError(
+    uint32_t,
+    int32_t nErrorCode
+    )
+{
+    this->nErrorCode = nErrorCode;
+    emit Log(QString("Failed. ").append(pErrHandler->ErrorCodeToString(nErrorCode, true)));
+}
+
+//=============================================================================
+// Slot for status updates from the update object
+//=============================================================================
+void
+LrdFwSession::CurrentAction(
+    uint32_t,
+    uint32_t,
+    QString strActionName
+    )
+{
+    emit Log(strActionName);
+}
+
+//=============================================================================
+// Slot for progress updates from the update object
+//=============================================================================
+void
+LrdFwSession::ProgressUpdate(
+    int8_t nCurrentTaskPercent,
+    int8_t nOverallPercent
+    )
+{
+    emit Progress(nCurrentTaskPercent, nOverallPercent);
+}
+
+//=============================================================================
+// Slot for update finished
+//=============================================================================
+void
+LrdFwSession::UpgradeFinished(
+    bool bSuccessful,
+    qint64 nUpgradeTimeMS
+    )
+{
+    emit Completed(bSuccessful, (bSuccessful == true ? (int32_t)EXIT_CODE_SUCCESS : nErrorCode), nUpgradeTimeMS);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,128 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwSession.h
+**
+** Notes:   Self-contained firmware update session (settings, update object
+**          and error handling) for use without the GUI
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWSESSION_H
+#define LRDFWSESSION_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include "LrdFwCommon.h"
+#include "LrdFwUpd.h"
+#include "LrdSettings.h"
+#include "LrdErr.h"
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwSession : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwSession(
+        QObject *parent = nullptr
+        );
+    ~LrdFwSession(
+        );
+    LrdSettings *
+    Settings(
+        );
+    void
+    ResetSettings(
+        );
+    void
+    CopySettings(
+        LrdSettings *pSource
+        );
+    void
+    SetImageCache(
+        LrdFwImageCache *pCache
+        );
+    bool
+    Start(
+        );
+    bool
+    IsActive(
+        );
+    int32_t
+    GetLastErrorCode(
+        );
+    QString
+    ErrorCodeToString(
+        int32_t nErrorCode
+        );
+
+signals:
+    void
+    Progress(
+        int8_t nCurrentTaskPercent,
+        int8_t nOverallPercent
+        );
+    void
+    Log(
+        QString strMessage
+        );
+    void
+    Completed(
+        bool bSuccessful,
+        int32_t nErrorCode,
+        qint64 nUpgradeTimeMS
+        );
+
+private slots:
+    void
+    ModuleError(
+        uint32_t nModule,
+        int32_t nErrorCode
+        );
+    void
+    CurrentAction(
+        uint32_t nModule,
+        uint32_t nActionID,
+        QString strActionName
+        );
+    void
+    ProgressUpdate(
+        int8_t nCurrentTaskPercent,
+        int8_t nOverallPercent
+        );
+    void
+    UpgradeFinished(
+        bool bSuccessful,
+        qint64 nUpgradeTimeMS
+        );
+
+private:
+    LrdSettings *pSettingsHandle = NULL; //Settings for this session
+    LrdFwUpd *pFwUpd = NULL;             //Firmware update object
+    LrdErr *pErrHandler = NULL;          //Error code to string conversion
+    int32_t nErrorCode;                  //Last error code reported by the update
+};
+
+#endif // LRDFWSESSION_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,444 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwStation.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwStation.h"
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwStation::LrdFwStation(
+    LrdSettings *pSettings,
+    QObject *parent
+    ) : QObject(parent)
+{
+    pSettingsHandle = pSettings;
+    nHotplugSocket = -1;
+    bRunning = false;
+    nSucceeded = 0;
+    nFailed = 0;
+
+    pImageCache = new LrdFwImageCache();
+    MallocFailCheck(pImageCache);
+
+    //Scan timer is used either to poll or to delay a scan after a hotplug event
+    tmrScan.setSingleShot(true);
+    connect(&tmrScan, SIGNAL(timeout()), this, SLOT(ScanPorts()));
+    tmrPoll.setSingleShot(false);
+    connect(&tmrPoll, SIGNAL(timeout()), this, SLOT(ScanPorts()));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwStation::~LrdFwStation(
+    )
+{
+    Stop();
+    disconnect(this, SLOT(ScanPorts()));
+
+    //Sessions use the image cache so must be removed first
+    QMap<LrdFwSession *, StationDeviceStruct>::iterator itSession = mapActive.begin();
+    while (itSession != mapActive.end())
+    {
+        delete itSession.key();
+        ++itSession;
+    }
+    mapActive.clear();
+    delete pImageCache;
+}
+
+//=============================================================================
+// Starts station mode, devices which are already present are also updated
+//=============================================================================
+bool
+LrdFwStation::Start(
+    )
+{
+    if (bRunning == true)
+    {
+        return true;
+    }
+
+    //Parse VID:PID pairs
+    lstMatches.clear();
+    QStringList lstPairs = pSettingsHandle->GetConfigOption(STATION_MATCH).toString().split(',', Qt::SkipEmptyParts);
+    foreach (QString strPair, lstPairs)
+    {
+        QStringList lstIDs = strPair.trimmed().split(':');
+        bool bVIDOk = false;
+        bool bPIDOk = false;
+        StationMatchStruct sMatch;
+        if (lstIDs.count() == 2)
+        {
+            sMatch.nVID = lstIDs.at(0).toUShort(&bVIDOk, 16);
+            sMatch.nPID = lstIDs.at(1).toUShort(&bPIDOk, 16);
+        }
+
+        if (bVIDOk == false || bPIDOk == false)
+        {
+            emit Status(QString("Station mode: USB ID '").append(strPair).append("' is not valid, expected VID:PID in hexadecimal"));
+            return false;
+        }
+        lstMatches.append(sMatch);
+    }
+
+    rxSerial.setPattern(pSettingsHandle->GetConfigOption(STATION_SERIAL).toString());
+    if (!rxSerial.isValid())
+    {
+        emit Status(QString("Station mode: serial number pattern is not valid: ").append(rxSerial.errorString()));
+        return false;
+    }
+
+    if (lstMatches.isEmpty() && rxSerial.pattern().isEmpty())
+    {
+        //Updating every serial port that appears would be dangerous
+        emit Status("Station mode requires USB IDs or a serial number pattern to match devices with");
+        return false;
+    }
+
+    bRunning = true;
+    setKnownPorts.clear();
+    setUpdatedSerials.clear();
+    if (OpenHotplugSocket() == true)
+    {
+        //Hotplug events trigger scans, a slow poll covers any missed events
+        tmrPoll.start(STATION_HOTPLUG_POLL_PERIOD_MS);
+        emit Status("Station mode started, waiting for devices (hotplug events)");
+    }
+    else
+    {
+        tmrPoll.start(STATION_POLL_PERIOD_MS);
+        emit Status("Station mode started, waiting for devices (polling)");
+    }
+
+    ScanPorts();
+    return true;
+}
+
+//=============================================================================
+// Stops station mode, updates in progress are allowed to complete
+//=============================================================================
+void
+LrdFwStation::Stop(
+    )
+{
+    if (bRunning == false)
+    {
+        return;
+    }
+
+    bRunning = false;
+    tmrScan.stop();
+    tmrPoll.stop();
+    CloseHotplugSocket();
+    emit Status(QString("Station mode stopped. ").append(Summary()));
+}
+
+//=============================================================================
+// Returns true if station mode is running
+//=============================================================================
+bool
+LrdFwStation::IsRunning(
+    )
+{
+    return bRunning;
+}
+
+//=============================================================================
+// Returns the update counts
+//=============================================================================
+QString
+LrdFwStation::Summary(
+    )
+{
+    return QString::number(mapResults.count()).append(" devices seen, ").append(QString::number(nSucceeded)).append(" updates passed, ").append(QString::number(nFailed)).append(" failed, ").append(QString::number(mapActive.count())).append(" in progress");
+}
+
+//=============================================================================
+// Returns the results, by USB serial number
+//=============================================================================
+QMap<QString, StationResultStruct>
+LrdFwStation::Results(
+    )
+{
+    return mapResults;
+}
+
+//=============================================================================
+// Opens the kernel hotplug event socket (Linux only)
+//=============================================================================
+bool
+LrdFwStation::OpenHotplugSocket(
+    )
+{
+#ifdef __linux__
+    nHotplugSocket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (nHotplugSocket < 0)
+    {
+        nHotplugSocket = -1;
+        return false;
+    }
+
+    struct sockaddr_nl snlAddress;
+    memset(&snlAddress, 0, sizeof(snlAddress));
+    snlAddress.nl_family = AF_NETLINK;
+    snlAddress.nl_pid = 0;
+    snlAddress.nl_groups = 1;
+    if (bind(nHotplugSocket, (struct sockaddr *)&snlAddress, sizeof(snlAddress)) < 0)
+    {
+        //Not permitted or not supported
+        close(nHotplugSocket);
+        nHotplugSocket = -1;
+        return false;
+    }
+
+    pHotplugNotifier = new QSocketNotifier(nHotplugSocket, QSocketNotifier::Read);
+    MallocFailCheck(pHotplugNotifier);
+    connect(pHotplugNotifier, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), this, SLOT(HotplugEvent()));
+    return true;
+#else
+    return false;
+#endif
+}
+
+//=============================================================================
+// Closes the kernel hotplug event socket
+//=============================================================================
+void
+LrdFwStation::CloseHotplugSocket(
+    )
+{
+    if (pHotplugNotifier != NULL)
+    {
+        disconnect(this, SLOT(HotplugEvent()));
+        delete pHotplugNotifier;
+        pHotplugNotifier = NULL;
+    }
+
+#ifdef __linux__
+    if (nHotplugSocket >= 0)
+    {
+        close(nHotplugSocket);
+        nHotplugSocket = -1;
+    }
+#endif
+}
+
+//=============================================================================
+// Slot for kernel hotplug events, a scan is started shortly after a tty is
+// added to allow the device node permissions to be set up
+//=============================================================================
+void
+LrdFwStation::HotplugEvent(
+    )
+{
+#ifdef __linux__
+    char baEvent[STATION_HOTPLUG_BUFFER_SIZE];
+    ssize_t nLength = recv(nHotplugSocket, baEvent, sizeof(baEvent), 0);
+    while (nLength > 0)
+    {
+        //Events are a header followed by null separated KEY=VALUE fields
+        QList<QByteArray> lstFields = QByteArray(baEvent, nLength).split('\0');
+        if (lstFields.contains("SUBSYSTEM=tty") && (lstFields.contains("ACTION=add") || lstFields.contains("ACTION=remove")))
+        {
+            tmrScan.start(STATION_HOTPLUG_SETTLE_MS);
+        }
+        nLength = recv(nHotplugSocket, baEvent, sizeof(baEvent), 0);
+    }
+#endif
+}
+
+//=============================================================================
+// Checks the list of serial ports and starts updating any new matching ports
+//=============================================================================
+void
+LrdFwStation::ScanPorts(
+    )
+{
+    if (bRunning == false)
+    {
+        return;
+    }
+
+    QSet<QString> setPorts;
+    QSet<QString> setSerials;
+    QList<QSerialPortInfo> lstPorts = QSerialPortInfo::availablePorts();
+    foreach (QSerialPortInfo spiPort, lstPorts)
+    {
+        setPorts.insert(spiPort.portName());
+        setSerials.insert(spiPort.serialNumber().isEmpty() ? spiPort.portName() : spiPort.serialNumber());
+    }
+
+    //Devices which have been unplugged are updated again when they are plugged back in
+    setUpdatedSerials.intersect(setSerials);
+
+    foreach (QSerialPortInfo spiPort, lstPorts)
+    {
+        if (!setKnownPorts.contains(spiPort.portName()) && PortMatches(spiPort))
+        {
+            StartDevice(spiPort);
+        }
+    }
+
+    //Removed ports are forgotten so that they are treated as new if plugged in again
+    setKnownPorts = setPorts;
+}
+
+//=============================================================================
+// Returns true if a port is one which should be updated
+//=============================================================================
+bool
+LrdFwStation::PortMatches(
+    const QSerialPortInfo &spiPort
+    )
+{
+    if (!lstMatches.isEmpty())
+    {
+        bool bFound = false;
+        foreach (StationMatchStruct sMatch, lstMatches)
+        {
+            if (spiPort.hasVendorIdentifier() && spiPort.hasProductIdentifier() && spiPort.vendorIdentifier() == sMatch.nVID && spiPort.productIdentifier() == sMatch.nPID)
+            {
+                bFound = true;
+                break;
+            }
+        }
+
+        if (bFound == false)
+        {
+            return false;
+        }
+    }
+
+    if (!rxSerial.pattern().isEmpty() && !rxSerial.match(spiPort.serialNumber()).hasMatch())
+    {
+        //Serial number does not match
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Starts updating a device, unless it has been updated successfully and not
+// unplugged since or is currently being updated (e.g. it re-enumerated during
+// the update)
+//=============================================================================
+void
+LrdFwStation::StartDevice(
+    const QSerialPortInfo &spiPort
+    )
+{
+    StationDeviceStruct sDevice;
+    sDevice.strSerial = (spiPort.serialNumber().isEmpty() ? spiPort.portName() : spiPort.serialNumber());
+    sDevice.strPort = spiPort.portName();
+
+    if (setUpdatedSerials.contains(sDevice.strSerial))
+    {
+        //Still plugged in since it was updated, e.g. it re-enumerated when it rebooted
+        emit Status(QString("[").append(sDevice.strSerial).append("] ").append(spiPort.portName()).append(" has already been updated, unplug it to update it again"));
+        return;
+    }
+
+    foreach (StationDeviceStruct sActive, mapActive)
+    {
+        if (sActive.strSerial == sDevice.strSerial)
+        {
+            //Already being updated
+            return;
+        }
+    }
+
+    //Each device has its own session with a copy of the current settings
+    LrdFwSession *pSession = new LrdFwSession();
+    MallocFailCheck(pSession);
+    pSession->SetImageCache(pImageCache);
+    pSession->CopySettings(pSettingsHandle);
+    pSession->Settings()->SetConfigOption(OUTPUT_DEVICE, sDevice.strPort);
+    connect(pSession, SIGNAL(Completed(bool,int32_t,qint64)), this, SLOT(SessionCompleted(bool,int32_t,qint64)));
+    mapActive.insert(pSession, sDevice);
+
+    emit Status(QString("[").append(sDevice.strSerial).append("] ").append(spiPort.portName()).append(" plugged in, updating"));
+
+    //Failures to start are reported through the completed signal
+    pSession->Start();
+}
+
+//=============================================================================
+// Slot for a device update completing
+//=============================================================================
+void
+LrdFwStation::SessionCompleted(
+    bool bSuccessful,
+    int32_t nErrorCode,
+    qint64 nUpgradeTimeMS
+    )
+{
+    LrdFwSession *pSession = qobject_cast<LrdFwSession *>(sender());
+    if (pSession == NULL || !mapActive.contains(pSession))
+    {
+        return;
+    }
+
+    StationDeviceStruct sDevice = mapActive.take(pSession);
+    StationResultStruct sResult;
+    sResult.nAttempts = (mapResults.contains(sDevice.strSerial) ? mapResults[sDevice.strSerial].nAttempts : 0) + 1;
+    sResult.strPort = sDevice.strPort;
+    sResult.bSuccessful = bSuccessful;
+    sResult.nErrorCode = nErrorCode;
+    sResult.nUpgradeTimeMS = nUpgradeTimeMS;
+    sResult.dtFinished = QDateTime::currentDateTime();
+    mapResults.insert(sDevice.strSerial, sResult);
+
+    if (bSuccessful == true)
+    {
+        ++nSucceeded;
+        setUpdatedSerials.insert(sDevice.strSerial);
+        emit Status(QString("[").append(sDevice.strSerial).append("] passed in ").append(QString::number(nUpgradeTimeMS)).append("ms. ").append(Summary()));
+    }
+    else
+    {
+        ++nFailed;
+        emit Status(QString("[").append(sDevice.strSerial).append("] failed with error ").append(QString::number(nErrorCode)).append(" (").append(pSession->ErrorCodeToString(nErrorCode)).append("), unplug it to retry. ").append(Summary()));
+    }
+
+    disconnect(pSession, SIGNAL(Completed(bool,int32_t,qint64)), this, SLOT(SessionCompleted(bool,int32_t,qint64)));
+    pSession->deleteLater();
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
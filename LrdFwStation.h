@@ -0,0 +1,167 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwStation.h
+**
+** Notes:   Station mode, updates USB serial devices as they are plugged in.
+**          On Linux kernel hotplug events are used, other platforms (or if
+**          the hotplug socket cannot be opened) poll the list of ports
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWSTATION_H
+#define LRDFWSTATION_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QSerialPortInfo>
+#include <QSocketNotifier>
+#include <QRegularExpression>
+#include <QDateTime>
+#include <QTimer>
+#include <QSet>
+#include <QMap>
+#include "LrdFwCommon.h"
+#include "LrdFwSession.h"
+#include "LrdFwImageCache.h"
+#include "LrdSettings.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define STATION_POLL_PERIOD_MS                        1000
+#define STATION_HOTPLUG_POLL_PERIOD_MS                10000
+#define STATION_HOTPLUG_SETTLE_MS                     500
+#define STATION_HOTPLUG_BUFFER_SIZE                   4096
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold a USB VID/PID pair to match
+typedef struct
+{
+    quint16 nVID;
+    quint16 nPID;
+} StationMatchStruct;
+
+//Structure to hold a device being updated
+typedef struct
+{
+    QString strSerial;            //USB serial number (or port name if there is none)
+    QString strPort;              //Serial port
+} StationDeviceStruct;
+
+//Structure to hold the result for a single USB serial number
+typedef struct
+{
+    QString   strPort;            //Serial port used for the last attempt
+    bool      bSuccessful;        //Result of the last attempt
+    int32_t   nErrorCode;         //Error code of the last attempt
+    qint64    nUpgradeTimeMS;     //Update time of the last attempt
+    quint32   nAttempts;          //Number of attempts
+    QDateTime dtFinished;         //Time the last attempt finished
+} StationResultStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwStation : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwStation(
+        LrdSettings *pSettings,
+        QObject *parent = nullptr
+        );
+    ~LrdFwStation(
+        );
+    bool
+    Start(
+        );
+    void
+    Stop(
+        );
+    bool
+    IsRunning(
+        );
+    QString
+    Summary(
+        );
+    QMap<QString, StationResultStruct>
+    Results(
+        );
+
+signals:
+    void
+    Status(
+        QString strMessage
+        );
+
+private slots:
+    void
+    ScanPorts(
+        );
+    void
+    HotplugEvent(
+        );
+    void
+    SessionCompleted(
+        bool bSuccessful,
+        int32_t nErrorCode,
+        qint64 nUpgradeTimeMS
+        );
+
+private:
+    bool
+    OpenHotplugSocket(
+        );
+    void
+    CloseHotplugSocket(
+        );
+    bool
+    PortMatches(
+        const QSerialPortInfo &spiPort
+        );
+    void
+    StartDevice(
+        const QSerialPortInfo &spiPort
+        );
+
+    LrdSettings    *pSettingsHandle = NULL;     //Settings which are copied to each session
+    LrdFwImageCache *pImageCache = NULL;        //Upgrade file shared by all sessions
+    QSocketNotifier *pHotplugNotifier = NULL;   //Notifier for the hotplug socket (NULL if polling)
+    int            nHotplugSocket;              //Hotplug socket handle (-1 if not open)
+    QTimer         tmrScan;                     //Timer used to poll ports or to let hotplugged ports settle
+    QTimer         tmrPoll;                     //Fallback timer used to rescan ports periodically
+    QList<StationMatchStruct> lstMatches;       //USB VID/PID pairs to update
+    QRegularExpression rxSerial;                //USB serial number pattern to update
+    QSet<QString>  setKnownPorts;               //Ports present at the last scan
+    QMap<LrdFwSession *, StationDeviceStruct> mapActive; //Sessions in progress
+    QMap<QString, StationResultStruct> mapResults; //Results, by USB serial number
+    QSet<QString>  setUpdatedSerials;           //USB serial numbers updated successfully which have not been unplugged since
+    bool           bRunning;                    //True if station mode is running
+    quint32        nSucceeded;                  //Number of successful updates
+    quint32        nFailed;                     //Number of failed updates
+};
+
+#endif // LRDFWSTATION_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,304 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTrace.cpp
+**
+** Notes:   Session timeline recorder, writes spans, instants and counters in the
+**          Chrome trace-event (JSON array) format which can be opened in
+**          chrome://tracing or Perfetto. Sessions writing to the same file
+**          share one recorder and each gets its own track
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwTrace.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+QMap<QString, LrdFwTrace *> LrdFwTrace::mapTraces;
+QMutex LrdFwTrace::mtxTraces;
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwTrace::LrdFwTrace(
+    QString strFilename
+    ) : QObject(nullptr)
+{
+    fileTrace.setFileName(strFilename);
+    nReferences = 0;
+    nNextTrack = 1;
+    bCreated = false;
+    bHasEvents = false;
+    elptmrTrace.start();
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwTrace::~LrdFwTrace(
+    )
+{
+    Close();
+}
+
+//=============================================================================
+// Returns the recorder for a file, opening the file if no other session is
+// using it. Returns NULL if the file cannot be opened
+//=============================================================================
+LrdFwTrace *
+LrdFwTrace::Acquire(
+    QString strFilename
+    )
+{
+    QMutexLocker lckTraces(&mtxTraces);
+    QString strAbsolute = QFileInfo(strFilename).absoluteFilePath();
+    LrdFwTrace *pTrace = mapTraces.value(strAbsolute, NULL);
+
+    if (pTrace == NULL)
+    {
+        //Recorders are kept for the life of the process so that later sessions continue the same timeline
+        pTrace = new LrdFwTrace(strAbsolute);
+        MallocFailCheck(pTrace);
+        mapTraces.insert(strAbsolute, pTrace);
+    }
+
+    QMutexLocker lckTrace(&pTrace->mtxTrace);
+    if (pTrace->nReferences == 0 && pTrace->Open() == false)
+    {
+        return NULL;
+    }
+    ++pTrace->nReferences;
+
+    return pTrace;
+}
+
+//=============================================================================
+// Stops a session using a recorder, the file is completed once no sessions
+// are using it
+//=============================================================================
+void
+LrdFwTrace::Release(
+    LrdFwTrace *pTrace
+    )
+{
+    if (pTrace == NULL)
+    {
+        return;
+    }
+
+    QMutexLocker lckTraces(&mtxTraces);
+    QMutexLocker lckTrace(&pTrace->mtxTrace);
+    if (pTrace->nReferences > 0)
+    {
+        --pTrace->nReferences;
+        if (pTrace->nReferences == 0)
+        {
+            pTrace->Close();
+        }
+        else
+        {
+            pTrace->fileTrace.flush();
+        }
+    }
+}
+
+//=============================================================================
+// Opens the trace file, a file which was created earlier by this process is
+// continued so that all sessions appear on one timeline
+//=============================================================================
+bool
+LrdFwTrace::Open(
+    )
+{
+    if (bCreated == true)
+    {
+        //Re-open and write over the footer
+        if (fileTrace.open(QIODevice::ReadWrite) == false)
+        {
+            return false;
+        }
+
+        qint64 nFooterLength = qstrlen(TRACE_FILE_FOOTER);
+        if (fileTrace.size() >= nFooterLength)
+        {
+            fileTrace.seek(fileTrace.size() - nFooterLength);
+            if (fileTrace.peek(nFooterLength) == TRACE_FILE_FOOTER)
+            {
+                return true;
+            }
+        }
+        fileTrace.seek(fileTrace.size());
+        return true;
+    }
+
+    if (fileTrace.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+    {
+        return false;
+    }
+
+    fileTrace.write(TRACE_FILE_HEADER);
+    bCreated = true;
+    bHasEvents = false;
+
+    return true;
+}
+
+//=============================================================================
+// Completes and closes the trace file
+//=============================================================================
+void
+LrdFwTrace::Close(
+    )
+{
+    if (fileTrace.isOpen())
+    {
+        fileTrace.write(TRACE_FILE_FOOTER);
+        fileTrace.close();
+    }
+}
+
+//=============================================================================
+// Adds a track for a session (shown as a process named after the port so
+// that counters are also kept per session) and returns its ID
+//=============================================================================
+uint32_t
+LrdFwTrace::AddTrack(
+    QString strName
+    )
+{
+    QJsonObject jsoEvent;
+    QJsonObject jsoArgs;
+    uint32_t nTrack;
+
+    mtxTrace.lock();
+    nTrack = nNextTrack;
+    ++nNextTrack;
+    mtxTrace.unlock();
+
+    jsoArgs["name"] = strName;
+    jsoEvent["name"] = "process_name";
+    jsoEvent["ph"] = "M";
+    jsoEvent["pid"] = (qint64)nTrack;
+    jsoEvent["tid"] = 1;
+    jsoEvent["args"] = jsoArgs;
+    WriteEvent(QJsonDocument(jsoEvent).toJson(QJsonDocument::Compact));
+
+    return nTrack;
+}
+
+//=============================================================================
+// Returns the current trace timestamp in us
+//=============================================================================
+qint64
+LrdFwTrace::Now(
+    )
+{
+    return elptmrTrace.nsecsElapsed() / 1000;
+}
+
+//=============================================================================
+// Records a span which started at nStartUS and ends now
+//=============================================================================
+void
+LrdFwTrace::Complete(
+    uint32_t nTrack,
+    const char *pName,
+    qint64 nStartUS,
+    const QJsonObject &jsoArgs
+    )
+{
+    qint64 nNowUS = Now();
+    QByteArray baEvent;
+
+    baEvent.append("{\"name\":\"").append(pName).append("\",\"ph\":\"X\",\"ts\":").append(QByteArray::number(nStartUS)).append(",\"dur\":").append(QByteArray::number(nNowUS - nStartUS)).append(",\"pid\":").append(QByteArray::number(nTrack)).append(",\"tid\":1");
+    if (!jsoArgs.isEmpty())
+    {
+        baEvent.append(",\"args\":").append(QJsonDocument(jsoArgs).toJson(QJsonDocument::Compact));
+    }
+    baEvent.append("}");
+    WriteEvent(baEvent);
+}
+
+//=============================================================================
+// Records a single point in time
+//=============================================================================
+void
+LrdFwTrace::Instant(
+    uint32_t nTrack,
+    const char *pName,
+    const QJsonObject &jsoArgs
+    )
+{
+    QByteArray baEvent;
+
+    baEvent.append("{\"name\":\"").append(pName).append("\",\"ph\":\"i\",\"s\":\"p\",\"ts\":").append(QByteArray::number(Now())).append(",\"pid\":").append(QByteArray::number(nTrack)).append(",\"tid\":1");
+    if (!jsoArgs.isEmpty())
+    {
+        baEvent.append(",\"args\":").append(QJsonDocument(jsoArgs).toJson(QJsonDocument::Compact));
+    }
+    baEvent.append("}");
+    WriteEvent(baEvent);
+}
+
+//=============================================================================
+// Records the value of a counter
+//=============================================================================
+void
+LrdFwTrace::Counter(
+    uint32_t nTrack,
+    const char *pName,
+    qint64 nValue
+    )
+{
+    QByteArray baEvent;
+
+    baEvent.append("{\"name\":\"").append(pName).append("\",\"ph\":\"C\",\"ts\":").append(QByteArray::number(Now())).append(",\"pid\":").append(QByteArray::number(nTrack)).append(",\"tid\":1,\"args\":{\"value\":").append(QByteArray::number(nValue)).append("}}");
+    WriteEvent(baEvent);
+}
+
+//=============================================================================
+// Appends an event to the file
+//=============================================================================
+void
+LrdFwTrace::WriteEvent(
+    const QByteArray &baEvent
+    )
+{
+    QMutexLocker lckTrace(&mtxTrace);
+
+    if (!fileTrace.isOpen())
+    {
+        return;
+    }
+
+    if (bHasEvents == true)
+    {
+        fileTrace.write(TRACE_EVENT_SEPARATOR);
+    }
+    fileTrace.write(baEvent);
+    bHasEvents = true;
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,123 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTrace.h
+**
+** Notes:   Session timeline recorder, writes spans, instants and counters in the
+**          Chrome trace-event (JSON array) format which can be opened in
+**          chrome://tracing or Perfetto. Sessions writing to the same file
+**          share one recorder and each gets its own track
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRACE_H
+#define LRDFWTRACE_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include "LrdFwCommon.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define TRACE_FILE_HEADER                             "[\n"
+#define TRACE_FILE_FOOTER                             "\n]\n"
+#define TRACE_EVENT_SEPARATOR                         ",\n"
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTrace : public QObject
+{
+    Q_OBJECT
+public:
+    static LrdFwTrace *
+    Acquire(
+        QString strFilename
+        );
+    static void
+    Release(
+        LrdFwTrace *pTrace
+        );
+    uint32_t
+    AddTrack(
+        QString strName
+        );
+    qint64
+    Now(
+        );
+    void
+    Complete(
+        uint32_t nTrack,
+        const char *pName,
+        qint64 nStartUS,
+        const QJsonObject &jsoArgs = QJsonObject()
+        );
+    void
+    Instant(
+        uint32_t nTrack,
+        const char *pName,
+        const QJsonObject &jsoArgs = QJsonObject()
+        );
+    void
+    Counter(
+        uint32_t nTrack,
+        const char *pName,
+        qint64 nValue
+        );
+
+private:
+    explicit
+    LrdFwTrace(
+        QString strFilename
+        );
+    ~LrdFwTrace(
+        );
+    bool
+    Open(
+        );
+    void
+    Close(
+        );
+    void
+    WriteEvent(
+        const QByteArray &baEvent
+        );
+
+    static QMap<QString, LrdFwTrace *> mapTraces; //Recorders which have been used, keyed by absolute filename
+    static QMutex  mtxTraces;                      //Protects mapTraces
+
+    QFile          fileTrace;                      //Trace output file
+    QMutex         mtxTrace;                       //Protects writing to the file
+    QElapsedTimer  elptmrTrace;                    //Time since the recorder was created, used for event timestamps
+    uint32_t       nReferences;                    //Number of sessions using the recorder
+    uint32_t       nNextTrack;                     //Track ID given to the next session
+    bool           bCreated;                       //True if the file has been created by this process (it is continued rather than replaced)
+    bool           bHasEvents;                     //True if an event has been written to the file
+};
+
+#endif // LRDFWTRACE_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,121 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransport.h
+**
+** Notes:   Interface for the link used to talk to the module, implemented by
+**          the QSerialPort backend (portable default) and native backends
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRANSPORT_H
+#define LRDFWTRANSPORT_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QByteArray>
+#include "LrdFwCommon.h"
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTransport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwTransport(
+        QObject *parent = nullptr
+        ) : QObject(parent)
+    {
+    }
+    virtual
+    ~LrdFwTransport(
+        )
+    {
+    }
+    virtual bool
+    Open(
+        QString strPort,
+        quint32 nBaudRate
+        ) = 0;
+    virtual void
+    Close(
+        ) = 0;
+    virtual bool
+    IsOpen(
+        ) = 0;
+    virtual qint64
+    Write(
+        const QByteArray *pParts,
+        uint8_t nParts
+        ) = 0;
+    virtual qint64
+    Read(
+        char *pBuffer,
+        qint64 nMaxSize
+        ) = 0;
+    virtual bool
+    ClearToSend(
+        ) = 0;
+    virtual void
+    SetDTR(
+        bool bEnabled
+        ) = 0;
+    virtual void
+    SetBreak(
+        bool bEnabled
+        ) = 0;
+    virtual bool
+    SetBaudRate(
+        quint32
+        )
+    {
+        //Backends which cannot change the baud rate of an open link are re-opened instead
+        return false;
+    }
+    virtual qint64
+    OutputQueueBytes(
+        )
+    {
+        //Number of bytes reported as written which have not left yet, backends which cannot tell report none
+        return 0;
+    }
+
+signals:
+    void
+    ReadyRead(
+        );
+    void
+    BytesWritten(
+        qint64 nBytes
+        );
+    void
+    TransportError(
+        int32_t nErrorCode
+        );
+    void
+    Closing(
+        );
+};
+
+#endif // LRDFWTRANSPORT_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
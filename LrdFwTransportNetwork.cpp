@@ -0,0 +1,614 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportNetwork.cpp
+**
+** Notes:   Network transport backend for modules exposed by serial to TCP
+**          bridges, either as a raw TCP stream (tcp://host:port) or using the
+**          RFC 2217 telnet COM port control option (rfc2217://host:port)
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwTransportNetwork.h"
+#include <QUrl>
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwTransportNetwork::LrdFwTransportNetwork(
+    QObject *parent
+    ) : LrdFwTransport(parent)
+{
+    bRFC2217 = false;
+    bClosing = false;
+    bClearToSend = true;
+    nReceiveState = TELNET_STATE_DATA;
+    nOptionCommand = 0;
+
+    tmrConnect.setSingleShot(true);
+    tmrDisconnect.setSingleShot(true);
+    connect(&tcpSocket, SIGNAL(readyRead()), this, SLOT(SocketRead()));
+    connect(&tcpSocket, SIGNAL(connected()), this, SLOT(SocketConnected()));
+    connect(&tcpSocket, SIGNAL(disconnected()), this, SLOT(SocketDisconnected()));
+    connect(&tcpSocket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(SocketError(QAbstractSocket::SocketError)));
+    connect(&tmrConnect, SIGNAL(timeout()), this, SLOT(ConnectTimeout()));
+    connect(&tmrDisconnect, SIGNAL(timeout()), this, SLOT(DisconnectTimeout()));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwTransportNetwork::~LrdFwTransportNetwork(
+    )
+{
+    disconnect(&tcpSocket, SIGNAL(readyRead()), this, SLOT(SocketRead()));
+    disconnect(&tcpSocket, SIGNAL(connected()), this, SLOT(SocketConnected()));
+    disconnect(&tcpSocket, SIGNAL(disconnected()), this, SLOT(SocketDisconnected()));
+    disconnect(&tcpSocket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(SocketError(QAbstractSocket::SocketError)));
+    disconnect(&tmrConnect, SIGNAL(timeout()), this, SLOT(ConnectTimeout()));
+    disconnect(&tmrDisconnect, SIGNAL(timeout()), this, SLOT(DisconnectTimeout()));
+    Close();
+
+    //The connection cannot be closed gracefully once the object has gone
+    tcpSocket.abort();
+}
+
+//=============================================================================
+// Returns true if a port name refers to a network bridge
+//=============================================================================
+bool
+LrdFwTransportNetwork::IsNetworkPort(
+    QString strPort
+    )
+{
+    return (strPort.startsWith(NETWORK_SCHEME_RAW, Qt::CaseInsensitive) || strPort.startsWith(NETWORK_SCHEME_RFC2217, Qt::CaseInsensitive));
+}
+
+//=============================================================================
+// Starts connecting to the bridge and, for RFC 2217, queues the configuration
+// of the remote port. Data written before the connection has been made is
+// sent once it has, a connection which fails or is not made in time is
+// reported with TransportError()
+//=============================================================================
+bool
+LrdFwTransportNetwork::Open(
+    QString strPort,
+    quint32 nBaudRate
+    )
+{
+    QUrl urlPort(strPort);
+
+    if (urlPort.host().isEmpty() || urlPort.port() <= 0)
+    {
+        //Invalid address
+        return false;
+    }
+
+    if (tcpSocket.state() != QAbstractSocket::UnconnectedState)
+    {
+        //A previous connection is still closing, drop it
+        bClosing = true;
+        tcpSocket.abort();
+    }
+    tmrDisconnect.stop();
+
+    bRFC2217 = strPort.startsWith(NETWORK_SCHEME_RFC2217, Qt::CaseInsensitive);
+    bClosing = false;
+    bClearToSend = true;
+    nReceiveState = TELNET_STATE_DATA;
+    baSubnegotiation.clear();
+    baReceived.clear();
+    baPendingWrite.clear();
+
+    tcpSocket.connectToHost(urlPort.host(), urlPort.port());
+    tmrConnect.start(NETWORK_CONNECT_TIMEOUT_MS);
+
+    if (bRFC2217 == true)
+    {
+        //Negotiate binary transfer and the COM port option, then configure the remote port
+        QByteArray baNegotiate;
+        const uint8_t baOptions[] = {TELNET_IAC, TELNET_WILL, TELNET_OPTION_BINARY, TELNET_IAC, TELNET_DO, TELNET_OPTION_BINARY, TELNET_IAC, TELNET_WILL, TELNET_OPTION_SUPPRESS_GO_AHEAD, TELNET_IAC, TELNET_DO, TELNET_OPTION_SUPPRESS_GO_AHEAD, TELNET_IAC, TELNET_WILL, TELNET_OPTION_COM_PORT};
+        baNegotiate.append((const char *)baOptions, sizeof(baOptions));
+        SendRaw(baNegotiate);
+
+        SetBaudRate(nBaudRate);
+        SendComPortCommand(RFC2217_SET_DATASIZE, QByteArray(1, 8));
+        SendComPortCommand(RFC2217_SET_PARITY, QByteArray(1, RFC2217_PARITY_NONE));
+        SendComPortCommand(RFC2217_SET_STOPSIZE, QByteArray(1, RFC2217_STOPSIZE_1));
+        SendComPortCommand(RFC2217_SET_CONTROL, QByteArray(1, RFC2217_CONTROL_HARDWARE_FLOW));
+        SendComPortCommand(RFC2217_SET_MODEMSTATE_MASK, QByteArray(1, RFC2217_MODEMSTATE_CTS));
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Starts closing the connection to the bridge, data which has been written is
+// sent first. The close finishes in the background and is aborted if it takes
+// too long
+//=============================================================================
+void
+LrdFwTransportNetwork::Close(
+    )
+{
+    if (tcpSocket.state() == QAbstractSocket::UnconnectedState || bClosing == true)
+    {
+        return;
+    }
+
+    emit Closing();
+    bClosing = true;
+    tmrConnect.stop();
+    baPendingWrite.clear();
+    tcpSocket.disconnectFromHost();
+    if (tcpSocket.state() != QAbstractSocket::UnconnectedState)
+    {
+        tmrDisconnect.start(NETWORK_DISCONNECT_TIMEOUT_MS);
+    }
+    else
+    {
+        bClosing = false;
+    }
+}
+
+//=============================================================================
+// Returns true if connected, or connecting, to the bridge
+//=============================================================================
+bool
+LrdFwTransportNetwork::IsOpen(
+    )
+{
+    return (bClosing == false && tcpSocket.state() != QAbstractSocket::UnconnectedState);
+}
+
+//=============================================================================
+// Writes all parts of a packet as one TCP write, IAC bytes are escaped for
+// RFC 2217
+//=============================================================================
+qint64
+LrdFwTransportNetwork::Write(
+    const QByteArray *pParts,
+    uint8_t nParts
+    )
+{
+    QByteArray baPacket;
+    qint64 nTotal = 0;
+    uint8_t i = 0;
+
+    while (i < nParts)
+    {
+        nTotal += pParts[i].length();
+        ++i;
+    }
+    baPacket.reserve(nTotal + (bRFC2217 == true ? nTotal/16 : 0));
+
+    i = 0;
+    while (i < nParts)
+    {
+        if (bRFC2217 == true && pParts[i].contains((char)TELNET_IAC))
+        {
+            //Escape IAC bytes by doubling them
+            QByteArray baEscaped = pParts[i];
+            baPacket.append(baEscaped.replace(QByteArray(1, (char)TELNET_IAC), QByteArray(2, (char)TELNET_IAC)));
+        }
+        else
+        {
+            baPacket.append(pParts[i]);
+        }
+        ++i;
+    }
+
+    if (SendRaw(baPacket) == false)
+    {
+        return -1;
+    }
+
+    //The socket buffers the whole packet, what is still to be sent is reported by OutputQueueBytes()
+    emit BytesWritten(nTotal);
+
+    return nTotal;
+}
+
+//=============================================================================
+// Reads received serial data into the provided buffer
+//=============================================================================
+qint64
+LrdFwTransportNetwork::Read(
+    char *pBuffer,
+    qint64 nMaxSize
+    )
+{
+    qint64 nRead = (baReceived.length() < nMaxSize ? baReceived.length() : nMaxSize);
+
+    if (nRead > 0)
+    {
+        memcpy(pBuffer, baReceived.constData(), nRead);
+        baReceived.remove(0, nRead);
+    }
+
+    return nRead;
+}
+
+//=============================================================================
+// Returns the CTS state reported by the bridge (raw TCP bridges are always
+// treated as ready)
+//=============================================================================
+bool
+LrdFwTransportNetwork::ClearToSend(
+    )
+{
+    return bClearToSend;
+}
+
+//=============================================================================
+// Sets DTR to be high or low (RFC 2217 only)
+//=============================================================================
+void
+LrdFwTransportNetwork::SetDTR(
+    bool bEnabled
+    )
+{
+    if (bRFC2217 == true)
+    {
+        SendComPortCommand(RFC2217_SET_CONTROL, QByteArray(1, (bEnabled == true ? RFC2217_CONTROL_DTR_ON : RFC2217_CONTROL_DTR_OFF)));
+    }
+}
+
+//=============================================================================
+// Applies or removes BREAK (RFC 2217 only)
+//=============================================================================
+void
+LrdFwTransportNetwork::SetBreak(
+    bool bEnabled
+    )
+{
+    if (bRFC2217 == true)
+    {
+        SendComPortCommand(RFC2217_SET_CONTROL, QByteArray(1, (bEnabled == true ? RFC2217_CONTROL_BREAK_ON : RFC2217_CONTROL_BREAK_OFF)));
+    }
+}
+
+//=============================================================================
+// Changes the baud rate of the remote port without reconnecting, raw TCP
+// bridges have a fixed baud rate so this fails for them
+//=============================================================================
+bool
+LrdFwTransportNetwork::SetBaudRate(
+    quint32 nBaudRate
+    )
+{
+    if (bRFC2217 == false)
+    {
+        return false;
+    }
+
+    QByteArray baBaudRate;
+    baBaudRate.append((char)((nBaudRate >> 24) & 0xff));
+    baBaudRate.append((char)((nBaudRate >> 16) & 0xff));
+    baBaudRate.append((char)((nBaudRate >> 8) & 0xff));
+    baBaudRate.append((char)(nBaudRate & 0xff));
+    SendComPortCommand(RFC2217_SET_BAUDRATE, baBaudRate);
+
+    return true;
+}
+
+//=============================================================================
+// Returns the number of bytes buffered by the socket, or waiting for the
+// connection, which have not been sent to the bridge yet
+//=============================================================================
+qint64
+LrdFwTransportNetwork::OutputQueueBytes(
+    )
+{
+    return tcpSocket.bytesToWrite() + baPendingWrite.length();
+}
+
+//=============================================================================
+// Writes data to the bridge, or holds it until the connection has been made
+//=============================================================================
+bool
+LrdFwTransportNetwork::SendRaw(
+    const QByteArray &baData
+    )
+{
+    if (bClosing == true || tcpSocket.state() == QAbstractSocket::UnconnectedState)
+    {
+        return false;
+    }
+
+    if (tcpSocket.state() != QAbstractSocket::ConnectedState)
+    {
+        //Still connecting
+        baPendingWrite.append(baData);
+        return true;
+    }
+
+    return (tcpSocket.write(baData) != -1);
+}
+
+//=============================================================================
+// Abandons a connection attempt and reports that the port could not be opened
+//=============================================================================
+void
+LrdFwTransportNetwork::ConnectFailed(
+    )
+{
+    tmrConnect.stop();
+    baPendingWrite.clear();
+    bClosing = true;
+    tcpSocket.abort();
+    bClosing = false;
+    emit Closing();
+    emit TransportError(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
+}
+
+//=============================================================================
+// Sends an RFC 2217 COM port option subnegotiation
+//=============================================================================
+void
+LrdFwTransportNetwork::SendComPortCommand(
+    uint8_t nCommand,
+    QByteArray baValue
+    )
+{
+    QByteArray baCommand;
+    baCommand.append((char)TELNET_IAC);
+    baCommand.append((char)TELNET_SB);
+    baCommand.append((char)TELNET_OPTION_COM_PORT);
+    baCommand.append((char)nCommand);
+    baCommand.append(baValue.replace(QByteArray(1, (char)TELNET_IAC), QByteArray(2, (char)TELNET_IAC)));
+    baCommand.append((char)TELNET_IAC);
+    baCommand.append((char)TELNET_SE);
+    SendRaw(baCommand);
+}
+
+//=============================================================================
+// Replies to a telnet option negotiation from the bridge, only the options
+// needed for a binary COM port link are accepted
+//=============================================================================
+void
+LrdFwTransportNetwork::ProcessOption(
+    uint8_t nCommand,
+    uint8_t nOption
+    )
+{
+    bool bSupported = (nOption == TELNET_OPTION_BINARY || nOption == TELNET_OPTION_SUPPRESS_GO_AHEAD || nOption == TELNET_OPTION_COM_PORT);
+    QByteArray baReply;
+
+    if (nCommand == TELNET_DO && bSupported == false)
+    {
+        //Refuse to enable an unsupported option locally
+        baReply.append((char)TELNET_IAC);
+        baReply.append((char)TELNET_WONT);
+        baReply.append((char)nOption);
+    }
+    else if (nCommand == TELNET_WILL && bSupported == false)
+    {
+        //Refuse to let the bridge enable an unsupported option
+        baReply.append((char)TELNET_IAC);
+        baReply.append((char)TELNET_DONT);
+        baReply.append((char)nOption);
+    }
+
+    //Supported options were already requested when connecting so are not acknowledged again (prevents negotiation loops)
+    if (!baReply.isEmpty())
+    {
+        SendRaw(baReply);
+    }
+}
+
+//=============================================================================
+// Handles a completed subnegotiation from the bridge
+//=============================================================================
+void
+LrdFwTransportNetwork::ProcessSubnegotiation(
+    )
+{
+    if (baSubnegotiation.length() >= 3 && (uint8_t)baSubnegotiation.at(0) == TELNET_OPTION_COM_PORT && (uint8_t)baSubnegotiation.at(1) == (RFC2217_NOTIFY_MODEMSTATE + RFC2217_SERVER_OFFSET))
+    {
+        //Modem line state change
+        bClearToSend = (((uint8_t)baSubnegotiation.at(2) & RFC2217_MODEMSTATE_CTS) ? true : false);
+    }
+    baSubnegotiation.clear();
+}
+
+//=============================================================================
+// Callback when data has been received from the bridge, telnet commands are
+// removed from the stream for RFC 2217
+//=============================================================================
+void
+LrdFwTransportNetwork::SocketRead(
+    )
+{
+    QByteArray baData = tcpSocket.readAll();
+    qsizetype nPreviousLength = baReceived.length();
+
+    if (bRFC2217 == false)
+    {
+        //Raw stream
+        baReceived.append(baData);
+    }
+    else
+    {
+        qsizetype i = 0;
+        baReceived.reserve(baReceived.length() + baData.length());
+        while (i < baData.length())
+        {
+            uint8_t nByte = (uint8_t)baData.at(i);
+            if (nReceiveState == TELNET_STATE_DATA)
+            {
+                if (nByte == TELNET_IAC)
+                {
+                    nReceiveState = TELNET_STATE_IAC;
+                }
+                else
+                {
+                    baReceived.append((char)nByte);
+                }
+            }
+            else if (nReceiveState == TELNET_STATE_IAC)
+            {
+                if (nByte == TELNET_IAC)
+                {
+                    //Escaped 0xff data byte
+                    baReceived.append((char)nByte);
+                    nReceiveState = TELNET_STATE_DATA;
+                }
+                else if (nByte == TELNET_SB)
+                {
+                    baSubnegotiation.clear();
+                    nReceiveState = TELNET_STATE_SUBNEGOTIATION;
+                }
+                else if (nByte == TELNET_WILL || nByte == TELNET_WONT || nByte == TELNET_DO || nByte == TELNET_DONT)
+                {
+                    nOptionCommand = nByte;
+                    nReceiveState = TELNET_STATE_OPTION;
+                }
+                else
+                {
+                    //Other telnet commands are ignored
+                    nReceiveState = TELNET_STATE_DATA;
+                }
+            }
+            else if (nReceiveState == TELNET_STATE_OPTION)
+            {
+                ProcessOption(nOptionCommand, nByte);
+                nReceiveState = TELNET_STATE_DATA;
+            }
+            else if (nReceiveState == TELNET_STATE_SUBNEGOTIATION)
+            {
+                if (nByte == TELNET_IAC)
+                {
+                    nReceiveState = TELNET_STATE_SUBNEGOTIATION_IAC;
+                }
+                else
+                {
+                    baSubnegotiation.append((char)nByte);
+                }
+            }
+            else
+            {
+                if (nByte == TELNET_SE)
+                {
+                    //End of subnegotiation
+                    ProcessSubnegotiation();
+                    nReceiveState = TELNET_STATE_DATA;
+                }
+                else
+                {
+                    //Escaped 0xff in subnegotiation data
+                    baSubnegotiation.append((char)nByte);
+                    nReceiveState = TELNET_STATE_SUBNEGOTIATION;
+                }
+            }
+            ++i;
+        }
+    }
+
+    if (baReceived.length() > nPreviousLength)
+    {
+        emit ReadyRead();
+    }
+}
+
+//=============================================================================
+// Callback when the connection to the bridge has been made, data written
+// whilst connecting is sent
+//=============================================================================
+void
+LrdFwTransportNetwork::SocketConnected(
+    )
+{
+    tmrConnect.stop();
+
+    //Packets are sent with a single write each, there is no need to wait to coalesce them
+    tcpSocket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    if (!baPendingWrite.isEmpty())
+    {
+        tcpSocket.write(baPendingWrite);
+        baPendingWrite.clear();
+    }
+}
+
+//=============================================================================
+// Callback when the bridge closes the connection, or a close has finished
+//=============================================================================
+void
+LrdFwTransportNetwork::SocketDisconnected(
+    )
+{
+    if (bClosing == false)
+    {
+        //Connection was lost
+        emit Closing();
+        emit TransportError(EXIT_CODE_SERIAL_PORT_DEVICE_UNPLUGGED);
+    }
+    else if (tmrDisconnect.isActive())
+    {
+        //Close has finished
+        tmrDisconnect.stop();
+        bClosing = false;
+    }
+}
+
+//=============================================================================
+// Callback when a socket error occurs, only errors whilst connecting are
+// handled here as a lost connection is reported by SocketDisconnected()
+//=============================================================================
+void
+LrdFwTransportNetwork::SocketError(
+    QAbstractSocket::SocketError
+    )
+{
+    if (tmrConnect.isActive())
+    {
+        //Could not connect to bridge
+        ConnectFailed();
+    }
+}
+
+//=============================================================================
+// Callback when the connection to the bridge has not been made in time
+//=============================================================================
+void
+LrdFwTransportNetwork::ConnectTimeout(
+    )
+{
+    if (tcpSocket.state() != QAbstractSocket::ConnectedState)
+    {
+        ConnectFailed();
+    }
+}
+
+//=============================================================================
+// Callback when the bridge has not closed the connection in time
+//=============================================================================
+void
+LrdFwTransportNetwork::DisconnectTimeout(
+    )
+{
+    tcpSocket.abort();
+    bClosing = false;
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
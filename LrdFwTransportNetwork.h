@@ -0,0 +1,203 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportNetwork.h
+**
+** Notes:   Network transport backend for modules exposed by serial to TCP
+**          bridges, either as a raw TCP stream (tcp://host:port) or using the
+**          RFC 2217 telnet COM port control option (rfc2217://host:port)
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRANSPORTNETWORK_H
+#define LRDFWTRANSPORTNETWORK_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QTcpSocket>
+#include <QTimer>
+#include "LrdFwTransport.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define NETWORK_SCHEME_RAW                            "tcp://"
+#define NETWORK_SCHEME_RFC2217                        "rfc2217://"
+#define NETWORK_CONNECT_TIMEOUT_MS                    5000
+#define NETWORK_DISCONNECT_TIMEOUT_MS                 5000
+
+//Telnet commands and options
+#define TELNET_IAC                                    255
+#define TELNET_DONT                                   254
+#define TELNET_DO                                     253
+#define TELNET_WONT                                   252
+#define TELNET_WILL                                   251
+#define TELNET_SB                                     250
+#define TELNET_SE                                     240
+#define TELNET_OPTION_BINARY                          0
+#define TELNET_OPTION_SUPPRESS_GO_AHEAD               3
+#define TELNET_OPTION_COM_PORT                        44
+
+//RFC 2217 COM port option commands (responses from the server add 100)
+#define RFC2217_SET_BAUDRATE                          1
+#define RFC2217_SET_DATASIZE                          2
+#define RFC2217_SET_PARITY                            3
+#define RFC2217_SET_STOPSIZE                          4
+#define RFC2217_SET_CONTROL                           5
+#define RFC2217_NOTIFY_MODEMSTATE                     7
+#define RFC2217_SET_MODEMSTATE_MASK                   11
+#define RFC2217_SERVER_OFFSET                         100
+
+#define RFC2217_PARITY_NONE                           1
+#define RFC2217_STOPSIZE_1                            1
+#define RFC2217_CONTROL_HARDWARE_FLOW                 3
+#define RFC2217_CONTROL_BREAK_ON                      5
+#define RFC2217_CONTROL_BREAK_OFF                     6
+#define RFC2217_CONTROL_DTR_ON                        8
+#define RFC2217_CONTROL_DTR_OFF                       9
+#define RFC2217_MODEMSTATE_CTS                        0x10
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+enum TELNET_RECEIVE_STATES
+{
+    TELNET_STATE_DATA,
+    TELNET_STATE_IAC,
+    TELNET_STATE_OPTION,
+    TELNET_STATE_SUBNEGOTIATION,
+    TELNET_STATE_SUBNEGOTIATION_IAC
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTransportNetwork : public LrdFwTransport
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwTransportNetwork(
+        QObject *parent = nullptr
+        );
+    ~LrdFwTransportNetwork(
+        );
+    static bool
+    IsNetworkPort(
+        QString strPort
+        );
+    bool
+    Open(
+        QString strPort,
+        quint32 nBaudRate
+        ) override;
+    void
+    Close(
+        ) override;
+    bool
+    IsOpen(
+        ) override;
+    qint64
+    Write(
+        const QByteArray *pParts,
+        uint8_t nParts
+        ) override;
+    qint64
+    Read(
+        char *pBuffer,
+        qint64 nMaxSize
+        ) override;
+    bool
+    ClearToSend(
+        ) override;
+    void
+    SetDTR(
+        bool bEnabled
+        ) override;
+    void
+    SetBreak(
+        bool bEnabled
+        ) override;
+    bool
+    SetBaudRate(
+        quint32 nBaudRate
+        ) override;
+    qint64
+    OutputQueueBytes(
+        ) override;
+
+private slots:
+    void
+    SocketRead(
+        );
+    void
+    SocketConnected(
+        );
+    void
+    SocketDisconnected(
+        );
+    void
+    SocketError(
+        QAbstractSocket::SocketError nError
+        );
+    void
+    ConnectTimeout(
+        );
+    void
+    DisconnectTimeout(
+        );
+
+private:
+    bool
+    SendRaw(
+        const QByteArray &baData
+        );
+    void
+    ConnectFailed(
+        );
+    void
+    SendComPortCommand(
+        uint8_t nCommand,
+        QByteArray baValue
+        );
+    void
+    ProcessOption(
+        uint8_t nCommand,
+        uint8_t nOption
+        );
+    void
+    ProcessSubnegotiation(
+        );
+
+    QTcpSocket  tcpSocket;            //Connection to the bridge
+    QTimer      tmrConnect;           //Timer used to abandon a connection attempt which takes too long
+    QTimer      tmrDisconnect;        //Timer used to abort a close which takes too long
+    bool        bRFC2217;             //True if the RFC 2217 COM port option is used
+    bool        bClosing;             //True whilst the connection is being closed
+    bool        bClearToSend;         //Last CTS state reported by the bridge
+    uint8_t     nReceiveState;        //Telnet receive state
+    uint8_t     nOptionCommand;       //Telnet command (WILL/WONT/DO/DONT) waiting for its option
+    QByteArray  baSubnegotiation;     //Subnegotiation data being received
+    QByteArray  baReceived;           //Received serial data waiting to be read
+    QByteArray  baPendingWrite;       //Data written whilst connecting, sent once connected
+};
+
+#endif // LRDFWTRANSPORTNETWORK_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,410 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportReplay.cpp
+**
+** Notes:   Replay transport, acts as a module by sending the responses from a
+**          serial capture (replay://<file>) when the data transmitted matches the
+**          capture, with the captured or scaled response timing
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwTransportReplay.h"
+#include <QFile>
+#include <QDebug>
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwTransportReplay::LrdFwTransportReplay(
+    quint32 nResponseDelayPercent,
+    uint8_t nOutputVerbosity,
+    QObject *parent
+    ) : LrdFwTransport(parent)
+{
+    nDelayPercent = nResponseDelayPercent;
+    nVerbosity = nOutputVerbosity;
+    nRecordIndex = 0;
+    nRecordOffset = 0;
+    nLastTimeUS = 0;
+    bOpen = false;
+    bReadPending = false;
+
+    tmrResponse.setSingleShot(true);
+    connect(&tmrResponse, SIGNAL(timeout()), this, SLOT(ResponseTimerTimeout()));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwTransportReplay::~LrdFwTransportReplay(
+    )
+{
+    disconnect(&tmrResponse, SIGNAL(timeout()), this, SLOT(ResponseTimerTimeout()));
+    Close();
+}
+
+//=============================================================================
+// Returns true if a port name refers to a capture to replay
+//=============================================================================
+bool
+LrdFwTransportReplay::IsReplayPort(
+    QString strPort
+    )
+{
+    return strPort.startsWith(REPLAY_SCHEME, Qt::CaseInsensitive);
+}
+
+//=============================================================================
+// Loads the capture, if the same capture is re-opened part way through (i.e.
+// the port is re-opened during an update) replay continues where it was
+//=============================================================================
+bool
+LrdFwTransportReplay::Open(
+    QString strPort,
+    quint32
+    )
+{
+    QString strNewFilename = strPort.mid(qstrlen(REPLAY_SCHEME));
+
+    if (strNewFilename != strFilename || nRecordIndex >= lstRecords.count())
+    {
+        //Start from the beginning of the capture
+        if (LoadCapture(strNewFilename) == false)
+        {
+            //Reported by the caller as the port failing to open
+            if (nVerbosity >= VERBOSITY_MODES)
+            {
+                qDebug() << "Replay capture file could not be read:" << strNewFilename;
+            }
+            return false;
+        }
+    }
+
+    bOpen = true;
+    Advance();
+
+    return true;
+}
+
+//=============================================================================
+// Closes the transport, the position in the capture is kept
+//=============================================================================
+void
+LrdFwTransportReplay::Close(
+    )
+{
+    if (bOpen == false)
+    {
+        return;
+    }
+
+    emit Closing();
+    bOpen = false;
+    bReadPending = false;
+    tmrResponse.stop();
+    baReceived.clear();
+}
+
+//=============================================================================
+// Returns true if the transport is open
+//=============================================================================
+bool
+LrdFwTransportReplay::IsOpen(
+    )
+{
+    return bOpen;
+}
+
+//=============================================================================
+// Checks transmitted data against the capture, responses which follow it are
+// then replayed
+//=============================================================================
+qint64
+LrdFwTransportReplay::Write(
+    const QByteArray *pParts,
+    uint8_t nParts
+    )
+{
+    qint64 nTotal = 0;
+    uint8_t i = 0;
+    bool bResponsesSent = false;
+
+    if (bOpen == false)
+    {
+        return -1;
+    }
+
+    while (i < nParts)
+    {
+        const QByteArray &baPart = pParts[i];
+        qsizetype nPosition = 0;
+        while (nPosition < baPart.length())
+        {
+            if (nRecordIndex < lstRecords.count() && lstRecords.at(nRecordIndex).bTransmit == false)
+            {
+                //The update has moved on before a response was due, send it straight away
+                tmrResponse.stop();
+                baReceived.append(lstRecords.at(nRecordIndex).baData);
+                nLastTimeUS = lstRecords.at(nRecordIndex).nTimeUS;
+                ++nRecordIndex;
+                bResponsesSent = true;
+                continue;
+            }
+
+            if (nRecordIndex >= lstRecords.count())
+            {
+                //Transmitting beyond the end of the capture
+                if (nVerbosity >= VERBOSITY_COMMANDS)
+                {
+                    qDebug() << "Replay: data transmitted after the end of the capture";
+                }
+                QTimer::singleShot(0, this, SLOT(ReportMismatch()));
+                return -1;
+            }
+
+            const CaptureRecordStruct &sRecord = lstRecords.at(nRecordIndex);
+            qsizetype nCompare = qMin(baPart.length() - nPosition, sRecord.baData.length() - nRecordOffset);
+            if (memcmp(baPart.constData() + nPosition, sRecord.baData.constData() + nRecordOffset, nCompare) != 0)
+            {
+                //Update has diverged from the capture
+                if (nVerbosity >= VERBOSITY_COMMANDS)
+                {
+                    qDebug() << "Replay: transmitted data does not match capture record" << nRecordIndex << ", expected" << sRecord.baData.mid(nRecordOffset).toHex() << "got" << baPart.mid(nPosition).toHex();
+                }
+                QTimer::singleShot(0, this, SLOT(ReportMismatch()));
+                return -1;
+            }
+
+            nPosition += nCompare;
+            nRecordOffset += nCompare;
+            if (nRecordOffset == sRecord.baData.length())
+            {
+                //Whole record has been transmitted
+                nLastTimeUS = sRecord.nTimeUS;
+                nRecordOffset = 0;
+                ++nRecordIndex;
+            }
+        }
+        nTotal += baPart.length();
+        ++i;
+    }
+
+    emit BytesWritten(nTotal);
+    if (bResponsesSent == true && bReadPending == false)
+    {
+        //Responses are signalled from the event loop, the caller is still inside the write
+        bReadPending = true;
+        QTimer::singleShot(0, this, SLOT(SendPendingReadyRead()));
+    }
+    Advance();
+
+    return nTotal;
+}
+
+//=============================================================================
+// Reads replayed data into the provided buffer
+//=============================================================================
+qint64
+LrdFwTransportReplay::Read(
+    char *pBuffer,
+    qint64 nMaxSize
+    )
+{
+    qint64 nRead = (baReceived.length() < nMaxSize ? baReceived.length() : nMaxSize);
+
+    if (nRead > 0)
+    {
+        memcpy(pBuffer, baReceived.constData(), nRead);
+        baReceived.remove(0, nRead);
+    }
+
+    return nRead;
+}
+
+//=============================================================================
+// The replayed module is always ready
+//=============================================================================
+bool
+LrdFwTransportReplay::ClearToSend(
+    )
+{
+    return true;
+}
+
+//=============================================================================
+// Not used when replaying
+//=============================================================================
+void
+LrdFwTransportReplay::SetDTR(
+    bool
+    )
+{
+}
+
+//=============================================================================
+// Not used when replaying
+//=============================================================================
+void
+LrdFwTransportReplay::SetBreak(
+    bool
+    )
+{
+}
+
+//=============================================================================
+// The baud rate has no effect on a replay so changes are always accepted
+//=============================================================================
+bool
+LrdFwTransportReplay::SetBaudRate(
+    quint32
+    )
+{
+    return true;
+}
+
+//=============================================================================
+// Callback when the next response record is due
+//=============================================================================
+void
+LrdFwTransportReplay::ResponseTimerTimeout(
+    )
+{
+    if (bOpen == false || nRecordIndex >= lstRecords.count() || lstRecords.at(nRecordIndex).bTransmit == true)
+    {
+        return;
+    }
+
+    baReceived.append(lstRecords.at(nRecordIndex).baData);
+    nLastTimeUS = lstRecords.at(nRecordIndex).nTimeUS;
+    ++nRecordIndex;
+    emit ReadyRead();
+    Advance();
+}
+
+//=============================================================================
+// Signals responses which were queued up during a write
+//=============================================================================
+void
+LrdFwTransportReplay::SendPendingReadyRead(
+    )
+{
+    if (bReadPending == false)
+    {
+        //Transport has been closed since the responses were queued
+        return;
+    }
+
+    bReadPending = false;
+    if (baReceived.isEmpty() == false)
+    {
+        emit ReadyRead();
+    }
+}
+
+//=============================================================================
+// Reports that the update does not match the capture
+//=============================================================================
+void
+LrdFwTransportReplay::ReportMismatch(
+    )
+{
+    emit TransportError(EXIT_CODE_REPLAY_MISMATCH);
+}
+
+//=============================================================================
+// Reads a capture file
+//=============================================================================
+bool
+LrdFwTransportReplay::LoadCapture(
+    QString strCaptureFilename
+    )
+{
+    QFile fileCapture(strCaptureFilename);
+
+    strFilename.clear();
+    lstRecords.clear();
+    nRecordIndex = 0;
+    nRecordOffset = 0;
+    nLastTimeUS = 0;
+
+    if (fileCapture.open(QIODevice::ReadOnly | QIODevice::Text) == false)
+    {
+        return false;
+    }
+
+    while (!fileCapture.atEnd())
+    {
+        QByteArray baLine = fileCapture.readLine().trimmed();
+        if (baLine.isEmpty() || baLine.at(0) == CAPTURE_COMMENT)
+        {
+            //Blank line or comment
+            continue;
+        }
+
+        QList<QByteArray> lstFields = baLine.split(' ');
+        bool bTimeOk = false;
+        CaptureRecordStruct sRecord;
+        if (lstFields.count() != 3 || lstFields.at(1).length() != 1)
+        {
+            //Not a valid record
+            return false;
+        }
+
+        sRecord.nTimeUS = lstFields.at(0).toLongLong(&bTimeOk);
+        if (bTimeOk == false || (lstFields.at(1).at(0) != CAPTURE_DIRECTION_TRANSMIT && lstFields.at(1).at(0) != CAPTURE_DIRECTION_RECEIVE))
+        {
+            return false;
+        }
+        sRecord.bTransmit = (lstFields.at(1).at(0) == CAPTURE_DIRECTION_TRANSMIT);
+        sRecord.baData = QByteArray::fromHex(lstFields.at(2));
+        lstRecords.append(sRecord);
+    }
+
+    if (lstRecords.isEmpty())
+    {
+        return false;
+    }
+
+    strFilename = strCaptureFilename;
+
+    return true;
+}
+
+//=============================================================================
+// Schedules the next response record if the capture is waiting on one
+//=============================================================================
+void
+LrdFwTransportReplay::Advance(
+    )
+{
+    if (bOpen == false || tmrResponse.isActive() || nRecordIndex >= lstRecords.count() || lstRecords.at(nRecordIndex).bTransmit == true)
+    {
+        return;
+    }
+
+    //Delay from the previous record, scaled by the configured percentage
+    qint64 nDelayMS = (lstRecords.at(nRecordIndex).nTimeUS - nLastTimeUS) * nDelayPercent / 100 / 1000;
+    tmrResponse.start(nDelayMS > 0 ? (int)nDelayMS : 0);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,148 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportReplay.h
+**
+** Notes:   Replay transport, acts as a module by sending the responses from a
+**          serial capture (replay://<file>) when the data transmitted matches the
+**          capture, with the captured or scaled response timing
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRANSPORTREPLAY_H
+#define LRDFWTRANSPORTREPLAY_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QTimer>
+#include <QList>
+#include "LrdFwTransport.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define REPLAY_SCHEME                                 "replay://"
+//Capture file format, each line is "<time in us> <T|R> <data in hex>"
+#define CAPTURE_COMMENT                               '#'
+#define CAPTURE_DIRECTION_TRANSMIT                    'T'
+#define CAPTURE_DIRECTION_RECEIVE                     'R'
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Structure to hold a single capture record
+typedef struct
+{
+    qint64     nTimeUS;   //Time of the record since the capture started
+    bool       bTransmit; //True if the data was transmitted to the module, false if it was received from it
+    QByteArray baData;    //Data transmitted or received
+} CaptureRecordStruct;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTransportReplay : public LrdFwTransport
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwTransportReplay(
+        quint32 nResponseDelayPercent,
+        uint8_t nOutputVerbosity,
+        QObject *parent = nullptr
+        );
+    ~LrdFwTransportReplay(
+        );
+    static bool
+    IsReplayPort(
+        QString strPort
+        );
+    bool
+    Open(
+        QString strPort,
+        quint32 nBaudRate
+        ) override;
+    void
+    Close(
+        ) override;
+    bool
+    IsOpen(
+        ) override;
+    qint64
+    Write(
+        const QByteArray *pParts,
+        uint8_t nParts
+        ) override;
+    qint64
+    Read(
+        char *pBuffer,
+        qint64 nMaxSize
+        ) override;
+    bool
+    ClearToSend(
+        ) override;
+    void
+    SetDTR(
+        bool bEnabled
+        ) override;
+    void
+    SetBreak(
+        bool bEnabled
+        ) override;
+    bool
+    SetBaudRate(
+        quint32 nBaudRate
+        ) override;
+
+private slots:
+    void
+    ResponseTimerTimeout(
+        );
+    void
+    SendPendingReadyRead(
+        );
+    void
+    ReportMismatch(
+        );
+
+private:
+    bool
+    LoadCapture(
+        QString strCaptureFilename
+        );
+    void
+    Advance(
+        );
+
+    QString                    strFilename;     //Capture file which is loaded
+    QList<CaptureRecordStruct> lstRecords;      //Records from the capture file
+    qsizetype                  nRecordIndex;    //Index into lstRecords of the next record to replay
+    qsizetype                  nRecordOffset;   //Number of bytes of the current transmit record which have been matched
+    qint64                     nLastTimeUS;     //Capture time of the last record which was replayed
+    quint32                    nDelayPercent;   //Percentage of the captured response delays to use
+    uint8_t                    nVerbosity;      //The verbosity level of the output
+    bool                       bOpen;           //True if the transport is open
+    bool                       bReadPending;    //True if a ready read signal is queued for responses sent during a write
+    QByteArray                 baReceived;      //Replayed data waiting to be read
+    QTimer                     tmrResponse;     //Timer used to send the next response record
+};
+
+#endif // LRDFWTRANSPORTREPLAY_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,233 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportSerial.cpp
+**
+** Notes:   QSerialPort transport backend, this is the portable default
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwTransportSerial.h"
+#ifdef __linux__
+#include <sys/ioctl.h>
+#endif
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwTransportSerial::LrdFwTransportSerial(
+    QObject *parent
+    ) : LrdFwTransport(parent)
+{
+    //Connect serial signals
+    connect(&spSerialPort, SIGNAL(readyRead()), this, SIGNAL(ReadyRead()));
+    connect(&spSerialPort, SIGNAL(bytesWritten(qint64)), this, SIGNAL(BytesWritten(qint64)));
+    connect(&spSerialPort, SIGNAL(aboutToClose()), this, SIGNAL(Closing()));
+    connect(&spSerialPort, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(SerialError(QSerialPort::SerialPortError)));
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwTransportSerial::~LrdFwTransportSerial(
+    )
+{
+    //Remove serial signals
+    disconnect(&spSerialPort, SIGNAL(readyRead()), this, SIGNAL(ReadyRead()));
+    disconnect(&spSerialPort, SIGNAL(bytesWritten(qint64)), this, SIGNAL(BytesWritten(qint64)));
+    disconnect(&spSerialPort, SIGNAL(aboutToClose()), this, SIGNAL(Closing()));
+    disconnect(&spSerialPort, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(SerialError(QSerialPort::SerialPortError)));
+
+    if (spSerialPort.isOpen())
+    {
+        //Close serial port
+        spSerialPort.flush();
+        spSerialPort.close();
+    }
+}
+
+//=============================================================================
+// Opens the serial port with 8N1 and hardware flow control
+//=============================================================================
+bool
+LrdFwTransportSerial::Open(
+    QString strPort,
+    quint32 nBaudRate
+    )
+{
+    spSerialPort.setPortName(strPort);
+    spSerialPort.setBaudRate(nBaudRate);
+    spSerialPort.setDataBits(QSerialPort::Data8);
+    spSerialPort.setStopBits(QSerialPort::OneStop);
+    spSerialPort.setParity(QSerialPort::NoParity);
+    spSerialPort.setFlowControl(QSerialPort::HardwareControl);
+
+    return spSerialPort.open(QSerialPort::ReadWrite);
+}
+
+//=============================================================================
+// Closes the serial port, if open
+//=============================================================================
+void
+LrdFwTransportSerial::Close(
+    )
+{
+    if (spSerialPort.isOpen())
+    {
+        //Port is open, close it
+        spSerialPort.flush();
+        spSerialPort.close();
+    }
+}
+
+//=============================================================================
+// Returns true if the serial port is open
+//=============================================================================
+bool
+LrdFwTransportSerial::IsOpen(
+    )
+{
+    return spSerialPort.isOpen();
+}
+
+//=============================================================================
+// Queues data to be written, QSerialPort buffers internally so the parts are
+// written one after the other
+//=============================================================================
+qint64
+LrdFwTransportSerial::Write(
+    const QByteArray *pParts,
+    uint8_t nParts
+    )
+{
+    qint64 nWritten = 0;
+    uint8_t i = 0;
+    while (i < nParts)
+    {
+        qint64 nResult = spSerialPort.write(pParts[i]);
+        if (nResult < 0)
+        {
+            return nResult;
+        }
+        nWritten += nResult;
+        ++i;
+    }
+
+    return nWritten;
+}
+
+//=============================================================================
+// Returns the number of bytes in the driver output queue which have not been
+// transmitted yet (Linux only)
+//=============================================================================
+qint64
+LrdFwTransportSerial::OutputQueueBytes(
+    )
+{
+#ifdef __linux__
+    int nQueued = 0;
+
+    if (spSerialPort.isOpen() && ioctl(spSerialPort.handle(), TIOCOUTQ, &nQueued) != -1)
+    {
+        return nQueued;
+    }
+#endif
+
+    return 0;
+}
+
+//=============================================================================
+// Reads received data into the provided buffer
+//=============================================================================
+qint64
+LrdFwTransportSerial::Read(
+    char *pBuffer,
+    qint64 nMaxSize
+    )
+{
+    return spSerialPort.read(pBuffer, nMaxSize);
+}
+
+//=============================================================================
+// Returns true if CTS is asserted
+//=============================================================================
+bool
+LrdFwTransportSerial::ClearToSend(
+    )
+{
+    return ((spSerialPort.pinoutSignals() & QSerialPort::ClearToSendSignal) ? true : false);
+}
+
+//=============================================================================
+// Sets DTR to be high or low
+//=============================================================================
+void
+LrdFwTransportSerial::SetDTR(
+    bool bEnabled
+    )
+{
+    spSerialPort.setDataTerminalReady(bEnabled);
+}
+
+//=============================================================================
+// Applies or removes BREAK
+//=============================================================================
+void
+LrdFwTransportSerial::SetBreak(
+    bool bEnabled
+    )
+{
+    spSerialPort.setBreakEnabled(bEnabled);
+}
+
+//=============================================================================
+// Serial port error handler
+//=============================================================================
+void
+LrdFwTransportSerial::SerialError(
+    QSerialPort::SerialPortError speErrorCode
+    )
+{
+    if (speErrorCode == QSerialPort::NoError)
+    {
+        //No error. Why this is ever emitted is a mystery to me.
+        return;
+    }
+#if QT_VERSION < 0x050700
+    //As of Qt 5.7 these are now deprecated. It is being left in as a conditional compile for anyone using older versions of Qt to prevent these errors closing the serial port.
+    else if (speErrorCode == QSerialPort::ParityError)
+    {
+        //Parity error
+    }
+    else if (speErrorCode == QSerialPort::FramingError)
+    {
+        //Framing error
+    }
+#endif
+    else if (speErrorCode == QSerialPort::ResourceError || speErrorCode == QSerialPort::PermissionError)
+    {
+        //Resource error or permission error (device unplugged?)
+        emit TransportError(EXIT_CODE_SERIAL_PORT_DEVICE_UNPLUGGED);
+    }
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
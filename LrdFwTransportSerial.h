@@ -0,0 +1,95 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportSerial.h
+**
+** Notes:   QSerialPort transport backend, this is the portable default
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRANSPORTSERIAL_H
+#define LRDFWTRANSPORTSERIAL_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QSerialPort>
+#include "LrdFwTransport.h"
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTransportSerial : public LrdFwTransport
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwTransportSerial(
+        QObject *parent = nullptr
+        );
+    ~LrdFwTransportSerial(
+        );
+    bool
+    Open(
+        QString strPort,
+        quint32 nBaudRate
+        ) override;
+    void
+    Close(
+        ) override;
+    bool
+    IsOpen(
+        ) override;
+    qint64
+    Write(
+        const QByteArray *pParts,
+        uint8_t nParts
+        ) override;
+    qint64
+    Read(
+        char *pBuffer,
+        qint64 nMaxSize
+        ) override;
+    bool
+    ClearToSend(
+        ) override;
+    void
+    SetDTR(
+        bool bEnabled
+        ) override;
+    void
+    SetBreak(
+        bool bEnabled
+        ) override;
+    qint64
+    OutputQueueBytes(
+        ) override;
+
+private slots:
+    void
+    SerialError(
+        QSerialPort::SerialPortError speErrorCode
+        );
+
+private:
+    QSerialPort spSerialPort; //Contains the handle for the serial port
+};
+
+#endif // LRDFWTRANSPORTSERIAL_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
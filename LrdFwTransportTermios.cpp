@@ -0,0 +1,507 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportTermios.cpp
+**
+** Notes:   Native Linux termios transport backend, the port is opened in raw
+**          non-blocking mode with ASYNC_LOW_LATENCY set and is serviced directly
+**          from the event loop without any intermediate buffering
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+#ifdef __linux__
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "LrdFwTransportTermios.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <linux/serial.h>
+
+/******************************************************************************/
+// Local Variables
+/******************************************************************************/
+//Baud rates which can be set with cfsetspeed()
+static const struct
+{
+    quint32 nBaudRate;
+    speed_t nSpeed;
+} stBaudRates[] = {
+    {9600, B9600},
+    {19200, B19200},
+    {38400, B38400},
+    {57600, B57600},
+    {115200, B115200},
+    {230400, B230400},
+    {460800, B460800},
+    {500000, B500000},
+    {576000, B576000},
+    {921600, B921600},
+    {1000000, B1000000},
+    {1152000, B1152000},
+    {1500000, B1500000},
+    {2000000, B2000000},
+    {2500000, B2500000},
+    {3000000, B3000000},
+    {3500000, B3500000},
+    {4000000, B4000000}
+};
+
+//=============================================================================
+// Constructor
+//=============================================================================
+LrdFwTransportTermios::LrdFwTransportTermios(
+    QObject *parent
+    ) : LrdFwTransport(parent)
+{
+    nFd = -1;
+    pReadNotifier = NULL;
+    pWriteNotifier = NULL;
+}
+
+//=============================================================================
+// Destructor
+//=============================================================================
+LrdFwTransportTermios::~LrdFwTransportTermios(
+    )
+{
+    Close();
+}
+
+//=============================================================================
+// Opens the serial port in raw mode with 8N1 and hardware flow control
+//=============================================================================
+bool
+LrdFwTransportTermios::Open(
+    QString strPort,
+    quint32 nBaudRate
+    )
+{
+    struct termios tioSettings;
+    struct serial_struct ssSerial;
+    speed_t nSpeed = 0;
+    uint8_t i = 0;
+
+    if (nFd != -1)
+    {
+        //Already open
+        return false;
+    }
+
+    while (i < (sizeof(stBaudRates)/sizeof(stBaudRates[0])))
+    {
+        if (stBaudRates[i].nBaudRate == nBaudRate)
+        {
+            nSpeed = stBaudRates[i].nSpeed;
+            break;
+        }
+        ++i;
+    }
+
+    if (nSpeed == 0)
+    {
+        //Non-standard baud rates are only supported by the QSerialPort backend
+        return false;
+    }
+
+    if (!strPort.startsWith("/"))
+    {
+        //Port name without the device directory
+        strPort.prepend(TERMIOS_DEVICE_PATH);
+    }
+
+    nFd = ::open(strPort.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (nFd == -1)
+    {
+        return false;
+    }
+
+    if (::ioctl(nFd, TIOCEXCL) == -1 || ::tcgetattr(nFd, &tioSettings) == -1)
+    {
+        //Port is in use or is not a tty
+        ::close(nFd);
+        nFd = -1;
+        return false;
+    }
+
+    //Raw 8N1 with hardware flow control, reads return immediately
+    ::cfmakeraw(&tioSettings);
+    tioSettings.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+    tioSettings.c_cflag |= CS8 | CLOCAL | CREAD | CRTSCTS;
+    tioSettings.c_cc[VMIN] = 0;
+    tioSettings.c_cc[VTIME] = 0;
+    ::cfsetspeed(&tioSettings, nSpeed);
+    if (::tcsetattr(nFd, TCSANOW, &tioSettings) == -1)
+    {
+        ::close(nFd);
+        nFd = -1;
+        return false;
+    }
+
+    //Ask the driver not to hold back received data, not all drivers support this
+    if (::ioctl(nFd, TIOCGSERIAL, &ssSerial) == 0)
+    {
+        ssSerial.flags |= ASYNC_LOW_LATENCY;
+        ::ioctl(nFd, TIOCSSERIAL, &ssSerial);
+    }
+    ::tcflush(nFd, TCIOFLUSH);
+
+    pReadNotifier = new QSocketNotifier(nFd, QSocketNotifier::Read);
+    MallocFailCheck(pReadNotifier);
+    connect(pReadNotifier, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), this, SLOT(ReadActivated()));
+
+    pWriteNotifier = new QSocketNotifier(nFd, QSocketNotifier::Write);
+    MallocFailCheck(pWriteNotifier);
+    pWriteNotifier->setEnabled(false);
+    connect(pWriteNotifier, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), this, SLOT(WriteActivated()));
+
+    return true;
+}
+
+//=============================================================================
+// Closes the serial port, if open
+//=============================================================================
+void
+LrdFwTransportTermios::Close(
+    )
+{
+    if (nFd == -1)
+    {
+        return;
+    }
+
+    emit Closing();
+
+    if (pReadNotifier != NULL)
+    {
+        pReadNotifier->setEnabled(false);
+        disconnect(pReadNotifier, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), this, SLOT(ReadActivated()));
+        delete pReadNotifier;
+        pReadNotifier = NULL;
+    }
+
+    if (pWriteNotifier != NULL)
+    {
+        pWriteNotifier->setEnabled(false);
+        disconnect(pWriteNotifier, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), this, SLOT(WriteActivated()));
+        delete pWriteNotifier;
+        pWriteNotifier = NULL;
+    }
+
+    if (!baPending.isEmpty())
+    {
+        //Give queued data a chance to go out before closing
+        FlushPending();
+        baPending.clear();
+    }
+
+    //Wait a limited time for the driver to send queued data, tcdrain() could block forever if the module holds CTS
+    int nQueued = 0;
+    uint8_t nWaits = 0;
+    while (nWaits < (TERMIOS_CLOSE_DRAIN_TIMEOUT_MS / TERMIOS_CLOSE_DRAIN_POLL_MS) && ::ioctl(nFd, TIOCOUTQ, &nQueued) == 0 && nQueued > 0)
+    {
+        ::usleep(TERMIOS_CLOSE_DRAIN_POLL_MS * 1000);
+        ++nWaits;
+    }
+    ::tcflush(nFd, TCOFLUSH);
+    ::close(nFd);
+    nFd = -1;
+}
+
+//=============================================================================
+// Returns true if the serial port is open
+//=============================================================================
+bool
+LrdFwTransportTermios::IsOpen(
+    )
+{
+    return (nFd != -1);
+}
+
+//=============================================================================
+// Writes the parts of a packet with a single writev() call, anything the
+// driver cannot accept yet is kept and sent when the port is writable
+//=============================================================================
+qint64
+LrdFwTransportTermios::Write(
+    const QByteArray *pParts,
+    uint8_t nParts
+    )
+{
+    qint64 nTotal = 0;
+    uint8_t i = 0;
+
+    if (nFd == -1 || nParts > TERMIOS_MAX_WRITE_PARTS)
+    {
+        return -1;
+    }
+
+    while (i < nParts)
+    {
+        nTotal += pParts[i].length();
+        ++i;
+    }
+
+    if (!baPending.isEmpty())
+    {
+        //Keep the order of data which is already waiting
+        i = 0;
+        while (i < nParts)
+        {
+            baPending.append(pParts[i]);
+            ++i;
+        }
+        return nTotal;
+    }
+
+    struct iovec iovParts[TERMIOS_MAX_WRITE_PARTS];
+    i = 0;
+    while (i < nParts)
+    {
+        iovParts[i].iov_base = (void *)pParts[i].constData();
+        iovParts[i].iov_len = pParts[i].length();
+        ++i;
+    }
+
+    ssize_t nWritten = ::writev(nFd, iovParts, nParts);
+    if (nWritten == -1)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            DeviceLost();
+            return -1;
+        }
+        nWritten = 0;
+    }
+
+    if (nWritten < nTotal)
+    {
+        //Keep the remainder until the driver has space for it
+        qint64 nSkip = nWritten;
+        i = 0;
+        while (i < nParts)
+        {
+            if (nSkip >= pParts[i].length())
+            {
+                nSkip -= pParts[i].length();
+            }
+            else
+            {
+                baPending.append(pParts[i].constData() + nSkip, pParts[i].length() - nSkip);
+                nSkip = 0;
+            }
+            ++i;
+        }
+        pWriteNotifier->setEnabled(true);
+    }
+
+    if (nWritten > 0)
+    {
+        emit BytesWritten(nWritten);
+    }
+
+    return nTotal;
+}
+
+//=============================================================================
+// Returns the number of bytes in the driver output queue which have not been
+// transmitted yet
+//=============================================================================
+qint64
+LrdFwTransportTermios::OutputQueueBytes(
+    )
+{
+    int nQueued = 0;
+
+    if (nFd == -1 || ioctl(nFd, TIOCOUTQ, &nQueued) == -1)
+    {
+        return 0;
+    }
+
+    return nQueued;
+}
+
+//=============================================================================
+// Reads received data directly into the provided buffer
+//=============================================================================
+qint64
+LrdFwTransportTermios::Read(
+    char *pBuffer,
+    qint64 nMaxSize
+    )
+{
+    if (nFd == -1)
+    {
+        return -1;
+    }
+
+    //With VMIN and VTIME set to 0 a return of 0 means there is no data waiting, a hang up is detected in ReadActivated()
+    ssize_t nRead = ::read(nFd, pBuffer, nMaxSize);
+    if (nRead == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            //Nothing to read
+            return 0;
+        }
+        if (errno == EIO || errno == ENXIO || errno == ENODEV)
+        {
+            //The port has gone away
+            DeviceLost();
+        }
+        return -1;
+    }
+
+    return nRead;
+}
+
+//=============================================================================
+// Returns true if CTS is asserted
+//=============================================================================
+bool
+LrdFwTransportTermios::ClearToSend(
+    )
+{
+    int nStatus = 0;
+    if (nFd == -1 || ::ioctl(nFd, TIOCMGET, &nStatus) == -1)
+    {
+        return false;
+    }
+
+    return ((nStatus & TIOCM_CTS) ? true : false);
+}
+
+//=============================================================================
+// Sets DTR to be high or low
+//=============================================================================
+void
+LrdFwTransportTermios::SetDTR(
+    bool bEnabled
+    )
+{
+    int nBits = TIOCM_DTR;
+    if (nFd != -1)
+    {
+        ::ioctl(nFd, (bEnabled == true ? TIOCMBIS : TIOCMBIC), &nBits);
+    }
+}
+
+//=============================================================================
+// Applies or removes BREAK
+//=============================================================================
+void
+LrdFwTransportTermios::SetBreak(
+    bool bEnabled
+    )
+{
+    if (nFd != -1)
+    {
+        ::ioctl(nFd, (bEnabled == true ? TIOCSBRK : TIOCCBRK));
+    }
+}
+
+//=============================================================================
+// Callback when the port has data to read
+//=============================================================================
+void
+LrdFwTransportTermios::ReadActivated(
+    )
+{
+    struct pollfd pfdPort;
+    pfdPort.fd = nFd;
+    pfdPort.events = POLLIN;
+    pfdPort.revents = 0;
+    if (::poll(&pfdPort, 1, 0) > 0 && (pfdPort.revents & (POLLHUP | POLLERR | POLLNVAL)) && !(pfdPort.revents & POLLIN))
+    {
+        //The port has been hung up (device unplugged)
+        DeviceLost();
+        return;
+    }
+
+    emit ReadyRead();
+}
+
+//=============================================================================
+// Callback when the port can accept more data
+//=============================================================================
+void
+LrdFwTransportTermios::WriteActivated(
+    )
+{
+    if (FlushPending() == true && baPending.isEmpty())
+    {
+        //Everything has been handed to the driver
+        pWriteNotifier->setEnabled(false);
+    }
+}
+
+//=============================================================================
+// Writes as much pending data as the driver will accept
+//=============================================================================
+bool
+LrdFwTransportTermios::FlushPending(
+    )
+{
+    ssize_t nWritten = ::write(nFd, baPending.constData(), baPending.length());
+    if (nWritten == -1)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            DeviceLost();
+            return false;
+        }
+        return true;
+    }
+
+    baPending.remove(0, nWritten);
+    if (nWritten > 0)
+    {
+        emit BytesWritten(nWritten);
+    }
+    return true;
+}
+
+//=============================================================================
+// Handles the port going away (device unplugged)
+//=============================================================================
+void
+LrdFwTransportTermios::DeviceLost(
+    )
+{
+    if (pReadNotifier != NULL)
+    {
+        //Stop being notified about a dead descriptor
+        pReadNotifier->setEnabled(false);
+    }
+    if (pWriteNotifier != NULL)
+    {
+        pWriteNotifier->setEnabled(false);
+    }
+    emit TransportError(EXIT_CODE_SERIAL_PORT_DEVICE_UNPLUGGED);
+}
+
+#endif
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,121 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  LrdFwTransportTermios.h
+**
+** Notes:   Native Linux termios transport backend, the port is opened in raw
+**          non-blocking mode with ASYNC_LOW_LATENCY set and is serviced directly
+**          from the event loop without any intermediate buffering
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef LRDFWTRANSPORTTERMIOS_H
+#define LRDFWTRANSPORTTERMIOS_H
+
+#ifdef __linux__
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QSocketNotifier>
+#include "LrdFwTransport.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define TERMIOS_DEVICE_PATH                           "/dev/"
+#define TERMIOS_MAX_WRITE_PARTS                       4
+#define TERMIOS_CLOSE_DRAIN_TIMEOUT_MS                100
+#define TERMIOS_CLOSE_DRAIN_POLL_MS                   5
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class LrdFwTransportTermios : public LrdFwTransport
+{
+    Q_OBJECT
+public:
+    explicit
+    LrdFwTransportTermios(
+        QObject *parent = nullptr
+        );
+    ~LrdFwTransportTermios(
+        );
+    bool
+    Open(
+        QString strPort,
+        quint32 nBaudRate
+        ) override;
+    void
+    Close(
+        ) override;
+    bool
+    IsOpen(
+        ) override;
+    qint64
+    Write(
+        const QByteArray *pParts,
+        uint8_t nParts
+        ) override;
+    qint64
+    Read(
+        char *pBuffer,
+        qint64 nMaxSize
+        ) override;
+    bool
+    ClearToSend(
+        ) override;
+    void
+    SetDTR(
+        bool bEnabled
+        ) override;
+    void
+    SetBreak(
+        bool bEnabled
+        ) override;
+    qint64
+    OutputQueueBytes(
+        ) override;
+
+private slots:
+    void
+    ReadActivated(
+        );
+    void
+    WriteActivated(
+        );
+
+private:
+    bool
+    FlushPending(
+        );
+    void
+    DeviceLost(
+        );
+
+    int             nFd;                  //File descriptor of the open port (-1 if closed)
+    QSocketNotifier *pReadNotifier;       //Notifies when the port has data to read
+    QSocketNotifier *pWriteNotifier;      //Notifies when the port can accept more data
+    QByteArray      baPending;            //Data the driver could not accept yet
+};
+
+#endif
+
+#endif // LRDFWTRANSPORTTERMIOS_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
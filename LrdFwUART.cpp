@@ -25,6 +25,13 @@
 // Include Files
 /******************************************************************************/
 #include "LrdFwUART.h"
+#include "LrdFwTransportSerial.h"
+#include "LrdFwTransportNetwork.h"
+#include "LrdFwTransportReplay.h"
+#ifdef __linux__
+#include "LrdFwTransportTermios.h"
+#endif
+#include <QFileInfo>
 #include <QDebug>
 
 //=============================================================================
@@ -35,18 +42,28 @@ LrdFwUART::LrdFwUART(
     LrdSettings *pSettings
     ) : QObject(parent)
 {
-    //Connect serial signals
-    connect(&spSerialPort, SIGNAL(readyRead()), this, SLOT(SerialRead()));
-    connect(&spSerialPort, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(SerialError(QSerialPort::SerialPortError)));
-    connect(&spSerialPort, SIGNAL(bytesWritten(qint64)), this, SLOT(SerialBytesWritten(qint64)));
-    connect(&spSerialPort, SIGNAL(aboutToClose()), this, SLOT(SerialPortClosing()));
     pSettingsHandle = pSettings;
+    pTransport = NULL;
+    bUARTOpen = false;
+    nActiveBaud = 0;
 
     //No errors have occured
     nLastErrorCode = EXIT_CODE_SUCCESS;
 
     //Disable verbose messages by default
     nVerbosity = VERBOSITY_NONE;
+
+    //Leave the FTDI latency timer alone unless asked to change it
+    nLatencyTimer = 0;
+    nOriginalLatencyTimer = -1;
+    nRoundTripCount = 0;
+    nRoundTripTotalUS = 0;
+
+    //Nothing is being transmitted
+    nTransmitQueued = 0;
+    nLastInFlight = 0;
+    tmrTransmitPoll.setSingleShot(true);
+    connect(&tmrTransmitPoll, SIGNAL(timeout()), this, SLOT(TransmitPollTimeout()));
 }
 
 //=============================================================================
@@ -55,18 +72,17 @@ LrdFwUART::LrdFwUART(
 LrdFwUART::~LrdFwUART(
     )
 {
-    //Remove serial signals
-    disconnect(&spSerialPort, SIGNAL(readyRead()), this, SLOT(SerialRead()));
-    disconnect(&spSerialPort, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(SerialError(QSerialPort::SerialPortError)));
-    disconnect(&spSerialPort, SIGNAL(bytesWritten(qint64)), this, SLOT(SerialBytesWritten(qint64)));
-    disconnect(&spSerialPort, SIGNAL(aboutToClose()), this, SLOT(SerialPortClosing()));
-
-    if (spSerialPort.isOpen())
+    if (pTransport != NULL)
     {
-        //Close serial port
-        spSerialPort.flush();
-        spSerialPort.close();
+        //Close and remove the transport
+        DisconnectTransport();
+        pTransport->Close();
+        delete pTransport;
+        pTransport = NULL;
     }
+    RestoreLatencyTimer();
+    StopCapture();
+    disconnect(&tmrTransmitPoll, SIGNAL(timeout()), this, SLOT(TransmitPollTimeout()));
 }
 
 //=============================================================================
@@ -80,6 +96,18 @@ LrdFwUART::SetSettingsObject(
     pSettingsHandle = pSettings;
 }
 
+//=============================================================================
+// Set the configuration of the session that the port is used for, the port
+// name and serial options are taken from it when the port is opened
+//=============================================================================
+void
+LrdFwUART::SetSessionConfig(
+    QSharedPointer<const SessionConfigStruct> pConfig
+    )
+{
+    pSessionConfig = pConfig;
+}
+
 //=============================================================================
 // Returns true if serial port is open
 //=============================================================================
@@ -87,7 +115,7 @@ bool
 LrdFwUART::IsOpen(
     )
 {
-    return spSerialPort.isOpen();
+    return (pTransport != NULL && pTransport->IsOpen());
 }
 
 //=============================================================================
@@ -95,30 +123,47 @@ LrdFwUART::IsOpen(
 //=============================================================================
 bool
 LrdFwUART::Open(
+    quint32 nBaudRate
     )
 {
     //Set serial port configuration options and open port
-    if (pSettingsHandle == nullptr)
+    if (pSessionConfig.isNull())
     {
-        //Settings handle is not set
+        //Session configuration is not set
         nLastErrorCode = EXIT_CODE_SETTINGS_HANDLE_NULL;
         emit Error(MODULE_UART, EXIT_CODE_SETTINGS_HANDLE_NULL);
         return false;
     }
 
     //Set the verbosity
-    nVerbosity = pSettingsHandle->GetConfigOption(UART_VERBOSITY).toUInt();
+    nVerbosity = pSessionConfig->nUartVerbosity;
+
+    QString strPort = pSessionConfig->strPort;
+    if (pTransport != NULL && (strPort != strTransportPort || LrdFwTransportReplay::IsReplayPort(strPort) == false))
+    {
+        //Remove the transport used last time, it may be for a different port or backend. A replay is kept so that it continues from the same point
+        ResetTransport();
+    }
+
+    //Create the transport and open it
+    ResetTransmitQueue();
+    if (pTransport == NULL)
+    {
+        pTransport = CreateTransport(strPort);
+        strTransportPort = strPort;
+        connect(pTransport, SIGNAL(ReadyRead()), this, SLOT(SerialRead()));
+        connect(pTransport, SIGNAL(TransportError(int32_t)), this, SLOT(SerialError(int32_t)));
+        connect(pTransport, SIGNAL(BytesWritten(qint64)), this, SLOT(SerialBytesWritten(qint64)));
+        connect(pTransport, SIGNAL(Closing()), this, SLOT(SerialPortClosing()));
+    }
 
-    //Configure serial port
-    spSerialPort.setPortName(pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString());
-    spSerialPort.setBaudRate(pSettingsHandle->GetConfigOption(ACTIVE_BAUD).toULongLong());
-    spSerialPort.setDataBits(QSerialPort::Data8);
-    spSerialPort.setStopBits(QSerialPort::OneStop);
-    spSerialPort.setParity(QSerialPort::NoParity);
-    spSerialPort.setFlowControl(QSerialPort::HardwareControl);
+    nActiveBaud = nBaudRate;
+    if (fileCapture.isOpen())
+    {
+        fileCapture.write(QByteArray(1, CAPTURE_COMMENT).append(" Open ").append(strPort.toUtf8()).append(" at ").append(QByteArray::number(nActiveBaud)).append(" baud\n"));
+    }
 
-    //Open it
-    if (!spSerialPort.open(QSerialPort::ReadWrite))
+    if (pTransport->Open(strPort, nActiveBaud) == false)
     {
         nLastErrorCode = EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN;
         emit Error(MODULE_UART, EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
@@ -127,6 +172,12 @@ LrdFwUART::Open(
 
     //Port opened
     bUARTOpen = true;
+
+    if (nLatencyTimer > 0 && LrdFwTransportNetwork::IsNetworkPort(strPort) == false && LrdFwTransportReplay::IsReplayPort(strPort) == false)
+    {
+        //Tune the FTDI latency timer for this session
+        ApplyLatencyTimer();
+    }
     return true;
 }
 
@@ -138,12 +189,35 @@ LrdFwUART::Close(
     )
 {
     bUARTOpen = false;
-    if (spSerialPort.isOpen())
+    if (pTransport != NULL)
+    {
+        //Close the port, the transport is kept until the next open
+        pTransport->Close();
+    }
+    RestoreLatencyTimer();
+    elptmrRoundTrip.invalidate();
+    ResetTransmitQueue();
+}
+
+//=============================================================================
+// Changes the baud rate of the port, on the open link if the transport
+// supports it otherwise by re-opening the port
+//=============================================================================
+bool
+LrdFwUART::ChangeBaudRate(
+    quint32 nBaudRate
+    )
+{
+    nActiveBaud = nBaudRate;
+
+    if (bUARTOpen == true && pTransport != NULL && pTransport->SetBaudRate(nBaudRate) == true)
     {
-        //Port is open, close it
-        spSerialPort.flush();
-        spSerialPort.close();
+        //Changed without closing the link
+        return true;
     }
+
+    Close();
+    return Open(nBaudRate);
 }
 
 //=============================================================================
@@ -154,7 +228,182 @@ LrdFwUART::Transmit(
     QByteArray baData
     )
 {
-    spSerialPort.write(baData);
+    if (!elptmrRoundTrip.isValid())
+    {
+        //Time until the response arrives
+        elptmrRoundTrip.start();
+    }
+    if (pTransport != NULL)
+    {
+        QueueTransmit(baData.length());
+        if (fileCapture.isOpen())
+        {
+            CaptureRecord(CAPTURE_DIRECTION_TRANSMIT, baData);
+        }
+        if (pTransport->Write(&baData, 1) < 0)
+        {
+            //Nothing will be sent, let command timeouts run straight away
+            ResetTransmitQueue();
+            emit TransmitFinished();
+            return;
+        }
+        CheckTransmitProgress();
+    }
+}
+
+//=============================================================================
+// Transmits a packet made up of a header, payload and trailer, backends which
+// support it write all parts with a single gather write
+//=============================================================================
+void
+LrdFwUART::Transmit(
+    const QByteArray &baHeader,
+    const QByteArray &baPayload,
+    const QByteArray &baTrailer
+    )
+{
+    QByteArray baParts[3] = {baHeader, baPayload, baTrailer};
+
+    if (!elptmrRoundTrip.isValid())
+    {
+        //Time until the response arrives
+        elptmrRoundTrip.start();
+    }
+    if (pTransport != NULL)
+    {
+        QueueTransmit(baHeader.length() + baPayload.length() + baTrailer.length());
+        if (fileCapture.isOpen())
+        {
+            CaptureRecord(CAPTURE_DIRECTION_TRANSMIT, baHeader + baPayload + baTrailer);
+        }
+        if (pTransport->Write(baParts, (baTrailer.isEmpty() ? 2 : 3)) < 0)
+        {
+            //Nothing will be sent, let command timeouts run straight away
+            ResetTransmitQueue();
+            emit TransmitFinished();
+            return;
+        }
+        CheckTransmitProgress();
+    }
+}
+
+//=============================================================================
+// Creates the transport to use for a port
+//=============================================================================
+LrdFwTransport *
+LrdFwUART::CreateTransport(
+    QString strPort
+    )
+{
+    LrdFwTransport *pNewTransport = NULL;
+
+    if (LrdFwTransportNetwork::IsNetworkPort(strPort) == true)
+    {
+        //Serial to TCP bridge
+        pNewTransport = new LrdFwTransportNetwork();
+    }
+    else if (LrdFwTransportReplay::IsReplayPort(strPort) == true)
+    {
+        //Replay of a serial capture
+        pNewTransport = new LrdFwTransportReplay(pSessionConfig->nReplayDelayPercent, nVerbosity);
+    }
+#ifdef __linux__
+    else if (pSessionConfig->bNativeSerial == true)
+    {
+        //Native termios backend
+        pNewTransport = new LrdFwTransportTermios();
+    }
+#endif
+    else
+    {
+        //QSerialPort backend
+        pNewTransport = new LrdFwTransportSerial();
+    }
+    MallocFailCheck(pNewTransport);
+
+    return pNewTransport;
+}
+
+//=============================================================================
+// Closes and removes the transport, the next open creates a new one (a replay
+// starts again from the beginning of the capture)
+//=============================================================================
+void
+LrdFwUART::ResetTransport(
+    )
+{
+    if (pTransport == NULL)
+    {
+        return;
+    }
+
+    DisconnectTransport();
+    pTransport->Close();
+    pTransport->deleteLater();
+    pTransport = NULL;
+    strTransportPort.clear();
+}
+
+//=============================================================================
+// Starts recording all data transmitted and received to a capture file
+//=============================================================================
+bool
+LrdFwUART::StartCapture(
+    QString strFilename
+    )
+{
+    StopCapture();
+    fileCapture.setFileName(strFilename);
+    if (fileCapture.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+    {
+        return false;
+    }
+
+    fileCapture.write(QByteArray(1, CAPTURE_COMMENT).append(" UwFlashX serial capture: <time in us> <T (transmitted) or R (received)> <data in hex>\n"));
+    elptmrCapture.start();
+
+    return true;
+}
+
+//=============================================================================
+// Stops recording to the capture file
+//=============================================================================
+void
+LrdFwUART::StopCapture(
+    )
+{
+    if (fileCapture.isOpen())
+    {
+        fileCapture.close();
+    }
+    elptmrCapture.invalidate();
+}
+
+//=============================================================================
+// Adds a record to the capture file
+//=============================================================================
+void
+LrdFwUART::CaptureRecord(
+    char cDirection,
+    const QByteArray &baData
+    )
+{
+    QByteArray baRecord = QByteArray::number(elptmrCapture.nsecsElapsed() / 1000);
+    baRecord.append(' ').append(cDirection).append(' ').append(baData.toHex()).append('\n');
+    fileCapture.write(baRecord);
+}
+
+//=============================================================================
+// Removes the signal connections to the transport
+//=============================================================================
+void
+LrdFwUART::DisconnectTransport(
+    )
+{
+    disconnect(pTransport, SIGNAL(ReadyRead()), this, SLOT(SerialRead()));
+    disconnect(pTransport, SIGNAL(TransportError(int32_t)), this, SLOT(SerialError(int32_t)));
+    disconnect(pTransport, SIGNAL(BytesWritten(qint64)), this, SLOT(SerialBytesWritten(qint64)));
+    disconnect(pTransport, SIGNAL(Closing()), this, SLOT(SerialPortClosing()));
 }
 
 //=============================================================================
@@ -209,45 +458,164 @@ LrdFwUART::GetDetails(
 //=============================================================================
 void
 LrdFwUART::SerialError(
-    QSerialPort::SerialPortError speErrorCode
+    int32_t nErrorCode
     )
 {
-    if (speErrorCode == QSerialPort::NoError)
+    if (bUARTOpen == true)
     {
-        //No error. Why this is ever emitted is a mystery to me.
+        //Only emit an error if the UART is open
+        bUARTOpen = false;
+        emit Error(MODULE_UART, nErrorCode);
+    }
+}
+
+//=============================================================================
+// Callback for serial bytes being transmitted out of the UART
+//=============================================================================
+void
+LrdFwUART::SerialBytesWritten(
+    qint64 intByteCount
+    )
+{
+    nTransmitQueued -= intByteCount;
+    if (nTransmitQueued < 0)
+    {
+        nTransmitQueued = 0;
+    }
+    CheckTransmitProgress();
+}
+
+//=============================================================================
+// Callback when it is time to check the output queue again
+//=============================================================================
+void
+LrdFwUART::TransmitPollTimeout(
+    )
+{
+    CheckTransmitProgress();
+}
+
+//=============================================================================
+// Returns the number of bytes which have been transmitted but have not left
+// the port yet, this includes the driver output queue where the transport can
+// report it
+//=============================================================================
+qint64
+LrdFwUART::BytesInFlight(
+    )
+{
+    if (nLastInFlight == 0)
+    {
+        //Nothing outstanding
+        return 0;
+    }
+
+    return nTransmitQueued + (pTransport != NULL ? pTransport->OutputQueueBytes() : 0);
+}
+
+//=============================================================================
+// Returns the baud rate the port was opened at or last changed to
+//=============================================================================
+quint32
+LrdFwUART::ActiveBaud(
+    )
+{
+    return nActiveBaud;
+}
+
+//=============================================================================
+// Adds data which is about to be written to the bytes in flight
+//=============================================================================
+void
+LrdFwUART::QueueTransmit(
+    qint64 nBytes
+    )
+{
+    if (nLastInFlight == 0)
+    {
+        //Start of a new burst of data
+        elptmrTransmitProgress.start();
+    }
+    nTransmitQueued += nBytes;
+    nLastInFlight += nBytes;
+}
+
+//=============================================================================
+// Checks how much data is still in flight, emits TransmitFinished when all of
+// it has left the port or an error if nothing has left for too long (i.e. the
+// module is holding off hardware flow control)
+//=============================================================================
+void
+LrdFwUART::CheckTransmitProgress(
+    )
+{
+    if (nLastInFlight == 0)
+    {
+        //Nothing is being transmitted
         return;
     }
-#if QT_VERSION < 0x050700
-    //As of Qt 5.7 these are now deprecated. It is being left in as a conditional compile for anyone using older versions of Qt to prevent these errors closing the serial port.
-    else if (speErrorCode == QSerialPort::ParityError)
+
+    qint64 nInFlight = BytesInFlight();
+    if (nInFlight == 0)
     {
-        //Parity error
+        //All data has been transmitted
+        ResetTransmitQueue();
+        emit TransmitFinished();
+        return;
     }
-    else if (speErrorCode == QSerialPort::FramingError)
+
+    if (nInFlight < nLastInFlight)
     {
-        //Framing error
+        //Data is leaving the port
+        elptmrTransmitProgress.start();
     }
-#endif
-    else if (speErrorCode == QSerialPort::ResourceError || speErrorCode == QSerialPort::PermissionError)
+    else if (elptmrTransmitProgress.elapsed() > UART_TRANSMIT_STALL_TIMEOUT_MS)
     {
-        //Resource error or permission error (device unplugged?)
+        //No data has left the port for too long
+        ResetTransmitQueue();
         if (bUARTOpen == true)
         {
-            //Only emit an error if the UART is open
-            bUARTOpen = false;
-            emit Error(MODULE_UART, EXIT_CODE_SERIAL_PORT_DEVICE_UNPLUGGED);
+            nLastErrorCode = EXIT_CODE_SERIAL_PORT_TRANSMIT_STALLED;
+            emit Error(MODULE_UART, EXIT_CODE_SERIAL_PORT_TRANSMIT_STALLED);
+        }
+        else
+        {
+            //Port has gone, let command timeouts run
+            emit TransmitFinished();
+        }
+        return;
+    }
+    nLastInFlight = nInFlight;
+
+    //Check again once the data in flight should have been sent
+    qint64 nBaud = nActiveBaud;
+    qint64 nPollMS = UART_TRANSMIT_POLL_MAX_MS;
+    if (nBaud > 0)
+    {
+        nPollMS = nInFlight * SERIAL_BITS_PER_BYTE * 1000 / nBaud;
+        if (nPollMS < 1)
+        {
+            nPollMS = 1;
+        }
+        else if (nPollMS > UART_TRANSMIT_POLL_MAX_MS)
+        {
+            nPollMS = UART_TRANSMIT_POLL_MAX_MS;
         }
     }
+    tmrTransmitPoll.start((int)nPollMS);
 }
 
 //=============================================================================
-// Callback for serial bytes being transmitted out of the UART
+// Forgets about any data in flight
 //=============================================================================
 void
-LrdFwUART::SerialBytesWritten(
-    qint64
+LrdFwUART::ResetTransmitQueue(
     )
 {
+    tmrTransmitPoll.stop();
+    elptmrTransmitProgress.invalidate();
+    nTransmitQueued = 0;
+    nLastInFlight = 0;
 }
 
 //=============================================================================
@@ -267,13 +635,48 @@ void
 LrdFwUART::SerialRead(
     )
 {
-    //Append received data into buffer
-    QByteArray baOrigData = spSerialPort.readAll();
+    //Read straight into the receive buffer, which is re-used to avoid an allocation for every read
+    qint64 nTotal = 0;
+    qint64 nRead;
+    baReceiveBuffer.resize(UART_RECEIVE_BUFFER_SIZE);
+    while ((nRead = pTransport->Read(baReceiveBuffer.data() + nTotal, baReceiveBuffer.length() - nTotal)) > 0)
+    {
+        nTotal += nRead;
+        if (nTotal == baReceiveBuffer.length())
+        {
+            //Buffer is full, make room for more data
+            baReceiveBuffer.resize(baReceiveBuffer.length() + UART_RECEIVE_BUFFER_SIZE);
+        }
+    }
+    baReceiveBuffer.resize(nTotal);
+
+    if (nTotal == 0)
+    {
+        //Nothing was read
+        return;
+    }
+
+    if (elptmrRoundTrip.isValid())
+    {
+        //Response to transmitted data
+        qint64 nRoundTripUS = elptmrRoundTrip.nsecsElapsed()/1000;
+        nRoundTripTotalUS += nRoundTripUS;
+        ++nRoundTripCount;
+        if (lstRoundTripSamplesUS.count() < UART_ROUND_TRIP_MAX_SAMPLES)
+        {
+            lstRoundTripSamplesUS.append((quint32)nRoundTripUS);
+        }
+        elptmrRoundTrip.invalidate();
+    }
+    if (fileCapture.isOpen())
+    {
+        CaptureRecord(CAPTURE_DIRECTION_RECEIVE, baReceiveBuffer);
+    }
     if (nVerbosity >= VERBOSITY_COMMANDS)
     {
-        qDebug() << baOrigData;
+        qDebug() << baReceiveBuffer;
     }
-    emit Receive(&baOrigData);
+    emit Receive(&baReceiveBuffer);
 }
 
 //=============================================================================
@@ -283,7 +686,7 @@ bool
 LrdFwUART::DeviceReady(
     )
 {
-    if (spSerialPort.pinoutSignals() & QSerialPort::ClearToSendSignal)
+    if (pTransport != NULL && pTransport->ClearToSend())
     {
         return true;
     }
@@ -298,7 +701,10 @@ LrdFwUART::SetDTR(
     bool bEnabled
     )
 {
-    spSerialPort.setDataTerminalReady(bEnabled);
+    if (pTransport != NULL)
+    {
+        pTransport->SetDTR(bEnabled);
+    }
 }
 
 //=============================================================================
@@ -309,7 +715,10 @@ LrdFwUART::SetBreak(
     bool bEnabled
     )
 {
-    spSerialPort.setBreakEnabled(bEnabled);
+    if (pTransport != NULL)
+    {
+        pTransport->SetBreak(bEnabled);
+    }
 }
 
 //=============================================================================
@@ -322,6 +731,138 @@ LrdFwUART::GetLastErrorCode(
     return nLastErrorCode;
 }
 
+//=============================================================================
+// Sets the FTDI latency timer to use whilst the port is open, 0 restores the
+// original value. Returns false if the port does not support changing it
+//=============================================================================
+bool
+LrdFwUART::SetLatencyTimer(
+    uint8_t nLatencyMS
+    )
+{
+    nLatencyTimer = nLatencyMS;
+    if (nLatencyMS == 0)
+    {
+        RestoreLatencyTimer();
+        return true;
+    }
+
+    if (IsOpen())
+    {
+        return ApplyLatencyTimer();
+    }
+    return true;
+}
+
+//=============================================================================
+// Returns the FTDI latency timer value from before it was changed, or -1 if
+// it has not been changed
+//=============================================================================
+int16_t
+LrdFwUART::GetOriginalLatencyTimer(
+    )
+{
+    return nOriginalLatencyTimer;
+}
+
+//=============================================================================
+// Applies the requested latency timer to the open port. This is done using
+// the ftdi_sio sysfs attribute on Linux, it is not available on other
+// platforms as the VCP driver only reads it from the registry
+//=============================================================================
+bool
+LrdFwUART::ApplyLatencyTimer(
+    )
+{
+#ifdef __linux__
+    QString strPath = QString(FTDI_SYSFS_PATH).append(QFileInfo(strTransportPort).fileName()).append(FTDI_SYSFS_LATENCY_TIMER);
+    QFile fileLatency(strPath);
+
+    if (!fileLatency.open(QIODevice::ReadWrite | QIODevice::Text))
+    {
+        //Not an FTDI device or no permission to change it
+        return false;
+    }
+
+    if (nOriginalLatencyTimer == -1)
+    {
+        //Keep the original value so it can be restored
+        bool bValid = false;
+        int16_t nValue = fileLatency.readAll().trimmed().toShort(&bValid);
+        if (bValid == false)
+        {
+            return false;
+        }
+        nOriginalLatencyTimer = nValue;
+        strLatencyTimerPath = strPath;
+    }
+
+    fileLatency.seek(0);
+    return (fileLatency.write(QByteArray::number(nLatencyTimer)) > 0);
+#else
+    return false;
+#endif
+}
+
+//=============================================================================
+// Puts the FTDI latency timer back to the value it had before it was changed
+//=============================================================================
+void
+LrdFwUART::RestoreLatencyTimer(
+    )
+{
+    if (nOriginalLatencyTimer == -1)
+    {
+        return;
+    }
+
+    QFile fileLatency(strLatencyTimerPath);
+    if (fileLatency.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        fileLatency.write(QByteArray::number(nOriginalLatencyTimer));
+        fileLatency.close();
+    }
+    nOriginalLatencyTimer = -1;
+    strLatencyTimerPath.clear();
+}
+
+//=============================================================================
+// Clears the round trip time statistics
+//=============================================================================
+void
+LrdFwUART::ResetRoundTripStats(
+    )
+{
+    elptmrRoundTrip.invalidate();
+    nRoundTripCount = 0;
+    nRoundTripTotalUS = 0;
+    lstRoundTripSamplesUS.clear();
+}
+
+//=============================================================================
+// Returns the number of round trips measured (transmit until the first data
+// is received) and their average time in us
+//=============================================================================
+quint32
+LrdFwUART::GetRoundTripStats(
+    qint64 *pAverageUS
+    )
+{
+    *pAverageUS = (nRoundTripCount > 0 ? nRoundTripTotalUS/nRoundTripCount : 0);
+    return nRoundTripCount;
+}
+
+//=============================================================================
+// Returns the individual round trip times (in us) measured since the stats
+// were last reset
+//=============================================================================
+const QList<quint32> &
+LrdFwUART::GetRoundTripSamples(
+    )
+{
+    return lstRoundTripSamplesUS;
+}
+
 /******************************************************************************/
 // END OF FILE
 /******************************************************************************/
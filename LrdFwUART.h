@@ -27,13 +27,23 @@
 // Include Files
 /******************************************************************************/
 #include <QObject>
-#include <QSerialPort>
 #include <QSerialPortInfo>
 #include <QFile>
 #include <QTimer>
 #include <QElapsedTimer>
 #include "LrdFwCommon.h"
 #include "LrdSettings.h"
+#include "LrdFwTransport.h"
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#define FTDI_SYSFS_PATH                               "/sys/bus/usb-serial/devices/"
+#define FTDI_SYSFS_LATENCY_TIMER                      "/latency_timer"
+#define UART_RECEIVE_BUFFER_SIZE                      4096
+#define UART_ROUND_TRIP_MAX_SAMPLES                   100000  //Maximum number of individual round trip times kept
+#define UART_TRANSMIT_POLL_MAX_MS                     50      //Longest wait between checks of the output queue while data is in flight
+#define UART_TRANSMIT_STALL_TIMEOUT_MS                10000   //Time with no data leaving the port before transmit is considered stalled
 
 /******************************************************************************/
 // Class definitions
@@ -54,18 +64,33 @@ public:
         );
     bool
     Open(
+        quint32 nBaudRate
         );
     void
     Close(
         );
+    bool
+    ChangeBaudRate(
+        quint32 nBaudRate
+        );
     void
     Transmit(
         QByteArray baData
         );
     void
+    Transmit(
+        const QByteArray &baHeader,
+        const QByteArray &baPayload,
+        const QByteArray &baTrailer
+        );
+    void
     SetSettingsObject(
         LrdSettings *pSettings
         );
+    void
+    SetSessionConfig(
+        QSharedPointer<const SessionConfigStruct> pConfig
+        );
     bool
     DeviceReady(
         );
@@ -87,6 +112,39 @@ public:
     qint16
     GetLastErrorCode(
         );
+    bool
+    SetLatencyTimer(
+        uint8_t nLatencyMS
+        );
+    int16_t
+    GetOriginalLatencyTimer(
+        );
+    void
+    ResetRoundTripStats(
+        );
+    quint32
+    GetRoundTripStats(
+        qint64 *pAverageUS
+        );
+    const QList<quint32> &
+    GetRoundTripSamples(
+        );
+    qint64
+    BytesInFlight(
+        );
+    quint32
+    ActiveBaud(
+        );
+    void
+    ResetTransport(
+        );
+    bool
+    StartCapture(
+        QString strFilename
+        );
+    void
+    StopCapture(
+        );
 
 signals:
     void
@@ -98,6 +156,9 @@ signals:
     Receive(
         QByteArray *pData
         );
+    void
+    TransmitFinished(
+        );
 
 private slots:
     void
@@ -105,7 +166,7 @@ private slots:
         );
     void
     SerialError(
-        QSerialPort::SerialPortError speErrorCode
+        int32_t nErrorCode
         );
     void
     SerialBytesWritten(
@@ -114,12 +175,61 @@ private slots:
     void
     SerialPortClosing(
         );
+    void
+    TransmitPollTimeout(
+        );
 private:
-    QSerialPort    spSerialPort;            //Contains the handle for the serial port
+    LrdFwTransport *
+    CreateTransport(
+        QString strPort
+        );
+    void
+    DisconnectTransport(
+        );
+    bool
+    ApplyLatencyTimer(
+        );
+    void
+    RestoreLatencyTimer(
+        );
+    void
+    QueueTransmit(
+        qint64 nBytes
+        );
+    void
+    CheckTransmitProgress(
+        );
+    void
+    ResetTransmitQueue(
+        );
+    void
+    CaptureRecord(
+        char cDirection,
+        const QByteArray &baData
+        );
+
+    LrdFwTransport *pTransport;             //Transport (backend) used for the port
+    QString        strTransportPort;        //Port name that the transport was created for
+    QByteArray     baReceiveBuffer;         //Buffer that received data is read in to
     LrdSettings    *pSettingsHandle = NULL; //Contains the handle for the settings object
+    QSharedPointer<const SessionConfigStruct> pSessionConfig; //Configuration of the session the port is used for
     uint8_t        nVerbosity;              //The verbosity level of the output
     qint16         nLastErrorCode;          //Last error code
     bool           bUARTOpen;               //If the port is open (prevents duplicate error being reported if port could not be opened)
+    uint8_t        nLatencyTimer;           //FTDI latency timer to apply when the port is opened (0 to leave unchanged)
+    quint32        nActiveBaud;             //Baud rate the port was opened at or last changed to
+    int16_t        nOriginalLatencyTimer;   //FTDI latency timer value before it was changed (-1 if not changed)
+    QString        strLatencyTimerPath;     //sysfs path of the latency timer which was changed
+    QElapsedTimer  elptmrRoundTrip;         //Time since data was transmitted with no response yet
+    quint32        nRoundTripCount;         //Number of round trips measured
+    qint64         nRoundTripTotalUS;       //Total of all round trip times measured in us
+    QList<quint32> lstRoundTripSamplesUS;   //Individual round trip times measured in us
+    qint64         nTransmitQueued;         //Bytes given to the transport which it has not written yet
+    qint64         nLastInFlight;           //Bytes in flight at the last progress check
+    QTimer         tmrTransmitPoll;         //Checks the output queue until all data has left the port
+    QElapsedTimer  elptmrTransmitProgress;  //Time since data in flight last decreased
+    QFile          fileCapture;             //Capture file that all serial traffic is recorded to (if open)
+    QElapsedTimer  elptmrCapture;           //Time since the capture was started, used for record timestamps
 };
 
 #endif // LRDFWUART_H
@@ -26,6 +26,12 @@
 /******************************************************************************/
 #include "LrdFwUpd.h"
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <algorithm>
 #if defined(__linux__) || defined(__APPLE__)
 //Linux or mac, required include for usleep
 #include <unistd.h>
@@ -38,6 +44,24 @@
 /******************************************************************************/
 // Local Functions or Private Members
 /******************************************************************************/
+//Names of the modes (APPLICATION_MODE) shown in the session timeline
+static const char *pModeTraceNames[] = {
+    "Idle",
+    "Enter bootloader (AT+FUP) and wait for CTS",
+    "Target platform",
+    "Erase",
+    "Write",
+    "Reboot",
+    "Bootloader version (V)",
+    "Supported functions (?)",
+    "Supported options (o)",
+    "Set options (s)",
+    "Unlock",
+    "Probe bootloader",
+    "Verify",
+    "Read"
+};
+COMPILE_ASSERT((sizeof(pModeTraceNames)/sizeof(pModeTraceNames[0])) == (MODE_READ_COMMAND+1));
 
 //=============================================================================
 // Constructor
@@ -67,9 +91,12 @@ LrdFwUpd::LrdFwUpd(
     //Connect signals
     connect(pDevice, SIGNAL(Receive(QByteArray*)), this, SLOT(ModuleDataReceived(QByteArray*)));
     connect(pDevice, SIGNAL(Error(uint32_t,int32_t)), this, SLOT(ModuleError(uint32_t,int32_t)));
+    connect(pDevice, SIGNAL(TransmitFinished()), this, SLOT(DeviceTransmitFinished()));
     connect(pUwfData, SIGNAL(Error(uint32_t,int32_t)), this, SLOT(ModuleError(uint32_t,int32_t)));
 #if !defined(TARGET_OS_MAC)
     connect(pBlEnter, SIGNAL(Error(uint32_t,int32_t)), this, SLOT(ModuleError(uint32_t,int32_t)));
+    connect(pBlEnter, SIGNAL(EnterBootloaderFinished(bool,QString)), this, SLOT(BootloaderEntranceFinished(bool,QString)));
+    connect(pBlEnter, SIGNAL(UserPrompt(uint8_t,QString,QString,bool*)), this, SIGNAL(BootloaderEntrancePrompt(uint8_t,QString,QString,bool*)), Qt::DirectConnection);
 #endif
 
     //Setup command timeout timer
@@ -78,11 +105,78 @@ LrdFwUpd::LrdFwUpd(
     tmrCommandTimeoutTimer->setInterval(COMMAND_TIMEOUT_PERIOD_MS);
     tmrCommandTimeoutTimer->setSingleShot(false);
     connect(tmrCommandTimeoutTimer, SIGNAL(timeout()), this, SLOT(CommandTimeout()));
+    nPendingCommandTimeoutMS = 0;
 
     //Set variables to null
     tmrBaudRateChangeTimer = NULL;
     tmrDeviceReadyTimer = NULL;
     tmrRestartTimer = NULL;
+    tmrProbeTimer = NULL;
+    bProbeAttempted = false;
+
+    //No upgrade file is being parsed
+    bUwfScanPending = false;
+    nUwfPacketIndex = 0;
+    bUwfScanValidate = false;
+    bUwfScanFromCache = false;
+    bLatencyTuned = false;
+
+    //Tracing is enabled per session
+    nCMode = MODE_IDLE;
+    CSubMode = SUBMODE_NONE;
+    pTrace = NULL;
+    nTraceTrack = 0;
+    nTraceSessionStartUS = 0;
+    nTraceModeStartUS = 0;
+    nTraceEntranceStartUS = 0;
+    nTraceReadyWaitStartUS = 0;
+    nTraceWrittenBytes = 0;
+
+    //Link health is assessed per session
+    pLinkHealth = new LrdFwLinkHealth(this);
+    MallocFailCheck(pLinkHealth);
+    bLinkHealthActive = false;
+
+    //Metrics are enabled per session
+    pMetrics = NULL;
+    nSessionErrorCode = EXIT_CODE_SUCCESS;
+    lstModeTimeUS.fill(0, MODE_READ_COMMAND + 1);
+    bOptionsNegotiated = false;
+    nJobIndex = 0;
+
+    //Nothing has been erased or skipped yet
+    nEraseCommandIndex = 0;
+    bSkipErasedChunks = false;
+    nSkippedChunks = 0;
+    nSkippedBytes = 0;
+    bAlignWrites = false;
+    nConfigPageSize = 0;
+    nVerifyStrategy = VERIFY_STRATEGY_INTERLEAVED;
+    nVerifyPipelineDepth = 1;
+    bReadbackMode = false;
+    bReadbackStarted = false;
+    bReadbackExplicitRange = false;
+    bReadbackCompare = false;
+    nMaxReadSize = 0;
+    nActiveReadLengthCmd = 0;
+    nReadRequestIndex = 0;
+    nReadResponseIndex = 0;
+    nReadInFlight = 0;
+    nReadbackBytes = 0;
+    nReadbackFileAddress = 0;
+    nReadbackExpectedIndex = 0;
+    bDeferredVerify = false;
+    nMaxVerifySize = 0;
+    nVerifyWindowIndex = 0;
+    nVerifyResponseIndex = 0;
+    nVerifyInFlight = 0;
+    nVerifyInitialWindows = 0;
+    nWritePackets = 0;
+    nAlignedWritePackets = 0;
+    nUnalignedWritePackets = 0;
+    nWritePacketTimeUS = 0;
+    nLastVerifyAddress = 0;
+    nLastVerifySize = 0;
 
     //No errors have occured
     nLastErrorCode = EXIT_CODE_SUCCESS;
@@ -121,8 +215,21 @@ LrdFwUpd::~LrdFwUpd(
         elptmrUpgradeTime.invalidate();
     }
 
+    if (bUwfScanPending == true)
+    {
+        //Wait for the background upgrade file parse to finish
+        futUwfScan.waitForFinished();
+    }
+
+    //Finish the timeline if a session was still running
+    StopTrace(false);
+    StopMetrics(false);
+
     delete pDevice;
     delete pUwfData;
+#if !defined(TARGET_OS_MAC)
+    delete pBlEnter;
+#endif
 
     if (tmrCommandTimeoutTimer != NULL)
     {
@@ -163,10 +270,13 @@ LrdFwUpd::StartUpdate(
         return false;
     }
 
-    nVerbosity = pSettingsHandle->GetConfigOption(UPDATE_VERBOSITY).toUInt();
+    //Take a typed copy of the settings for this port, which is used for the remainder of the session
+    pSessionConfig = pSettingsHandle->CreateSessionConfig(pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString());
+    nVerbosity = pSessionConfig->nVerbosity;
+    pDevice->SetSessionConfig(pSessionConfig);
 
     //Check if the bootloader unlock key is valid
-    uint8_t nUnlockKeySize = pSettingsHandle->GetConfigOption(UNLOCK_KEY).toByteArray().length();
+    uint8_t nUnlockKeySize = pSessionConfig->baUnlockKey.length();
     if (nUnlockKeySize > 0 && nUnlockKeySize != FUP_BOOTLOADER_UNLOCK_KEY_SIZE)
     {
         //The bootloader unlock key is an invalid length
@@ -175,65 +285,104 @@ LrdFwUpd::StartUpdate(
         return false;
     }
 
-    if (pUwfData->Open() == false)
+    //Check if a multi-image job manifest has been supplied, in which case the images listed in it are written in a single bootloader session
+    lstJobItems.clear();
+    nJobIndex = 0;
+    bReadbackMode = !pSessionConfig->strReadbackFile.isEmpty();
+    if (bReadbackMode == false && !pSessionConfig->strFirmwareManifest.isEmpty())
     {
-        return false;
-    }
+        if (LoadJobManifest(pSessionConfig->strFirmwareManifest) == false)
+        {
+            //Job manifest is not valid
+            nLastErrorCode = EXIT_CODE_JOB_MANIFEST_NOT_VALID;
+            emit Error(MODULE_UPDATE, EXIT_CODE_JOB_MANIFEST_NOT_VALID);
+            return false;
+        }
 
-    nFileSize = pUwfData->TotalSize();
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Job manifest contains ").append(QString::number(lstJobItems.count())).append(" images"));
 
-    //Check if the file size is valid
-    if (nFileSize < UWF_COMMAND_HEADER_LENGTH || nFileSize > UWF_FILE_MAX_SIZE_BYTES)
-    {
-        //Filesize is too small or large, not a valid uwf file
-        pUwfData->Close();
-        emit CurrentAction(MODULE_UPDATE, 0, "Selected upgrade file is too small or large and is not valid.");
-        emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_INVALID_SIZE);
-        return false;
+        //Every image must be usable before the module is touched, otherwise the job could stop with only some of the images written
+        int32_t nStatus = CheckJobItems();
+        if (nStatus != EXIT_CODE_SUCCESS)
+        {
+            lstJobItems.clear();
+            nLastErrorCode = nStatus;
+            emit Error(MODULE_UPDATE, nStatus);
+            return false;
+        }
+        ApplyJobItem(nJobIndex);
     }
 
-    //If enabled, validate that the upgrade file does not have any errors in it
-    bool bValidateUpgradeFile = pSettingsHandle->GetConfigOption(UPDATE_VERBOSITY).toUInt();
-    if (bValidateUpgradeFile == true && ValidateUpgradeFile() == false)
+    //Check if flash is being read back rather than written
+    bReadbackStarted = false;
+    bReadbackExplicitRange = false;
+    bReadbackCompare = false;
+    lstReadbackRanges.clear();
+    lstReadbackExpected.clear();
+    lstReadbackMismatches.clear();
+    nMaxReadSize = 0;
+    nActiveReadLengthCmd = 0;
+    baSupportedFeatures.clear();
+    if (bReadbackMode == true)
     {
-        //The upgrade file is not valid and contains an error
-        pUwfData->Close();
-        emit CurrentAction(MODULE_UPDATE, 0, "Selected upgrade file is not valid.");
-        emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_NOT_VALID);
-        return false;
+        bReadbackCompare = pSessionConfig->bReadbackCompare;
+        if (!pSessionConfig->strReadbackRange.isEmpty())
+        {
+            //Read back the specified range instead of the ranges written by the upgrade file
+            AddressRangeStruct sRange;
+            if (ParseAddressRange(pSessionConfig->strReadbackRange, &sRange) == false)
+            {
+                //Range is not valid
+                nLastErrorCode = EXIT_CODE_READBACK_RANGE_NOT_VALID;
+                emit Error(MODULE_UPDATE, EXIT_CODE_READBACK_RANGE_NOT_VALID);
+                return false;
+            }
+            lstReadbackRanges.append(sRange);
+            bReadbackExplicitRange = true;
+        }
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Reading flash back to ").append(pSessionConfig->strReadbackFile).append(", the upgrade file is only used for the target and device setup"));
     }
 
-    if (bValidateUpgradeFile == true)
+    if (OpenUpgradeFile() == false)
     {
-        //Rewind to the beginning of the uwf file
-        pUwfData->Seek(SEEK_FROM_BEGINNING, 0);
+        return false;
     }
 
-    //Check if the first command is a valid
-    QByteArray baTmpPktHeader = pUwfData->Read(UWF_COMMAND_HEADER_LENGTH);
-    uint8_t nCmdID = (uint8_t)baTmpPktHeader[UWF_OFFSET_HEADER_COMMAND_ID];
+    nFileSize = pUwfData->TotalSize();
 
-    if (nCmdID != UWF_COMMAND_TARGET_PLATFORM && nCmdID != UWF_COMMAND_REGISTER && nCmdID != UWF_COMMAND_SELECT && nCmdID != UWF_COMMAND_SECTOR_MAP && nCmdID != UWF_COMMAND_ERASE && nCmdID != UWF_COMMAND_WRITE && nCmdID != UWF_COMMAND_QUERY && nCmdID != UWF_COMMAND_UNREGISTER)
+    //Check if the file size is valid
+    if (nFileSize < UWF_COMMAND_HEADER_LENGTH || (quint64)nFileSize > pSessionConfig->nMaxUwfSize)
     {
-        emit CurrentAction(MODULE_UPDATE, 0, QString("Selected upgrade file has unknown command 0x").append(QString::number(nCmdID, 16)).append(" and is not valid."));
-        emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_COMMAND_INVALID);
+        //Filesize is too small or large (the limit is set with UWF_MAX_SIZE_MB), not a valid uwf file
+        pUwfData->Close();
+        emit CurrentAction(MODULE_UPDATE, 0, "Selected upgrade file is too small or large and is not valid.");
+        emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_INVALID_SIZE);
         return false;
     }
 
-    //Check if packet length is valid
-    uint32_t nPktLen = 0;
-    ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTmpPktHeader, UWF_OFFSET_HEADER_PACKET_LENGTH, nPktLen);
+    //Parse (and if enabled, validate) the upgrade file on a worker thread whilst the module enters bootloader mode, the result is only needed before the first packet is sent
+    StartUpgradeFileScan(pSessionConfig->strFirmwareFile, pSessionConfig->bValidateUwf);
 
-    if (nPktLen > nFileSize - UWF_COMMAND_HEADER_LENGTH || nPktLen > UWF_FILE_MAX_PACKET_SIZE_BYTES)
+    if (pSessionConfig->bValidateUwf == true && lstJobItems.isEmpty())
     {
-        emit CurrentAction(MODULE_UPDATE, 0, QString("Selected upgrade file has command of length ").append(QString::number(nPktLen)).append(" and is not valid."));
-        emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_PACKET_LENGTH_INVALID);
-        return false;
+        //When validating, an invalid file must be reported before the module is touched (job manifest images have already been checked)
+        futUwfScan.waitForFinished();
+        UwfScanStruct sResult = futUwfScan.result();
+        if (sResult.nErrorCode != EXIT_CODE_SUCCESS)
+        {
+            //The upgrade file is not valid and contains an error
+            bUwfScanPending = false;
+            pUwfData->Close();
+            if (!sResult.strError.isEmpty())
+            {
+                emit CurrentAction(MODULE_UPDATE, 0, sResult.strError);
+            }
+            nLastErrorCode = sResult.nErrorCode;
+            emit Error(MODULE_UPDATE, sResult.nErrorCode);
+            return false;
+        }
     }
 
-    //Valid upgrade file, rewind to beginning of file
-    pUwfData->Seek(SEEK_FROM_BEGINNING, 0);
-
     //Set defaults
     nMaxEraseLengthCmd = DEFAULT_ERASE_COMMAND_LENGTH;
     nMaxWriteLengthCmd = DEFAULT_WRITE_COMMAND_LENGTH;
@@ -242,17 +391,86 @@ LrdFwUpd::StartUpdate(
     nMaxWriteSize = DEFAULT_WRITE_SIZE;
     nActiveWriteSize = DEFAULT_WRITE_SIZE;
     nMaxChecksumSize = DEFAULT_CHECKSUM_COMMAND_LENGTH;
+    bSkipErasedChunks = pSessionConfig->bSkipErasedChunks;
+    lstErasedRanges.clear();
+    nSkippedChunks = 0;
+    nSkippedBytes = 0;
+    bAlignWrites = pSessionConfig->bAlignWrites;
+    nVerifyStrategy = pSessionConfig->nVerifyStrategy;
+
+    //Older bootloaders handle one command at a time, so deferred verify commands are only pipelined if this is enabled
+    nVerifyPipelineDepth = qBound((uint8_t)1, (uint8_t)pSessionConfig->nVerifyPipelineDepth, (uint8_t)FUP_VERIFY_PIPELINE_DEPTH_MAXIMUM);
+    bDeferredVerify = false;
+    nMaxVerifySize = 0;
+    lstVerifyRuns.clear();
+    nConfigPageSize = pSessionConfig->nWritePageSize;
+    nWritePackets = 0;
+    nAlignedWritePackets = 0;
+    nUnalignedWritePackets = 0;
+    nWritePacketTimeUS = 0;
     nActiveEraseLengthCmd = DEFAULT_ERASE_COMMAND_LENGTH;
     nActiveWriteLengthCmd = DEFAULT_WRITE_COMMAND_LENGTH;
     nActiveChecksumLengthCmd = DEFAULT_CHECKSUM_COMMAND_LENGTH;
     nActiveVerifyChecksumLengthCmd = DEFAULT_VERIFY_CHECKSUM_COMMAND_LENGTH;
 
+    if (pSessionConfig->bDryRun == true)
+    {
+        //Only estimate the update without opening the port, this runs from the event loop so that the result is signalled after this returns
+        QTimer::singleShot(0, this, SLOT(DryRunEstimate()));
+        return true;
+    }
+
+    //Record a timeline of the session if enabled
+    StartTrace();
+
+    //Gather link health statistics if enabled
+    bLinkHealthActive = pSessionConfig->bLinkHealth;
+    pLinkHealth->Start();
+
+    //Count the session in the metrics if enabled
+    StartMetrics();
+
+    //Each session starts with a new transport, so a replayed capture starts from the beginning
+    pDevice->ResetTransport();
+    if (!pSessionConfig->strCaptureFile.isEmpty() && pDevice->StartCapture(pSessionConfig->strCaptureFile) == false)
+    {
+        //The capture is not required for the update so only a warning is shown
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to open capture file ").append(pSessionConfig->strCaptureFile).append(", continuing without capturing"));
+    }
+
+    //Check if the module should be probed to see if it is already in bootloader mode
+    bProbeAttempted = false;
+    if (pSessionConfig->bProbeFirst == true)
+    {
+        //Probe module, bootloader entrance will take place if there is no response
+        StartBootloaderProbe();
+        return true;
+    }
+
+    if (EnterBootloaderMode() == false)
+    {
+        StopTrace(false);
+        bLinkHealthActive = false;
+        nSessionErrorCode = EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN;
+        StopMetrics(false);
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Reboots the module (if enabled) and then enters bootloader mode
+//=============================================================================
+bool
+LrdFwUpd::EnterBootloaderMode(
+    )
+{
     //Check if module should be restarted prior to upgrade by using a UART BREAK
-    if (pSettingsHandle->GetConfigOption(REBOOT_MODULE_BEFORE_UPDATE).toBool() == true)
+    if (pSessionConfig->bRebootBeforeUpdate == true)
     {
         //Module should be rebooted, BAUD rate does not matter so let's use the bootloader BAUD rate
-        pSettingsHandle->SetConfigOption(ACTIVE_BAUD, pSettingsHandle->GetConfigOption(BOOTLOADER_BAUD));
-        if (pDevice->Open() == false)
+        if (pDevice->Open(pSessionConfig->nBootloaderBaud) == false)
         {
             //Failed to open
             emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
@@ -260,7 +478,7 @@ LrdFwUpd::StartUpdate(
         }
 
         //Set DTR to the desired state, enable BREAK, wait for a period of time, then disable BREAK
-        pDevice->SetDTR(pSettingsHandle->GetConfigOption(REBOOT_MODULE_BEFORE_UPDATE_DTR_STATUS).toBool());
+        pDevice->SetDTR(pSessionConfig->bRebootBeforeUpdateDTR);
         pDevice->SetBreak(true);
 #ifdef _WIN32
         Sleep(REBOOT_MODULE_BREAK_ON_TIME_MS);
@@ -287,6 +505,143 @@ LrdFwUpd::StartUpdate(
     return true;
 }
 
+//=============================================================================
+// Starts probing the module to check if it is already in bootloader mode at
+// either the bootloader baud rate or the last negotiated baud rate
+//=============================================================================
+void
+LrdFwUpd::StartBootloaderProbe(
+    )
+{
+    bProbeAttempted = true;
+    nProbeIndex = 0;
+    lstProbeBauds.clear();
+    lstProbeBauds.append(pSessionConfig->nBootloaderBaud);
+
+    quint32 nLastBaud = GetLastBootloaderBaud();
+    if (nLastBaud != 0 && !lstProbeBauds.contains(nLastBaud))
+    {
+        //Module may have been left in bootloader mode at a higher baud rate
+        lstProbeBauds.append(nLastBaud);
+    }
+
+    tmrProbeTimer = new QTimer();
+    MallocFailCheck(tmrProbeTimer);
+    tmrProbeTimer->setInterval(FUP_PROBE_TIMEOUT_MS);
+    tmrProbeTimer->setSingleShot(true);
+    connect(tmrProbeTimer, SIGNAL(timeout()), this, SLOT(ProbeTimerTimeout()));
+
+    ProbeNextBaudRate();
+}
+
+//=============================================================================
+// Sends a version request at the next baud rate to probe, or falls back to the
+// normal bootloader entrance process if all baud rates have been tried
+//=============================================================================
+void
+LrdFwUpd::ProbeNextBaudRate(
+    )
+{
+    if (pDevice->IsOpen())
+    {
+        //Close port from previous probe
+        pDevice->Close();
+    }
+    baReceivedData.clear();
+
+    while (nProbeIndex < lstProbeBauds.count())
+    {
+        if (pDevice->Open(lstProbeBauds.at(nProbeIndex)) == true)
+        {
+            //Send version request and wait a short period for a response
+            SetMode(MODE_PROBE_BOOTLOADER);
+            CSubMode = SUBMODE_NONE;
+            pDevice->Transmit(COMMAND_BOOTLOADER_VERSION);
+            if (nVerbosity >= VERBOSITY_COMMANDS)
+            {
+                qDebug() << COMMAND_BOOTLOADER_VERSION;
+            }
+            tmrProbeTimer->start();
+            return;
+        }
+        ++nProbeIndex;
+    }
+
+    //No response at any baud rate, enter bootloader mode normally
+    disconnect(tmrProbeTimer, SIGNAL(timeout()), this, SLOT(ProbeTimerTimeout()));
+    delete tmrProbeTimer;
+    tmrProbeTimer = NULL;
+    SetMode(MODE_IDLE);
+    if (nVerbosity >= VERBOSITY_MODES)
+    {
+        emit CurrentAction(MODULE_UPDATE, 0, "Module did not respond to probe, entering bootloader mode");
+    }
+
+    if (EnterBootloaderMode() == false)
+    {
+        //Failed to start bootloader entrance
+        UpdateFailed(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
+    }
+}
+
+//=============================================================================
+// Callback when no response has been received to a bootloader probe
+//=============================================================================
+void
+LrdFwUpd::ProbeTimerTimeout(
+    )
+{
+    ++nProbeIndex;
+    ProbeNextBaudRate();
+}
+
+//=============================================================================
+// Returns the baud rate the module on the current port was last left at in
+// bootloader mode, or 0 if it is not known
+//=============================================================================
+quint32
+LrdFwUpd::GetLastBootloaderBaud(
+    )
+{
+    bool bWasOpen = pSettingsHandle->IsPersistentConfigOpen();
+    if (bWasOpen == false)
+    {
+        pSettingsHandle->OpenPersistentConfig(APP_NAME);
+    }
+
+    quint32 nBaud = pSettingsHandle->GetPersistentConfigOption(QString(PERSISTENT_KEY_LAST_BOOTLOADER_BAUD).append(QString(pSessionConfig->strPort).replace('/', '_')), (quint32)0).toUInt();
+
+    if (bWasOpen == false)
+    {
+        pSettingsHandle->ClosePersistentConfig();
+    }
+
+    return nBaud;
+}
+
+//=============================================================================
+// Stores the baud rate the module on the current port has been left at in
+// bootloader mode (0 if it is no longer in bootloader mode)
+//=============================================================================
+void
+LrdFwUpd::SetLastBootloaderBaud(
+    quint32 nBaud
+    )
+{
+    bool bWasOpen = pSettingsHandle->IsPersistentConfigOpen();
+    if (bWasOpen == false)
+    {
+        pSettingsHandle->OpenPersistentConfig(APP_NAME);
+    }
+
+    pSettingsHandle->SetPersistentConfigOption(QString(PERSISTENT_KEY_LAST_BOOTLOADER_BAUD).append(QString(pSessionConfig->strPort).replace('/', '_')), nBaud);
+
+    if (bWasOpen == false)
+    {
+        pSettingsHandle->ClosePersistentConfig();
+    }
+}
+
 //=============================================================================
 // Continues with the update process either right away or after a module reboot
 //=============================================================================
@@ -295,12 +650,11 @@ LrdFwUpd::ContinueUpgrade(
     )
 {
     //Check if there is a special bootloader entrance method
-    uint8_t nBlEnterType = pSettingsHandle->GetConfigOption(BOOTLOADER_ENTER_METHOD).toUInt();
-    pSettingsHandle->SetConfigOption(ACTIVE_BAUD, pSettingsHandle->GetConfigOption((nBlEnterType == ENTER_BOOTLOADER_BL654_USB || nBlEnterType == ENTER_BOOTLOADER_AT_FUP ? APPLICATION_BAUD : BOOTLOADER_BAUD)));
+    uint8_t nBlEnterType = pSessionConfig->nBootloaderEnterMethod;
 
     if (nBlEnterType == ENTER_BOOTLOADER_NONE)
     {
-        if (pDevice->Open() == false)
+        if (pDevice->Open(pSessionConfig->nBootloaderBaud) == false)
         {
             //Failed to open
             emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
@@ -318,17 +672,13 @@ LrdFwUpd::ContinueUpgrade(
             UpdateFailed(EXIT_CODE_BOOTLOADER_ENTRANCE_NOT_SUPPORTED);
             return;
 #else
-            //Use FTDI to enter bootloader
+            //Use FTDI to enter bootloader, confirmation dialogs are shown before the entrance sequence starts
             emit CurrentAction(MODULE_UPDATE, 0, "Waiting for module to enter bootloader...");
-#ifdef __linux__
-            QString strNewPortName;
-#endif
-
-            if (pBlEnter->EnterBootloader(nBlEnterType, pSettingsHandle->GetConfigOption(OUTPUT_DEVICE).toString(), "",
-#ifdef __linux__
-                &strNewPortName,
-#endif
-                pSettingsHandle->GetConfigOption(BOOTLOADER_ENTRANCE_WARNINGS_DISABLED).toBool(), pSettingsHandle->GetConfigOption(BOOTLOADER_ENTRANCE_ERRORS_DISABLED).toBool()) == false)
+            if (pTrace != NULL)
+            {
+                nTraceEntranceStartUS = pTrace->Now();
+            }
+            if (pBlEnter->ConfirmEnterBootloader(nBlEnterType, pSessionConfig->strPort, "", pSessionConfig->bEntranceWarningsDisabled, pSessionConfig->bEntranceErrorsDisabled) == false || pBlEnter->StartEnterBootloader(nBlEnterType, pSessionConfig->strPort, "") == false)
             {
                 //Failed to enter bootloader mode
                 emit CurrentAction(MODULE_UPDATE, 0, "Error whilst attempting to enter bootloader mode.");
@@ -336,55 +686,113 @@ LrdFwUpd::ContinueUpgrade(
                 return;
             }
 
-#ifdef __linux__
-            if (!strNewPortName.isNull() && !strNewPortName.isEmpty())
-            {
-                //Update serial port
-                pSettingsHandle->SetConfigOption(OUTPUT_DEVICE, strNewPortName);
-                emit SerialPortNameChanged(&strNewPortName);
-            }
+            //The update continues from BootloaderEntranceFinished() once the module has been reset
+            return;
 #endif
+        }
+    }
 
-            if (nBlEnterType == ENTER_BOOTLOADER_PINNACLE100)
-            {
-                //Re-open serial port
-                if (pDevice->Open() == false)
-                {
-                    //Failed to open
-                    emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
-                    UpdateFailed(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
-                    return;
-                }
-            }
+    WaitForBootloader();
+}
+
+//=============================================================================
+// Callback when the FTDI bootloader entrance sequence has finished
+//=============================================================================
+void
+LrdFwUpd::BootloaderEntranceFinished(
+    bool bSuccess,
+    QString strNewPortName
+    )
+{
+    if (pTrace != NULL)
+    {
+        QJsonObject jsoArgs;
+        jsoArgs["success"] = bSuccess;
+        pTrace->Complete(nTraceTrack, "FTDI bootloader entrance", nTraceEntranceStartUS, jsoArgs);
+    }
+
+    if (bSuccess == false)
+    {
+        //Failed to enter bootloader mode
+        emit CurrentAction(MODULE_UPDATE, 0, "Error whilst attempting to enter bootloader mode.");
+        UpdateFailed(EXIT_CODE_BOOTLOADER_ENTRANCE_FAILED);
+        return;
+    }
+
+#ifdef __linux__
+    if (!strNewPortName.isNull() && !strNewPortName.isEmpty())
+    {
+        //Update serial port, the rest of the session uses a copy of the session configuration with the new port
+        SessionConfigStruct *pConfig = new SessionConfigStruct(*pSessionConfig);
+        MallocFailCheck(pConfig);
+        pConfig->strPort = strNewPortName;
+        pSessionConfig = QSharedPointer<const SessionConfigStruct>(pConfig);
+        pDevice->SetSessionConfig(pSessionConfig);
+        pSettingsHandle->SetConfigOption(OUTPUT_DEVICE, strNewPortName);
+        emit SerialPortNameChanged(&strNewPortName);
+    }
+#else
+    Q_UNUSED(strNewPortName);
 #endif
+
+    if (pSessionConfig->nBootloaderEnterMethod == ENTER_BOOTLOADER_PINNACLE100)
+    {
+        //Re-open serial port
+        if (pDevice->Open(pSessionConfig->nBootloaderBaud) == false)
+        {
+            //Failed to open
+            emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
+            UpdateFailed(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
+            return;
         }
+    }
 
-        if (nBlEnterType == ENTER_BOOTLOADER_BL654_USB || nBlEnterType == ENTER_BOOTLOADER_AT_FUP)
+    WaitForBootloader();
+}
+
+//=============================================================================
+// Sends the AT+FUP command if required and waits for the module to be ready
+// in bootloader mode
+//=============================================================================
+void
+LrdFwUpd::WaitForBootloader(
+    )
+{
+    uint8_t nBlEnterType = pSessionConfig->nBootloaderEnterMethod;
+    if (nBlEnterType == ENTER_BOOTLOADER_BL654_USB || nBlEnterType == ENTER_BOOTLOADER_AT_FUP)
+    {
+        //Use AT+FUP entrance, the module is still running the application so the application baud rate is used
+        if (pDevice->Open(pSessionConfig->nApplicationBaud) == false)
         {
-            //Use AT+FUP entrance
-            if (pDevice->Open() == false)
-            {
-                //Failed to open
-                emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
-                UpdateFailed(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
-                return;
-            }
+            //Failed to open
+            emit CurrentAction(MODULE_UPDATE, 0, "Serial port opening failed.");
+            UpdateFailed(EXIT_CODE_SERIAL_PORT_FAILED_TO_OPEN);
+            return;
+        }
 
-            nCMode = MODE_ENTER_BOOTLOADER;
-            pDevice->Transmit(COMMAND_ENTER_BOOTLOADER);
-            if (nVerbosity >= VERBOSITY_COMMANDS)
-            {
-                qDebug() << COMMAND_ENTER_BOOTLOADER;
-            }
+        SetMode(MODE_ENTER_BOOTLOADER);
+        if (bProbeAttempted == true)
+        {
+            //Terminate the line containing the probe command
+            pDevice->Transmit(COMMAND_LINE_TERMINATOR);
+        }
+        pDevice->Transmit(COMMAND_ENTER_BOOTLOADER);
+        if (nVerbosity >= VERBOSITY_COMMANDS)
+        {
+            qDebug() << COMMAND_ENTER_BOOTLOADER;
+        }
 
-            if (nBlEnterType == ENTER_BOOTLOADER_AT_FUP)
-            {
-                emit CurrentAction(MODULE_UPDATE, 0, "Waiting for module to enter bootloader...");
-            }
+        if (nBlEnterType == ENTER_BOOTLOADER_AT_FUP)
+        {
+            emit CurrentAction(MODULE_UPDATE, 0, "Waiting for module to enter bootloader...");
         }
     }
 
     //Waiting for module to become ready
+    if (pTrace != NULL)
+    {
+        nTraceReadyWaitStartUS = pTrace->Now();
+    }
     nDeviceReadyChecks = 0;
     tmrDeviceReadyTimer = new QTimer();
     MallocFailCheck(tmrDeviceReadyTimer);
@@ -409,15 +817,13 @@ LrdFwUpd::DeviceReadyTimerTimeout(
         disconnect(tmrDeviceReadyTimer, SIGNAL(timeout()), this, SLOT(DeviceReadyTimerTimeout()));
         delete tmrDeviceReadyTimer;
         tmrDeviceReadyTimer = NULL;
-        uint8_t nBlEnterType = pSettingsHandle->GetConfigOption(BOOTLOADER_ENTER_METHOD).toUInt();
+        uint8_t nBlEnterType = pSessionConfig->nBootloaderEnterMethod;
         if (nBlEnterType == ENTER_BOOTLOADER_BL654_USB || nBlEnterType == ENTER_BOOTLOADER_AT_FUP)
         {
-            if (pSettingsHandle->GetConfigOption(BOOTLOADER_BAUD) != pSettingsHandle->GetConfigOption(ACTIVE_BAUD))
+            if (pSessionConfig->nBootloaderBaud != pDevice->ActiveBaud())
             {
-                //Different baud rates, close and re-open with new baud rate
-                pDevice->Close();
-                pSettingsHandle->SetConfigOption(ACTIVE_BAUD, pSettingsHandle->GetConfigOption(BOOTLOADER_BAUD));
-                if (pDevice->Open() == false)
+                //Different baud rates, switch to the bootloader baud rate
+                if (pDevice->ChangeBaudRate(pSessionConfig->nBootloaderBaud) == false)
                 {
                     UpdateFailed(EXIT_CODE_SERIAL_PORT_REOPEN_FAILED);
                     return;
@@ -425,17 +831,25 @@ LrdFwUpd::DeviceReadyTimerTimeout(
             }
         }
 
-        //Module is ready
+        if (pTrace != NULL)
+        {
+            QJsonObject jsoArgs;
+            jsoArgs["checks"] = (int)nDeviceReadyChecks;
+            pTrace->Complete(nTraceTrack, "Wait for CTS", nTraceReadyWaitStartUS, jsoArgs);
+        }
+
+        //Module is ready, round trips from here on are timed against the bootloader
         bResentFirstBootloaderCommand = false;
+        pDevice->ResetRoundTripStats();
         elptmrUpgradeTime.start();
-        nCMode = MODE_BOOTLOADER_VERSION;
+        SetMode(MODE_BOOTLOADER_VERSION);
         CSubMode = SUBMODE_NONE;
         pDevice->Transmit(COMMAND_BOOTLOADER_VERSION);
         if (nVerbosity >= VERBOSITY_COMMANDS)
         {
             qDebug() << COMMAND_BOOTLOADER_VERSION;
         }
-        tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+        StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
     }
     else
     {
@@ -453,6 +867,31 @@ LrdFwUpd::DeviceReadyTimerTimeout(
     }
 }
 
+//=============================================================================
+// Sets the FTDI latency timer of the port for the rest of the update and
+// reports the round trip time measured so far (with the original value)
+//=============================================================================
+void
+LrdFwUpd::TuneLatencyTimer(
+    )
+{
+    qint64 nAverageUS;
+    pDevice->GetRoundTripStats(&nAverageUS);
+    uint8_t nLatencyMS = pSessionConfig->nFtdiLatencyTimer;
+
+    if (pDevice->SetLatencyTimer(nLatencyMS) == false)
+    {
+        //Not an FTDI port or the value could not be changed
+        pDevice->SetLatencyTimer(0);
+        emit CurrentAction(MODULE_UPDATE, 0, "FTDI latency timer could not be changed on this port, leaving it unchanged");
+        return;
+    }
+
+    emit CurrentAction(MODULE_UPDATE, 0, QString("FTDI latency timer changed from ").append(QString::number(pDevice->GetOriginalLatencyTimer())).append("ms to ").append(QString::number(nLatencyMS)).append("ms, round trip time before tuning: ").append(QString::number(nAverageUS)).append("us"));
+    pDevice->ResetRoundTripStats();
+    bLatencyTuned = true;
+}
+
 //=============================================================================
 // Callback when the CTS timer has elapsed (for resetting module)
 //=============================================================================
@@ -501,42 +940,155 @@ bool LrdFwUpd::IsUpdateInProgress()
 }
 
 //=============================================================================
-// Processes target platform commands
+// Processes a record from the upgrade file (the header has been read), this
+// is shared by the update and the dry run estimate. The device, sector map,
+// erase and write block state is updated but nothing is sent to the module.
+// Returns FUNCTION_RETURN_CODE_SUCCESS_DONE if the record needs commands to be
+// sent (baPendingCommand for target platform records, lstEraseCommands for
+// erase records and PlanNextWriteStep() for write records)
 //=============================================================================
 int8_t
-LrdFwUpd::ProcessCommandTargetPlatform(
+LrdFwUpd::ProcessRecord(
+    uint8_t nCmdID,
     uint32_t nLength
     )
 {
-    //Check length of command
-    if (nLength != UWF_TARGET_PLATFORM_LENGTH)
+    if (nCmdID == UWF_COMMAND_TARGET_PLATFORM)
     {
-        //Packet length is not valid
-        return FUNCTION_RETURN_CODE_INVALID_LENGTH;
+        //Target platform
+        return ProcessCommandTargetPlatform(nLength);
     }
-
-    //Read in data and construct target platform packet
-    QByteArray baTargetData = COMMAND_TARGET_PLATFORM;
-    baTargetData.append(pUwfData->Read(nLength));
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
-    uint32_t nTargetID = 0;
-    ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, 1, nTargetID);
-    emit CurrentAction(MODULE_UPDATE, 0, QString("\tTarget - ID: ").append(QString::number(nTargetID, 16)));
-
-    nCMode = MODE_PLATFORM_COMMAND;
-    pDevice->Transmit(baTargetData);
-    if (nVerbosity >= VERBOSITY_COMMANDS)
+    else if (nCmdID == UWF_COMMAND_REGISTER)
     {
-        qDebug() << baTargetData;
+        //Register device
+        return ProcessCommandRegisterDevice(nLength);
     }
-
-    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
-}
-
-//=============================================================================
-// Processes register device commands
-//=============================================================================
-int8_t
+    else if (nCmdID == UWF_COMMAND_SELECT)
+    {
+        //Select device
+        return ProcessCommandSelectDevice(nLength);
+    }
+    else if (nCmdID == UWF_COMMAND_SECTOR_MAP)
+    {
+        //Sector map
+        return ProcessCommandSectorMap(nLength);
+    }
+    else if (nCmdID == UWF_COMMAND_ERASE)
+    {
+        //Erase
+        return ProcessCommandEraseBlock(nLength);
+    }
+    else if (nCmdID == UWF_COMMAND_WRITE)
+    {
+        //Write
+        return ProcessCommandWriteBlock(nLength);
+    }
+    else if (nCmdID == UWF_COMMAND_UNREGISTER)
+    {
+        //Unregister
+        return ProcessCommandUnregister(nLength);
+    }
+
+    //Unknown command
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Unknown command encountered: ").append((char)nCmdID));
+    pUwfData->Seek(SEEK_CURRENT, nLength);
+    emit PercentComplete(-1, UpgradeFilePercent());
+
+    return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
+}
+
+//=============================================================================
+// Sends the commands for a record which has been processed by ProcessRecord()
+//=============================================================================
+int8_t
+LrdFwUpd::SendRecordCommands(
+    uint8_t nCmdID
+    )
+{
+    if (nCmdID == UWF_COMMAND_TARGET_PLATFORM)
+    {
+        SetMode(MODE_PLATFORM_COMMAND);
+        pDevice->Transmit(baPendingCommand);
+        if (nVerbosity >= VERBOSITY_COMMANDS)
+        {
+            qDebug() << baPendingCommand;
+        }
+    }
+    else if (nCmdID == UWF_COMMAND_ERASE)
+    {
+        //Start erase process
+        SetMode(MODE_ERASE_COMMAND);
+        nEraseCommandIndex = 0;
+        SendNextEraseCommand();
+    }
+    else if (nCmdID == UWF_COMMAND_WRITE)
+    {
+        //Send first write address command, if every chunk was skipped then move on to the next packet
+        SetMode(MODE_WRITE_COMMAND);
+        CSubMode = SUBMODE_NONE;
+        if (SendNextWriteAddress() == false)
+        {
+            SetMode(MODE_IDLE);
+            return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
+        }
+    }
+
+    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+}
+
+//=============================================================================
+// Returns the exit code for a failed record
+//=============================================================================
+int32_t
+LrdFwUpd::RecordErrorCode(
+    int8_t nStatus
+    )
+{
+    if (nStatus == FUNCTION_RETURN_CODE_SECTOR_MAPPING_NOT_FOUND)
+    {
+        return EXIT_CODE_ERASE_SECTOR_MAPPING_NOT_FOUND;
+    }
+    else if (nStatus == FUNCTION_RETURN_CODE_DEVICE_NOT_REGISTERED)
+    {
+        return EXIT_CODE_UWF_FILE_NOT_VALID;
+    }
+
+    return EXIT_CODE_RETURN_CODE_ERROR;
+}
+
+//=============================================================================
+// Processes target platform commands
+//=============================================================================
+int8_t
+LrdFwUpd::ProcessCommandTargetPlatform(
+    uint32_t nLength
+    )
+{
+    //Check length of command
+    if (nLength != UWF_TARGET_PLATFORM_LENGTH)
+    {
+        //Packet length is not valid
+        return FUNCTION_RETURN_CODE_INVALID_LENGTH;
+    }
+
+    //Read in data and construct target platform packet
+    QByteArray baTargetData = COMMAND_TARGET_PLATFORM;
+    baTargetData.append(pUwfData->Read(nLength));
+    emit PercentComplete(-1, UpgradeFilePercent());
+    uint32_t nTargetID = 0;
+    ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, 1, nTargetID);
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tTarget - ID: ").append(QString::number(nTargetID, 16)));
+
+    //Sent by the caller
+    baPendingCommand = baTargetData;
+
+    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+}
+
+//=============================================================================
+// Processes register device commands
+//=============================================================================
+int8_t
 LrdFwUpd::ProcessCommandRegisterDevice(
     uint32_t nLength
     )
@@ -550,7 +1102,7 @@ LrdFwUpd::ProcessCommandRegisterDevice(
 
     //Read in data and construct register device packet
     QByteArray baTargetData = pUwfData->Read(nLength);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
+    emit PercentComplete(-1, UpgradeFilePercent());
     uint8_t nHandle = (uint8_t)baTargetData[UWF_OFFSET_REGISTER_HANDLE];
     uint32_t nBaseAddr = 0;
     ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_REGISTER_BASE_ADDRESS, nBaseAddr);
@@ -596,7 +1148,7 @@ LrdFwUpd::ProcessCommandSelectDevice(
 
     //Read in data and construct select device packet
     QByteArray baTargetData = pUwfData->Read(nLength);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
+    emit PercentComplete(-1, UpgradeFilePercent());
     uint8_t nFlash = (uint8_t)baTargetData[UWF_OFFSET_SELECT_FLASH];
     uint8_t nBank = (uint8_t)baTargetData[UWF_OFFSET_SELECT_BANK];
     emit CurrentAction(MODULE_UPDATE, 0, QString("\tSelect - Flash: ").append(QString::number(nFlash)).append(", Bank: ").append(QString::number(nBank)));
@@ -634,9 +1186,15 @@ LrdFwUpd::ProcessCommandSectorMap(
         return FUNCTION_RETURN_CODE_INVALID_LENGTH;
     }
 
+    if (nActiveDevice >= lstDevices.count())
+    {
+        //No device to map
+        return FUNCTION_RETURN_CODE_DEVICE_NOT_REGISTERED;
+    }
+
     //Read in data and construct sector map packet
     QByteArray baTargetData = pUwfData->Read(nLength);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
+    emit PercentComplete(-1, UpgradeFilePercent());
     uint32_t nSectors = 0;
     uint32_t nSectorSize = 0;
     uint8_t nCurrentPosition = 0;
@@ -653,7 +1211,6 @@ LrdFwUpd::ProcessCommandSectorMap(
         if (nCurrentPosition == 0)
         {
             //This is the default
-            nActiveSectorSize = nSectorSize;
             pSS->nOffset = lstDevices[nActiveDevice]->nBaseAddr;
         }
         else
@@ -673,11 +1230,15 @@ LrdFwUpd::ProcessCommandSectorMap(
         nCurrentPosition += UWF_SECTOR_MAP_LENGTH;
     }
 
+    //Update the index used for sector lookups
+    BuildSectorIndex();
+
     return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
 }
 
 //=============================================================================
-// Processes erase block commands
+// Processes erase block commands, this and any erase block commands which
+// directly follow it are merged and planned in one go
 //=============================================================================
 int8_t
 LrdFwUpd::ProcessCommandEraseBlock(
@@ -691,116 +1252,308 @@ LrdFwUpd::ProcessCommandEraseBlock(
         return FUNCTION_RETURN_CODE_INVALID_LENGTH;
     }
 
-    //Read in data and construct erase packet
-    QByteArray baTargetData = pUwfData->Read(UWF_ERASE_BLOCK_LENGTH);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
-    uint32_t nOffset = 0;
-    ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_ERASE_OFFSET, nOffset);
-    uint32_t nSize = 0;
-    ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_ERASE_SIZE, nSize);
-
-    //Start erase process
-    nEraseStart = lstDevices[nActiveDeviceIndex]->nBaseAddr + nOffset;
-    nEraseSize = nSize;
-    nEraseWholeSize = nSize;
-    nCMode = MODE_ERASE_COMMAND;
-    emit CurrentAction(MODULE_UPDATE, 0, QString("\tErase - Offset: 0x").append(QString::number(nOffset, 16)).append(", Address: 0x").append(QString::number(nEraseStart, 16)).append(", Size: 0x").append(QString::number(nSize, 16)));
-    if (nActiveEraseLengthCmd > 0)
+    if (bReadbackMode == true)
     {
-        //Use new version of command with size specifier
-        uint8_t i = 0;
-        while (i < lstEraseSizes.count())
-        {
-            if (lstEraseSizes.at(i) >= nEraseSize)
-            {
-                break;
-            }
-            ++i;
-        }
+        //Flash is only being read, do not erase anything
+        pUwfData->Read(UWF_ERASE_BLOCK_LENGTH);
+        return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
+    }
+
+    if (nActiveDeviceIndex >= lstDevices.count())
+    {
+        //No device to erase
+        return FUNCTION_RETURN_CODE_DEVICE_NOT_REGISTERED;
+    }
 
-        if (i >= lstEraseSizes.count())
+    QList<AddressRangeStruct> lstRanges;
+    while (true)
+    {
+        //Read in data and add the range to be erased
+        QByteArray baTargetData = pUwfData->Read(UWF_ERASE_BLOCK_LENGTH);
+        emit PercentComplete(-1, UpgradeFilePercent());
+        uint32_t nOffset = 0;
+        ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_ERASE_OFFSET, nOffset);
+        uint32_t nSize = 0;
+        ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_ERASE_SIZE, nSize);
+
+        AddressRangeStruct sRange;
+        sRange.nStart = (quint64)lstDevices[nActiveDeviceIndex]->nBaseAddr + nOffset;
+        sRange.nEnd = sRange.nStart + nSize;
+        lstRanges.append(sRange);
+        emit CurrentAction(MODULE_UPDATE, 0, QString("\tErase - Offset: 0x").append(QString::number(nOffset, 16)).append(", Address: 0x").append(QString::number(sRange.nStart, 16)).append(", Size: 0x").append(QString::number(nSize, 16)));
+
+        if (nUwfPacketIndex >= lstUwfPackets.count() || lstUwfPackets.at(nUwfPacketIndex).nCmdID != UWF_COMMAND_ERASE || lstUwfPackets.at(nUwfPacketIndex).nLength != UWF_ERASE_BLOCK_LENGTH)
         {
-            //Cap erase size
-            i = lstEraseSizes.count()-1;
+            //No more packets, or a different command which is processed normally
+            break;
         }
 
-        //Send erase command
-        QByteArray baAddr = COMMAND_ERASE_SECTION;
-        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nEraseStart);
-        baAddr.append((uint8_t)i);
-        pDevice->Transmit(baAddr);
-        if (nVerbosity >= VERBOSITY_COMMANDS)
+        //The next packet is also an erase block command, merge it with this one
+        pUwfData->Seek(SEEK_FROM_BEGINNING, lstUwfPackets.at(nUwfPacketIndex).nFileOffset);
+        ++nUwfPacketIndex;
+    }
+
+    //Work out the erase commands needed for all of the ranges
+    QList<AddressRangeStruct> lstMergedRanges = MergeAddressRanges(lstRanges);
+    lstEraseCommands.clear();
+    if (PlanEraseCommands(lstMergedRanges, lstSectorIndex, lstEraseSizes, (nActiveEraseLengthCmd > 0), &lstEraseCommands) == false)
+    {
+        //No match found in sector map
+        return FUNCTION_RETURN_CODE_SECTOR_MAPPING_NOT_FOUND;
+    }
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tErase plan: ").append(QString::number(lstRanges.count())).append(" range(s) merged into ").append(QString::number(lstMergedRanges.count())).append(", ").append(QString::number(lstEraseCommands.count())).append(" erase command(s)"));
+
+    if (lstEraseCommands.isEmpty())
+    {
+        //Nothing to erase
+        return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
+    }
+
+    //Track erased ranges (only if exactly what is erased is known, as erased chunks are skipped based on this)
+    int i = 0;
+    while (i < lstEraseCommands.count())
+    {
+        if (lstEraseCommands.at(i).bExact == true)
         {
-            qDebug() << baAddr;
+            AddErasedRange((uint32_t)lstEraseCommands.at(i).nAddress, lstEraseCommands.at(i).nSize);
         }
+        ++i;
+    }
+
+    //Erase commands are sent by the caller
+    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+}
+
+//=============================================================================
+// Sends the next planned erase command
+//=============================================================================
+void
+LrdFwUpd::SendNextEraseCommand(
+    )
+{
+    const EraseCommandStruct &sCommand = lstEraseCommands.at(nEraseCommandIndex);
+    QByteArray baAddr = COMMAND_ERASE_SECTION;
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, (uint32_t)sCommand.nAddress);
+    if (sCommand.nSizeIndex >= 0)
+    {
+        //Use new version of command with size specifier
+        baAddr.append((uint8_t)sCommand.nSizeIndex);
+    }
+    pDevice->Transmit(baAddr);
+    if (nVerbosity >= VERBOSITY_COMMANDS)
+    {
+        qDebug() << baAddr;
+    }
 
-        //Update debug output
-        emit CurrentAction(MODULE_UPDATE, 0, QString("Erasing 0x").append(QString::number(nEraseStart, 16)).append(" - 0x").append(QString::number(nEraseStart + lstEraseSizes.at(i), 16)));
+    //Update log
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Erasing 0x").append(QString::number(sCommand.nAddress, 16)).append(" - 0x").append(QString::number(sCommand.nAddress + sCommand.nSize, 16)));
+
+    //Move on to the next command
+    ++nEraseCommandIndex;
+    emit PercentComplete((int8_t)((nEraseCommandIndex * 100) / lstEraseCommands.count()), -1);
+}
+
+//=============================================================================
+// Sorts a list of address ranges and merges any which overlap or are adjacent
+//=============================================================================
+QList<AddressRangeStruct>
+LrdFwUpd::MergeAddressRanges(
+    QList<AddressRangeStruct> lstRanges
+    )
+{
+    std::sort(lstRanges.begin(), lstRanges.end(), [](const AddressRangeStruct &a, const AddressRangeStruct &b) { return a.nStart < b.nStart; });
 
-        //Increment the current erase position
-        nEraseStart += lstEraseSizes.at(i);
-        if (nEraseSize < lstEraseSizes.at(i))
+    QList<AddressRangeStruct> lstMerged;
+    int i = 0;
+    while (i < lstRanges.count())
+    {
+        if (lstRanges.at(i).nEnd <= lstRanges.at(i).nStart)
         {
-            //Final erase message
-            nEraseSize = 0;
+            //Empty range
+        }
+        else if (!lstMerged.isEmpty() && lstRanges.at(i).nStart <= lstMerged.last().nEnd)
+        {
+            //Overlaps or is adjacent to the previous range
+            lstMerged.last().nEnd = qMax(lstMerged.last().nEnd, lstRanges.at(i).nEnd);
         }
         else
         {
-            //Decrement size left to erase
-            nEraseSize -= lstEraseSizes.at(i);
+            //New range
+            lstMerged.append(lstRanges.at(i));
         }
+        ++i;
     }
-    else
+
+    return lstMerged;
+}
+
+//=============================================================================
+// Rebuilds the sector map index (sorted by address) from the sector map
+//=============================================================================
+void
+LrdFwUpd::BuildSectorIndex(
+    )
+{
+    lstSectorIndex.clear();
+    uint8_t i = 0;
+    while (i < lstSectorMap.length())
     {
-        //Use classic command without size specified
-        QByteArray baAddr = COMMAND_ERASE_SECTION;
-        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nEraseStart);
-        pDevice->Transmit(baAddr);
-        if (nVerbosity >= VERBOSITY_COMMANDS)
+        SectorIndexStruct sEntry;
+        sEntry.nStart = lstSectorMap[i]->nOffset;
+        sEntry.nEnd = (quint64)lstSectorMap[i]->nOffset + lstSectorMap[i]->nTotalSize;
+        sEntry.nSectorSize = lstSectorMap[i]->nSectorSize;
+        if (sEntry.nSectorSize > 0 && sEntry.nEnd > sEntry.nStart)
         {
-                qDebug() << baAddr;
+            lstSectorIndex.append(sEntry);
         }
+        ++i;
+    }
+
+    std::stable_sort(lstSectorIndex.begin(), lstSectorIndex.end(), [](const SectorIndexStruct &a, const SectorIndexStruct &b) { return a.nStart < b.nStart; });
+}
+
+//=============================================================================
+// Returns the index of the sector map index entry which contains an address
+// (binary search), or -1 if the address is not in the sector map
+//=============================================================================
+int32_t
+LrdFwUpd::FindSectorIndex(
+    const QList<SectorIndexStruct> &lstIndex,
+    quint64 nAddress
+    )
+{
+    //Find the first entry which starts after the address, the entry before it is the only candidate
+    auto itEntry = std::upper_bound(lstIndex.constBegin(), lstIndex.constEnd(), nAddress, [](quint64 nValue, const SectorIndexStruct &sEntry) { return nValue < sEntry.nStart; });
+    if (itEntry == lstIndex.constBegin())
+    {
+        //Address is before the first entry
+        return -1;
+    }
+    --itEntry;
+
+    if (nAddress >= itEntry->nEnd)
+    {
+        //Address is in a gap between entries
+        return -1;
+    }
 
-        //Find which sector map this erase section applies to
-        uint8_t i = 0;
-        while (i < lstSectorMap.length())
+    return (int32_t)(itEntry - lstIndex.constBegin());
+}
+
+//=============================================================================
+// Plans the erase commands needed to erase a list of merged ranges. Ranges
+// are expanded to whole sectors (which the module erases regardless). When
+// the command takes a size, each command uses the largest supported erase
+// size which is aligned to the current address and does not go past the end
+// of the range, which gives the minimum number of commands when the erase
+// sizes are multiples of each other. The classic command erases one sector
+// per command. Returns false if a range is not covered by the sector map
+// (required for the classic command)
+//=============================================================================
+bool
+LrdFwUpd::PlanEraseCommands(
+    const QList<AddressRangeStruct> &lstRanges,
+    const QList<SectorIndexStruct> &lstIndex,
+    const QList<quint32> &lstSizes,
+    bool bSizedCommand,
+    QList<EraseCommandStruct> *plstCommands
+    )
+{
+    quint64 nCovered = 0;
+    int i = 0;
+    while (i < lstRanges.count())
+    {
+        quint64 nStart = lstRanges.at(i).nStart;
+        quint64 nEnd = lstRanges.at(i).nEnd;
+
+        //Expand the start and end of the range to sector boundaries
+        int32_t nEntry = FindSectorIndex(lstIndex, nStart);
+        if (nEntry >= 0)
         {
-            if (nEraseStart >= lstSectorMap[i]->nOffset && nEraseStart < (lstSectorMap[i]->nOffset + lstSectorMap[i]->nTotalSize))
-            {
-                //Correct sector found
-                break;
-            }
-            ++i;
+            const SectorIndexStruct &sEntry = lstIndex.at(nEntry);
+            nStart = sEntry.nStart + ((nStart - sEntry.nStart) / sEntry.nSectorSize) * sEntry.nSectorSize;
         }
-
-        if (i == lstSectorMap.length())
+        else if (bSizedCommand == false)
         {
-            //No match found in sector map
-            return FUNCTION_RETURN_CODE_SECTOR_MAPPING_NOT_FOUND;
+            //Classic erase requires the sector map
+            return false;
         }
 
-        nActiveSectorSize = lstSectorMap[i]->nSectorSize;
-        nActiveEraseSectorLeft = lstSectorMap[i]->nSectors - ((nEraseStart - lstSectorMap[i]->nOffset) / nActiveSectorSize);
-
-        //Update debug output
-        emit CurrentAction(MODULE_UPDATE, 0, QString("Erasing 0x").append(QString::number(nEraseStart, 16)).append(" - 0x").append(QString::number(nEraseStart + nActiveSectorSize, 16)));
+        nEntry = FindSectorIndex(lstIndex, nEnd - 1);
+        if (nEntry >= 0)
+        {
+            const SectorIndexStruct &sEntry = lstIndex.at(nEntry);
+            nEnd = sEntry.nStart + ((nEnd - 1 - sEntry.nStart) / sEntry.nSectorSize + 1) * sEntry.nSectorSize;
+        }
 
-        //Increment the current erase position
-        nEraseStart += nActiveSectorSize;
-        --nActiveEraseSectorLeft;
-        if (nEraseSize < nActiveSectorSize)
+        if (nStart < nCovered)
         {
-            //Final erase message
-            nEraseSize = 0;
+            //Start of this range has already been erased by a previous command
+            nStart = nCovered;
         }
-        else
+
+        while (nStart < nEnd)
         {
-            //Decrement size left to erase
-            nEraseSize -= nActiveSectorSize;
+            EraseCommandStruct sCommand;
+            sCommand.nAddress = nStart;
+            if (bSizedCommand == true)
+            {
+                //Find the largest aligned erase size which fits, or the smallest size if none do
+                int8_t nBest = -1;
+                int8_t nSmallest = -1;
+                uint8_t n = 0;
+                while (n < lstSizes.count())
+                {
+                    if (lstSizes.at(n) > 0)
+                    {
+                        if (nSmallest == -1 || lstSizes.at(n) < lstSizes.at(nSmallest))
+                        {
+                            nSmallest = n;
+                        }
+
+                        if ((nStart % lstSizes.at(n)) == 0 && (nStart + lstSizes.at(n)) <= nEnd && (nBest == -1 || lstSizes.at(n) > lstSizes.at(nBest)))
+                        {
+                            nBest = n;
+                        }
+                    }
+                    ++n;
+                }
+
+                if (nSmallest == -1)
+                {
+                    //No erase sizes are available
+                    return false;
+                }
+
+                sCommand.nSizeIndex = (nBest == -1 ? nSmallest : nBest);
+                sCommand.nSize = lstSizes.at(sCommand.nSizeIndex);
+
+                //An unaligned erase may be rounded down by the module, so which flash it clears is not known
+                sCommand.bExact = ((nStart % sCommand.nSize) == 0);
+            }
+            else
+            {
+                //Erase the sector containing this address
+                nEntry = FindSectorIndex(lstIndex, nStart);
+                if (nEntry < 0)
+                {
+                    //No match found in sector map
+                    return false;
+                }
+                sCommand.nSizeIndex = -1;
+                sCommand.nSize = lstIndex.at(nEntry).nSectorSize;
+                sCommand.bExact = true;
+            }
+
+            plstCommands->append(sCommand);
+            nStart += sCommand.nSize;
         }
+
+        nCovered = nStart;
+        ++i;
     }
 
-    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+    return true;
 }
 
 //=============================================================================
@@ -818,9 +1571,15 @@ LrdFwUpd::ProcessCommandWriteBlock(
         return FUNCTION_RETURN_CODE_INVALID_LENGTH;
     }
 
+    if (nActiveDeviceIndex >= lstDevices.count())
+    {
+        //No device to write to
+        return FUNCTION_RETURN_CODE_DEVICE_NOT_REGISTERED;
+    }
+
     //Read in data and construct write data packet
     QByteArray baTargetData = pUwfData->Read(UWF_WRITE_BLOCK_LENGTH);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
+    emit PercentComplete(-1, UpgradeFilePercent());
     uint32_t nOffset = 0;
     ENDIAN_FLIP_BYTEARRAY_TO_UI32(baTargetData, UWF_OFFSET_WRITE_OFFSET, nOffset);
     uint32_t nFlags = 0;
@@ -830,18 +1589,52 @@ LrdFwUpd::ProcessCommandWriteBlock(
     nWriteStart = lstDevices[nActiveDeviceIndex]->nBaseAddr + nOffset;
     nWriteSize = nLength - UWF_WRITE_BLOCK_LENGTH;
     nWriteWholeSize = nWriteSize;
-    nCMode = MODE_WRITE_COMMAND;
-    CSubMode = SUBMODE_WRITE_DATA;
-    nDataSize = nActiveWriteSize;
-    if (nDataSize > nWriteSize)
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tWrite - Offset: 0x").append(QString::number(nOffset, 16)).append(", Address: 0x").append(QString::number(nWriteStart, 16)).append(", Flags: 0x").append(QString::number(nFlags, 16)).append(", Size: 0x").append(QString::number((nLength - 8), 16)));
+
+    if (bReadbackMode == true)
     {
-        //Limit data size
-        nDataSize = nWriteSize;
+        //Flash is only being read, remember the range (and where the data is if comparing) instead of writing it
+        qint64 nDataFileOffset = pUwfData->CurrentPosition();
+        pUwfData->Seek(SEEK_CURRENT, nWriteSize);
+        emit PercentComplete(-1, UpgradeFilePercent());
+        if (bReadbackExplicitRange == false)
+        {
+            AddressRangeStruct sRange;
+            sRange.nStart = nWriteStart;
+            sRange.nEnd = (quint64)nWriteStart + nWriteSize;
+            lstReadbackRanges.append(sRange);
+        }
+        if (bReadbackCompare == true)
+        {
+            ReadbackExpectedStruct sExpected;
+            sExpected.nAddress = nWriteStart;
+            sExpected.nFileOffset = nDataFileOffset;
+            sExpected.nSize = nWriteSize;
+            lstReadbackExpected.append(sExpected);
+        }
+        return FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
+    }
+
+    //Keep track of how many write commands are needed with and without page alignment
+    nUnalignedWritePackets += CountWriteChunks(nWriteStart, nWriteSize, nActiveWriteSize, 0);
+    if (bAlignWrites == true)
+    {
+        nAlignedWritePackets += CountWriteChunks(nWriteStart, nWriteSize, nActiveWriteSize, GetWritePageSize(nWriteStart));
+    }
+    else
+    {
+        nAlignedWritePackets += CountWriteChunks(nWriteStart, nWriteSize, nActiveWriteSize, 0);
     }
-    emit CurrentAction(MODULE_UPDATE, 0, QString("\tWrite - Offset: 0x").append(QString::number(nOffset, 16)).append(", Address: 0x").append(QString::number(nWriteStart, 16)).append(", Flags: 0x").append(QString::number(nFlags, 16)).append(", Size: 0x").append(QString::number((nLength - 8), 16)));
 
-    //Check if verification is enabled
-    bVerifyActive = pSettingsHandle->GetConfigOption(VERIFY_DATA).toBool();
+    //Check if verification is enabled and if it is done with the writes or afterwards
+    bVerifyActive = pSessionConfig->bVerifyData;
+    bDeferredVerify = false;
+    if (bVerifyActive == true && nVerifyStrategy == VERIFY_STRATEGY_DEFERRED)
+    {
+        //Data is verified once all writes for this image are complete
+        bVerifyActive = false;
+        bDeferredVerify = true;
+    }
     if (bVerifyActive == true)
     {
         //Reset verification variables and set first adddress
@@ -850,7 +1643,46 @@ LrdFwUpd::ProcessCommandWriteBlock(
         nVerifySize = 0;
     }
 
+    //Chunks are planned with PlanNextWriteStep() by the caller
+    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+}
+
+//=============================================================================
+// Sends the write address command for the next chunk of the active write
+// block, or a verify command when the verification size limit is reached or
+// at the end of the write block (see PlanNextWriteStep()). Returns false if
+// the write block has finished and no command was sent
+//=============================================================================
+bool
+LrdFwUpd::SendNextWriteAddress(
+    )
+{
+    uint8_t nStep = PlanNextWriteStep();
+    while (nStep == WRITE_STEP_SKIP)
+    {
+        //Chunk did not need to be written
+        emit PercentComplete(-1, UpgradeFilePercent());
+        emit PercentComplete(100 - ((nWriteSize * 100) / nWriteWholeSize), -1);
+        nStep = PlanNextWriteStep();
+    }
+
+    if (nStep == WRITE_STEP_VERIFY)
+    {
+        //Verify the data on the module
+        SendVerifyCommand();
+        return true;
+    }
+    else if (nStep == WRITE_STEP_DONE)
+    {
+        //Write block has finished
+        return false;
+    }
+
+    //Chunk is to be written
+    emit PercentComplete(-1, UpgradeFilePercent());
+
     //Send write address command
+    CSubMode = SUBMODE_WRITE_DATA;
     QByteArray baAddr = COMMAND_WRITE_SECTION;
     ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nWriteStart);
     if (nActiveWriteLengthCmd == FUP_LENGTH_4BYTE)
@@ -869,32 +1701,1053 @@ LrdFwUpd::ProcessCommandWriteBlock(
         baAddr.append((uint8_t)nDataSize);
     }
     pDevice->Transmit(baAddr);
+    ++nWritePackets;
+    elptmrWritePacket.start();
     if (nVerbosity >= VERBOSITY_COMMANDS)
     {
         qDebug() << baAddr;
     }
-
-    return FUNCTION_RETURN_CODE_SUCCESS_DONE;
+    if (nVerbosity >= VERBOSITY_MODES)
+    {
+        emit CurrentAction(MODULE_UPDATE, 0, QString("SubMode ").append(QString::number(SUBMODE_WRITE_ADDRESS)).append(", ").append(QString::number(nDataSize)).append(", ").append(QString::number(nWriteStart)).append(", ").append(QString::number(nWriteSize)));
+    }
+    return true;
 }
 
 //=============================================================================
-// Processes unregister commands
+// Plans the next step of the active write block, this is shared by the update
+// and the dry run estimate. The next chunk is read into baPendingChunk and is
+// either to be written (CompleteWriteChunk() is called once it has been) or
+// has been skipped as it only contains erased data in a range erased during
+// this session (skipped chunks are still included in verification). When the
+// verification size limit is reached, or at the end of the write block, the
+// data since the last verification is to be verified (CompleteVerifyStep() is
+// called once it has been)
 //=============================================================================
-int8_t
-LrdFwUpd::ProcessCommandUnregister(
-    uint32_t nLength
+uint8_t
+LrdFwUpd::PlanNextWriteStep(
     )
 {
-    //Check length of command
-    if (nLength < UWF_UNREGISTER_DEVICE_LENGTH)
+    if (nWriteSize == 0)
     {
-        //Packet length is not valid
+        if (bVerifyActive == true && nVerifySize > 0)
+        {
+            //Verify the remainder of the write block
+            return WRITE_STEP_VERIFY;
+        }
+
+        //Write block has finished
+        return WRITE_STEP_DONE;
+    }
+
+    //Get the size of the next chunk, ending it on a page boundary if possible
+    nDataSize = PlanWriteChunkSize(nWriteStart, nWriteSize, nActiveWriteSize, (bAlignWrites == true ? GetWritePageSize(nWriteStart) : 0));
+
+    if (bVerifyActive == true && nVerifySize > 0 && (nVerifySize + nDataSize) > FUP_VERIFY_COMMAND_MAXIMUM_SIZE)
+    {
+        //The verification size limit has been reached, verify the data on the module first
+        return WRITE_STEP_VERIFY;
+    }
+
+    //Read in the data for this chunk
+    qint64 nChunkFileOffset = pUwfData->CurrentPosition();
+    baPendingChunk = pUwfData->Read(nDataSize);
+
+    if (bDeferredVerify == true)
+    {
+        //Check this chunk in the deferred verification pass
+        AppendDeferredVerifyData(nWriteStart, nChunkFileOffset, baPendingChunk);
+    }
+
+    if (bSkipErasedChunks == true && IsChunkErased(baPendingChunk) == true && IsRangeErased(nWriteStart, nDataSize) == true)
+    {
+        //Flash already contains this data, skip writing it
+        if (bVerifyActive == true)
+        {
+            //Include the chunk in the verification section
+            nVerifySize += nDataSize;
+            nVerifyChecksum += ChunkChecksum(baPendingChunk);
+        }
+        nWriteStart += nDataSize;
+        nWriteSize -= nDataSize;
+        ++nSkippedChunks;
+        nSkippedBytes += nDataSize;
+        return WRITE_STEP_SKIP;
+    }
+
+    return WRITE_STEP_WRITE;
+}
+
+//=============================================================================
+// Moves the active write block on past the chunk which has been written and
+// adds it to the verification section, returns the checksum of the chunk
+//=============================================================================
+uint32_t
+LrdFwUpd::CompleteWriteChunk(
+    )
+{
+    uint32_t nChecksum = ChunkChecksum(baPendingChunk);
+
+    nWriteStart += nDataSize;
+    nWriteSize -= nDataSize;
+    if (bVerifyActive == true)
+    {
+        //Increase size of verification section
+        nVerifySize += nDataSize;
+        nVerifyChecksum += nChecksum;
+    }
+
+    return nChecksum;
+}
+
+//=============================================================================
+// Returns the size of the next write chunk starting at nAddress. When a page
+// size is given, the chunk ends on the last page boundary which fits within
+// nMaxChunk so that writes do not straddle pages on the module, if no
+// boundary fits then a full size chunk is used. A page larger than nMaxChunk
+// (such as an erase sector when no page size is configured) is aligned to as
+// the largest power of two which fits in a chunk, so that every chunk within
+// it is aligned rather than only the one at its end
+//=============================================================================
+uint32_t
+LrdFwUpd::PlanWriteChunkSize(
+    quint64 nAddress,
+    uint32_t nRemaining,
+    uint32_t nMaxChunk,
+    uint32_t nPageSize
+    )
+{
+    uint32_t nChunk = nMaxChunk;
+    if (nPageSize > nMaxChunk)
+    {
+        //Use the largest power of two page that fits in a chunk
+        nPageSize = 1;
+        while (nPageSize <= (nMaxChunk >> 1))
+        {
+            nPageSize <<= 1;
+        }
+    }
+
+    if (nPageSize > 0)
+    {
+        //Find the last page boundary that can be reached with this chunk
+        quint64 nBoundary = ((nAddress + nMaxChunk) / nPageSize) * nPageSize;
+        if (nBoundary > nAddress)
+        {
+            //End this chunk on the page boundary
+            nChunk = (uint32_t)(nBoundary - nAddress);
+        }
+    }
+
+    if (nChunk > nRemaining)
+    {
+        //Limit data size
+        nChunk = nRemaining;
+    }
+
+    return nChunk;
+}
+
+//=============================================================================
+// Returns the number of write commands needed to write nSize bytes at
+// nAddress (a page size of 0 disables alignment)
+//=============================================================================
+uint32_t
+LrdFwUpd::CountWriteChunks(
+    quint64 nAddress,
+    uint32_t nSize,
+    uint32_t nMaxChunk,
+    uint32_t nPageSize
+    )
+{
+    uint32_t nChunks = 0;
+    if (nMaxChunk == 0)
+    {
+        //Invalid chunk size
+        return 0;
+    }
+
+    while (nSize > 0)
+    {
+        uint32_t nChunk = PlanWriteChunkSize(nAddress, nSize, nMaxChunk, nPageSize);
+        nAddress += nChunk;
+        nSize -= nChunk;
+        ++nChunks;
+    }
+
+    return nChunks;
+}
+
+//=============================================================================
+// Returns the flash page size to align writes at an address to, this is the
+// configured page size if set, otherwise the sector size from the sector map
+// (0 if unknown)
+//=============================================================================
+uint32_t
+LrdFwUpd::GetWritePageSize(
+    quint64 nAddress
+    )
+{
+    if (nConfigPageSize > 0)
+    {
+        //Use configured page size
+        return nConfigPageSize;
+    }
+
+    //Find the sector map that this address belongs to
+    int32_t nEntry = FindSectorIndex(lstSectorIndex, nAddress);
+    if (nEntry < 0)
+    {
+        //Not in the sector map
+        return 0;
+    }
+
+    return lstSectorIndex.at(nEntry).nSectorSize;
+}
+
+//=============================================================================
+// Sends a verify command for the data written since the last verification
+//=============================================================================
+void
+LrdFwUpd::SendVerifyCommand(
+    )
+{
+    CSubMode = SUBMODE_VERIFY_DATA;
+    TransmitVerifyCommand(nVerifyAddress, nVerifySize, nVerifyChecksum);
+    CompleteVerifyStep();
+}
+
+//=============================================================================
+// Moves the verification section on past the data which has been verified
+//=============================================================================
+void
+LrdFwUpd::CompleteVerifyStep(
+    )
+{
+    //Reset variables for next checksum, the verified range is kept for reporting failures
+    nLastVerifyAddress = nVerifyAddress;
+    nLastVerifySize = nVerifySize;
+    nVerifyAddress += nVerifySize;
+    nVerifySize = 0;
+    nVerifyChecksum = 0;
+}
+
+//=============================================================================
+// Transmits a verify command for a range of flash
+//=============================================================================
+void
+LrdFwUpd::TransmitVerifyCommand(
+    uint32_t nAddress,
+    uint32_t nSize,
+    uint32_t nChecksum
+    )
+{
+    //Create verify section packet
+    QByteArray baTmpDat = COMMAND_VERIFY_SECTION;
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nAddress);
+    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nSize);
+
+    //Add the checksum
+    if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_4BYTE)
+    {
+        //32-bit checksum (4 bytes)
+        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nChecksum);
+    }
+    else if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_2BYTE)
+    {
+        //16-bit checksum (2 bytes)
+        ENDIAN_FLIP_UI16_TO_BYTEARRAY(baTmpDat, nChecksum);
+    }
+    else if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_1BYTE)
+    {
+        //8-bit checksum (1 byte)
+        baTmpDat.append((uint8_t)nChecksum);
+    }
+    pDevice->Transmit(baTmpDat);
+    if (nVerbosity >= VERBOSITY_COMMANDS)
+    {
+        qDebug() << baTmpDat;
+    }
+    if (nVerbosity >= VERBOSITY_MODES)
+    {
+        emit CurrentAction(MODULE_UPDATE, 0, QString("SubMode ").append(QString::number(SUBMODE_VERIFY_DATA)).append(", ").append(QString::number(nAddress)).append(", ").append(QString::number(nSize)).append(", ").append(QString::number(nChecksum)));
+    }
+}
+
+//=============================================================================
+// Adds data which has been written (or skipped) to the list of data to check
+// in the deferred verification pass, only where the data is in the upgrade
+// file and its checksum are kept
+//=============================================================================
+void
+LrdFwUpd::AppendDeferredVerifyData(
+    quint64 nAddress,
+    qint64 nFileOffset,
+    const QByteArray &baData
+    )
+{
+    if (!lstVerifyRuns.isEmpty() && (lstVerifyRuns.last().nAddress + lstVerifyRuns.last().nSize) == nAddress && (lstVerifyRuns.last().nFileOffset + lstVerifyRuns.last().nSize) == nFileOffset)
+    {
+        //Continues on from the previous data in both flash and the upgrade file
+        lstVerifyRuns.last().nSize += baData.length();
+        lstVerifyRuns.last().nChecksum += ChunkChecksum(baData);
+    }
+    else
+    {
+        //Start a new run of data
+        VerifyRunStruct sRun;
+        sRun.nAddress = nAddress;
+        sRun.nFileOffset = nFileOffset;
+        sRun.nSize = baData.length();
+        sRun.nChecksum = ChunkChecksum(baData);
+        lstVerifyRuns.append(sRun);
+    }
+}
+
+//=============================================================================
+// Splits runs of written data into verification windows no larger than
+// nMaxWindow bytes and (if bChecksums is set) works out the checksum of each
+// window, re-reading the data from the upgrade file if a run is split
+//=============================================================================
+QList<VerifyWindowStruct>
+LrdFwUpd::PlanVerifyWindows(
+    const QList<VerifyRunStruct> &lstRuns,
+    uint32_t nMaxWindow,
+    bool bChecksums
+    )
+{
+    QList<VerifyWindowStruct> lstWindows;
+    int i = 0;
+    while (i < lstRuns.count())
+    {
+        uint32_t nRunOffset = 0;
+        uint32_t nRunSize = lstRuns.at(i).nSize;
+        while (nRunOffset < nRunSize)
+        {
+            VerifyWindowStruct sWindow;
+            sWindow.nRun = i;
+            sWindow.nRunOffset = nRunOffset;
+            sWindow.nSize = qMin(nMaxWindow, nRunSize - nRunOffset);
+            sWindow.nAddress = lstRuns.at(i).nAddress + nRunOffset;
+            sWindow.nChecksum = 0;
+            if (bChecksums == true)
+            {
+                //A window covering the whole run uses the checksum worked out when the data was written
+                sWindow.nChecksum = (sWindow.nSize == nRunSize ? lstRuns.at(i).nChecksum : UpgradeFileChecksum(lstRuns.at(i).nFileOffset + nRunOffset, sWindow.nSize));
+            }
+            lstWindows.append(sWindow);
+            nRunOffset += sWindow.nSize;
+        }
+        ++i;
+    }
+
+    return lstWindows;
+}
+
+//=============================================================================
+// Returns the checksum of part of the upgrade file, the data is read in blocks
+// and the current position in the file is kept
+//=============================================================================
+uint32_t
+LrdFwUpd::UpgradeFileChecksum(
+    qint64 nOffset,
+    uint32_t nSize
+    )
+{
+    uint32_t nChecksum = 0;
+    qint64 nPosition = pUwfData->CurrentPosition();
+    pUwfData->Seek(SEEK_FROM_BEGINNING, nOffset);
+    while (nSize > 0)
+    {
+        QByteArray baBlock = pUwfData->Read(qMin(nSize, (uint32_t)VERIFY_FILE_READ_BLOCK_SIZE));
+        if (baBlock.isEmpty())
+        {
+            //End of file, cannot happen for data which has been written
+            break;
+        }
+        nChecksum += ChunkChecksum(baBlock);
+        nSize -= baBlock.length();
+    }
+    pUwfData->Seek(SEEK_FROM_BEGINNING, nPosition);
+
+    return nChecksum;
+}
+
+//=============================================================================
+// Starts the deferred verification pass for all data written in the current
+// image
+//=============================================================================
+void
+LrdFwUpd::StartDeferredVerify(
+    )
+{
+    uint32_t nMaxWindow = (nMaxVerifySize > 0 ? nMaxVerifySize : FUP_VERIFY_COMMAND_MAXIMUM_SIZE);
+    lstVerifyWindows = PlanVerifyWindows(lstVerifyRuns, nMaxWindow, true);
+    lstVerifyFailures.clear();
+    nVerifyWindowIndex = 0;
+    nVerifyResponseIndex = 0;
+    nVerifyInFlight = 0;
+    nVerifyInitialWindows = lstVerifyWindows.count();
+    elptmrVerifyTime.start();
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Verifying ").append(QString::number(lstVerifyRuns.count())).append(" region(s) using ").append(QString::number(nVerifyInitialWindows)).append(" verify command(s) of up to ").append(QString::number(nMaxWindow)).append(" bytes"));
+
+    SetMode(MODE_VERIFY_COMMAND);
+    CSubMode = SUBMODE_VERIFY_DATA;
+    StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+    SendDeferredVerifyCommands();
+}
+
+//=============================================================================
+// Sends deferred verify commands until the pipeline is full, which is a single
+// command unless pipelining has been enabled
+//=============================================================================
+void
+LrdFwUpd::SendDeferredVerifyCommands(
+    )
+{
+    while (nVerifyInFlight < nVerifyPipelineDepth && nVerifyWindowIndex < lstVerifyWindows.count())
+    {
+        const VerifyWindowStruct &sWindow = lstVerifyWindows.at(nVerifyWindowIndex);
+        TransmitVerifyCommand((uint32_t)sWindow.nAddress, sWindow.nSize, sWindow.nChecksum);
+        ++nVerifyWindowIndex;
+        ++nVerifyInFlight;
+    }
+}
+
+//=============================================================================
+// Processes a response to a deferred verify command, responses arrive in the
+// order that the commands were sent. Failed windows are split in half and
+// checked again until the failing region is small enough to report
+//=============================================================================
+void
+LrdFwUpd::DeferredVerifyResponse(
+    bool bMatched
+    )
+{
+    VerifyWindowStruct sWindow = lstVerifyWindows.at(nVerifyResponseIndex);
+    ++nVerifyResponseIndex;
+    --nVerifyInFlight;
+
+    if (bMatched == false)
+    {
+        if (sWindow.nSize > FUP_VERIFY_BISECT_MINIMUM_SIZE)
+        {
+            //Split the window in half and check both halves, the data is read again from the upgrade file
+            qint64 nRunFileOffset = lstVerifyRuns.at(sWindow.nRun).nFileOffset;
+            VerifyWindowStruct sFirst = sWindow;
+            sFirst.nSize = sWindow.nSize / 2;
+            sFirst.nChecksum = UpgradeFileChecksum(nRunFileOffset + sFirst.nRunOffset, sFirst.nSize);
+            VerifyWindowStruct sSecond = sWindow;
+            sSecond.nAddress = sWindow.nAddress + sFirst.nSize;
+            sSecond.nRunOffset = sWindow.nRunOffset + sFirst.nSize;
+            sSecond.nSize = sWindow.nSize - sFirst.nSize;
+            sSecond.nChecksum = sWindow.nChecksum - sFirst.nChecksum;
+            lstVerifyWindows.append(sFirst);
+            lstVerifyWindows.append(sSecond);
+        }
+        else
+        {
+            //Failing region has been found
+            AddressRangeStruct sRange;
+            sRange.nStart = sWindow.nAddress;
+            sRange.nEnd = sWindow.nAddress + sWindow.nSize;
+            lstVerifyFailures.append(sRange);
+            ++pLinkHealth->Stats()->nVerifyFailures;
+        }
+    }
+
+    //Keep the pipeline full
+    SendDeferredVerifyCommands();
+
+    if (nVerifyInFlight == 0 && nVerifyWindowIndex >= lstVerifyWindows.count())
+    {
+        //All windows have been checked
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Verification completed using ").append(QString::number(lstVerifyWindows.count())).append(" verify command(s) (").append(QString::number(lstVerifyWindows.count() - nVerifyInitialWindows)).append(" for bisection) in ").append(QString::number(elptmrVerifyTime.elapsed())).append("ms"));
+
+        if (!lstVerifyFailures.isEmpty())
+        {
+            //Report the regions which did not match
+            QList<AddressRangeStruct> lstMergedFailures = MergeAddressRanges(lstVerifyFailures);
+            int i = 0;
+            while (i < lstMergedFailures.count())
+            {
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Verification failed for 0x").append(QString::number(lstMergedFailures.at(i).nStart, 16)).append(" - 0x").append(QString::number(lstMergedFailures.at(i).nEnd, 16)));
+                ++i;
+            }
+            UpdateFailed(EXIT_CODE_BOOTLOADER_VERIFICATION_FAILED);
+            return;
+        }
+
+        //Verification passed, continue with the update
+        lstVerifyRuns.clear();
+        lstVerifyWindows.clear();
+        SetMode(MODE_IDLE);
+        CSubMode = SUBMODE_NONE;
+        NextPacket();
+    }
+}
+
+//=============================================================================
+// Sends the next bootloader option query which is only needed for the
+// selected features (deferred verification, flash readback), once these have
+// been queried the supported erase sizes are queried
+//=============================================================================
+void
+LrdFwUpd::SendNextOptionalQuery(
+    )
+{
+    QByteArray baTmp = COMMAND_SETTINGS_QUERY;
+    if (CSubMode == SUBMODE_QUERY_MAX_CHECKSUM_PER_COMMAND && nVerifyStrategy == VERIFY_STRATEGY_DEFERRED)
+    {
+        //Deferred verification uses the largest verify size the module supports
+        CSubMode = SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND;
+        ENDIAN_FLIP_UI16_CHAR_TO_BYTEARRAY(baTmp, FUP_OPTION_MAX_VERIFY_CHECKSUM_SIZE_PER_CMD);
+    }
+    else if ((CSubMode == SUBMODE_QUERY_MAX_CHECKSUM_PER_COMMAND || CSubMode == SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND) && bReadbackMode == true)
+    {
+        //Readback uses the largest read size the module supports
+        CSubMode = SUBMODE_QUERY_MAX_READ_PER_COMMAND;
+        ENDIAN_FLIP_UI16_CHAR_TO_BYTEARRAY(baTmp, FUP_OPTION_MAX_READ_SIZE_PER_CMD);
+    }
+    else if (CSubMode == SUBMODE_QUERY_MAX_READ_PER_COMMAND && nMaxReadSize > 0)
+    {
+        //Size of the length field in read commands
+        CSubMode = SUBMODE_QUERY_CURRENT_READ_LENGTH;
+        ENDIAN_FLIP_UI16_CHAR_TO_BYTEARRAY(baTmp, FUP_OPTION_CURRENT_READ_LEN_BYTES);
+    }
+    else
+    {
+        //Supported erase sizes
+        CSubMode = SUBMODE_QUERY_ERASE_SIZES;
+        ENDIAN_FLIP_UI16_CHAR_TO_BYTEARRAY(baTmp, FUP_OPTION_ERASE_SIZES_PER_CMD);
+    }
+
+    //Check for error
+    baTmp.append((ByteArrayType)0x00);
+    pDevice->Transmit(baTmp);
+    if (nVerbosity >= VERBOSITY_COMMANDS)
+    {
+        qDebug() << baTmp;
+    }
+}
+
+//=============================================================================
+// Parses an address range in the format start:size or start-end (end is
+// exclusive), values can be decimal or 0x prefixed hex
+//=============================================================================
+bool
+LrdFwUpd::ParseAddressRange(
+    QString strRange,
+    AddressRangeStruct *pRange
+    )
+{
+    bool bStartValid = false;
+    bool bSecondValid = false;
+    QStringList lstParts;
+    bool bSize = strRange.contains(':');
+    lstParts = strRange.split((bSize == true ? ':' : '-'));
+    if (lstParts.count() != 2)
+    {
+        //Not a valid range
+        return false;
+    }
+
+    quint64 nStart = lstParts.at(0).trimmed().toULongLong(&bStartValid, 0);
+    quint64 nSecond = lstParts.at(1).trimmed().toULongLong(&bSecondValid, 0);
+    if (bStartValid == false || bSecondValid == false)
+    {
+        //Not a valid number
+        return false;
+    }
+
+    pRange->nStart = nStart;
+    pRange->nEnd = (bSize == true ? nStart + nSecond : nSecond);
+    if (pRange->nEnd <= pRange->nStart || pRange->nEnd > ((quint64)UINT32_MAX + 1))
+    {
+        //Range is empty or outside of the 32-bit address space
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Splits a list of merged address ranges into read commands of no more than
+// nMaxRead bytes
+//=============================================================================
+QList<ReadRequestStruct>
+LrdFwUpd::PlanReadRequests(
+    const QList<AddressRangeStruct> &lstRanges,
+    uint32_t nMaxRead
+    )
+{
+    QList<ReadRequestStruct> lstRequests;
+    int i = 0;
+    while (i < lstRanges.count())
+    {
+        quint64 nAddress = lstRanges.at(i).nStart;
+        while (nAddress < lstRanges.at(i).nEnd)
+        {
+            ReadRequestStruct sRequest;
+            sRequest.nAddress = nAddress;
+            sRequest.nSize = (uint32_t)qMin((quint64)nMaxRead, lstRanges.at(i).nEnd - nAddress);
+            lstRequests.append(sRequest);
+            nAddress += sRequest.nSize;
+        }
+        ++i;
+    }
+
+    return lstRequests;
+}
+
+//=============================================================================
+// Returns true if the bootloader listed a feature in its supported features
+// response
+//=============================================================================
+bool
+LrdFwUpd::IsFeatureSupported(
+    uint8_t nFeature
+    )
+{
+    if ((nFeature / 8) >= baSupportedFeatures.length())
+    {
+        //Not in the response (or no response received)
+        return false;
+    }
+
+    return (((uint8_t)baSupportedFeatures.at(nFeature / 8) & (1 << (nFeature % 8))) != 0);
+}
+
+//=============================================================================
+// Starts reading flash back from the module into the readback file
+//=============================================================================
+void
+LrdFwUpd::StartReadback(
+    )
+{
+    bReadbackStarted = true;
+    if (bNewBootloader == true && IsFeatureSupported(FUP_FEATURE_FLASH_READ) == false)
+    {
+        //The read command must not be sent to a bootloader which does not list it
+        emit CurrentAction(MODULE_UPDATE, 0, "Bootloader does not list flash reading in its supported features, unable to read flash back");
+        UpdateFailed(EXIT_CODE_BOOTLOADER_READ_NOT_SUPPORTED);
+        return;
+    }
+    else if (bNewBootloader == false || nMaxReadSize == 0 || nActiveReadLengthCmd == 0)
+    {
+        //Bootloader cannot read flash
+        UpdateFailed(EXIT_CODE_BOOTLOADER_READ_NOT_SUPPORTED);
+        return;
+    }
+
+    QList<AddressRangeStruct> lstRanges = MergeAddressRanges(lstReadbackRanges);
+    if (lstRanges.isEmpty())
+    {
+        //Nothing to read
+        emit CurrentAction(MODULE_UPDATE, 0, "No flash ranges to read back");
+        SetMode(MODE_IDLE);
+        NextPacket();
+        return;
+    }
+
+    //Limit the read size to what fits in the length field of the command
+    uint32_t nMaxRead = nMaxReadSize;
+    if (nActiveReadLengthCmd == FUP_LENGTH_1BYTE && nMaxRead > UINT8_MAX)
+    {
+        nMaxRead = UINT8_MAX;
+    }
+    else if (nActiveReadLengthCmd == FUP_LENGTH_2BYTE && nMaxRead > UINT16_MAX)
+    {
+        nMaxRead = UINT16_MAX;
+    }
+    lstReadRequests = PlanReadRequests(lstRanges, nMaxRead);
+
+    //Open the output file, data is written to it as it is received
+    pReadbackFile = new QFile(pSessionConfig->strReadbackFile);
+    MallocFailCheck(pReadbackFile);
+    if (pReadbackFile->open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+    {
+        //Failed to open file
+        UpdateFailed(EXIT_CODE_READBACK_FILE_FAILED);
+        return;
+    }
+
+    //The file starts at the lowest address read, gaps between ranges are filled with the erased flash value
+    nReadbackFileAddress = lstRanges.first().nStart;
+    nReadbackBytes = 0;
+    nReadRequestIndex = 0;
+    nReadResponseIndex = 0;
+    nReadInFlight = 0;
+    lstReadbackMismatches.clear();
+
+    //Responses arrive in address order, so the expected data is sorted the same way and compared from a cursor
+    std::stable_sort(lstReadbackExpected.begin(), lstReadbackExpected.end(), [](const ReadbackExpectedStruct &a, const ReadbackExpectedStruct &b) { return a.nAddress < b.nAddress; });
+    nReadbackExpectedIndex = 0;
+    elptmrReadbackTime.start();
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Reading 0x").append(QString::number(lstRanges.first().nStart, 16)).append(" - 0x").append(QString::number(lstRanges.last().nEnd, 16)).append(" (").append(QString::number(lstRanges.count())).append(" range(s)) using ").append(QString::number(lstReadRequests.count())).append(" read command(s) of up to ").append(QString::number(nMaxRead)).append(" bytes"));
+
+    SetMode(MODE_READ_COMMAND);
+    CSubMode = SUBMODE_NONE;
+    SendReadCommands();
+}
+
+//=============================================================================
+// Sends read commands until the pipeline is full
+//=============================================================================
+void
+LrdFwUpd::SendReadCommands(
+    )
+{
+    while (nReadInFlight < FUP_READ_PIPELINE_DEPTH && nReadRequestIndex < lstReadRequests.count())
+    {
+        const ReadRequestStruct &sRequest = lstReadRequests.at(nReadRequestIndex);
+        QByteArray baTmp = COMMAND_READ_SECTION;
+        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmp, (uint32_t)sRequest.nAddress);
+        if (nActiveReadLengthCmd == FUP_LENGTH_4BYTE)
+        {
+            //4-byte data size field
+            ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmp, sRequest.nSize);
+        }
+        else if (nActiveReadLengthCmd == FUP_LENGTH_2BYTE)
+        {
+            //2-byte data size field
+            ENDIAN_FLIP_UI16_TO_BYTEARRAY(baTmp, sRequest.nSize);
+        }
+        else if (nActiveReadLengthCmd == FUP_LENGTH_1BYTE)
+        {
+            //1-byte data size field
+            baTmp.append((uint8_t)sRequest.nSize);
+        }
+        pDevice->Transmit(baTmp);
+        if (nVerbosity >= VERBOSITY_COMMANDS)
+        {
+            qDebug() << baTmp;
+        }
+        ++nReadRequestIndex;
+        ++nReadInFlight;
+    }
+
+    if (nReadInFlight > 0)
+    {
+        //Allow time for all outstanding data to be received
+        quint64 nOutstandingBytes = (quint64)nReadInFlight * nMaxReadSize;
+        quint64 nBaud = pDevice->ActiveBaud();
+        quint64 nTimeout = COMMAND_TIMEOUT_PERIOD_MS;
+        if (nBaud > 0)
+        {
+            nTimeout += (nOutstandingBytes * SERIAL_BITS_PER_BYTE * 1000 / nBaud) * 100 / SERIAL_TIMEOUT_SPREAD_FACTOR;
+        }
+        StartCommandTimeout((int)nTimeout);
+    }
+}
+
+//=============================================================================
+// Processes data received in response to a read command, responses arrive in
+// the order that the commands were sent
+//=============================================================================
+void
+LrdFwUpd::ReadbackDataReceived(
+    const QByteArray &baData
+    )
+{
+    const ReadRequestStruct sRequest = lstReadRequests.at(nReadResponseIndex);
+    ++nReadResponseIndex;
+    --nReadInFlight;
+
+    if (sRequest.nAddress > nReadbackFileAddress)
+    {
+        //Fill the gap since the previous range a block at a time, gaps in sparse images can be very large
+        quint64 nGap = sRequest.nAddress - nReadbackFileAddress;
+        QByteArray baGap((qsizetype)qMin(nGap, (quint64)READBACK_GAP_FILL_BLOCK_SIZE), (char)FUP_ERASED_FLASH_VALUE);
+        while (nGap > 0)
+        {
+            qint64 nBlock = (qint64)qMin(nGap, (quint64)baGap.length());
+            if (pReadbackFile->write(baGap.constData(), nBlock) != nBlock)
+            {
+                //Failed to write to file
+                UpdateFailed(EXIT_CODE_READBACK_FILE_FAILED);
+                return;
+            }
+            nGap -= nBlock;
+        }
+    }
+
+    if (pReadbackFile->write(baData) != baData.length())
+    {
+        //Failed to write to file
+        UpdateFailed(EXIT_CODE_READBACK_FILE_FAILED);
+        return;
+    }
+    nReadbackFileAddress = sRequest.nAddress + sRequest.nSize;
+    nReadbackBytes += sRequest.nSize;
+
+    if (bReadbackCompare == true)
+    {
+        //Check the data against the upgrade file
+        CompareReadbackData(sRequest.nAddress, baData);
+    }
+    emit PercentComplete((int8_t)((nReadResponseIndex * 100) / lstReadRequests.count()), -1);
+
+    //Keep the pipeline full
+    SendReadCommands();
+
+    if (nReadInFlight == 0 && nReadRequestIndex >= lstReadRequests.count())
+    {
+        //All data has been read
+        FinishReadback();
+    }
+}
+
+//=============================================================================
+// Compares data read back from the module with the data in the upgrade file,
+// differing bytes are added to the list of mismatched ranges. Only the part of
+// the upgrade file which overlaps the read back data is read. Responses are in
+// address order, so only the entries from the cursor up to the end of the data
+// are looked at and the cursor is moved past entries which have been passed
+//=============================================================================
+void
+LrdFwUpd::CompareReadbackData(
+    quint64 nAddress,
+    const QByteArray &baData
+    )
+{
+    quint64 nEnd = nAddress + baData.length();
+    while (nReadbackExpectedIndex < lstReadbackExpected.count() && lstReadbackExpected.at(nReadbackExpectedIndex).nAddress + lstReadbackExpected.at(nReadbackExpectedIndex).nSize <= nAddress)
+    {
+        //Entry ends before this data, no later response can overlap it
+        ++nReadbackExpectedIndex;
+    }
+
+    qsizetype i = nReadbackExpectedIndex;
+    while (i < lstReadbackExpected.count() && lstReadbackExpected.at(i).nAddress < nEnd)
+    {
+        const ReadbackExpectedStruct &sExpected = lstReadbackExpected.at(i);
+        quint64 nOverlapStart = qMax(nAddress, sExpected.nAddress);
+        quint64 nOverlapEnd = qMin(nEnd, sExpected.nAddress + sExpected.nSize);
+        if (nOverlapStart >= nOverlapEnd)
+        {
+            //Does not overlap
+            ++i;
+            continue;
+        }
+
+        QByteArray baExpected = ReadUpgradeFileData(sExpected.nFileOffset + (qint64)(nOverlapStart - sExpected.nAddress), (qint64)(nOverlapEnd - nOverlapStart));
+        quint64 nCheck = nOverlapStart;
+        while (nCheck < nOverlapEnd)
+        {
+            if ((qsizetype)(nCheck - nOverlapStart) >= baExpected.length() || baData.at((qsizetype)(nCheck - nAddress)) != baExpected.at((qsizetype)(nCheck - nOverlapStart)))
+            {
+                if (!lstReadbackMismatches.isEmpty() && lstReadbackMismatches.last().nEnd == nCheck)
+                {
+                    //Extend the previous mismatched range
+                    ++lstReadbackMismatches.last().nEnd;
+                }
+                else
+                {
+                    //New mismatched range
+                    AddressRangeStruct sRange;
+                    sRange.nStart = nCheck;
+                    sRange.nEnd = nCheck + 1;
+                    lstReadbackMismatches.append(sRange);
+                }
+            }
+            ++nCheck;
+        }
+        ++i;
+    }
+}
+
+//=============================================================================
+// Reads part of the upgrade file, the current position in the file is kept
+//=============================================================================
+QByteArray
+LrdFwUpd::ReadUpgradeFileData(
+    qint64 nOffset,
+    qint64 nSize
+    )
+{
+    qint64 nPosition = pUwfData->CurrentPosition();
+    pUwfData->Seek(SEEK_FROM_BEGINNING, nOffset);
+    QByteArray baData = pUwfData->Read(nSize);
+    pUwfData->Seek(SEEK_FROM_BEGINNING, nPosition);
+
+    return baData;
+}
+
+//=============================================================================
+// Finishes a readback, closing the file and reporting any differences
+//=============================================================================
+void
+LrdFwUpd::FinishReadback(
+    )
+{
+    pReadbackFile->close();
+    delete pReadbackFile;
+    pReadbackFile = NULL;
+
+    qint64 nReadTime = elptmrReadbackTime.elapsed();
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Read ").append(QString::number(nReadbackBytes)).append(" bytes in ").append(QString::number(nReadTime)).append("ms (").append(QString::number(nReadTime > 0 ? (nReadbackBytes * 1000 / nReadTime) : nReadbackBytes)).append(" bytes/s)"));
+
+    if (bReadbackCompare == true)
+    {
+        if (!lstReadbackMismatches.isEmpty())
+        {
+            //Report the regions which differ
+            QList<AddressRangeStruct> lstMergedMismatches = MergeAddressRanges(lstReadbackMismatches);
+            int i = 0;
+            while (i < lstMergedMismatches.count() && i < READBACK_MAX_REPORTED_MISMATCHES)
+            {
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Readback differs from upgrade file at 0x").append(QString::number(lstMergedMismatches.at(i).nStart, 16)).append(" - 0x").append(QString::number(lstMergedMismatches.at(i).nEnd, 16)));
+                ++i;
+            }
+            if (lstMergedMismatches.count() > READBACK_MAX_REPORTED_MISMATCHES)
+            {
+                emit CurrentAction(MODULE_UPDATE, 0, QString("...and ").append(QString::number(lstMergedMismatches.count() - READBACK_MAX_REPORTED_MISMATCHES)).append(" more region(s)"));
+            }
+            UpdateFailed(EXIT_CODE_READBACK_COMPARE_FAILED);
+            return;
+        }
+
+        emit CurrentAction(MODULE_UPDATE, 0, "Readback matches upgrade file");
+    }
+
+    //Readback finished, continue to the end of the session
+    SetMode(MODE_IDLE);
+    NextPacket();
+}
+
+//=============================================================================
+// Returns the additive checksum of a chunk of data
+//=============================================================================
+uint32_t
+LrdFwUpd::ChunkChecksum(
+    const QByteArray &baData
+    )
+{
+    uint32_t nChecksum = 0;
+    const uint8_t *pData = (const uint8_t *)baData.constData();
+    qsizetype nSize = baData.length();
+    qsizetype i = 0;
+    while (i < nSize)
+    {
+        nChecksum += pData[i];
+        ++i;
+    }
+
+    return nChecksum;
+}
+
+//=============================================================================
+// Returns true if a chunk of data only contains the erased flash value
+//=============================================================================
+bool
+LrdFwUpd::IsChunkErased(
+    const QByteArray &baData
+    )
+{
+    const uint8_t *pData = (const uint8_t *)baData.constData();
+    qsizetype nSize = baData.length();
+    qsizetype i = 0;
+    while (i < nSize)
+    {
+        if (pData[i] != FUP_ERASED_FLASH_VALUE)
+        {
+            //Data has been programmed
+            return false;
+        }
+        ++i;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Records a range of flash which has been erased during this session, ranges
+// are kept sorted and merged with overlapping or adjacent ranges
+//=============================================================================
+void
+LrdFwUpd::AddErasedRange(
+    uint32_t nStart,
+    uint32_t nSize
+    )
+{
+    quint64 nNewStart = nStart;
+    quint64 nNewEnd = (quint64)nStart + nSize;
+    int i = 0;
+    while (i < lstErasedRanges.count())
+    {
+        if (lstErasedRanges.at(i).nEnd < nNewStart)
+        {
+            //Range is entirely before the new range
+            ++i;
+        }
+        else if (lstErasedRanges.at(i).nStart > nNewEnd)
+        {
+            //Range is entirely after the new range, insert here
+            break;
+        }
+        else
+        {
+            //Range overlaps or is adjacent, merge it into the new range
+            nNewStart = qMin(nNewStart, lstErasedRanges.at(i).nStart);
+            nNewEnd = qMax(nNewEnd, lstErasedRanges.at(i).nEnd);
+            lstErasedRanges.removeAt(i);
+        }
+    }
+
+    AddressRangeStruct sRange;
+    sRange.nStart = nNewStart;
+    sRange.nEnd = nNewEnd;
+    lstErasedRanges.insert(i, sRange);
+}
+
+//=============================================================================
+// Returns true if a range of flash has been erased during this session
+//=============================================================================
+bool
+LrdFwUpd::IsRangeErased(
+    uint32_t nStart,
+    uint32_t nSize
+    )
+{
+    quint64 nEnd = (quint64)nStart + nSize;
+    int i = 0;
+    while (i < lstErasedRanges.count())
+    {
+        if (lstErasedRanges.at(i).nStart <= nStart && lstErasedRanges.at(i).nEnd >= nEnd)
+        {
+            //Range is fully covered
+            return true;
+        }
+        else if (lstErasedRanges.at(i).nStart > nStart)
+        {
+            //Ranges are sorted so no later range can cover the start
+            break;
+        }
+        ++i;
+    }
+
+    return false;
+}
+
+//=============================================================================
+// Processes unregister commands
+//=============================================================================
+int8_t
+LrdFwUpd::ProcessCommandUnregister(
+    uint32_t nLength
+    )
+{
+    //Check length of command
+    if (nLength < UWF_UNREGISTER_DEVICE_LENGTH)
+    {
+        //Packet length is not valid
         return FUNCTION_RETURN_CODE_INVALID_LENGTH;
     }
 
     //Read in data and construct unregister device packet
     QByteArray baTargetData = pUwfData->Read(nLength);
-    emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
+    emit PercentComplete(-1, UpgradeFilePercent());
     uint8_t nHandle = (uint8_t)baTargetData[UWF_OFFSET_UNREGISTER_HANDLE];
     emit CurrentAction(MODULE_UPDATE, 0, QString("\tUnregister - Handle: ").append(QString::number(nHandle)));
 
@@ -937,6 +2790,12 @@ LrdFwUpd::UpdateFailed(
         //Do not include time
         emit CurrentAction(MODULE_UPDATE, 0, QString("Firmware upgrade failed."));
     }
+    nSessionErrorCode = nErrorCode;
+    if (nErrorCode > 0)
+    {
+        //Error was reported by the module
+        ++pLinkHealth->Stats()->nModuleErrors;
+    }
     emit Error(MODULE_UPDATE, nErrorCode);
     CleanUp(false);
 
@@ -951,29 +2810,83 @@ void
 LrdFwUpd::NextPacket(
     )
 {
+    if (WaitForUpgradeFileScan() == false)
+    {
+        //Upgrade file is not valid
+        return;
+    }
+
     //Process the next packet from the upgrade file
-    QByteArray baPktHeader;
     int8_t nStatus = FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
     while (nStatus == FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET)
     {
         //Assume no more loops required
         nStatus = FUNCTION_RETURN_CODE_SUCCESS_DONE;
 
-        if (pUwfData->AtEnd())
+        if (nUwfPacketIndex >= lstUwfPackets.count())
         {
+            if (bReadbackMode == true && bReadbackStarted == false)
+            {
+                //All setup commands have been sent, read the flash back
+                StartReadback();
+                return;
+            }
+
+            if (!lstVerifyRuns.isEmpty())
+            {
+                //Verify the data written for this image before moving on
+                StartDeferredVerify();
+                return;
+            }
+
+            if (!lstJobItems.isEmpty())
+            {
+                //Report the time taken for the image that has just been written
+                qint64 nItemTime = elptmrJobItemTime.elapsed();
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Image ").append(QString::number(nJobIndex + 1)).append(" of ").append(QString::number(lstJobItems.count())).append(" (").append(lstJobItems.at(nJobIndex).strFilename).append(") completed in ").append(QString::number(nItemTime)).append("ms"));
+                emit JobItemFinished(nJobIndex, lstJobItems.at(nJobIndex).strFilename, nItemTime);
+
+                if ((nJobIndex + 1) < lstJobItems.count())
+                {
+                    //Continue with the next image in the same bootloader session
+                    if (StartNextJobItem() == true)
+                    {
+                        NextPacket();
+                    }
+                    return;
+                }
+            }
+
+            if (nSkippedChunks > 0)
+            {
+                //Show how much data did not need to be written
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Skipped ").append(QString::number(nSkippedChunks)).append(" write chunks (").append(QString::number(nSkippedBytes)).append(" bytes) containing only erased data"));
+            }
+
+            if (nWritePackets > 0 && bAlignWrites == true)
+            {
+                //Show the effect of page alignment on the number of write commands, the time is not measured but estimated from the average time of a write packet
+                qint64 nPacketTimeDifferenceMS = ((qint64)nAlignedWritePackets - (qint64)nUnalignedWritePackets) * (qint64)(nWritePacketTimeUS / nWritePackets) / 1000;
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Write commands: ").append(QString::number(nAlignedWritePackets)).append(" page aligned vs ").append(QString::number(nUnalignedWritePackets)).append(" if unaligned, estimated time difference from the average write packet time: ").append(QString::number(nPacketTimeDifferenceMS)).append("ms"));
+            }
+
             //Upgrade has finished, reset module
-            nCMode = MODE_RESET;
+            SetMode(MODE_RESET);
             CSubMode = SUBMODE_NONE;
 
             //Stop command timeout timer
-            tmrCommandTimeoutTimer->stop();
+            StopCommandTimeout();
 
-            if (pSettingsHandle->GetConfigOption(REBOOT_MODULE_AFTER_UPDATE) == false)
+            if (pSessionConfig->bRebootAfterUpdate == false)
             {
                 //Do not reboot module
                 qint64 nUpgradeTime = elptmrUpgradeTime.elapsed();
                 elptmrUpgradeTime.invalidate();
-                emit CurrentAction(MODULE_UPDATE, 0, QString("Firmware upgrade completed in ").append(QString::number(nUpgradeTime)).append("ms (module left in bootloader mode at ").append(QString::number(lstUARTSpeeds.at(nChosenBaudRateIndex-1))).append(" baud)"));
+                quint32 nLeftBaud = pDevice->ActiveBaud();
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Firmware upgrade completed in ").append(QString::number(nUpgradeTime)).append("ms (module left in bootloader mode at ").append(QString::number(nLeftBaud)).append(" baud)"));
+
+                //Remember the baud rate so that the module can be probed at it next time
+                SetLastBootloaderBaud(nLeftBaud);
                 CleanUp(true);
 
                 //Signal parent
@@ -982,6 +2895,9 @@ LrdFwUpd::NextPacket(
                 return;
             }
 
+            //Module will no longer be in bootloader mode
+            SetLastBootloaderBaud(0);
+
             //Configure restart timer
             tmrRestartTimer = new QTimer();
             MallocFailCheck(tmrRestartTimer);
@@ -1011,140 +2927,503 @@ LrdFwUpd::NextPacket(
         }
 
         //Restart command timeout timer
-        tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+        StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+
+        //Take the next packet from the index built by the upgrade file parse
+        uint8_t nCmdID = lstUwfPackets.at(nUwfPacketIndex).nCmdID;
+        uint32_t nPktLen = lstUwfPackets.at(nUwfPacketIndex).nLength;
+        pUwfData->Seek(SEEK_FROM_BEGINNING, lstUwfPackets.at(nUwfPacketIndex).nFileOffset);
+        ++nUwfPacketIndex;
+        emit PercentComplete(-1, UpgradeFilePercent());
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Pkt: ").append(QString::number(nCmdID)).append(" | ").append((char)nCmdID).append(", Len: ").append(QString::number(nPktLen)));
+        nStatus = ProcessRecord(nCmdID, nPktLen);
+        if (nStatus == FUNCTION_RETURN_CODE_SUCCESS_DONE)
+        {
+            //Send the commands for this record
+            nStatus = SendRecordCommands(nCmdID);
+        }
+    }
+
+    if (nStatus < FUNCTION_RETURN_CODE_SUCCESS_DONE)
+    {
+        //Command execution failure
+        UpdateFailed(RecordErrorCode(nStatus));
+    }
+}
+
+//=============================================================================
+// Parses an upgrade file into an index of packets and optionally validates the
+// length of every command. No object state is used so that this can run on a
+// worker thread whilst the module is entering bootloader mode
+//=============================================================================
+UwfScanStruct
+LrdFwUpd::ScanUpgradeFile(
+    QString strFilename,
+    bool bValidate
+    )
+{
+    QFile fileUpgrade(strFilename);
+    if (!fileUpgrade.open(QFile::ReadOnly))
+    {
+        //Cannot get read only access
+        UwfScanStruct sResult;
+        sResult.nErrorCode = EXIT_CODE_UWF_FILE_FAILED_TO_OPEN;
+        return sResult;
+    }
+
+    UwfScanStruct sResult = ScanUpgradeDevice(&fileUpgrade, bValidate);
+    fileUpgrade.close();
+    return sResult;
+}
+
+//=============================================================================
+// Parses an in-memory copy of an upgrade file, as per ScanUpgradeFile
+//=============================================================================
+UwfScanStruct
+LrdFwUpd::ScanUpgradeData(
+    QByteArray baData,
+    bool bValidate
+    )
+{
+    QBuffer bufUpgrade;
+    bufUpgrade.setData(baData);
+    bufUpgrade.open(QIODevice::ReadOnly);
+    UwfScanStruct sResult = ScanUpgradeDevice(&bufUpgrade, bValidate);
+    bufUpgrade.close();
+    return sResult;
+}
+
+//=============================================================================
+// Parses an open upgrade file into an index of packets
+//=============================================================================
+UwfScanStruct
+LrdFwUpd::ScanUpgradeDevice(
+    QIODevice *pUpgradeFile,
+    bool bValidate
+    )
+{
+    UwfScanStruct sResult;
+    sResult.nErrorCode = EXIT_CODE_SUCCESS;
+
+    qint64 nTotalSize = pUpgradeFile->size();
+    while (!pUpgradeFile->atEnd() && sResult.nErrorCode == EXIT_CODE_SUCCESS)
+    {
+        //Read in the header for the next packet
+        QByteArray baPktHeader = pUpgradeFile->read(UWF_COMMAND_HEADER_LENGTH);
+        if (baPktHeader.length() != UWF_COMMAND_HEADER_LENGTH)
+        {
+            //File ends part way through a header
+            sResult.strError = "Selected upgrade file has a truncated command and is not valid.";
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_PACKET_LENGTH_INVALID;
+            break;
+        }
+
+        uint8_t nCmdID = (uint8_t)baPktHeader[UWF_OFFSET_HEADER_COMMAND_ID];
+        uint32_t nPktLen = 0;
+        ENDIAN_FLIP_BYTEARRAY_TO_UI32(baPktHeader, UWF_OFFSET_HEADER_PACKET_LENGTH, nPktLen);
+
+        if (nPktLen > (nTotalSize - pUpgradeFile->pos()) || (nPktLen > UWF_FILE_MAX_PACKET_SIZE_BYTES && nCmdID != UWF_COMMAND_WRITE))
+        {
+            //Packet extends beyond the end of the file, or is too large to be read in one go (write data is read in chunks so is only limited by the file size)
+            sResult.strError = QString("Selected upgrade file has command of length ").append(QString::number(nPktLen)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_PACKET_LENGTH_INVALID;
+        }
+        else if ((bValidate == true || sResult.lstPackets.isEmpty()) && nCmdID != UWF_COMMAND_TARGET_PLATFORM && nCmdID != UWF_COMMAND_REGISTER && nCmdID != UWF_COMMAND_SELECT && nCmdID != UWF_COMMAND_SECTOR_MAP && nCmdID != UWF_COMMAND_ERASE && nCmdID != UWF_COMMAND_WRITE && nCmdID != UWF_COMMAND_QUERY && nCmdID != UWF_COMMAND_UNREGISTER)
+        {
+            //Unknown command (the first command is always checked)
+            sResult.strError = QString("Selected upgrade file has unknown command 0x").append(QString::number(nCmdID, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_COMMAND_INVALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_TARGET_PLATFORM && nPktLen != UWF_TARGET_PLATFORM_LENGTH)
+        {
+            //Target platform command with invalid size
+            sResult.strError = QString("Target platform command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_REGISTER && nPktLen != UWF_REGISTER_DEVICE_LENGTH)
+        {
+            //Register device command with invalid size
+            sResult.strError = QString("Register device command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_SELECT && nPktLen != UWF_SELECT_DEVICE_LENGTH)
+        {
+            //Select device command with invalid size
+            sResult.strError = QString("Select device command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_SECTOR_MAP && (nPktLen < UWF_SECTOR_MAP_LENGTH || (nPktLen % UWF_SECTOR_MAP_LENGTH) != 0))
+        {
+            //Sector map command with invalid size
+            sResult.strError = QString("Sector map command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_ERASE && nPktLen != UWF_ERASE_BLOCK_LENGTH)
+        {
+            //Erase command with invalid size
+            sResult.strError = QString("Erase command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_WRITE && nPktLen < UWF_WRITE_BLOCK_LENGTH)
+        {
+            //Write command with invalid size
+            sResult.strError = QString("Write command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else if (bValidate == true && nCmdID == UWF_COMMAND_UNREGISTER && nPktLen < UWF_UNREGISTER_DEVICE_LENGTH)
+        {
+            //Unregister command with invalid size
+            sResult.strError = QString("Unregister command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid.");
+            sResult.nErrorCode = EXIT_CODE_UWF_FILE_NOT_VALID;
+        }
+        else
+        {
+            //Valid command, add it to the index and skip the data to process the next command
+            UwfPacketStruct sPacket;
+            sPacket.nCmdID = nCmdID;
+            sPacket.nLength = nPktLen;
+            sPacket.nFileOffset = pUpgradeFile->pos();
+            sResult.lstPackets.append(sPacket);
+            pUpgradeFile->seek(sPacket.nFileOffset + nPktLen);
+        }
+    }
+
+    return sResult;
+}
+
+//=============================================================================
+// Opens the upgrade file set in the settings, using the image cache if one has
+// been set
+//=============================================================================
+bool
+LrdFwUpd::OpenUpgradeFile(
+    )
+{
+    QByteArray baImage;
+    if (pImageCache != NULL && pImageCache->Load(pSessionConfig->strFirmwareFile, &baImage) == false)
+    {
+        //Not cacheable, read it from the file as normal to get the error
+        baImage = QByteArray();
+    }
+    pUwfData->SetFilename(pSessionConfig->strFirmwareFile);
+    pUwfData->SetImageData(baImage);
+
+    return pUwfData->Open();
+}
+
+//=============================================================================
+// Returns how much of the upgrade file has been processed as a percentage
+//=============================================================================
+int8_t
+LrdFwUpd::UpgradeFilePercent(
+    )
+{
+    if (nFileSize <= 0)
+    {
+        //No file open
+        return 0;
+    }
+
+    //Offsets are 64-bit so this cannot overflow for any supported file size
+    return (int8_t)((pUwfData->CurrentPosition() * 100) / nFileSize);
+}
+
+//=============================================================================
+// Starts parsing the upgrade file on a worker thread, or takes the result from
+// the image cache if the file has already been parsed
+//=============================================================================
+void
+LrdFwUpd::StartUpgradeFileScan(
+    QString strFilename,
+    bool bValidate
+    )
+{
+    UwfScanStruct sCachedScan;
+    QByteArray baImage;
+    strUwfScanFilename = strFilename;
+    bUwfScanValidate = bValidate;
+    bUwfScanFromCache = false;
+
+    if (pImageCache != NULL && pImageCache->GetScan(strFilename, bValidate, &sCachedScan) == true)
+    {
+        //Already parsed
+        futUwfScan = QtConcurrent::run([sCachedScan]() { return sCachedScan; });
+        bUwfScanFromCache = true;
+    }
+    else if (pImageCache != NULL && pImageCache->Load(strFilename, &baImage) == true)
+    {
+        //Parse the cached copy of the file
+        futUwfScan = QtConcurrent::run(&LrdFwUpd::ScanUpgradeData, baImage, bValidate);
+    }
+    else
+    {
+        futUwfScan = QtConcurrent::run(&LrdFwUpd::ScanUpgradeFile, strFilename, bValidate);
+    }
+    bUwfScanPending = true;
+}
+
+//=============================================================================
+// Waits for the background upgrade file parse to complete, returns false (and
+// fails the update) if the file was not valid
+//=============================================================================
+bool
+LrdFwUpd::WaitForUpgradeFileScan(
+    )
+{
+    if (bUwfScanPending == false)
+    {
+        //Upgrade file has already been parsed
+        return true;
+    }
+
+    //This will normally have completed whilst the module was entering the bootloader
+    futUwfScan.waitForFinished();
+    bUwfScanPending = false;
+    UwfScanStruct sResult = futUwfScan.result();
+
+    if (sResult.nErrorCode != EXIT_CODE_SUCCESS)
+    {
+        //The upgrade file is not valid and contains an error
+        if (!sResult.strError.isEmpty())
+        {
+            emit CurrentAction(MODULE_UPDATE, 0, sResult.strError);
+        }
+        UpdateFailed(sResult.nErrorCode);
+        return false;
+    }
+
+    if (pImageCache != NULL && bUwfScanFromCache == false)
+    {
+        //Keep the parse result for the next update using this file
+        pImageCache->SetScan(strUwfScanFilename, bUwfScanValidate, sResult);
+    }
+
+    lstUwfPackets = sResult.lstPackets;
+    nUwfPacketIndex = 0;
+    elptmrJobItemTime.start();
+    if (nVerbosity >= VERBOSITY_MODES)
+    {
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Upgrade file parsed, ").append(QString::number(lstUwfPackets.count())).append(" packets"));
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Loads a multi-image job manifest, which is a JSON file in the format:
+// {"images": ["first.uwf", {"file": "second.uwf", "verify": false}]}
+// Relative image paths are relative to the directory of the manifest
+//=============================================================================
+bool
+LrdFwUpd::LoadJobManifest(
+    QString strFilename
+    )
+{
+    QFile fileManifest(strFilename);
+    if (!fileManifest.open(QFile::ReadOnly))
+    {
+        //Cannot get read only access
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to open job manifest: ").append(strFilename));
+        return false;
+    }
+
+    QJsonParseError jpeJsonError;
+    QJsonDocument jdJsonData = QJsonDocument::fromJson(fileManifest.readAll(), &jpeJsonError);
+    fileManifest.close();
+
+    if (jpeJsonError.error != QJsonParseError::NoError || !jdJsonData.isObject() || !jdJsonData.object().value("images").isArray())
+    {
+        //Not a valid manifest
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Job manifest is not valid: ").append(jpeJsonError.errorString()));
+        return false;
+    }
+
+    //Images inherit the current verification and validation settings unless overridden
+    QDir dirManifest = QFileInfo(strFilename).absoluteDir();
+    bool bDefaultVerify = pSessionConfig->bVerifyData;
+    bool bDefaultValidate = pSessionConfig->bValidateUwf;
+    QJsonArray jaImages = jdJsonData.object().value("images").toArray();
+    int i = 0;
+    while (i < jaImages.count())
+    {
+        JobItemStruct sItem;
+        sItem.bVerify = bDefaultVerify;
+        sItem.bValidate = bDefaultValidate;
+
+        if (jaImages.at(i).isString())
+        {
+            //Filename only
+            sItem.strFilename = jaImages.at(i).toString();
+        }
+        else if (jaImages.at(i).isObject())
+        {
+            //Filename with options
+            QJsonObject joImage = jaImages.at(i).toObject();
+            sItem.strFilename = joImage.value("file").toString();
+            sItem.bVerify = joImage.value("verify").toBool(bDefaultVerify);
+            sItem.bValidate = joImage.value("validate").toBool(bDefaultValidate);
+        }
+
+        if (sItem.strFilename.isEmpty())
+        {
+            //Image entry does not contain a filename
+            emit CurrentAction(MODULE_UPDATE, 0, QString("Job manifest image ").append(QString::number(i + 1)).append(" does not specify a file"));
+            lstJobItems.clear();
+            return false;
+        }
+
+        sItem.strFilename = dirManifest.absoluteFilePath(sItem.strFilename);
+        lstJobItems.append(sItem);
+        ++i;
+    }
+
+    if (lstJobItems.isEmpty())
+    {
+        //No images to write
+        emit CurrentAction(MODULE_UPDATE, 0, "Job manifest does not contain any images");
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================================
+// Applies the settings for an image from the job manifest
+//=============================================================================
+void
+LrdFwUpd::ApplyJobItem(
+    uint16_t nIndex
+    )
+{
+    //The user's settings and the session configuration are never changed, a copy with the settings for this image replaces it
+    SessionConfigStruct *pConfig = new SessionConfigStruct(*pSessionConfig);
+    MallocFailCheck(pConfig);
+    pConfig->strFirmwareFile = lstJobItems.at(nIndex).strFilename;
+    pConfig->bVerifyData = lstJobItems.at(nIndex).bVerify;
+    pConfig->bValidateUwf = lstJobItems.at(nIndex).bValidate;
+    pSessionConfig = QSharedPointer<const SessionConfigStruct>(pConfig);
+    pDevice->SetSessionConfig(pSessionConfig);
+}
+
+//=============================================================================
+// Switches to the next image in the job manifest, keeping the bootloader
+// session (options and baud rate) active. Returns false if the update failed
+//=============================================================================
+bool
+LrdFwUpd::StartNextJobItem(
+    )
+{
+    ++nJobIndex;
+    pUwfData->Close();
+    ApplyJobItem(nJobIndex);
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Starting image ").append(QString::number(nJobIndex + 1)).append(" of ").append(QString::number(lstJobItems.count())).append(": ").append(lstJobItems.at(nJobIndex).strFilename));
+
+    if (OpenUpgradeFile() == false)
+    {
+        //Failed to open the next image
+        UpdateFailed(EXIT_CODE_UWF_FILE_FAILED_TO_OPEN);
+        return false;
+    }
+
+    nFileSize = pUwfData->TotalSize();
+    if (nFileSize < UWF_COMMAND_HEADER_LENGTH || (quint64)nFileSize > pSessionConfig->nMaxUwfSize)
+    {
+        //Filesize is too small or large, not a valid uwf file
+        emit CurrentAction(MODULE_UPDATE, 0, "Selected upgrade file is too small or large and is not valid.");
+        UpdateFailed(EXIT_CODE_UWF_FILE_INVALID_SIZE);
+        return false;
+    }
 
-        //Read in the data for the next packet
-        baPktHeader = pUwfData->Read(UWF_COMMAND_HEADER_LENGTH);
-        emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
-        uint8_t nCmdID = (uint8_t)baPktHeader[UWF_OFFSET_HEADER_COMMAND_ID];
-        uint32_t nPktLen = 0;
-        ENDIAN_FLIP_BYTEARRAY_TO_UI32(baPktHeader, UWF_OFFSET_HEADER_PACKET_LENGTH, nPktLen);
-        emit CurrentAction(MODULE_UPDATE, 0, QString("Pkt: ").append(QString::number(nCmdID)).append(" | ").append((char)nCmdID).append(", Len: ").append(QString::number(nPktLen)));
-        if (nCmdID == UWF_COMMAND_TARGET_PLATFORM)
-        {
-            //Target platform
-            nStatus = ProcessCommandTargetPlatform(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_REGISTER)
-        {
-            //Register device
-            nStatus = ProcessCommandRegisterDevice(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_SELECT)
-        {
-            //Select device
-            nStatus = ProcessCommandSelectDevice(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_SECTOR_MAP)
-        {
-            //Sector map
-            nStatus = ProcessCommandSectorMap(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_ERASE)
-        {
-            //Erase
-            nStatus = ProcessCommandEraseBlock(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_WRITE)
-        {
-            //Write
-            nStatus = ProcessCommandWriteBlock(nPktLen);
-        }
-        else if (nCmdID == UWF_COMMAND_UNREGISTER)
-        {
-            //Unregister
-            nStatus = ProcessCommandUnregister(nPktLen);
-        }
-        else
-        {
-            //Unknown command
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Unknown command encountered: ").append((char)nCmdID));
-            pUwfData->Read(nPktLen);
-            emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
-            nStatus = FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET;
-        }
+    //Devices and sector maps are defined per image
+    while (lstDevices.count() > 0)
+    {
+        //Clear the device struct
+        DeviceStruct *pDevice = lstDevices.last();
+        lstDevices.pop_back();
+        delete pDevice;
     }
 
-    if (nStatus < FUNCTION_RETURN_CODE_SUCCESS_DONE)
+    while (lstSectorMap.count() > 0)
     {
-        //Command execution failure
-        UpdateFailed((nStatus == FUNCTION_RETURN_CODE_SECTOR_MAPPING_NOT_FOUND ? EXIT_CODE_ERASE_SECTOR_MAPPING_NOT_FOUND : EXIT_CODE_RETURN_CODE_ERROR));
+        //Clear the sector map struct
+        SectorStruct *pSector = lstSectorMap.last();
+        lstSectorMap.pop_back();
+        delete pSector;
     }
+    lstSectorIndex.clear();
+
+    nActiveDevice = 0;
+    nActiveBank = 0;
+    nActiveDeviceIndex = 0;
+    SetMode(MODE_IDLE);
+    CSubMode = SUBMODE_NONE;
+    emit PercentComplete(0, 0);
+
+    //The target platform command is sent again for the next image but the negotiated bootloader options are kept
+    StartUpgradeFileScan(lstJobItems.at(nJobIndex).strFilename, lstJobItems.at(nJobIndex).bValidate);
+
+    return true;
 }
 
 //=============================================================================
-// Validates that an upgrade file is valid
+// Opens, size checks and validates every image in the job manifest, so that a
+// bad image fails the job before bootloader entry instead of after the images
+// before it have been written. Returns EXIT_CODE_SUCCESS if all are usable
 //=============================================================================
-bool
-LrdFwUpd::ValidateUpgradeFile(
+int32_t
+LrdFwUpd::CheckJobItems(
     )
 {
-    QByteArray baPktHeader;
-    bool bFailed = false;
-    while (!pUwfData->AtEnd() && bFailed == false)
+    int i = 0;
+    while (i < lstJobItems.count())
     {
-        //Read in the data for the next packet
-        baPktHeader = pUwfData->Read(UWF_COMMAND_HEADER_LENGTH);
-        uint8_t nCmdID = (uint8_t)baPktHeader[UWF_OFFSET_HEADER_COMMAND_ID];
-        uint32_t nPktLen = 0;
-        ENDIAN_FLIP_BYTEARRAY_TO_UI32(baPktHeader, UWF_OFFSET_HEADER_PACKET_LENGTH, nPktLen);
-        if (nCmdID == UWF_COMMAND_TARGET_PLATFORM && nPktLen != UWF_TARGET_PLATFORM_LENGTH)
-        {
-            //Target platform command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Target platform command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
-        }
-        else if (nCmdID == UWF_COMMAND_REGISTER && nPktLen != UWF_REGISTER_DEVICE_LENGTH)
-        {
-            //Register device command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Register device command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
-        }
-        else if (nCmdID == UWF_COMMAND_SELECT && nPktLen != UWF_SELECT_DEVICE_LENGTH)
+        QString strFilename = lstJobItems.at(i).strFilename;
+        QString strImage = QString("Job manifest image ").append(QString::number(i + 1)).append(" (").append(strFilename).append(")");
+        QByteArray baImage;
+        qint64 nImageSize = 0;
+        if (pImageCache != NULL && pImageCache->Load(strFilename, &baImage) == true)
         {
-            //Select device command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Select device command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
-        }
-        else if (nCmdID == UWF_COMMAND_SECTOR_MAP && (nPktLen < UWF_SECTOR_MAP_LENGTH || (nPktLen % UWF_SECTOR_MAP_LENGTH) != 0))
-        {
-            //Sector map command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Sector map command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
+            //Check the cached copy, which is what will be written
+            nImageSize = baImage.length();
         }
-        else if (nCmdID == UWF_COMMAND_ERASE && nPktLen != UWF_ERASE_BLOCK_LENGTH)
-        {
-            //Erase command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Erase command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
-        }
-        else if (nCmdID == UWF_COMMAND_WRITE && nPktLen < UWF_WRITE_BLOCK_LENGTH)
+        else
         {
-            //Write command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Write command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
+            QFileInfo fiImage(strFilename);
+            if (!fiImage.isFile() || !fiImage.isReadable())
+            {
+                //Cannot get read only access
+                emit CurrentAction(MODULE_UPDATE, 0, strImage.append(" could not be opened."));
+                return EXIT_CODE_UWF_FILE_FAILED_TO_OPEN;
+            }
+            nImageSize = fiImage.size();
+            baImage.clear();
         }
-        else if (nCmdID == UWF_COMMAND_UNREGISTER && nPktLen < UWF_UNREGISTER_DEVICE_LENGTH)
+
+        if (nImageSize < UWF_COMMAND_HEADER_LENGTH || (quint64)nImageSize > pSessionConfig->nMaxUwfSize)
         {
-            //Unregister command with invalid size
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Unregister command has length 0x").append(QString::number(nPktLen, 16)).append(" and is not valid."));
-            bFailed = true;
+            //Filesize is too small or large, not a valid uwf file
+            emit CurrentAction(MODULE_UPDATE, 0, strImage.append(" is too small or large and is not valid."));
+            return EXIT_CODE_UWF_FILE_INVALID_SIZE;
         }
-        else if (nCmdID != UWF_COMMAND_TARGET_PLATFORM && nCmdID != UWF_COMMAND_REGISTER && nCmdID != UWF_COMMAND_SELECT && nCmdID != UWF_COMMAND_SECTOR_MAP && nCmdID != UWF_COMMAND_ERASE && nCmdID != UWF_COMMAND_WRITE && nCmdID != UWF_COMMAND_UNREGISTER )
+
+        //Always fully validated, as an error part way through the job cannot be undone
+        UwfScanStruct sResult = (baImage.isEmpty() ? ScanUpgradeFile(strFilename, true) : ScanUpgradeData(baImage, true));
+        if (sResult.nErrorCode != EXIT_CODE_SUCCESS)
         {
-            //Unknown command
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Selected upgrade file has unknown command 0x").append(QString::number(nCmdID, 16)).append(" and is not valid."));
-            emit Error(MODULE_UPDATE, EXIT_CODE_UWF_FILE_COMMAND_INVALID);
-            bFailed = true;
+            //The upgrade file is not valid and contains an error
+            emit CurrentAction(MODULE_UPDATE, 0, strImage.append(" is not valid: ").append(sResult.strError));
+            return sResult.nErrorCode;
         }
-        else
+
+        if (pImageCache != NULL)
         {
-            //Valid command, skip data for this command to process next command
-            pUwfData->Seek(SEEK_CURRENT, nPktLen);
+            //Keep the parse result so that it is not repeated when the image is written
+            pImageCache->SetScan(strFilename, true, sResult);
         }
+        ++i;
     }
 
-    return bFailed;
+    return EXIT_CODE_SUCCESS;
 }
 
 //=============================================================================
@@ -1155,7 +3434,7 @@ LrdFwUpd::SupportedFunctions(
     )
 {
     //Get supported options
-    nCMode = MODE_SUPPORTED_FUNCTIONS;
+    SetMode(MODE_SUPPORTED_FUNCTIONS);
     pDevice->Transmit(COMMAND_SUPPORTED_FEATURES);
     if (nVerbosity >= VERBOSITY_COMMANDS)
     {
@@ -1172,7 +3451,7 @@ LrdFwUpd::SupportedOptions(
     )
 {
     //Get supported options
-    nCMode = MODE_SUPPORTED_OPTIONS;
+    SetMode(MODE_SUPPORTED_OPTIONS);
     CSubMode = SUBMODE_QUERY_MAX_ERASE_LENGTH;
 
     //Check for error
@@ -1195,7 +3474,31 @@ LrdFwUpd::ModuleDataReceived(
     )
 {
     baReceivedData.append(*baOrigData);
-    uint16_t nRemoveBytes = 0;
+    qsizetype nRemoveBytes = 0;
+
+    if (nCMode == MODE_PROBE_BOOTLOADER)
+    {
+        //Response to bootloader probe
+        if (baReceivedData.length() < FUP_RESPONSE_LENGTH_VERSION || baReceivedData[FUP_OFFSET_PACKET_TYPE] != FUP_RESPONSE_VERSION)
+        {
+            //Not (yet) a version response
+            return;
+        }
+
+        //Module is already in bootloader mode, skip bootloader entrance and process the version response
+        tmrProbeTimer->stop();
+        disconnect(tmrProbeTimer, SIGNAL(timeout()), this, SLOT(ProbeTimerTimeout()));
+        delete tmrProbeTimer;
+        tmrProbeTimer = NULL;
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Module is already in bootloader mode at ").append(QString::number(lstProbeBauds.at(nProbeIndex))).append(" baud"));
+        pLinkHealth->Stats()->nProbeBaudIndex = nProbeIndex;
+
+        bResentFirstBootloaderCommand = false;
+        elptmrUpgradeTime.start();
+        SetMode(MODE_BOOTLOADER_VERSION);
+        CSubMode = SUBMODE_NONE;
+        StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+    }
 
     //Check which mode is active
     if (nCMode == MODE_PLATFORM_COMMAND)
@@ -1204,16 +3507,16 @@ LrdFwUpd::ModuleDataReceived(
         if (baReceivedData.length() >= FUP_RESPONSE_LENGTH_ACKNOWLEDGE && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ACKNOWLEDGE)
         {
             //Valid device
-            nCMode = MODE_IDLE;
-            if (bNewBootloader == true)
+            SetMode(MODE_IDLE);
+            if (bNewBootloader == true && bOptionsNegotiated == false)
             {
                 //New bootloader: get supported options
-                tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+                StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
                 SupportedFunctions();
             }
             else
             {
-                //Old bootloader: continue with update
+                //Old bootloader or options already set for this session: continue with update
                 NextPacket();
             }
 
@@ -1241,114 +3544,15 @@ LrdFwUpd::ModuleDataReceived(
         if (baReceivedData.length() >= FUP_RESPONSE_LENGTH_ACKNOWLEDGE && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ACKNOWLEDGE)
         {
             //Erased successfully
-            tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
-            if (nEraseSize > 0)
+            StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+            if (nEraseCommandIndex < lstEraseCommands.count())
             {
-                if (nActiveEraseLengthCmd > 0)
-                {
-                    //Use new version of command with size specifier
-                    uint8_t i = 0;
-                    while (i < lstEraseSizes.count())
-                    {
-                        //Find a suitable erase size for this section
-                        if (lstEraseSizes.at(i) > nEraseSize)
-                        {
-                            break;
-                        }
-                        ++i;
-                    }
-
-                    //Use next lower size, if available
-                    if (i > 0)
-                    {
-                        --i;
-                    }
-
-                    //Send erase command
-                    QByteArray baAddr = COMMAND_ERASE_SECTION;
-                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nEraseStart);
-                    baAddr.append((uint8_t)i);
-                    pDevice->Transmit(baAddr);
-                    if (nVerbosity >= VERBOSITY_COMMANDS)
-                    {
-                        qDebug() << baAddr;
-                    }
-
-                    //Update log
-                    emit CurrentAction(MODULE_UPDATE, 0, QString("Erasing 0x").append(QString::number(nEraseStart, 16)).append(" - 0x").append(QString::number(nEraseStart + lstEraseSizes.at(i), 16)));
-
-                    //Increment the current erase position
-                    nEraseStart += lstEraseSizes.at(i);
-                    if (nEraseSize < lstEraseSizes.at(i))
-                    {
-                        //Final erase message
-                        nEraseSize = 0;
-                    }
-                    else
-                    {
-                        //Decrement size left to erase
-                        nEraseSize -= lstEraseSizes.at(i);
-                    }
-                }
-                else
-                {
-                    //Use classic command without size specified
-                    QByteArray baAddr = COMMAND_ERASE_SECTION;
-                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nEraseStart);
-                    pDevice->Transmit(baAddr);
-                    if (nVerbosity >= VERBOSITY_COMMANDS)
-                    {
-                        qDebug() << baAddr;
-                    }
-
-                    if (nActiveEraseSectorLeft == 0)
-                    {
-                        //Sector mapping has finished, find which sector map the next part of this erase section applies to
-                        uint8_t i = 0;
-                        while (i < lstSectorMap.length())
-                        {
-                            if (nEraseStart >= lstSectorMap[i]->nOffset && nEraseStart < (lstSectorMap[i]->nOffset + lstSectorMap[i]->nTotalSize))
-                            {
-                                //Correct sector found
-                                break;
-                            }
-                            ++i;
-                        }
-
-                        if (i == lstSectorMap.length())
-                        {
-                            //No match found in sector map
-                            UpdateFailed(EXIT_CODE_ERASE_SECTOR_MAPPING_NOT_FOUND);
-                            return;
-                        }
-
-                        //Set the sector values
-                        nActiveSectorSize = lstSectorMap[i]->nSectorSize;
-                        nActiveEraseSectorLeft = lstSectorMap[i]->nSectors - ((nEraseStart - lstSectorMap[i]->nOffset) / nActiveSectorSize);
-                    }
-
-                    //Update log
-                    emit CurrentAction(MODULE_UPDATE, 0, QString("Erasing 0x").append(QString::number(nEraseStart, 16)).append(" - 0x").append(QString::number(nEraseStart + nActiveSectorSize, 16)));
-
-                    //Increment the current erase position
-                    nEraseStart += nActiveSectorSize;
-                    --nActiveEraseSectorLeft;
-                    if (nEraseSize < nActiveSectorSize)
-                    {
-                        //Final erase message
-                        nEraseSize = 0;
-                    }
-                    else
-                    {
-                        //Decrement size left to erase
-                        nEraseSize -= nActiveSectorSize;
-                    }
-                }
-                emit PercentComplete(100 - ((nEraseSize * 100) / nEraseWholeSize), -1);
+                //Send the next planned erase command
+                SendNextEraseCommand();
             }
             else
             {
-                nCMode = MODE_IDLE;
+                SetMode(MODE_IDLE);
                 NextPacket();
             }
 
@@ -1364,68 +3568,119 @@ LrdFwUpd::ModuleDataReceived(
             //Unknown
         }
     }
+    else if (nCMode == MODE_READ_COMMAND)
+    {
+        //Flash readback, several commands may be outstanding so handle every response received
+        while (nRemoveBytes < baReceivedData.length() && nCMode == MODE_READ_COMMAND)
+        {
+            if (baReceivedData[nRemoveBytes] == FUP_RESPONSE_ACKNOWLEDGE)
+            {
+                //Acknowledge followed by the data requested
+                uint32_t nReadSize = lstReadRequests.at(nReadResponseIndex).nSize;
+                if ((baReceivedData.length() - nRemoveBytes) < (qsizetype)(FUP_RESPONSE_LENGTH_ACKNOWLEDGE + nReadSize))
+                {
+                    //Wait for the rest of the data
+                    break;
+                }
+
+                QByteArray baReadData = baReceivedData.mid(nRemoveBytes + FUP_RESPONSE_LENGTH_ACKNOWLEDGE, nReadSize);
+                nRemoveBytes += FUP_RESPONSE_LENGTH_ACKNOWLEDGE + nReadSize;
+                ReadbackDataReceived(baReadData);
+            }
+            else if (baReceivedData[nRemoveBytes] == FUP_RESPONSE_ERROR)
+            {
+                if ((baReceivedData.length() - nRemoveBytes) < FUP_RESPONSE_LENGTH_ERROR)
+                {
+                    //Wait for the rest of the error
+                    break;
+                }
+
+                //Error
+                UpdateFailed(baReceivedData.at(nRemoveBytes + 1));
+                return;
+            }
+            else
+            {
+                //Unknown, discard
+                ++nRemoveBytes;
+            }
+        }
+    }
+    else if (nCMode == MODE_VERIFY_COMMAND)
+    {
+        //Deferred verification, several commands may be outstanding so handle every response received
+        while (nRemoveBytes < baReceivedData.length() && nCMode == MODE_VERIFY_COMMAND)
+        {
+            if (baReceivedData[nRemoveBytes] == FUP_RESPONSE_ACKNOWLEDGE || baReceivedData[nRemoveBytes] == FUP_RESPONSE_NOT_ACKNOWLEDGE)
+            {
+                //Checksum matched or did not match
+                bool bMatched = (baReceivedData[nRemoveBytes] == FUP_RESPONSE_ACKNOWLEDGE);
+                nRemoveBytes += FUP_RESPONSE_LENGTH_ACKNOWLEDGE;
+                StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+                DeferredVerifyResponse(bMatched);
+            }
+            else if (baReceivedData[nRemoveBytes] == FUP_RESPONSE_ERROR)
+            {
+                if ((baReceivedData.length() - nRemoveBytes) < FUP_RESPONSE_LENGTH_ERROR)
+                {
+                    //Wait for the rest of the error
+                    break;
+                }
+
+                //Error
+                UpdateFailed(baReceivedData.at(nRemoveBytes + 1));
+                return;
+            }
+            else
+            {
+                //Unknown, discard
+                ++nRemoveBytes;
+            }
+        }
+    }
     else if (nCMode == MODE_WRITE_COMMAND)
     {
         if (baReceivedData.length() >= FUP_RESPONSE_LENGTH_ACKNOWLEDGE && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ACKNOWLEDGE)
         {
-            tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+            StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
             if (CSubMode == SUBMODE_WRITE_DATA)
             {
                 //Wrote address, write data
-                nWriteStart += nDataSize;
-                nWriteSize -= nDataSize;
+                uint32_t nChecksum = CompleteWriteChunk();
 
                 emit PercentComplete(100 - ((nWriteSize * 100) / nWriteWholeSize), -1);
 
-                //Create data section packet
-                QByteArray baTmpDat;
-                baTmpDat.append(COMMAND_DATA_SECTION);
-                baTmpDat.append(pUwfData->Read(nDataSize));
-                emit PercentComplete(-1, (pUwfData->CurrentPosition() * 100) / nFileSize);
-                uint16_t i = 0;
-                uint32_t nChecksum = 0;
+                //Create data section packet, the header, chunk and checksum are written together without being copied into one buffer
+                QByteArray baTmpDat = COMMAND_DATA_SECTION;
+                QByteArray baChecksum;
                 CSubMode = SUBMODE_WRITE_ADDRESS;
 
-                //Generate a checksum
-                while (i < nDataSize)
-                {
-                    nChecksum += (uint8_t)baTmpDat[i+1];
-                    ++i;
-                }
-
-                if (bVerifyActive == true)
-                {
-                    //Append checksum and increase size of verification section
-                    nVerifySize += nDataSize;
-                    nVerifyChecksum += nChecksum;
-
-                    if ((nVerifySize + nDataSize) > FUP_VERIFY_COMMAND_MAXIMUM_SIZE)
-                    {
-                        //The verification size limit has been reached, the next state should be to verify the data on the module
-                        CSubMode = SUBMODE_VERIFY_DATA;
-                    }
-                }
-
                 //Append checksum
                 if (nActiveChecksumLengthCmd == FUP_LENGTH_4BYTE)
                 {
                     //32-bit checksum (4 bytes)
-                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nChecksum);
+                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baChecksum, nChecksum);
                 }
                 else if (nActiveChecksumLengthCmd == FUP_LENGTH_2BYTE)
                 {
                     //16-bit checksum (2 bytes)
-                    ENDIAN_FLIP_UI16_TO_BYTEARRAY(baTmpDat, nChecksum);
+                    ENDIAN_FLIP_UI16_TO_BYTEARRAY(baChecksum, nChecksum);
                 }
                 else if (nActiveChecksumLengthCmd == FUP_LENGTH_1BYTE)
                 {
                     //8-bit checksum (1 byte)
-                    baTmpDat.append((uint8_t)nChecksum);
+                    baChecksum.append((uint8_t)nChecksum);
+                }
+                pDevice->Transmit(baTmpDat, baPendingChunk, baChecksum);
+                pLinkHealth->Stats()->nBytesWritten += baPendingChunk.length();
+                if (pTrace != NULL)
+                {
+                    nTraceWrittenBytes += baPendingChunk.length();
+                    pTrace->Counter(nTraceTrack, "Bytes written", nTraceWrittenBytes);
                 }
-                pDevice->Transmit(baTmpDat);
                 if (nVerbosity >= VERBOSITY_COMMANDS)
                 {
-                    qDebug() << baTmpDat;
+                    qDebug() << baTmpDat << baPendingChunk << baChecksum;
                 }
                 if (nVerbosity >= VERBOSITY_MODES)
                 {
@@ -1435,93 +3690,26 @@ LrdFwUpd::ModuleDataReceived(
 
                 if (nVerbosity >= VERBOSITY_TIMEOUTS)
                 {
-                    qDebug() << "Timeout timer set to " << (nDataSize / (pSettingsHandle->GetConfigOption(ACTIVE_BAUD).toULongLong() / SERIAL_BITS_PER_BYTE)) * 100 * 1000 / SERIAL_TIMEOUT_SPREAD_FACTOR + COMMAND_TIMEOUT_PERIOD_MS;
-                }
-                tmrCommandTimeoutTimer->start((nDataSize / (pSettingsHandle->GetConfigOption(ACTIVE_BAUD).toULongLong() / SERIAL_BITS_PER_BYTE) * 100 / SERIAL_TIMEOUT_SPREAD_FACTOR) * 1000 + COMMAND_TIMEOUT_PERIOD_MS);
-            }
-            else if (CSubMode == SUBMODE_VERIFY_DATA)
-            {
-                //Wrote data, verify data
-                CSubMode = SUBMODE_WRITE_ADDRESS;
-
-                //Create data section packet
-                QByteArray baTmpDat = COMMAND_VERIFY_SECTION;
-                ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nVerifyAddress);
-                ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nVerifySize);
-
-                //Add the checksum
-                if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_4BYTE)
-                {
-                    //32-bit checksum (4 bytes)
-                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baTmpDat, nVerifyChecksum);
-                }
-                else if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_2BYTE)
-                {
-                    //16-bit checksum (2 bytes)
-                    ENDIAN_FLIP_UI16_TO_BYTEARRAY(baTmpDat, nVerifyChecksum);
-                }
-                else if (nActiveVerifyChecksumLengthCmd == FUP_LENGTH_1BYTE)
-                {
-                    //8-bit checksum (1 byte)
-                    baTmpDat.append((uint8_t)nVerifyChecksum);
-                }
-                pDevice->Transmit(baTmpDat);
-                if (nVerbosity >= VERBOSITY_COMMANDS)
-                {
-                    qDebug() << baTmpDat;
-                }
-                if (nVerbosity >= VERBOSITY_MODES)
-                {
-                    emit CurrentAction(MODULE_UPDATE, 0, QString("SubMode ").append(QString::number(SUBMODE_VERIFY_DATA)).append(", ").append(QString::number(nVerifyAddress)).append(", ").append(QString::number(nVerifySize)).append(", ").append(QString::number(nVerifyChecksum)));
+                    qDebug() << "Timeout timer set to" << COMMAND_TIMEOUT_PERIOD_MS << "ms after" << pDevice->BytesInFlight() << "bytes in flight have been sent";
                 }
 
-                //Reset variables for next checksum
-                nVerifyAddress += nVerifySize;
-                nVerifySize = 0;
-                nVerifyChecksum = 0;
+                //The timeout starts once the data has left the port, so no allowance for the transfer time is needed
+                StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
             }
-            else if (CSubMode == SUBMODE_WRITE_ADDRESS)
+            else if (CSubMode == SUBMODE_WRITE_ADDRESS || CSubMode == SUBMODE_VERIFY_DATA)
             {
-                //Wrote data, write address
-                if (nDataSize > 0)
+                if (CSubMode == SUBMODE_WRITE_ADDRESS && elptmrWritePacket.isValid())
                 {
-                    CSubMode = SUBMODE_WRITE_DATA;
-                    nDataSize = nActiveWriteSize;
-                    if (nDataSize > nWriteSize)
-                    {
-                        nDataSize = nWriteSize;
-                    }
-
-                    QByteArray baAddr = COMMAND_WRITE_SECTION;
-                    ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nWriteStart);
-                    if (nActiveWriteLengthCmd == FUP_LENGTH_4BYTE)
-                    {
-                        //4-byte data size field
-                        ENDIAN_FLIP_UI32_TO_BYTEARRAY(baAddr, nDataSize);
-                    }
-                    else if (nActiveWriteLengthCmd == FUP_LENGTH_2BYTE)
-                    {
-                        //2-byte data size field
-                        ENDIAN_FLIP_UI16_TO_BYTEARRAY(baAddr, nDataSize);
-                    }
-                    else if (nActiveWriteLengthCmd == FUP_LENGTH_1BYTE)
-                    {
-                        //1-byte data size field
-                        baAddr.append((uint8_t)nDataSize);
-                    }
-                    pDevice->Transmit(baAddr);
-                    if (nVerbosity >= VERBOSITY_COMMANDS)
-                    {
-                        qDebug() << baAddr;
-                    }
-                    if (nVerbosity >= VERBOSITY_MODES)
-                    {
-                        emit CurrentAction(MODULE_UPDATE, 0, QString("SubMode ").append(QString::number(SUBMODE_WRITE_ADDRESS)).append(", ").append(QString::number(nDataSize)).append(", ").append(QString::number(nWriteStart)).append(", ").append(QString::number(nWriteSize)));
-                    }
+                    //Add the time taken for this write address and data command pair
+                    nWritePacketTimeUS += elptmrWritePacket.nsecsElapsed() / 1000;
+                    elptmrWritePacket.invalidate();
                 }
-                else
+
+                //Wrote data or verified data, write next address
+                if (SendNextWriteAddress() == false)
                 {
-                    nCMode = MODE_IDLE;
+                    //Write block has finished
+                    SetMode(MODE_IDLE);
                     CSubMode = SUBMODE_NONE;
                     NextPacket();
                 }
@@ -1534,10 +3722,11 @@ LrdFwUpd::ModuleDataReceived(
             //Error
             UpdateFailed(baReceivedData.at(sizeof(FUP_RESPONSE_ERROR)));
         }
-        else if (CSubMode == SUBMODE_WRITE_ADDRESS && baReceivedData.length() >= (qsizetype)sizeof(FUP_RESPONSE_NOT_ACKNOWLEDGE) && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_NOT_ACKNOWLEDGE)
+        else if (CSubMode == SUBMODE_VERIFY_DATA && baReceivedData.length() >= (qsizetype)sizeof(FUP_RESPONSE_NOT_ACKNOWLEDGE) && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_NOT_ACKNOWLEDGE)
         {
             //Verification failure
-            emit CurrentAction(MODULE_UPDATE, 0, QString("Features: ").append(QString::number((uint8_t)baReceivedData[1], 16)).append(QString::number((uint8_t)baReceivedData[2], 16)).append(QString::number((uint8_t)baReceivedData[3], 16)).append(QString::number((uint8_t)baReceivedData[4], 16)).append(QString::number((uint8_t)baReceivedData[5], 16)).append(QString::number((uint8_t)baReceivedData[6], 16)).append(QString::number((uint8_t)baReceivedData[7], 16)).append(QString::number((uint8_t)baReceivedData[8], 16)));
+            emit CurrentAction(MODULE_UPDATE, 0, QString("Verification failed for 0x").append(QString::number(nLastVerifyAddress, 16)).append(" - 0x").append(QString::number(nLastVerifyAddress + nLastVerifySize, 16)));
+            ++pLinkHealth->Stats()->nVerifyFailures;
             UpdateFailed(EXIT_CODE_BOOTLOADER_VERIFICATION_FAILED);
         }
         else
@@ -1566,7 +3755,7 @@ LrdFwUpd::ModuleDataReceived(
             //Version response received
             emit CurrentAction(MODULE_UPDATE, 0, QString("Bootloader version ").append(baReceivedData.mid(sizeof(FUP_RESPONSE_VERSION))));
 
-            if (baReceivedData.at(sizeof(FUP_RESPONSE_VERSION)) >= FUP_EXTENDED_VERSION_NUMBER && pSettingsHandle->GetConfigOption(BOOTLOADER_ENHANCED_FUNCTIONALITY_DISABLE) == false)
+            if (baReceivedData.at(sizeof(FUP_RESPONSE_VERSION)) >= FUP_EXTENDED_VERSION_NUMBER && pSessionConfig->bEnhancedFunctionalityDisabled == false)
             {
                 //New bootloader
                 bNewBootloader = true;
@@ -1577,6 +3766,12 @@ LrdFwUpd::ModuleDataReceived(
                 bNewBootloader = false;
             }
 
+            if (pSessionConfig->nFtdiLatencyTimer > 0)
+            {
+                //Lower the FTDI latency timer for the remainder of the update
+                TuneLatencyTimer();
+            }
+
             //
             NextPacket();
         }
@@ -1591,6 +3786,7 @@ LrdFwUpd::ModuleDataReceived(
             //Received option
             emit CurrentAction(MODULE_UPDATE, 0, QString("Features: ").append(QString::number((uint8_t)baReceivedData[1], 16)).append(QString::number((uint8_t)baReceivedData[2], 16)).append(QString::number((uint8_t)baReceivedData[3], 16)).append(QString::number((uint8_t)baReceivedData[4], 16)).append(QString::number((uint8_t)baReceivedData[5], 16)).append(QString::number((uint8_t)baReceivedData[6], 16)).append(QString::number((uint8_t)baReceivedData[7], 16)).append(QString::number((uint8_t)baReceivedData[8], 16)));
             nRemoveBytes = baReceivedData.length();
+            baSupportedFeatures = baReceivedData.mid(FUP_OFFSET_FEATURES_SUPPORTED, FUP_FEATURES_SUPPORTED_LENGTH);
 
             SupportedOptions();
         }
@@ -1604,7 +3800,7 @@ LrdFwUpd::ModuleDataReceived(
             uint32_t nValue = 0;
             ENDIAN_FLIP_BYTEARRAY_TO_UI32(baReceivedData, FUP_OFFSET_BOOTLOADER_QUERY_VALUE, nValue);
             uint8_t nMoreData = (uint8_t)baReceivedData[FUP_OFFSET_BOOTLOADER_QUERY_MORE_DATA];
-            tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+            StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
 
             if (CSubMode == SUBMODE_QUERY_MAX_ERASE_LENGTH)
             {
@@ -1737,17 +3933,29 @@ LrdFwUpd::ModuleDataReceived(
                 emit CurrentAction(MODULE_UPDATE, 0, QString("Max checksum bytes per command: ").append(QString::number(nValue)));
                 nMaxChecksumSize = nValue;
 
-                CSubMode = SUBMODE_QUERY_ERASE_SIZES;
-
-                //Check for error
-                QByteArray baTmp = COMMAND_SETTINGS_QUERY;
-                ENDIAN_FLIP_UI16_CHAR_TO_BYTEARRAY(baTmp, FUP_OPTION_ERASE_SIZES_PER_CMD);
-                baTmp.append((ByteArrayType)0x00);
-                pDevice->Transmit(baTmp);
-                if (nVerbosity >= VERBOSITY_COMMANDS)
-                {
-                    qDebug() << baTmp;
-                }
+                //Query any options only needed for the selected features, then the erase sizes
+                SendNextOptionalQuery();
+            }
+            else if (CSubMode == SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND)
+            {
+                //Maximum verify bytes per command query response
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Max verify bytes per command: ").append(QString::number(nValue)));
+                nMaxVerifySize = nValue;
+                SendNextOptionalQuery();
+            }
+            else if (CSubMode == SUBMODE_QUERY_MAX_READ_PER_COMMAND)
+            {
+                //Maximum read bytes per command query response
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Max read bytes per command: ").append(QString::number(nValue)));
+                nMaxReadSize = nValue;
+                SendNextOptionalQuery();
+            }
+            else if (CSubMode == SUBMODE_QUERY_CURRENT_READ_LENGTH)
+            {
+                //Current read length query response
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Current read bytes: ").append(QString::number(nValue)));
+                nActiveReadLengthCmd = nValue;
+                SendNextOptionalQuery();
             }
             else if (CSubMode == SUBMODE_QUERY_ERASE_SIZES)
             {
@@ -1845,7 +4053,7 @@ LrdFwUpd::ModuleDataReceived(
                 else
                 {
                     //Finished getting bootloader settings, change settings
-                    nCMode = MODE_SET_OPTIONS;
+                    SetMode(MODE_SET_OPTIONS);
                     CSubMode = SUBMODE_SET_ERASE_LENGTH;
 
                     if (nMaxEraseLengthCmd == 1)
@@ -1876,6 +4084,27 @@ LrdFwUpd::ModuleDataReceived(
 
             nRemoveBytes = FUP_RESPONSE_LENGTH_QUERY_RESPONSE;
         }
+        else if ((CSubMode == SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND || CSubMode == SUBMODE_QUERY_MAX_READ_PER_COMMAND || CSubMode == SUBMODE_QUERY_CURRENT_READ_LENGTH) && baReceivedData.length() >= FUP_RESPONSE_LENGTH_ERROR && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ERROR)
+        {
+            //Optional option is not supported by this bootloader, continue without it
+            if (CSubMode == SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND)
+            {
+                //Use the default verify size
+                emit CurrentAction(MODULE_UPDATE, 0, QString("Max verify bytes per command: not supported, using ").append(QString::number(FUP_VERIFY_COMMAND_MAXIMUM_SIZE)));
+                nMaxVerifySize = 0;
+            }
+            else
+            {
+                //Reading is not possible, this is reported if a readback is attempted
+                emit CurrentAction(MODULE_UPDATE, 0, "Flash read options: not supported");
+                nMaxReadSize = 0;
+                nActiveReadLengthCmd = 0;
+            }
+            StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
+            SendNextOptionalQuery();
+
+            nRemoveBytes = FUP_RESPONSE_LENGTH_ERROR;
+        }
         else if (baReceivedData.length() >= FUP_RESPONSE_LENGTH_ERROR && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ERROR)
         {
             //Error
@@ -1891,7 +4120,7 @@ LrdFwUpd::ModuleDataReceived(
         //Bootloader setting
         if (baReceivedData.length() == FUP_RESPONSE_LENGTH_ACKNOWLEDGE && baReceivedData[FUP_OFFSET_PACKET_TYPE] == FUP_RESPONSE_ACKNOWLEDGE)
         {
-            tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+            StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
             if (CSubMode == SUBMODE_SET_ERASE_LENGTH)
             {
                 //Erase size has been set
@@ -1991,17 +4220,20 @@ LrdFwUpd::ModuleDataReceived(
             }
             else if (CSubMode == SUBMODE_SET_CHECKSUM_LENGTH)
             {
-                //Checksum size has been set, increase baud rate
+                //Checksum size has been set, the options do not need setting again for the next image of a job
+                bOptionsNegotiated = true;
+
+                //Increase baud rate
                 CSubMode = SUBMODE_SET_BAUD_RATE;
                 uint8_t nBaudRateIndex = lstUARTSpeeds.count();
 
-                if (pSettingsHandle->GetConfigOption(EXACT_BAUD) != 0)
+                if (pSessionConfig->nExactBaud != 0)
                 {
                     //Limit to exact baud rate
                     uint8_t i = 0;
                     while (i < lstUARTSpeeds.count())
                     {
-                        if (lstUARTSpeeds.at(i) == pSettingsHandle->GetConfigOption(EXACT_BAUD).toUInt())
+                        if (lstUARTSpeeds.at(i) == pSessionConfig->nExactBaud)
                         {
                             nBaudRateIndex = i + 1;
                             break;
@@ -2012,15 +4244,15 @@ LrdFwUpd::ModuleDataReceived(
                     if (i == lstUARTSpeeds.count())
                     {
                         //No suitable baud rate available
-                        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to find desired baud rate: ").append(pSettingsHandle->GetConfigOption(EXACT_BAUD).toString()));
+                        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to find desired baud rate: ").append(QString::number(pSessionConfig->nExactBaud)));
                         UpdateFailed(EXIT_CODE_SERIAL_PORT_EXACT_BAUD_NOT_FOUND);
                         return;
                     }
                 }
-                if (pSettingsHandle->GetConfigOption(MAX_BAUD) != 0)
+                if (pSessionConfig->nMaxBaud != 0)
                 {
                     //Cap to maximum baud rate
-                    uint32_t nMaxBaud = pSettingsHandle->GetConfigOption(MAX_BAUD).toUInt();
+                    uint32_t nMaxBaud = pSessionConfig->nMaxBaud;
                     uint8_t i = 0;
                     nBaudRateIndex++;
                     while (i < lstUARTSpeeds.count())
@@ -2086,7 +4318,7 @@ LrdFwUpd::ModuleDataReceived(
 
             nRemoveBytes = FUP_RESPONSE_LENGTH_UNLOCK_RESPONSE;
 
-            nCMode = MODE_IDLE;
+            SetMode(MODE_IDLE);
             CSubMode = SUBMODE_NONE;
             NextPacket();
         }
@@ -2097,7 +4329,7 @@ LrdFwUpd::ModuleDataReceived(
             {
                 //Module is not locked, continue with firmware upgrade but display a message
                 emit CurrentAction(MODULE_UPDATE, 0, "Bootloader key was supplied but module is not locked");
-                nCMode = MODE_IDLE;
+                SetMode(MODE_IDLE);
                 CSubMode = SUBMODE_NONE;
                 NextPacket();
             }
@@ -2126,14 +4358,56 @@ LrdFwUpd::CleanUp(
     )
 {
 
-    if (bSuccess == true && bNewBootloader == true && pSettingsHandle->GetConfigOption(REBOOT_MODULE_AFTER_UPDATE) == false)
+    if (bSuccess == true && bNewBootloader == true && pSessionConfig->bRebootAfterUpdate == false)
+    {
+        //Show message about baud rate being different
+        if (!lstUARTSpeeds.isEmpty() && lstUARTSpeeds.count() >= nChosenBaudRateIndex && nChosenBaudRateIndex != 0)
+        {
+            emit CurrentAction(MODULE_UPDATE, 0, QString("*NOTE*: Module baudrate has been left at ").append(QString::number(lstUARTSpeeds.at(nChosenBaudRateIndex-1))));
+        }
+    }
+
+    if (bLinkHealthActive == true)
+    {
+        //Score the session and compare it against the previous sessions on this port
+        QStringList lstWarnings;
+        QString strPort = pSessionConfig->strPort;
+        pLinkHealth->Stats()->bSuccessful = bSuccess;
+        pLinkHealth->Stats()->nErrorCode = nSessionErrorCode;
+        pLinkHealth->Stats()->nWriteTimeUS = nWritePacketTimeUS;
+        pLinkHealth->SetRoundTrips(pDevice->GetRoundTripSamples());
+        pLinkHealth->Assess(pSettingsHandle, strPort, &lstWarnings);
+        emit CurrentAction(MODULE_UPDATE, 0, pLinkHealth->Summary());
+        int i = 0;
+        while (i < lstWarnings.count())
+        {
+            emit CurrentAction(MODULE_UPDATE, 0, QString("Link health warning on ").append(strPort).append(": ").append(lstWarnings.at(i)));
+            ++i;
+        }
+        bLinkHealthActive = false;
+    }
+
+    //Count the result in the metrics
+    StopMetrics(bSuccess);
+
+    if (bLatencyTuned == true)
+    {
+        //Report the round trip time after the latency timer was changed
+        qint64 nAverageUS;
+        quint32 nCount = pDevice->GetRoundTripStats(&nAverageUS);
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Round trip time after tuning: ").append(QString::number(nAverageUS)).append("us average over ").append(QString::number(nCount)).append(" commands"));
+        pDevice->SetLatencyTimer(0);
+        bLatencyTuned = false;
+    }
+
+    if (bUwfScanPending == true)
     {
-        //Show message about baud rate being different
-        if (!lstUARTSpeeds.isEmpty() && lstUARTSpeeds.count() >= nChosenBaudRateIndex && nChosenBaudRateIndex != 0)
-        {
-            emit CurrentAction(MODULE_UPDATE, 0, QString("*NOTE*: Module baudrate has been left at ").append(QString::number(lstUARTSpeeds.at(nChosenBaudRateIndex-1))));
-        }
+        //Discard the result of the background upgrade file parse
+        futUwfScan.waitForFinished();
+        bUwfScanPending = false;
     }
+    lstUwfPackets.clear();
+    nUwfPacketIndex = 0;
 
     if (pUwfData->IsOpen())
     {
@@ -2149,6 +4423,23 @@ LrdFwUpd::CleanUp(
         tmrBaudRateChangeTimer = NULL;
     }
 
+    if (tmrProbeTimer != NULL)
+    {
+        //Clear up bootloader probe timer
+        tmrProbeTimer->stop();
+        disconnect(tmrProbeTimer, SIGNAL(timeout()), this, SLOT(ProbeTimerTimeout()));
+        delete tmrProbeTimer;
+        tmrProbeTimer = NULL;
+    }
+
+#if !defined(TARGET_OS_MAC)
+    if (pBlEnter->IsEnteringBootloader())
+    {
+        //Abort the FTDI bootloader entrance sequence
+        pBlEnter->CancelEnterBootloader();
+    }
+#endif
+
     if (tmrDeviceReadyTimer != NULL)
     {
         //Clear up CTS change timer
@@ -2162,17 +4453,15 @@ LrdFwUpd::CleanUp(
         tmrDeviceReadyTimer = NULL;
     }
 
-    if (tmrCommandTimeoutTimer->isActive())
-    {
-        //Stop command timeout timer
-        tmrCommandTimeoutTimer->stop();
-    }
+    //Stop command timeout timer
+    StopCommandTimeout();
 
     if (pDevice->IsOpen())
     {
         //Close the serial port
         pDevice->Close();
     }
+    pDevice->StopCapture();
 
     while (lstDevices.count() > 0)
     {
@@ -2189,6 +4478,7 @@ LrdFwUpd::CleanUp(
         lstSectorMap.pop_back();
         delete pSector;
     }
+    lstSectorIndex.clear();
 
     if (elptmrUpgradeTime.isValid())
     {
@@ -2197,16 +4487,14 @@ LrdFwUpd::CleanUp(
     }
 
     //Reset all variables back to default
-    nCMode = MODE_IDLE;
+    SetMode(MODE_IDLE);
     CSubMode = SUBMODE_NONE;
     nActiveDevice = 0;
     nActiveBank = 0;
-    nEraseStart = 0;
-    nEraseSize = 0;
+    lstEraseCommands.clear();
+    nEraseCommandIndex = 0;
     nWriteStart = 0;
     nWriteSize = 0;
-    nActiveSectorSize = 0;
-    nActiveEraseSectorLeft = 0;
     nDataSize = 0;
     nDeviceReadyChecks = 0;
     nActiveDeviceIndex = 0;
@@ -2220,9 +4508,45 @@ LrdFwUpd::CleanUp(
     nMaxChecksumSize = 0;
     nChosenBaudRateIndex = 0;
     bNewBootloader = false;
+    bOptionsNegotiated = false;
+    lstErasedRanges.clear();
+    nSkippedChunks = 0;
+    nSkippedBytes = 0;
+    baPendingChunk.clear();
+    elptmrWritePacket.invalidate();
+    bDeferredVerify = false;
+    nMaxVerifySize = 0;
+    lstVerifyRuns.clear();
+    lstVerifyWindows.clear();
+    lstVerifyFailures.clear();
+    nVerifyInFlight = 0;
+    if (pReadbackFile != NULL)
+    {
+        //Close readback file
+        pReadbackFile->close();
+        delete pReadbackFile;
+        pReadbackFile = NULL;
+    }
+    bReadbackMode = false;
+    lstReadbackRanges.clear();
+    lstReadbackExpected.clear();
+    nReadbackExpectedIndex = 0;
+    lstReadbackMismatches.clear();
+    lstReadRequests.clear();
+    nReadInFlight = 0;
+    lstJobItems.clear();
+    nJobIndex = 0;
+    if (elptmrJobItemTime.isValid())
+    {
+        //Invalidate the timer
+        elptmrJobItemTime.invalidate();
+    }
     bResentFirstBootloaderCommand = false;
     baReceivedData.clear();
 
+    //Complete the timeline
+    StopTrace(bSuccess);
+
     //Send message back to parent
     emit FirmwareUpdateActive(false);
 }
@@ -2237,12 +4561,13 @@ LrdFwUpd::CommandTimeout(
     {
         //Send command again
         pDevice->Transmit(COMMAND_BOOTLOADER_VERSION);
+        ++pLinkHealth->Stats()->nRetries;
         if (nVerbosity >= VERBOSITY_COMMANDS)
         {
             qDebug() << COMMAND_BOOTLOADER_VERSION;
         }
         bResentFirstBootloaderCommand = true;
-        tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+        StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
         return;
     }
 
@@ -2251,6 +4576,396 @@ LrdFwUpd::CommandTimeout(
     UpdateFailed(EXIT_CODE_SERIAL_PORT_COMMAND_TIMEOUT);
 }
 
+//=============================================================================
+// Changes the current mode, the time spent in the previous mode is added to
+// the session totals and (when tracing) to the timeline
+//=============================================================================
+void
+LrdFwUpd::SetMode(
+    uint8_t nMode
+    )
+{
+    if (nMode != nCMode && elptmrMode.isValid())
+    {
+        lstModeTimeUS[nCMode] += elptmrMode.nsecsElapsed() / 1000;
+        elptmrMode.restart();
+    }
+
+    if (pTrace != NULL && nMode != nCMode)
+    {
+        if (nCMode != MODE_IDLE)
+        {
+            pTrace->Complete(nTraceTrack, pModeTraceNames[nCMode], nTraceModeStartUS);
+        }
+        nTraceModeStartUS = pTrace->Now();
+    }
+    nCMode = nMode;
+}
+
+//=============================================================================
+// Starts recording a timeline of the session if a trace file is set
+//=============================================================================
+void
+LrdFwUpd::StartTrace(
+    )
+{
+    StopTrace(false);
+    if (pSettingsHandle->GetConfigOption(TRACE_FILE).toString().isEmpty())
+    {
+        //Tracing is disabled
+        return;
+    }
+
+    pTrace = LrdFwTrace::Acquire(pSettingsHandle->GetConfigOption(TRACE_FILE).toString());
+    if (pTrace == NULL)
+    {
+        //Tracing is not required for the update so only a warning is shown
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to open trace file ").append(pSettingsHandle->GetConfigOption(TRACE_FILE).toString()).append(", continuing without tracing"));
+        return;
+    }
+
+    nTraceTrack = pTrace->AddTrack(pSessionConfig->strPort);
+    nTraceSessionStartUS = pTrace->Now();
+    nTraceModeStartUS = nTraceSessionStartUS;
+    nTraceWrittenBytes = 0;
+}
+
+//=============================================================================
+// Adds the whole session to the timeline and stops recording
+//=============================================================================
+void
+LrdFwUpd::StopTrace(
+    bool bSuccess
+    )
+{
+    if (pTrace == NULL)
+    {
+        return;
+    }
+
+    QJsonObject jsoArgs;
+    jsoArgs["port"] = pSessionConfig->strPort;
+    jsoArgs["success"] = bSuccess;
+    jsoArgs["bytesWritten"] = nTraceWrittenBytes;
+    pTrace->Complete(nTraceTrack, "Session", nTraceSessionStartUS, jsoArgs);
+    LrdFwTrace::Release(pTrace);
+    pTrace = NULL;
+}
+
+//=============================================================================
+// Counts the session as running in the metrics if a metrics file or port is
+// set
+//=============================================================================
+void
+LrdFwUpd::StartMetrics(
+    )
+{
+    StopMetrics(false);
+    nSessionErrorCode = EXIT_CODE_SUCCESS;
+    lstModeTimeUS.fill(0, MODE_READ_COMMAND + 1);
+    elptmrMode.start();
+    if (pSettingsHandle->GetConfigOption(METRICS_FILE).toString().isEmpty() && pSettingsHandle->GetConfigOption(METRICS_PORT).toUInt() == 0)
+    {
+        //Metrics are disabled
+        return;
+    }
+
+    pMetrics = LrdFwMetrics::Instance();
+    if (!pSettingsHandle->GetConfigOption(METRICS_FILE).toString().isEmpty())
+    {
+        pMetrics->AddFile(pSettingsHandle->GetConfigOption(METRICS_FILE).toString());
+    }
+    if (pSettingsHandle->GetConfigOption(METRICS_PORT).toUInt() != 0 && pMetrics->Listen(pSettingsHandle->GetConfigOption(METRICS_ADDRESS).toString(), pSettingsHandle->GetConfigOption(METRICS_PORT).toUInt()) == false)
+    {
+        //Metrics are not required for the update so only a warning is shown
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Unable to serve metrics on ").append(pSettingsHandle->GetConfigOption(METRICS_ADDRESS).toString()).append(" port ").append(QString::number(pSettingsHandle->GetConfigOption(METRICS_PORT).toUInt())).append(", continuing without serving metrics"));
+    }
+
+    strMetricsPort = pSessionConfig->strPort;
+    pMetrics->SessionStarted(strMetricsPort);
+}
+
+//=============================================================================
+// Adds the result, phase durations and round trip times of the session to
+// the metrics
+//=============================================================================
+void
+LrdFwUpd::StopMetrics(
+    bool bSuccess
+    )
+{
+    if (pMetrics == NULL)
+    {
+        return;
+    }
+
+    if (elptmrMode.isValid())
+    {
+        //Include the time spent in the current mode
+        lstModeTimeUS[nCMode] += elptmrMode.nsecsElapsed() / 1000;
+        elptmrMode.invalidate();
+    }
+
+    //Only phases which the session reached are added
+    if (lstModeTimeUS[MODE_ERASE_COMMAND] > 0)
+    {
+        pMetrics->ObservePhase("erase", lstModeTimeUS[MODE_ERASE_COMMAND]);
+    }
+    if (lstModeTimeUS[MODE_WRITE_COMMAND] > 0)
+    {
+        pMetrics->ObservePhase("write", lstModeTimeUS[MODE_WRITE_COMMAND]);
+    }
+    if (lstModeTimeUS[MODE_VERIFY_COMMAND] > 0)
+    {
+        pMetrics->ObservePhase("verify", lstModeTimeUS[MODE_VERIFY_COMMAND]);
+    }
+    pMetrics->ObserveRoundTrips(pDevice->GetRoundTripSamples());
+    pMetrics->SessionFinished(strMetricsPort, (bSuccess == true ? EXIT_CODE_SUCCESS : nSessionErrorCode), pLinkHealth->Stats()->nBytesWritten);
+    pMetrics = NULL;
+}
+
+//=============================================================================
+// Estimates the commands, bytes on the wire and time that the update will
+// take without opening the port. The upgrade file is walked using the same
+// erase planning, write chunking, erased chunk skipping and verification
+// logic as an update, with the link parameters from the dry run settings in
+// place of the values negotiated with the bootloader
+//=============================================================================
+void
+LrdFwUpd::DryRunEstimate(
+    )
+{
+    UpdateEstimateStruct sEstimate = {};
+
+    //Use the baud rate which the update would end up at
+    nEstimateBaud = pSessionConfig->nExactBaud;
+    if (nEstimateBaud == 0)
+    {
+        nEstimateBaud = pSessionConfig->nMaxBaud;
+    }
+    if (nEstimateBaud == 0)
+    {
+        nEstimateBaud = pSessionConfig->nBootloaderBaud;
+    }
+    nEstimateRoundTripUS = pSettingsHandle->GetConfigOption(DRY_RUN_ROUND_TRIP_US).toUInt();
+
+    //Link framing and flash timings of the target, the defaults are for 8N1 and the nRF52 internal flash
+    nEstimateBitsPerByte = pSettingsHandle->GetConfigOption(DRY_RUN_BITS_PER_BYTE).toUInt();
+    nEstimateEraseUSPerKB = pSettingsHandle->GetConfigOption(DRY_RUN_ERASE_US_PER_KB).toUInt();
+    nEstimateProgramUSPerKB = pSettingsHandle->GetConfigOption(DRY_RUN_PROGRAM_US_PER_KB).toUInt();
+
+    //Use the write size, length field and checksum widths that the bootloader would be set to
+    nActiveWriteSize = pSettingsHandle->GetConfigOption(DRY_RUN_WRITE_SIZE).toUInt();
+    if (nActiveWriteSize == 0)
+    {
+        nActiveWriteSize = DEFAULT_WRITE_SIZE;
+    }
+    nActiveWriteLengthCmd = (nActiveWriteSize > UINT16_MAX ? FUP_LENGTH_4BYTE : (nActiveWriteSize > UINT8_MAX ? FUP_LENGTH_2BYTE : FUP_LENGTH_1BYTE));
+    nActiveChecksumLengthCmd = pSettingsHandle->GetConfigOption(DRY_RUN_CHECKSUM_LENGTH).toUInt();
+
+    //Erase sizes enable the erase command with a size index
+    lstEraseSizes.clear();
+    QStringList lstSizes = pSettingsHandle->GetConfigOption(DRY_RUN_ERASE_SIZES).toString().split(',', Qt::SkipEmptyParts);
+    bool bValid = (nEstimateBaud > 0 && nEstimateBitsPerByte > 0 && (nActiveChecksumLengthCmd == FUP_LENGTH_1BYTE || nActiveChecksumLengthCmd == FUP_LENGTH_2BYTE || nActiveChecksumLengthCmd == FUP_LENGTH_4BYTE));
+    int i = 0;
+    while (i < lstSizes.count() && bValid == true)
+    {
+        quint32 nSize = lstSizes.at(i).trimmed().toUInt(&bValid, 0);
+        lstEraseSizes.append(nSize);
+        ++i;
+    }
+    nActiveEraseLengthCmd = (lstEraseSizes.isEmpty() ? DEFAULT_ERASE_COMMAND_LENGTH : FUP_LENGTH_1BYTE);
+
+    if (bValid == false || lstEraseSizes.contains(0))
+    {
+        //A baud rate is needed and the checksum width and erase sizes must be usable
+        emit CurrentAction(MODULE_UPDATE, 0, "Dry run needs a baud rate, a non-zero number of bits per byte, a checksum width of 1, 2 or 4 bytes and non-zero erase sizes.");
+        UpdateFailed(EXIT_CODE_DRY_RUN_PARAMETER_INVALID);
+        return;
+    }
+
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Dry run at ").append(QString::number(nEstimateBaud)).append(" baud, ").append(QString::number(nActiveWriteSize)).append(" byte writes, ").append(QString::number(nActiveChecksumLengthCmd)).append(" byte checksums, ").append(lstEraseSizes.isEmpty() ? QString("sector erase") : QString::number(lstEraseSizes.count()).append(" erase sizes")).append(", verify ").append(pSessionConfig->bVerifyData == true ? (nVerifyStrategy == VERIFY_STRATEGY_DEFERRED ? "deferred" : "interleaved") : "off").append(", ").append(QString::number(nEstimateRoundTripUS)).append("us round trip"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Flash times are taken from the DRY_RUN_ERASE_US_PER_KB (").append(QString::number(nEstimateEraseUSPerKB)).append("us) and DRY_RUN_PROGRAM_US_PER_KB (").append(QString::number(nEstimateProgramUSPerKB)).append("us) settings and the link from DRY_RUN_BITS_PER_BYTE (").append(QString::number(nEstimateBitsPerByte)).append("), the defaults are for the nRF52 internal flash at 8N1"));
+
+    while (true)
+    {
+        if (WaitForUpgradeFileScan() == false)
+        {
+            //Upgrade file is not valid
+            return;
+        }
+
+        quint64 nImageStartUS = sEstimate.nSetupTimeUS + sEstimate.nEraseTimeUS + sEstimate.nWriteTimeUS + sEstimate.nVerifyTimeUS;
+        int32_t nStatus = EstimateImage(&sEstimate);
+        if (nStatus != EXIT_CODE_SUCCESS)
+        {
+            UpdateFailed(nStatus);
+            return;
+        }
+
+        if (lstJobItems.isEmpty())
+        {
+            break;
+        }
+
+        quint64 nImageTimeUS = sEstimate.nSetupTimeUS + sEstimate.nEraseTimeUS + sEstimate.nWriteTimeUS + sEstimate.nVerifyTimeUS - nImageStartUS;
+        emit CurrentAction(MODULE_UPDATE, 0, QString("Image ").append(QString::number(nJobIndex + 1)).append(" of ").append(QString::number(lstJobItems.count())).append(" (").append(lstJobItems.at(nJobIndex).strFilename).append(") estimated at ").append(QString::number(nImageTimeUS / 1000)).append("ms"));
+        if ((nJobIndex + 1) >= lstJobItems.count())
+        {
+            break;
+        }
+
+        if (StartNextJobItem() == false)
+        {
+            //Next image could not be opened
+            return;
+        }
+    }
+
+    ReportEstimate(&sEstimate);
+
+    qint64 nTotalMS = (qint64)((sEstimate.nSetupTimeUS + sEstimate.nEraseTimeUS + sEstimate.nWriteTimeUS + sEstimate.nVerifyTimeUS) / 1000);
+    CleanUp(true);
+    emit Finished(true, nTotalMS);
+}
+
+//=============================================================================
+// Adds the commands needed for the current upgrade file to an estimate. The
+// records are processed and the write blocks planned by the same functions as
+// an update, with the commands counted in place of being sent
+//=============================================================================
+int32_t
+LrdFwUpd::EstimateImage(
+    UpdateEstimateStruct *pEstimate
+    )
+{
+    uint32_t nEraseCommandLength = QByteArray(COMMAND_ERASE_SECTION).length() + FUP_LENGTH_4BYTE + (nActiveEraseLengthCmd > 0 ? FUP_LENGTH_1BYTE : 0);
+    uint32_t nWriteCommandLength = QByteArray(COMMAND_WRITE_SECTION).length() + FUP_LENGTH_4BYTE + nActiveWriteLengthCmd;
+    uint32_t nDataCommandLength = QByteArray(COMMAND_DATA_SECTION).length() + nActiveChecksumLengthCmd;
+    uint32_t nVerifyCommandLength = QByteArray(COMMAND_VERIFY_SECTION).length() + FUP_LENGTH_4BYTE + FUP_LENGTH_4BYTE + nActiveVerifyChecksumLengthCmd;
+    lstVerifyRuns.clear();
+
+    nUwfPacketIndex = 0;
+    while (nUwfPacketIndex < lstUwfPackets.count())
+    {
+        //Take the next packet from the index built by the upgrade file parse
+        uint8_t nCmdID = lstUwfPackets.at(nUwfPacketIndex).nCmdID;
+        uint32_t nPktLen = lstUwfPackets.at(nUwfPacketIndex).nLength;
+        pUwfData->Seek(SEEK_FROM_BEGINNING, lstUwfPackets.at(nUwfPacketIndex).nFileOffset);
+        ++nUwfPacketIndex;
+
+        int8_t nStatus = ProcessRecord(nCmdID, nPktLen);
+        if (nStatus < FUNCTION_RETURN_CODE_SUCCESS_DONE)
+        {
+            //Would fail the update
+            return RecordErrorCode(nStatus);
+        }
+        else if (nStatus == FUNCTION_RETURN_CODE_SUCCESS_NEXT_PACKET)
+        {
+            //Nothing is sent for this record
+            continue;
+        }
+
+        if (nCmdID == UWF_COMMAND_TARGET_PLATFORM)
+        {
+            //Sent to the module as-is
+            ++pEstimate->nTargetCommands;
+            pEstimate->nSetupTimeUS += EstimateCommandTime(baPendingCommand.length(), FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate);
+        }
+        else if (nCmdID == UWF_COMMAND_ERASE)
+        {
+            int i = 0;
+            while (i < lstEraseCommands.count())
+            {
+                ++pEstimate->nEraseCommands;
+                pEstimate->nEraseBytes += lstEraseCommands.at(i).nSize;
+                pEstimate->nEraseTimeUS += EstimateCommandTime(nEraseCommandLength, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate) + ((quint64)lstEraseCommands.at(i).nSize * nEstimateEraseUSPerKB / 1024);
+                ++i;
+            }
+        }
+        else if (nCmdID == UWF_COMMAND_WRITE)
+        {
+            uint8_t nStep = PlanNextWriteStep();
+            while (nStep != WRITE_STEP_DONE)
+            {
+                if (nStep == WRITE_STEP_WRITE)
+                {
+                    ++pEstimate->nWriteCommands;
+                    pEstimate->nWriteBytes += nDataSize;
+                    pEstimate->nWriteTimeUS += EstimateCommandTime(nWriteCommandLength, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate) + EstimateCommandTime(nDataCommandLength + nDataSize, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate) + ((quint64)nDataSize * nEstimateProgramUSPerKB / 1024);
+                    CompleteWriteChunk();
+                }
+                else if (nStep == WRITE_STEP_SKIP)
+                {
+                    //Flash already contains this data
+                    ++pEstimate->nSkippedChunks;
+                    pEstimate->nSkippedBytes += nDataSize;
+                }
+                else
+                {
+                    //Interleaved verification
+                    ++pEstimate->nVerifyCommands;
+                    pEstimate->nVerifyBytes += nVerifySize;
+                    pEstimate->nVerifyTimeUS += EstimateCommandTime(nVerifyCommandLength, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate);
+                    CompleteVerifyStep();
+                }
+                nStep = PlanNextWriteStep();
+            }
+        }
+    }
+
+    if (!lstVerifyRuns.isEmpty())
+    {
+        //When deferred verify commands are pipelined only some of the round trips are waited for
+        QList<VerifyWindowStruct> lstWindows = PlanVerifyWindows(lstVerifyRuns, FUP_VERIFY_COMMAND_MAXIMUM_SIZE, false);
+        int i = 0;
+        while (i < lstWindows.count())
+        {
+            ++pEstimate->nVerifyCommands;
+            pEstimate->nVerifyBytes += lstWindows.at(i).nSize;
+            pEstimate->nVerifyTimeUS += EstimateCommandTime(nVerifyCommandLength, FUP_RESPONSE_LENGTH_ACKNOWLEDGE, pEstimate) - nEstimateRoundTripUS;
+            ++i;
+        }
+        pEstimate->nVerifyTimeUS += (quint64)nEstimateRoundTripUS * ((lstWindows.count() + nVerifyPipelineDepth - 1) / nVerifyPipelineDepth);
+        lstVerifyRuns.clear();
+    }
+
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Returns the time taken for a command and its response, being the time on
+// the wire plus the round trip latency, and adds the bytes to an estimate
+//=============================================================================
+quint64
+LrdFwUpd::EstimateCommandTime(
+    uint32_t nTransmitBytes,
+    uint32_t nReceiveBytes,
+    UpdateEstimateStruct *pEstimate
+    )
+{
+    pEstimate->nTransmitBytes += nTransmitBytes;
+    pEstimate->nReceiveBytes += nReceiveBytes;
+
+    return ((quint64)(nTransmitBytes + nReceiveBytes) * nEstimateBitsPerByte * 1000000 / nEstimateBaud) + nEstimateRoundTripUS;
+}
+
+//=============================================================================
+// Outputs a dry run estimate
+//=============================================================================
+void
+LrdFwUpd::ReportEstimate(
+    const UpdateEstimateStruct *pEstimate
+    )
+{
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tTarget platform commands: ").append(QString::number(pEstimate->nTargetCommands)).append(", estimated ").append(QString::number(pEstimate->nSetupTimeUS / 1000)).append("ms"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tErase commands: ").append(QString::number(pEstimate->nEraseCommands)).append(" (").append(QString::number(pEstimate->nEraseBytes)).append(" bytes), estimated ").append(QString::number(pEstimate->nEraseTimeUS / 1000)).append("ms"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tWrite address and data commands: ").append(QString::number(pEstimate->nWriteCommands)).append(" each (").append(QString::number(pEstimate->nWriteBytes)).append(" bytes, ").append(QString::number(pEstimate->nSkippedChunks)).append(" chunks of ").append(QString::number(pEstimate->nSkippedBytes)).append(" bytes skipped), estimated ").append(QString::number(pEstimate->nWriteTimeUS / 1000)).append("ms"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tVerify commands: ").append(QString::number(pEstimate->nVerifyCommands)).append(" (").append(QString::number(pEstimate->nVerifyBytes)).append(" bytes), estimated ").append(QString::number(pEstimate->nVerifyTimeUS / 1000)).append("ms"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("\tBytes on the wire: ").append(QString::number(pEstimate->nTransmitBytes)).append(" sent, ").append(QString::number(pEstimate->nReceiveBytes)).append(" received"));
+    emit CurrentAction(MODULE_UPDATE, 0, QString("Estimated update time: ").append(QString::number((pEstimate->nSetupTimeUS + pEstimate->nEraseTimeUS + pEstimate->nWriteTimeUS + pEstimate->nVerifyTimeUS) / 1000)).append("ms (excluding bootloader entrance, option negotiation and module reboot, flash times from the dry run settings)"));
+}
+
 //=============================================================================
 // Callback when the baud rate change timer has elapsed
 //=============================================================================
@@ -2258,14 +4973,11 @@ void
 LrdFwUpd::BaudRateChangeTimerTimeout(
     )
 {
-    pDevice->Close();
-    pSettingsHandle->SetConfigOption(ACTIVE_BAUD, lstUARTSpeeds.at(nChosenBaudRateIndex-1));
-
     disconnect(this, SLOT(BaudRateChangeTimerTimeout()));
     delete tmrBaudRateChangeTimer;
     tmrBaudRateChangeTimer = NULL;
 
-    if (pDevice->Open() == false)
+    if (pDevice->ChangeBaudRate(lstUARTSpeeds.at(nChosenBaudRateIndex-1)) == false)
     {
         emit CurrentAction(MODULE_UPDATE, 0, QString("Failed to re-open serial port at baud rate: ").append(QString::number(lstUARTSpeeds.at(lstUARTSpeeds.count()-1))));
         UpdateFailed(EXIT_CODE_BAUD_RATE_ERROR);
@@ -2273,28 +4985,34 @@ LrdFwUpd::BaudRateChangeTimerTimeout(
     }
 
     emit CurrentAction(MODULE_UPDATE, 0, QString("Baud rate changed to ").append(QString::number(lstUARTSpeeds.at(nChosenBaudRateIndex-1))));
+    if (pTrace != NULL)
+    {
+        QJsonObject jsoArgs;
+        jsoArgs["baud"] = (qint64)lstUARTSpeeds.at(nChosenBaudRateIndex-1);
+        pTrace->Instant(nTraceTrack, "Baud rate changed", jsoArgs);
+    }
 
-    if (pSettingsHandle->GetConfigOption(UNLOCK_KEY).isValid() && !pSettingsHandle->GetConfigOption(UNLOCK_KEY).toString().isEmpty())
+    if (!pSessionConfig->baUnlockKey.isEmpty())
     {
         //Send unlock key
-        nCMode = MODE_UNLOCK;
+        SetMode(MODE_UNLOCK);
         CSubMode = SUBMODE_NONE;
 
         QByteArray baUnlockCommand = COMMAND_UNLOCK;
-        baUnlockCommand.append(pSettingsHandle->GetConfigOption(UNLOCK_KEY).toByteArray());
+        baUnlockCommand.append(pSessionConfig->baUnlockKey);
 
         pDevice->Transmit(baUnlockCommand);
         if (nVerbosity >= VERBOSITY_COMMANDS)
         {
-            qDebug() << pSettingsHandle->GetConfigOption(UNLOCK_KEY).toByteArray();
+            qDebug() << pSessionConfig->baUnlockKey;
         }
 
         //
-        tmrCommandTimeoutTimer->start(COMMAND_TIMEOUT_PERIOD_MS);
+        StartCommandTimeout(COMMAND_TIMEOUT_PERIOD_MS);
     }
     else
     {
-        nCMode = MODE_IDLE;
+        SetMode(MODE_IDLE);
         CSubMode = SUBMODE_NONE;
         NextPacket();
     }
@@ -2339,6 +5057,18 @@ LrdFwUpd::GetLastErrorCode(
     return nLastErrorCode;
 }
 
+//=============================================================================
+// Sets an image cache to hold upgrade files between updates, must outlive this
+// object
+//=============================================================================
+void
+LrdFwUpd::SetImageCache(
+    LrdFwImageCache *pCache
+    )
+{
+    pImageCache = pCache;
+}
+
 //=============================================================================
 // Error handler for child modules
 //=============================================================================
@@ -2355,8 +5085,74 @@ LrdFwUpd::ModuleError(
         //Error from the UART
         if (nErrorCode == EXIT_CODE_SERIAL_PORT_DEVICE_UNPLUGGED)
         {
+            nSessionErrorCode = nErrorCode;
             CleanUp(false);
         }
+        else if (nErrorCode == EXIT_CODE_SERIAL_PORT_TRANSMIT_STALLED)
+        {
+            //Module stopped accepting data
+            emit CurrentAction(MODULE_UPDATE, 0, "Module is not accepting data (CTS held inactive)");
+            UpdateFailed(nErrorCode);
+        }
+        else if (nErrorCode == EXIT_CODE_REPLAY_MISMATCH)
+        {
+            //Update has diverged from the capture being replayed
+            emit CurrentAction(MODULE_UPDATE, 0, "Data sent does not match the capture being replayed");
+            UpdateFailed(nErrorCode);
+        }
+    }
+}
+
+//=============================================================================
+// Starts the command timeout timer, if data is still being transmitted the
+// timer is started once it has all left the port so that the period does not
+// need to include the transfer time (which is unknown under flow control)
+//=============================================================================
+void
+LrdFwUpd::StartCommandTimeout(
+    int nPeriodMS
+    )
+{
+    if (pDevice->BytesInFlight() == 0)
+    {
+        //Nothing in flight, start now
+        nPendingCommandTimeoutMS = 0;
+        tmrCommandTimeoutTimer->start(nPeriodMS);
+    }
+    else
+    {
+        //Start when the data has been sent
+        tmrCommandTimeoutTimer->stop();
+        nPendingCommandTimeoutMS = nPeriodMS;
+    }
+}
+
+//=============================================================================
+// Stops the command timeout timer, including one waiting to be started
+//=============================================================================
+void
+LrdFwUpd::StopCommandTimeout(
+    )
+{
+    nPendingCommandTimeoutMS = 0;
+    if (tmrCommandTimeoutTimer->isActive())
+    {
+        tmrCommandTimeoutTimer->stop();
+    }
+}
+
+//=============================================================================
+// Callback when all data sent to the module has left the port
+//=============================================================================
+void
+LrdFwUpd::DeviceTransmitFinished(
+    )
+{
+    if (nPendingCommandTimeoutMS > 0)
+    {
+        //Start the command timeout now
+        tmrCommandTimeoutTimer->start(nPendingCommandTimeoutMS);
+        nPendingCommandTimeoutMS = 0;
     }
 }
 
@@ -32,10 +32,16 @@
 #include <QMetaType>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
 #include "LrdFwCommon.h"
 #include "LrdFwUART.h"
 #include "LrdFwUwf.h"
+#include "LrdFwImageCache.h"
 #include "LrdFwBlEnter.h"
+#include "LrdFwTrace.h"
+#include "LrdFwLinkHealth.h"
+#include "LrdFwMetrics.h"
 #include "LrdErr.h"
 
 /******************************************************************************/
@@ -54,7 +60,10 @@ enum APPLICATION_MODE
     MODE_SUPPORTED_FUNCTIONS,
     MODE_SUPPORTED_OPTIONS,
     MODE_SET_OPTIONS,
-    MODE_UNLOCK
+    MODE_UNLOCK,
+    MODE_PROBE_BOOTLOADER,
+    MODE_VERIFY_COMMAND,
+    MODE_READ_COMMAND
 };
 
 //Submodes (nCSubMode)
@@ -72,6 +81,9 @@ enum APPLICATION_SUB_MODE
     SUBMODE_QUERY_MAX_ERASE_PER_COMMAND,
     SUBMODE_QUERY_MAX_WRITE_PER_COMMAND,
     SUBMODE_QUERY_MAX_CHECKSUM_PER_COMMAND,
+    SUBMODE_QUERY_MAX_VERIFY_PER_COMMAND,
+    SUBMODE_QUERY_MAX_READ_PER_COMMAND,
+    SUBMODE_QUERY_CURRENT_READ_LENGTH,
     SUBMODE_QUERY_ERASE_SIZES,
     SUBMODE_QUERY_BAUD_RATES,
     SUBMODE_QUERY_SUPPORTED_ERASE_SIZE,
@@ -84,6 +96,22 @@ enum APPLICATION_SUB_MODE
     SUBMODE_RESET_VIA_BREAK
 };
 
+//Verification strategies (VERIFY_STRATEGY setting)
+enum VERIFY_STRATEGIES
+{
+    VERIFY_STRATEGY_INTERLEAVED = 0,
+    VERIFY_STRATEGY_DEFERRED
+};
+
+//Next step of a write block (from PlanNextWriteStep())
+enum WRITE_STEPS
+{
+    WRITE_STEP_DONE,
+    WRITE_STEP_WRITE,
+    WRITE_STEP_SKIP,
+    WRITE_STEP_VERIFY
+};
+
 //Structure to hold information on a flash device
 typedef struct
 {
@@ -102,6 +130,92 @@ typedef struct
     uint32_t nSectorSize;
 } SectorStruct;
 
+//Structure to hold a range of addresses (end is exclusive)
+typedef struct
+{
+    quint64 nStart;
+    quint64 nEnd;
+} AddressRangeStruct;
+
+//Structure to hold an entry in the sector map index (end is exclusive)
+typedef struct
+{
+    quint64  nStart;
+    quint64  nEnd;
+    uint32_t nSectorSize;
+} SectorIndexStruct;
+
+//Structure to hold a single planned erase command
+typedef struct
+{
+    quint64  nAddress;
+    uint32_t nSize;
+    int16_t  nSizeIndex; //Index into the supported erase sizes, -1 for the classic command
+    bool     bExact;     //True if the command is known to erase exactly nAddress to nAddress + nSize (false for an unaligned sized erase)
+} EraseCommandStruct;
+
+//Structure to hold a contiguous run of data written to flash, for deferred verification. The data is not kept, it is read again from the upgrade file if needed
+typedef struct
+{
+    quint64  nAddress;
+    qint64   nFileOffset; //Offset of the data in the upgrade file
+    uint32_t nSize;
+    uint32_t nChecksum;   //Checksum of the whole run
+} VerifyRunStruct;
+
+//Structure to hold a single deferred verify command
+typedef struct
+{
+    quint64  nAddress;
+    uint32_t nSize;
+    uint32_t nChecksum;
+    int      nRun;       //Index of the run containing this window
+    uint32_t nRunOffset; //Offset of this window within the run
+} VerifyWindowStruct;
+
+//Structure to hold where the data for a range of flash is in the upgrade file, for comparing with read back data
+typedef struct
+{
+    quint64  nAddress;
+    qint64   nFileOffset;
+    uint32_t nSize;
+} ReadbackExpectedStruct;
+
+//Structure to hold a single flash read command
+typedef struct
+{
+    quint64  nAddress;
+    uint32_t nSize;
+} ReadRequestStruct;
+
+//Structure to hold the dry run estimate of an update (times in microseconds)
+typedef struct
+{
+    quint32 nTargetCommands;      //Target platform commands
+    quint32 nEraseCommands;       //Erase commands
+    quint64 nEraseBytes;          //Bytes of flash erased
+    quint32 nWriteCommands;       //Write address and data command pairs
+    quint64 nWriteBytes;          //Bytes of data written
+    quint32 nSkippedChunks;       //Chunks not written as they only contain erased data
+    quint64 nSkippedBytes;        //Bytes in the skipped chunks
+    quint32 nVerifyCommands;      //Verify commands
+    quint64 nVerifyBytes;         //Bytes of flash verified
+    quint64 nTransmitBytes;       //Bytes sent to the module
+    quint64 nReceiveBytes;        //Bytes received from the module
+    quint64 nSetupTimeUS;         //Time for the target platform commands
+    quint64 nEraseTimeUS;         //Time for the erase commands
+    quint64 nWriteTimeUS;         //Time for the write commands
+    quint64 nVerifyTimeUS;        //Time for the verify commands
+} UpdateEstimateStruct;
+
+//Structure to hold a single image from a multi-image job manifest
+typedef struct
+{
+    QString strFilename;
+    bool    bVerify;
+    bool    bValidate;
+} JobItemStruct;
+
 /******************************************************************************/
 // Defines
 /******************************************************************************/
@@ -118,6 +232,8 @@ typedef struct
 #define COMMAND_SETTINGS_SET                          "s"
 #define COMMAND_UNLOCK                                "u"
 #define COMMAND_SUPPORTED_FEATURES                    "?"
+#define COMMAND_LINE_TERMINATOR                       "\r"
+#define COMMAND_READ_SECTION                          "r"     //Address (4 bytes) then size (current read length bytes), response is an acknowledge followed by the data
 
 //Default values, these need to be left alone to maintain compatibility with bootloader v3
 #define DEFAULT_ERASE_COMMAND_LENGTH                  0
@@ -232,6 +348,11 @@ typedef struct
 #define FUP_RESPONSE_LENGTH_VERSION                   6
 #define FUP_RESPONSE_LENGTH_FEATURES_SUPPORTED        9
 
+//Supported features response, a bit mask of the optional commands the bootloader supports (bit 0 is the lowest bit of the first byte)
+#define FUP_OFFSET_FEATURES_SUPPORTED                 1
+#define FUP_FEATURES_SUPPORTED_LENGTH                 8
+#define FUP_FEATURE_FLASH_READ                        4       //COMMAND_READ_SECTION
+
 //Version numbed used to differentiate legacy and enhanced bootloaders
 #define FUP_EXTENDED_VERSION_NUMBER                   '6'
 
@@ -241,9 +362,36 @@ typedef struct
 //Time (in ms) between checking if a module is ready with the CTS line
 #define FUP_DEVICE_READY_TIMER_TIME_MS                250
 
+//Time (in ms) to wait for a response when probing if a module is already in bootloader mode
+#define FUP_PROBE_TIMEOUT_MS                          100
+
+//Persistent configuration key prefix for the baud rate a module was left in bootloader mode at
+#define PERSISTENT_KEY_LAST_BOOTLOADER_BAUD           "LastBootloaderBaud/"
+
+//Value of a byte of flash which has been erased
+#define FUP_ERASED_FLASH_VALUE                        0xFF
+
 //Maximum size (in bytes) that a single verify command can check
 #define FUP_VERIFY_COMMAND_MAXIMUM_SIZE               65535
 
+//Maximum number of deferred verify commands which can be outstanding at once, the number used is set by VERIFY_PIPELINE_DEPTH
+#define FUP_VERIFY_PIPELINE_DEPTH_MAXIMUM             16
+
+//Size (in bytes) at which a failing deferred verify window is no longer split
+#define FUP_VERIFY_BISECT_MINIMUM_SIZE                256
+
+//Number of read commands which can be outstanding at once
+#define FUP_READ_PIPELINE_DEPTH                       2
+
+//Maximum number of differing regions listed when comparing a readback with an upgrade file
+#define READBACK_MAX_REPORTED_MISMATCHES              32
+
+//Size of the erased flash filler written at a time for gaps between read back ranges
+#define READBACK_GAP_FILL_BLOCK_SIZE                  65536
+
+//Size of the blocks the upgrade file is read in when working out the checksum of a deferred verification window
+#define VERIFY_FILE_READ_BLOCK_SIZE                   65536
+
 //Size of bytes
 #define FUP_LENGTH_4BYTE                              sizeof(uint32_t)
 #define FUP_LENGTH_2BYTE                              sizeof(uint16_t)
@@ -255,6 +403,10 @@ typedef struct
 class LrdFwUpd : public QObject
 {
     Q_OBJECT
+#ifdef UWFLASHX_BENCHMARK
+    friend class LrdFwBenchmark; //Drives the per packet code paths directly, only in the benchmark target
+#endif
+
 public:
     explicit
     LrdFwUpd(
@@ -284,6 +436,10 @@ public:
     qint16
     GetLastErrorCode(
         );
+    void
+    SetImageCache(
+        LrdFwImageCache *pCache
+        );
 
 signals:
     void
@@ -311,6 +467,19 @@ signals:
     FirmwareUpdateActive(
         bool bStatus
         );
+    void
+    JobItemFinished(
+        uint16_t nIndex,
+        QString strFilename,
+        qint64 nItemTimeMS
+        );
+    void
+    BootloaderEntrancePrompt(
+        uint8_t nType,
+        QString strTitle,
+        QString strMessage,
+        bool *pbAccepted
+        );
 #ifdef __linux__
     void
     SerialPortNameChanged(
@@ -343,8 +512,257 @@ public slots:
         uint32_t nModule,
         int32_t nErrorCode
         );
+    void
+    ProbeTimerTimeout(
+        );
+    void
+    BootloaderEntranceFinished(
+        bool bSuccess,
+        QString strNewPortName
+        );
+    void
+    DeviceTransmitFinished(
+        );
+    void
+    DryRunEstimate(
+        );
 
 private:
+    bool
+    EnterBootloaderMode(
+        );
+    void
+    WaitForBootloader(
+        );
+    void
+    StartCommandTimeout(
+        int nPeriodMS
+        );
+    void
+    StopCommandTimeout(
+        );
+    void
+    TuneLatencyTimer(
+        );
+    void
+    SetMode(
+        uint8_t nMode
+        );
+    void
+    StartTrace(
+        );
+    void
+    StopTrace(
+        bool bSuccess
+        );
+    int32_t
+    EstimateImage(
+        UpdateEstimateStruct *pEstimate
+        );
+    quint64
+    EstimateCommandTime(
+        uint32_t nTransmitBytes,
+        uint32_t nReceiveBytes,
+        UpdateEstimateStruct *pEstimate
+        );
+    void
+    ReportEstimate(
+        const UpdateEstimateStruct *pEstimate
+        );
+    void
+    StartMetrics(
+        );
+    void
+    StopMetrics(
+        bool bSuccess
+        );
+    void
+    StartBootloaderProbe(
+        );
+    void
+    ProbeNextBaudRate(
+        );
+    quint32
+    GetLastBootloaderBaud(
+        );
+    void
+    SetLastBootloaderBaud(
+        quint32 nBaud
+        );
+    void
+    SendNextEraseCommand(
+        );
+    static QList<AddressRangeStruct>
+    MergeAddressRanges(
+        QList<AddressRangeStruct> lstRanges
+        );
+    void
+    BuildSectorIndex(
+        );
+    static int32_t
+    FindSectorIndex(
+        const QList<SectorIndexStruct> &lstIndex,
+        quint64 nAddress
+        );
+    static bool
+    PlanEraseCommands(
+        const QList<AddressRangeStruct> &lstRanges,
+        const QList<SectorIndexStruct> &lstIndex,
+        const QList<quint32> &lstSizes,
+        bool bSizedCommand,
+        QList<EraseCommandStruct> *plstCommands
+        );
+    bool
+    SendNextWriteAddress(
+        );
+    uint8_t
+    PlanNextWriteStep(
+        );
+    uint32_t
+    CompleteWriteChunk(
+        );
+    static uint32_t
+    PlanWriteChunkSize(
+        quint64 nAddress,
+        uint32_t nRemaining,
+        uint32_t nMaxChunk,
+        uint32_t nPageSize
+        );
+    static uint32_t
+    CountWriteChunks(
+        quint64 nAddress,
+        uint32_t nSize,
+        uint32_t nMaxChunk,
+        uint32_t nPageSize
+        );
+    uint32_t
+    GetWritePageSize(
+        quint64 nAddress
+        );
+    void
+    SendVerifyCommand(
+        );
+    void
+    CompleteVerifyStep(
+        );
+    void
+    TransmitVerifyCommand(
+        uint32_t nAddress,
+        uint32_t nSize,
+        uint32_t nChecksum
+        );
+    void
+    AppendDeferredVerifyData(
+        quint64 nAddress,
+        qint64 nFileOffset,
+        const QByteArray &baData
+        );
+    QList<VerifyWindowStruct>
+    PlanVerifyWindows(
+        const QList<VerifyRunStruct> &lstRuns,
+        uint32_t nMaxWindow,
+        bool bChecksums
+        );
+    uint32_t
+    UpgradeFileChecksum(
+        qint64 nOffset,
+        uint32_t nSize
+        );
+    void
+    StartDeferredVerify(
+        );
+    void
+    SendDeferredVerifyCommands(
+        );
+    void
+    DeferredVerifyResponse(
+        bool bMatched
+        );
+    void
+    SendNextOptionalQuery(
+        );
+    static bool
+    ParseAddressRange(
+        QString strRange,
+        AddressRangeStruct *pRange
+        );
+    static QList<ReadRequestStruct>
+    PlanReadRequests(
+        const QList<AddressRangeStruct> &lstRanges,
+        uint32_t nMaxRead
+        );
+    bool
+    IsFeatureSupported(
+        uint8_t nFeature
+        );
+    void
+    StartReadback(
+        );
+    void
+    SendReadCommands(
+        );
+    void
+    ReadbackDataReceived(
+        const QByteArray &baData
+        );
+    void
+    CompareReadbackData(
+        quint64 nAddress,
+        const QByteArray &baData
+        );
+    QByteArray
+    ReadUpgradeFileData(
+        qint64 nOffset,
+        qint64 nSize
+        );
+    void
+    FinishReadback(
+        );
+    static uint32_t
+    ChunkChecksum(
+        const QByteArray &baData
+        );
+    static bool
+    IsChunkErased(
+        const QByteArray &baData
+        );
+    void
+    AddErasedRange(
+        uint32_t nStart,
+        uint32_t nSize
+        );
+    bool
+    IsRangeErased(
+        uint32_t nStart,
+        uint32_t nSize
+        );
+    bool
+    LoadJobManifest(
+        QString strFilename
+        );
+    void
+    ApplyJobItem(
+        uint16_t nIndex
+        );
+    bool
+    StartNextJobItem(
+        );
+    int32_t
+    CheckJobItems(
+        );
+    int8_t
+    ProcessRecord(
+        uint8_t nCmdID,
+        uint32_t nLength
+        );
+    int8_t
+    SendRecordCommands(
+        uint8_t nCmdID
+        );
+    static int32_t
+    RecordErrorCode(
+        int8_t nStatus
+        );
     int8_t
     ProcessCommandTargetPlatform(
         uint32_t nLength
@@ -390,13 +808,40 @@ private:
     CleanUp(
         bool bSuccess
         );
+    static UwfScanStruct
+    ScanUpgradeFile(
+        QString strFilename,
+        bool bValidate
+        );
+    static UwfScanStruct
+    ScanUpgradeData(
+        QByteArray baData,
+        bool bValidate
+        );
+    static UwfScanStruct
+    ScanUpgradeDevice(
+        QIODevice *pUpgradeFile,
+        bool bValidate
+        );
+    bool
+    OpenUpgradeFile(
+        );
+    int8_t
+    UpgradeFilePercent(
+        );
+    void
+    StartUpgradeFileScan(
+        QString strFilename,
+        bool bValidate
+        );
     bool
-    ValidateUpgradeFile(
+    WaitForUpgradeFileScan(
         );
 
     LrdFwUART               *pDevice = NULL;                //UART object
     LrdFwUwf                *pUwfData = NULL;               //Uwf reader object
     LrdSettings             *pSettingsHandle = NULL;        //Settings object
+    QSharedPointer<const SessionConfigStruct> pSessionConfig; //Typed copy of the settings for the current session (or image of a job)
 #if !defined(TARGET_OS_MAC)
     LrdFwBlEnter            *pBlEnter = NULL;               //Bootloader entrance object
 #endif
@@ -404,24 +849,24 @@ private:
     uint8_t                 CSubMode;                       //Current sub-mode of active move (APPLICATION_SUB_MODE)
     QList<DeviceStruct *>   lstDevices;                     //Holds the list of flash devices on the module
     QList<SectorStruct *>   lstSectorMap;                   //Holds the list of sectors and their mapping on the module
+    QList<SectorIndexStruct> lstSectorIndex;                //Sector map sorted by address, used for lookups
     uint8_t                 nActiveDevice;                  //The active flash device
     uint8_t                 nActiveBank;                    //The active bank of the active flash device
-    uint32_t                nEraseStart;                    //The current position for an erase operation
-    uint32_t                nEraseSize;                     //The amount left for an erase operation
-    uint32_t                nEraseWholeSize;                //The whole size of an erase operation (used for current task percent)
+    QList<EraseCommandStruct> lstEraseCommands;             //Planned erase commands for the current erase operation
+    qsizetype               nEraseCommandIndex;             //Index into lstEraseCommands of the next erase command to send
     uint32_t                nWriteStart;                    //The current position for a write operation
     uint32_t                nWriteSize;                     //The amount left for a write operation
     uint32_t                nWriteWholeSize;                //The whole size of a write operation (used for current task percent)
-    uint32_t                nActiveEraseSectorLeft;         //Number of sectors left in the current sector mapping for the current erase task
-    uint32_t                nActiveSectorSize;              //Currently active sector size
     uint32_t                nDataSize;                      //The amount of data in a single write block instruction
     QTimer                  *tmrDeviceReadyTimer = NULL;    //Timer used for checking if the device is ready to start communication in bootloader mode
     QTimer                  *tmrBaudRateChangeTimer = NULL; //Timer used for checking if an error is received when changing baud rates
     QTimer                  *tmrRestartTimer = NULL;        //Timer used for restarting the module
     QTimer                  *tmrCommandTimeoutTimer = NULL; //Timer used to check if a command sent has timed out
+    int                     nPendingCommandTimeoutMS;       //Command timeout to start once the data sent has left the port (0 if none)
+    QTimer                  *tmrProbeTimer = NULL;          //Timer used to wait for a response when probing for a module already in bootloader mode
     uint8_t                 nDeviceReadyChecks;             //Number of times device has been checked to see if it is ready
     uint8_t                 nActiveDeviceIndex;             //The currently active flash device index
-    uint32_t                nFileSize;                      //The total size of the upgrade file
+    qint64                  nFileSize;                      //The total size of the upgrade file
     QList<quint32>          lstEraseSizes;                  //Holds the list of supported erase sizes (enhanced bootloader only)
     QList<quint32>          lstUARTSpeeds;                  //Holds the list of supported baud rates (enhanced bootloader only)
 
@@ -451,6 +896,87 @@ private:
     uint32_t                nVerifyChecksum;                //Checksum used for verification command
     uint32_t                nVerifyAddress;                 //Address used for verification command
     uint32_t                nVerifySize;                    //Size used for verification command
+    uint32_t                nLastVerifyAddress;             //Address of the last verification command sent
+    uint32_t                nLastVerifySize;                //Size of the last verification command sent
+    QByteArray              baPendingChunk;                 //Data for the write address command which has been sent
+    QByteArray              baPendingCommand;               //Command to send for the record which has been processed (target platform)
+    bool                    bSkipErasedChunks;              //Cached value of if chunks containing only erased data can be skipped
+    QList<AddressRangeStruct> lstErasedRanges;              //Sorted list of flash ranges erased during this session
+    uint32_t                nSkippedChunks;                 //Number of write chunks skipped as they only contained erased data
+    quint64                 nSkippedBytes;                  //Number of bytes skipped as they only contained erased data
+    bool                    bAlignWrites;                   //Cached value of if write commands should be aligned to flash pages
+    uint32_t                nConfigPageSize;                //Cached value of the configured flash page size (0 to use the sector map)
+    uint32_t                nWritePackets;                  //Number of write address and data command pairs sent
+    uint32_t                nAlignedWritePackets;           //Number of write commands planned with the active alignment setting
+    uint32_t                nUnalignedWritePackets;         //Number of write commands which would be needed without page alignment
+    quint64                 nWritePacketTimeUS;             //Total time (in microseconds) taken by write address and data command pairs
+    QElapsedTimer           elptmrWritePacket;              //Timer used to measure a single write address and data command pair
+    uint8_t                 nVerifyStrategy;                //Cached value of the verification strategy (VERIFY_STRATEGIES)
+    bool                    bDeferredVerify;                //True if written data is being collected for the deferred verification pass
+    uint32_t                nMaxVerifySize;                 //Maximum number of bytes per verify command response from module (0 if unknown)
+    QList<VerifyRunStruct>  lstVerifyRuns;                  //Data written in the current image, checked in the deferred verification pass
+    QList<VerifyWindowStruct> lstVerifyWindows;             //Deferred verify commands (failing windows have their halves appended)
+    QList<AddressRangeStruct> lstVerifyFailures;            //Regions which failed deferred verification
+    qsizetype               nVerifyWindowIndex;             //Index into lstVerifyWindows of the next verify command to send
+    qsizetype               nVerifyResponseIndex;           //Index into lstVerifyWindows of the next verify command response expected
+    qsizetype               nVerifyInFlight;                //Number of verify commands sent without a response
+    uint8_t                 nVerifyPipelineDepth;           //Number of verify commands which can be sent without a response (1 unless enabled by the settings)
+    qsizetype               nVerifyInitialWindows;          //Number of verify commands planned before any bisection
+    QElapsedTimer           elptmrVerifyTime;               //Timer used to measure the deferred verification pass
+    bool                    bReadbackMode;                  //True if flash is being read back from the module instead of being written
+    bool                    bReadbackStarted;               //True once the readback of flash has started
+    bool                    bReadbackExplicitRange;         //True if a readback range was specified instead of using the upgrade file write ranges
+    bool                    bReadbackCompare;               //Cached value of if data read back should be compared with the upgrade file
+    uint32_t                nMaxReadSize;                   //Maximum number of bytes per read command response from module (0 if reading is not supported)
+    QByteArray              baSupportedFeatures;            //Feature bit mask from the supported features response (enhanced bootloader only)
+    uint8_t                 nActiveReadLengthCmd;           //The active read size in bytes per field for a single command (0 if reading is not supported)
+    QList<AddressRangeStruct> lstReadbackRanges;            //Flash ranges to read back
+    QList<ReadbackExpectedStruct> lstReadbackExpected;      //Upgrade file data to compare read back data with, sorted by address when the readback starts
+    qsizetype               nReadbackExpectedIndex;         //Index into lstReadbackExpected of the first entry which can overlap the next read response
+    QList<AddressRangeStruct> lstReadbackMismatches;        //Flash ranges which differ from the upgrade file
+    QList<ReadRequestStruct> lstReadRequests;               //Planned read commands
+    qsizetype               nReadRequestIndex;              //Index into lstReadRequests of the next read command to send
+    qsizetype               nReadResponseIndex;             //Index into lstReadRequests of the next read command response expected
+    qsizetype               nReadInFlight;                  //Number of read commands sent without a response
+    QFile                   *pReadbackFile = NULL;          //File that read back data is written to
+    quint64                 nReadbackFileAddress;           //Flash address corresponding to the current end of the readback file
+    quint64                 nReadbackBytes;                 //Number of bytes read back from the module
+    QElapsedTimer           elptmrReadbackTime;             //Timer used to measure the readback
+    QFuture<UwfScanStruct>  futUwfScan;                     //Result of the background upgrade file parse
+    bool                    bUwfScanPending;                //True if the background upgrade file parse result has not yet been collected
+    QList<UwfPacketStruct>  lstUwfPackets;                  //Index of the packets in the upgrade file
+    int32_t                 nUwfPacketIndex;                //Index into lstUwfPackets of the next packet to process
+    LrdFwImageCache         *pImageCache = NULL;            //Cache of parsed upgrade files shared between sessions (NULL if not used)
+    QString                 strUwfScanFilename;             //Upgrade file being parsed, used to store the result in the image cache
+    bool                    bUwfScanValidate;               //True if the upgrade file being parsed is being validated
+    bool                    bUwfScanFromCache;              //True if the parse result came from the image cache
+    bool                    bProbeAttempted;                //True if the module was probed to check if it was already in bootloader mode
+    bool                    bLatencyTuned;                  //True if the FTDI latency timer was changed for this update
+    QList<quint32>          lstProbeBauds;                  //Baud rates to probe the module at
+    uint8_t                 nProbeIndex;                    //Index into lstProbeBauds of the baud rate currently being probed
+    bool                    bOptionsNegotiated;             //True once the enhanced bootloader options and baud rate have been set for this session
+    QList<JobItemStruct>    lstJobItems;                    //Images from the job manifest (empty if a single upgrade file is being used)
+    uint16_t                nJobIndex;                      //Index into lstJobItems of the image currently being written
+    QElapsedTimer           elptmrJobItemTime;              //Timer used to measure the amount of time that a single image takes
+    LrdFwTrace              *pTrace;                        //Timeline recorder for the session (NULL if tracing is disabled)
+    uint32_t                nTraceTrack;                    //Track of this session in the timeline
+    qint64                  nTraceSessionStartUS;           //Timeline time that the session started
+    qint64                  nTraceModeStartUS;              //Timeline time that the current mode started
+    qint64                  nTraceEntranceStartUS;          //Timeline time that the FTDI bootloader entrance started
+    qint64                  nTraceReadyWaitStartUS;         //Timeline time that waiting for the module to be ready (CTS) started
+    qint64                  nTraceWrittenBytes;             //Bytes of data written, recorded as a counter in the timeline
+    LrdFwLinkHealth         *pLinkHealth;                   //Link health statistics of the session
+    bool                    bLinkHealthActive;              //True if the link health of this session is being assessed
+    LrdFwMetrics            *pMetrics;                      //Metrics the session is counted in (NULL if metrics are disabled)
+    QString                 strMetricsPort;                 //Port the session is counted against in the metrics
+    int32_t                 nSessionErrorCode;              //Error code the session failed with (EXIT_CODE_SUCCESS if it has not failed)
+    QElapsedTimer           elptmrMode;                     //Timer used to measure the amount of time spent in the current mode
+    QList<qint64>           lstModeTimeUS;                  //Time (in microseconds) spent in each mode during the session
+    quint32                 nEstimateBaud;                  //Baud rate used for the dry run estimate
+    quint32                 nEstimateRoundTripUS;           //Command round trip latency used for the dry run estimate
+    quint8                  nEstimateBitsPerByte;           //Bits sent on the link per byte used for the dry run estimate
+    quint32                 nEstimateEraseUSPerKB;          //Target flash erase time per KB used for the dry run estimate
+    quint32                 nEstimateProgramUSPerKB;        //Target flash program time per KB used for the dry run estimate
 };
 
 #endif // LRDFWUPD_H
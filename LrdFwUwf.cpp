@@ -85,19 +85,30 @@ LrdFwUwf::Open(
     }
 
     nVerbosity = pSettingsHandle->GetConfigOption(UWF_VERBOSITY).toUInt();
-    pUpgradeFile = new QFile(pSettingsHandle->GetConfigOption(FIRMWARE_FILE).toString());
-    MallocFailCheck(pUpgradeFile);
-    if (!pUpgradeFile->exists())
+    if (!baImageData.isNull())
     {
-        //File does not exist
-        delete pUpgradeFile;
-        pUpgradeFile = NULL;
-        nLastErrorCode = EXIT_CODE_UWF_FILE_NOT_FOUND;
-        emit Error(MODULE_UWF, EXIT_CODE_UWF_FILE_NOT_FOUND);
-        return false;
+        //Read from the in-memory copy of the file
+        QBuffer *pBuffer = new QBuffer();
+        MallocFailCheck(pBuffer);
+        pBuffer->setData(baImageData);
+        pUpgradeFile = pBuffer;
+    }
+    else
+    {
+        QFile *pFile = new QFile(strFilename.isEmpty() ? pSettingsHandle->GetConfigOption(FIRMWARE_FILE).toString() : strFilename);
+        MallocFailCheck(pFile);
+        if (!pFile->exists())
+        {
+            //File does not exist
+            delete pFile;
+            nLastErrorCode = EXIT_CODE_UWF_FILE_NOT_FOUND;
+            emit Error(MODULE_UWF, EXIT_CODE_UWF_FILE_NOT_FOUND);
+            return false;
+        }
+        pUpgradeFile = pFile;
     }
 
-    if (!pUpgradeFile->open(QFile::ReadOnly))
+    if (!pUpgradeFile->open(QIODevice::ReadOnly))
     {
         //Cannot get read only access
         delete pUpgradeFile;
@@ -126,12 +137,36 @@ LrdFwUwf::Close(
     }
 }
 
+//=============================================================================
+// Sets an in-memory copy of the uwf file to read from instead of the file on
+// disk, a null array reverts to reading the file
+//=============================================================================
+void
+LrdFwUwf::SetImageData(
+    QByteArray baData
+    )
+{
+    baImageData = baData;
+}
+
+//=============================================================================
+// Sets the uwf file to open, an empty filename reverts to using the file set in
+// the settings
+//=============================================================================
+void
+LrdFwUwf::SetFilename(
+    QString strFilename
+    )
+{
+    this->strFilename = strFilename;
+}
+
 //=============================================================================
 // Reads data from uwf file
 //=============================================================================
 QByteArray
 LrdFwUwf::Read(
-    qint32 nBytes
+    qint64 nBytes
     )
 {
     return pUpgradeFile->read(nBytes);
@@ -143,7 +178,7 @@ LrdFwUwf::Read(
 bool
 LrdFwUwf::Seek(
     qint8 nType,
-    qint32 nPosition
+    qint64 nPosition
     )
 {
     if (nType == SEEK_CURRENT)
@@ -191,7 +226,7 @@ LrdFwUwf::IsOpen(
 //=============================================================================
 // Returns the total size of the uwf file
 //=============================================================================
-qint32
+qint64
 LrdFwUwf::TotalSize(
     )
 {
@@ -206,7 +241,7 @@ LrdFwUwf::TotalSize(
 //=============================================================================
 // Returns the current offset into the opened uwf file
 //=============================================================================
-qint32
+qint64
 LrdFwUwf::CurrentPosition(
     )
 {
@@ -28,6 +28,7 @@
 /******************************************************************************/
 #include <QObject>
 #include <QFile>
+#include <QBuffer>
 #include "LrdFwCommon.h"
 #include "LrdSettings.h"
 #include "LrdErr.h"
@@ -42,6 +43,22 @@ enum SEEK_TYPES
     SEEK_FROM_END
 };
 
+//Structure to hold the location of a single command in a Uwf file
+typedef struct
+{
+    uint8_t  nCmdID;
+    uint32_t nLength;
+    qint64   nFileOffset;
+} UwfPacketStruct;
+
+//Structure to hold the result of parsing a Uwf file
+typedef struct
+{
+    int32_t                nErrorCode;
+    QString                strError;
+    QList<UwfPacketStruct> lstPackets;
+} UwfScanStruct;
+
 /******************************************************************************/
 // Class definitions
 /******************************************************************************/
@@ -66,22 +83,30 @@ public:
     void
     Close(
         );
+    void
+    SetImageData(
+        QByteArray baData
+        );
+    void
+    SetFilename(
+        QString strFilename
+        );
     QByteArray
     Read(
-        qint32 nBytes
+        qint64 nBytes
         );
     bool
     Seek(
         qint8 nType,
-        qint32 nPosition
+        qint64 nPosition
         );
     bool
     IsOpen(
         );
-    qint32
+    qint64
     TotalSize(
         );
-    qint32
+    qint64
     CurrentPosition(
         );
     bool
@@ -96,7 +121,9 @@ signals:
         );
 
 private:
-    QFile          *pUpgradeFile = NULL;    //Pointer to the upgrade file handle
+    QIODevice      *pUpgradeFile = NULL;    //Pointer to the upgrade file handle
+    QByteArray     baImageData;             //In-memory copy of the upgrade file (null to read from the file)
+    QString        strFilename;             //Upgrade file to open (empty to use the FIRMWARE_FILE setting)
     LrdSettings    *pSettingsHandle = NULL; //Pointer to the settings object
     qint16         nLastErrorCode;          //Last error code
     uint8_t        nVerbosity;              //The verbosity level of the output
@@ -25,8 +25,73 @@
 // Include Files
 /******************************************************************************/
 #include "LrdSettings.h"
+#include "LrdErr.h"
 #include <QDebug>
 
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Setting names, in CONFIG_TYPES order, used by string based interfaces
+static const char *pConfigNames[] = {
+    "OUTPUT_DEVICE",
+    "FIRMWARE_FILE",
+    "APPLICATION_BAUD",
+    "BOOTLOADER_BAUD",
+    "ACTIVE_BAUD",
+    "MAX_BAUD",
+    "EXACT_BAUD",
+    "BOOTLOADER_ENHANCED_FUNCTIONALITY_DISABLE",
+    "REBOOT_MODULE_BEFORE_UPDATE",
+    "REBOOT_MODULE_BEFORE_UPDATE_DTR_STATUS",
+    "REBOOT_MODULE_AFTER_UPDATE",
+    "VERIFY_DATA",
+    "UNLOCK_KEY",
+    "BOOTLOADER_ENTER_METHOD",
+    "UART_VERBOSITY",
+    "UPDATE_VERBOSITY",
+    "UWF_VERBOSITY",
+    "SETTINGS_VERBOSITY",
+    "UPDATE_SERVER_HOST",
+    "BOOTLOADER_ENTRANCE_WARNINGS_DISABLED",
+    "BOOTLOADER_ENTRANCE_ERRORS_DISABLED",
+    "VALIDATE_UWF",
+    "BOOTLOADER_PROBE_FIRST",
+    "FIRMWARE_MANIFEST",
+    "SKIP_ERASED_CHUNKS",
+    "WRITE_PAGE_SIZE",
+    "ALIGN_WRITES",
+    "VERIFY_STRATEGY",
+    "READBACK_FILE",
+    "READBACK_RANGE",
+    "READBACK_COMPARE",
+    "FIXTURE_MODE",
+    "FIXTURE_DETECT",
+    "FIXTURE_SETTLE_MS",
+    "STATION_MODE",
+    "STATION_MATCH",
+    "STATION_SERIAL",
+    "FTDI_LATENCY_TIMER",
+    "NATIVE_SERIAL",
+    "TRACE_FILE",
+    "CAPTURE_FILE",
+    "REPLAY_DELAY_PERCENT",
+    "LINK_HEALTH",
+    "METRICS_FILE",
+    "METRICS_PORT",
+    "DRY_RUN",
+    "DRY_RUN_WRITE_SIZE",
+    "DRY_RUN_CHECKSUM_LENGTH",
+    "DRY_RUN_ERASE_SIZES",
+    "DRY_RUN_ROUND_TRIP_US",
+    "UWF_MAX_SIZE_MB",
+    "METRICS_ADDRESS",
+    "DRY_RUN_BITS_PER_BYTE",
+    "DRY_RUN_ERASE_US_PER_KB",
+    "DRY_RUN_PROGRAM_US_PER_KB",
+    "VERIFY_PIPELINE_DEPTH"
+};
+COMPILE_ASSERT((sizeof(pConfigNames)/sizeof(pConfigNames[0])) == (CONFIG_ID_MAX-CONFIG_ID_MIN-1));
+
 /******************************************************************************/
 // Local Functions or Private Members
 /******************************************************************************/
@@ -156,6 +221,142 @@ LrdSettings::SetConfigOption(
     {
         varTmp = DEFAULT_CONFIG_VALIDATE_UWF;
     }
+    else if (cnfType == BOOTLOADER_PROBE_FIRST)
+    {
+        varTmp = DEFAULT_CONFIG_BOOTLOADER_PROBE_FIRST;
+    }
+    else if (cnfType == FIRMWARE_MANIFEST)
+    {
+        varTmp = DEFAULT_CONFIG_FIRMWARE_MANIFEST;
+    }
+    else if (cnfType == SKIP_ERASED_CHUNKS)
+    {
+        varTmp = DEFAULT_CONFIG_SKIP_ERASED_CHUNKS;
+    }
+    else if (cnfType == WRITE_PAGE_SIZE)
+    {
+        varTmp = DEFAULT_CONFIG_WRITE_PAGE_SIZE;
+    }
+    else if (cnfType == ALIGN_WRITES)
+    {
+        varTmp = DEFAULT_CONFIG_ALIGN_WRITES;
+    }
+    else if (cnfType == VERIFY_STRATEGY)
+    {
+        varTmp = DEFAULT_CONFIG_VERIFY_STRATEGY;
+    }
+    else if (cnfType == READBACK_FILE)
+    {
+        varTmp = DEFAULT_CONFIG_READBACK_FILE;
+    }
+    else if (cnfType == READBACK_RANGE)
+    {
+        varTmp = DEFAULT_CONFIG_READBACK_RANGE;
+    }
+    else if (cnfType == READBACK_COMPARE)
+    {
+        varTmp = DEFAULT_CONFIG_READBACK_COMPARE;
+    }
+    else if (cnfType == FIXTURE_MODE)
+    {
+        varTmp = DEFAULT_CONFIG_FIXTURE_MODE;
+    }
+    else if (cnfType == FIXTURE_DETECT)
+    {
+        varTmp = DEFAULT_CONFIG_FIXTURE_DETECT;
+    }
+    else if (cnfType == FIXTURE_SETTLE_MS)
+    {
+        varTmp = DEFAULT_CONFIG_FIXTURE_SETTLE_MS;
+    }
+    else if (cnfType == STATION_MODE)
+    {
+        varTmp = DEFAULT_CONFIG_STATION_MODE;
+    }
+    else if (cnfType == STATION_MATCH)
+    {
+        varTmp = DEFAULT_CONFIG_STATION_MATCH;
+    }
+    else if (cnfType == STATION_SERIAL)
+    {
+        varTmp = DEFAULT_CONFIG_STATION_SERIAL;
+    }
+    else if (cnfType == FTDI_LATENCY_TIMER)
+    {
+        varTmp = DEFAULT_CONFIG_FTDI_LATENCY_TIMER;
+    }
+    else if (cnfType == NATIVE_SERIAL)
+    {
+        varTmp = DEFAULT_CONFIG_NATIVE_SERIAL;
+    }
+    else if (cnfType == TRACE_FILE)
+    {
+        varTmp = DEFAULT_CONFIG_TRACE_FILE;
+    }
+    else if (cnfType == CAPTURE_FILE)
+    {
+        varTmp = DEFAULT_CONFIG_CAPTURE_FILE;
+    }
+    else if (cnfType == REPLAY_DELAY_PERCENT)
+    {
+        varTmp = DEFAULT_CONFIG_REPLAY_DELAY_PERCENT;
+    }
+    else if (cnfType == LINK_HEALTH)
+    {
+        varTmp = DEFAULT_CONFIG_LINK_HEALTH;
+    }
+    else if (cnfType == METRICS_FILE)
+    {
+        varTmp = DEFAULT_CONFIG_METRICS_FILE;
+    }
+    else if (cnfType == METRICS_PORT)
+    {
+        varTmp = DEFAULT_CONFIG_METRICS_PORT;
+    }
+    else if (cnfType == DRY_RUN)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN;
+    }
+    else if (cnfType == DRY_RUN_WRITE_SIZE)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_WRITE_SIZE;
+    }
+    else if (cnfType == DRY_RUN_CHECKSUM_LENGTH)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_CHECKSUM_LENGTH;
+    }
+    else if (cnfType == DRY_RUN_ERASE_SIZES)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_ERASE_SIZES;
+    }
+    else if (cnfType == DRY_RUN_ROUND_TRIP_US)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_ROUND_TRIP_US;
+    }
+    else if (cnfType == UWF_MAX_SIZE_MB)
+    {
+        varTmp = DEFAULT_CONFIG_UWF_MAX_SIZE_MB;
+    }
+    else if (cnfType == METRICS_ADDRESS)
+    {
+        varTmp = DEFAULT_CONFIG_METRICS_ADDRESS;
+    }
+    else if (cnfType == DRY_RUN_BITS_PER_BYTE)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_BITS_PER_BYTE;
+    }
+    else if (cnfType == DRY_RUN_ERASE_US_PER_KB)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_ERASE_US_PER_KB;
+    }
+    else if (cnfType == DRY_RUN_PROGRAM_US_PER_KB)
+    {
+        varTmp = DEFAULT_CONFIG_DRY_RUN_PROGRAM_US_PER_KB;
+    }
+    else if (cnfType == VERIFY_PIPELINE_DEPTH)
+    {
+        varTmp = DEFAULT_CONFIG_VERIFY_PIPELINE_DEPTH;
+    }
 
     if (varValue.typeId() != varTmp.typeId())
     {
@@ -245,6 +446,40 @@ LrdSettings::SetConfigDefaults(
     mapSettings[BOOTLOADER_ENTRANCE_WARNINGS_DISABLED] = DEFAULT_CONFIG_BOOTLOADER_ENTRANCE_WARNINGS_DISABLED;
     mapSettings[BOOTLOADER_ENTRANCE_ERRORS_DISABLED] = DEFAULT_CONFIG_BOOTLOADER_ENTRANCE_ERRORS_DISABLED;
     mapSettings[VALIDATE_UWF] = DEFAULT_CONFIG_VALIDATE_UWF;
+    mapSettings[BOOTLOADER_PROBE_FIRST] = DEFAULT_CONFIG_BOOTLOADER_PROBE_FIRST;
+    mapSettings[FIRMWARE_MANIFEST] = DEFAULT_CONFIG_FIRMWARE_MANIFEST;
+    mapSettings[SKIP_ERASED_CHUNKS] = DEFAULT_CONFIG_SKIP_ERASED_CHUNKS;
+    mapSettings[WRITE_PAGE_SIZE] = DEFAULT_CONFIG_WRITE_PAGE_SIZE;
+    mapSettings[ALIGN_WRITES] = DEFAULT_CONFIG_ALIGN_WRITES;
+    mapSettings[VERIFY_STRATEGY] = DEFAULT_CONFIG_VERIFY_STRATEGY;
+    mapSettings[READBACK_FILE] = DEFAULT_CONFIG_READBACK_FILE;
+    mapSettings[READBACK_RANGE] = DEFAULT_CONFIG_READBACK_RANGE;
+    mapSettings[READBACK_COMPARE] = DEFAULT_CONFIG_READBACK_COMPARE;
+    mapSettings[FIXTURE_MODE] = DEFAULT_CONFIG_FIXTURE_MODE;
+    mapSettings[FIXTURE_DETECT] = DEFAULT_CONFIG_FIXTURE_DETECT;
+    mapSettings[FIXTURE_SETTLE_MS] = DEFAULT_CONFIG_FIXTURE_SETTLE_MS;
+    mapSettings[STATION_MODE] = DEFAULT_CONFIG_STATION_MODE;
+    mapSettings[STATION_MATCH] = DEFAULT_CONFIG_STATION_MATCH;
+    mapSettings[STATION_SERIAL] = DEFAULT_CONFIG_STATION_SERIAL;
+    mapSettings[FTDI_LATENCY_TIMER] = DEFAULT_CONFIG_FTDI_LATENCY_TIMER;
+    mapSettings[NATIVE_SERIAL] = DEFAULT_CONFIG_NATIVE_SERIAL;
+    mapSettings[TRACE_FILE] = DEFAULT_CONFIG_TRACE_FILE;
+    mapSettings[CAPTURE_FILE] = DEFAULT_CONFIG_CAPTURE_FILE;
+    mapSettings[REPLAY_DELAY_PERCENT] = DEFAULT_CONFIG_REPLAY_DELAY_PERCENT;
+    mapSettings[LINK_HEALTH] = DEFAULT_CONFIG_LINK_HEALTH;
+    mapSettings[METRICS_FILE] = DEFAULT_CONFIG_METRICS_FILE;
+    mapSettings[METRICS_PORT] = DEFAULT_CONFIG_METRICS_PORT;
+    mapSettings[DRY_RUN] = DEFAULT_CONFIG_DRY_RUN;
+    mapSettings[DRY_RUN_WRITE_SIZE] = DEFAULT_CONFIG_DRY_RUN_WRITE_SIZE;
+    mapSettings[DRY_RUN_CHECKSUM_LENGTH] = DEFAULT_CONFIG_DRY_RUN_CHECKSUM_LENGTH;
+    mapSettings[DRY_RUN_ERASE_SIZES] = DEFAULT_CONFIG_DRY_RUN_ERASE_SIZES;
+    mapSettings[DRY_RUN_ROUND_TRIP_US] = DEFAULT_CONFIG_DRY_RUN_ROUND_TRIP_US;
+    mapSettings[UWF_MAX_SIZE_MB] = DEFAULT_CONFIG_UWF_MAX_SIZE_MB;
+    mapSettings[METRICS_ADDRESS] = DEFAULT_CONFIG_METRICS_ADDRESS;
+    mapSettings[DRY_RUN_BITS_PER_BYTE] = DEFAULT_CONFIG_DRY_RUN_BITS_PER_BYTE;
+    mapSettings[DRY_RUN_ERASE_US_PER_KB] = DEFAULT_CONFIG_DRY_RUN_ERASE_US_PER_KB;
+    mapSettings[DRY_RUN_PROGRAM_US_PER_KB] = DEFAULT_CONFIG_DRY_RUN_PROGRAM_US_PER_KB;
+    mapSettings[VERIFY_PIPELINE_DEPTH] = DEFAULT_CONFIG_VERIFY_PIPELINE_DEPTH;
 }
 
 //=============================================================================
@@ -474,6 +709,245 @@ LrdSettings::ErasePersistentConfig(
     return CONFIG_ERROR_NONE;
 }
 
+//=============================================================================
+// Change a settings value from a string, converted to the type of the setting
+//=============================================================================
+qint16
+LrdSettings::SetConfigOptionFromString(
+    CONFIG_TYPES cnfType,
+    QString strValue
+    )
+{
+    if (!(cnfType > CONFIG_ID_MIN && cnfType < CONFIG_ID_MAX))
+    {
+        //Invalid key
+        return EXIT_CODE_INVALID_SETTINGS_ID;
+    }
+    else if (!mapSettings.contains(cnfType))
+    {
+        //Key is not set so the type is unknown
+        return EXIT_CODE_INVALID_SETTINGS_NOT_SET;
+    }
+
+    bool bOk = true;
+    QVariant varValue;
+    switch (mapSettings[cnfType].typeId())
+    {
+        case QMetaType::Bool:
+        {
+            //Anything other than 0 or false is treated as enabled
+            varValue = (strValue == "0" || strValue.toLower() == "false" ? false : true);
+            break;
+        }
+        case QMetaType::UInt:
+        {
+            //Decimal, hex (0x) or octal (0)
+            varValue = (quint32)strValue.toUInt(&bOk, 0);
+            break;
+        }
+        case QMetaType::UChar:
+        {
+            quint32 nValue = strValue.toUInt(&bOk, 0);
+            if (nValue > 0xff)
+            {
+                bOk = false;
+            }
+            varValue = (quint8)nValue;
+            break;
+        }
+        case QMetaType::QString:
+        {
+            varValue = strValue;
+            break;
+        }
+        case QMetaType::QByteArray:
+        {
+            varValue = strValue.toUtf8();
+            break;
+        }
+        default:
+        {
+            bOk = false;
+            break;
+        }
+    }
+
+    if (bOk == false)
+    {
+        //Value could not be converted to the type of this setting
+        return EXIT_CODE_INVALID_SETTINGS_TYPE;
+    }
+
+    return SetConfigOption(cnfType, varValue);
+}
+
+//=============================================================================
+// Look up a setting by its name, e.g. "VERIFY_DATA"
+//=============================================================================
+bool
+LrdSettings::ConfigTypeFromName(
+    QString strName,
+    CONFIG_TYPES *pType
+    )
+{
+    uint16_t i = 0;
+    strName = strName.toUpper();
+    while (i < (sizeof(pConfigNames)/sizeof(pConfigNames[0])))
+    {
+        if (strName == pConfigNames[i])
+        {
+            *pType = (CONFIG_TYPES)(CONFIG_ID_MIN + 1 + i);
+            return true;
+        }
+        ++i;
+    }
+
+    return false;
+}
+
+//=============================================================================
+// Change a settings value for a single port only, this overrides the value
+// set with SetConfigOption in the session configuration for that port
+//=============================================================================
+qint16
+LrdSettings::SetPortConfigOption(
+    QString strPort,
+    CONFIG_TYPES cnfType,
+    QVariant varValue
+    )
+{
+    if (!(cnfType > CONFIG_ID_MIN && cnfType < CONFIG_ID_MAX))
+    {
+        //Invalid key
+        return EXIT_CODE_INVALID_SETTINGS_ID;
+    }
+    else if (!mapSettings.contains(cnfType))
+    {
+        //Key is not set so the type is unknown
+        return EXIT_CODE_INVALID_SETTINGS_NOT_SET;
+    }
+    else if (varValue.typeId() != mapSettings[cnfType].typeId())
+    {
+        //Invalid type
+        return EXIT_CODE_INVALID_SETTINGS_TYPE;
+    }
+
+    mapPortSettings[strPort][cnfType] = varValue;
+
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Removes a single settings value which overrides that of a port
+//=============================================================================
+void
+LrdSettings::ClearPortConfigOption(
+    QString strPort,
+    CONFIG_TYPES cnfType
+    )
+{
+    if (mapPortSettings.contains(strPort))
+    {
+        mapPortSettings[strPort].remove(cnfType);
+        if (mapPortSettings[strPort].isEmpty())
+        {
+            //No overrides left for this port
+            mapPortSettings.remove(strPort);
+        }
+    }
+}
+
+//=============================================================================
+// Removes all of the settings values which override those of a single port
+//=============================================================================
+void
+LrdSettings::ClearPortConfigOptions(
+    QString strPort
+    )
+{
+    mapPortSettings.remove(strPort);
+}
+
+//=============================================================================
+// Copies the per-port settings values from another settings object
+//=============================================================================
+void
+LrdSettings::CopyPortConfigOptions(
+    LrdSettings *pSource
+    )
+{
+    mapPortSettings = pSource->mapPortSettings;
+}
+
+//=============================================================================
+// Returns a settings value for a port, using the per-port value if one is set
+//=============================================================================
+QVariant
+LrdSettings::GetPortConfigOption(
+    QString strPort,
+    CONFIG_TYPES cnfType
+    )
+{
+    QMap<QString, QMap<qint16, QVariant>>::const_iterator itPort = mapPortSettings.constFind(strPort);
+    if (itPort != mapPortSettings.constEnd() && itPort->contains(cnfType))
+    {
+        //Overridden for this port
+        return itPort->value(cnfType);
+    }
+
+    return GetConfigOption(cnfType);
+}
+
+//=============================================================================
+// Creates the read-only session configuration for a port from the current
+// settings, the result can be shared between sessions as it is never changed
+//=============================================================================
+QSharedPointer<const SessionConfigStruct>
+LrdSettings::CreateSessionConfig(
+    QString strPort
+    )
+{
+    SessionConfigStruct *pConfig = new SessionConfigStruct();
+    MallocFailCheck(pConfig);
+    pConfig->strPort = strPort;
+    pConfig->strFirmwareFile = GetPortConfigOption(strPort, FIRMWARE_FILE).toString();
+    pConfig->nBootloaderBaud = GetPortConfigOption(strPort, BOOTLOADER_BAUD).toUInt();
+    pConfig->nMaxBaud = GetPortConfigOption(strPort, MAX_BAUD).toUInt();
+    pConfig->nExactBaud = GetPortConfigOption(strPort, EXACT_BAUD).toUInt();
+    pConfig->bEnhancedFunctionalityDisabled = GetPortConfigOption(strPort, BOOTLOADER_ENHANCED_FUNCTIONALITY_DISABLE).toBool();
+    pConfig->bRebootAfterUpdate = GetPortConfigOption(strPort, REBOOT_MODULE_AFTER_UPDATE).toBool();
+    pConfig->bVerifyData = GetPortConfigOption(strPort, VERIFY_DATA).toBool();
+    pConfig->bValidateUwf = GetPortConfigOption(strPort, VALIDATE_UWF).toBool();
+    pConfig->nVerbosity = GetPortConfigOption(strPort, UPDATE_VERBOSITY).toUInt();
+    pConfig->bSkipErasedChunks = GetPortConfigOption(strPort, SKIP_ERASED_CHUNKS).toBool();
+    pConfig->nWritePageSize = GetPortConfigOption(strPort, WRITE_PAGE_SIZE).toUInt();
+    pConfig->bAlignWrites = GetPortConfigOption(strPort, ALIGN_WRITES).toBool();
+    pConfig->nVerifyStrategy = GetPortConfigOption(strPort, VERIFY_STRATEGY).toUInt();
+    pConfig->nFtdiLatencyTimer = GetPortConfigOption(strPort, FTDI_LATENCY_TIMER).toUInt();
+    pConfig->bLinkHealth = GetPortConfigOption(strPort, LINK_HEALTH).toBool();
+    pConfig->bDryRun = GetPortConfigOption(strPort, DRY_RUN).toBool();
+    pConfig->bProbeFirst = GetPortConfigOption(strPort, BOOTLOADER_PROBE_FIRST).toBool();
+    pConfig->nMaxUwfSize = (quint64)GetPortConfigOption(strPort, UWF_MAX_SIZE_MB).toUInt() * UWF_FILE_SIZE_MB_BYTES;
+    pConfig->baUnlockKey = GetPortConfigOption(strPort, UNLOCK_KEY).toByteArray();
+    pConfig->strFirmwareManifest = GetPortConfigOption(strPort, FIRMWARE_MANIFEST).toString();
+    pConfig->strReadbackFile = GetPortConfigOption(strPort, READBACK_FILE).toString();
+    pConfig->bReadbackCompare = GetPortConfigOption(strPort, READBACK_COMPARE).toBool();
+    pConfig->strReadbackRange = GetPortConfigOption(strPort, READBACK_RANGE).toString();
+    pConfig->strCaptureFile = GetPortConfigOption(strPort, CAPTURE_FILE).toString();
+    pConfig->bRebootBeforeUpdate = GetPortConfigOption(strPort, REBOOT_MODULE_BEFORE_UPDATE).toBool();
+    pConfig->bRebootBeforeUpdateDTR = GetPortConfigOption(strPort, REBOOT_MODULE_BEFORE_UPDATE_DTR_STATUS).toBool();
+    pConfig->nBootloaderEnterMethod = GetPortConfigOption(strPort, BOOTLOADER_ENTER_METHOD).toUInt();
+    pConfig->nApplicationBaud = GetPortConfigOption(strPort, APPLICATION_BAUD).toUInt();
+    pConfig->bEntranceWarningsDisabled = GetPortConfigOption(strPort, BOOTLOADER_ENTRANCE_WARNINGS_DISABLED).toBool();
+    pConfig->bEntranceErrorsDisabled = GetPortConfigOption(strPort, BOOTLOADER_ENTRANCE_ERRORS_DISABLED).toBool();
+    pConfig->nUartVerbosity = GetPortConfigOption(strPort, UART_VERBOSITY).toUInt();
+    pConfig->bNativeSerial = GetPortConfigOption(strPort, NATIVE_SERIAL).toBool();
+    pConfig->nReplayDelayPercent = GetPortConfigOption(strPort, REPLAY_DELAY_PERCENT).toUInt();
+    pConfig->nVerifyPipelineDepth = GetPortConfigOption(strPort, VERIFY_PIPELINE_DEPTH).toUInt();
+
+    return QSharedPointer<const SessionConfigStruct>(pConfig);
+}
+
 /******************************************************************************/
 // END OF FILE
 /******************************************************************************/
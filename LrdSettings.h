@@ -31,6 +31,7 @@
 #include <QVariant>
 #include <QFile>
 #include <QSettings>
+#include <QSharedPointer>
 #include "LrdFwCommon.h"
 
 /******************************************************************************/
@@ -61,6 +62,40 @@ enum CONFIG_TYPES
     BOOTLOADER_ENTRANCE_WARNINGS_DISABLED,
     BOOTLOADER_ENTRANCE_ERRORS_DISABLED,
     VALIDATE_UWF,
+    BOOTLOADER_PROBE_FIRST,
+    FIRMWARE_MANIFEST,
+    SKIP_ERASED_CHUNKS,
+    WRITE_PAGE_SIZE,
+    ALIGN_WRITES,
+    VERIFY_STRATEGY,
+    READBACK_FILE,
+    READBACK_RANGE,
+    READBACK_COMPARE,
+    FIXTURE_MODE,
+    FIXTURE_DETECT,
+    FIXTURE_SETTLE_MS,
+    STATION_MODE,
+    STATION_MATCH,
+    STATION_SERIAL,
+    FTDI_LATENCY_TIMER,
+    NATIVE_SERIAL,
+    TRACE_FILE,
+    CAPTURE_FILE,
+    REPLAY_DELAY_PERCENT,
+    LINK_HEALTH,
+    METRICS_FILE,
+    METRICS_PORT,
+    DRY_RUN,
+    DRY_RUN_WRITE_SIZE,
+    DRY_RUN_CHECKSUM_LENGTH,
+    DRY_RUN_ERASE_SIZES,
+    DRY_RUN_ROUND_TRIP_US,
+    UWF_MAX_SIZE_MB,
+    METRICS_ADDRESS,
+    DRY_RUN_BITS_PER_BYTE,
+    DRY_RUN_ERASE_US_PER_KB,
+    DRY_RUN_PROGRAM_US_PER_KB,
+    VERIFY_PIPELINE_DEPTH,
 
     CONFIG_ID_MAX
 };
@@ -79,6 +114,46 @@ enum CONFIG_ERRORS
     CONFIG_ERROR_MAX
 };
 
+//Typed copy of the settings used by an update session, created when the session (or the next image of a job) starts so that no settings are looked up per packet
+typedef struct
+{
+    QString strPort;                         //OUTPUT_DEVICE
+    QString strFirmwareFile;                 //FIRMWARE_FILE (the current image of a job)
+    quint32 nBootloaderBaud;                 //BOOTLOADER_BAUD
+    quint32 nMaxBaud;                        //MAX_BAUD
+    quint32 nExactBaud;                      //EXACT_BAUD
+    bool    bEnhancedFunctionalityDisabled;  //BOOTLOADER_ENHANCED_FUNCTIONALITY_DISABLE
+    bool    bRebootAfterUpdate;              //REBOOT_MODULE_AFTER_UPDATE
+    bool    bVerifyData;                     //VERIFY_DATA
+    bool    bValidateUwf;                    //VALIDATE_UWF
+    quint8  nVerbosity;                      //UPDATE_VERBOSITY
+    bool    bSkipErasedChunks;               //SKIP_ERASED_CHUNKS
+    quint32 nWritePageSize;                  //WRITE_PAGE_SIZE
+    bool    bAlignWrites;                    //ALIGN_WRITES
+    quint8  nVerifyStrategy;                 //VERIFY_STRATEGY
+    quint8  nFtdiLatencyTimer;               //FTDI_LATENCY_TIMER
+    bool    bLinkHealth;                     //LINK_HEALTH
+    bool    bDryRun;                         //DRY_RUN
+    bool    bProbeFirst;                     //BOOTLOADER_PROBE_FIRST
+    quint64 nMaxUwfSize;                     //UWF_MAX_SIZE_MB, in bytes
+    QByteArray baUnlockKey;                  //UNLOCK_KEY
+    QString strFirmwareManifest;             //FIRMWARE_MANIFEST
+    QString strReadbackFile;                 //READBACK_FILE
+    bool    bReadbackCompare;                //READBACK_COMPARE
+    QString strReadbackRange;                //READBACK_RANGE
+    QString strCaptureFile;                  //CAPTURE_FILE
+    bool    bRebootBeforeUpdate;             //REBOOT_MODULE_BEFORE_UPDATE
+    bool    bRebootBeforeUpdateDTR;          //REBOOT_MODULE_BEFORE_UPDATE_DTR_STATUS
+    quint8  nBootloaderEnterMethod;          //BOOTLOADER_ENTER_METHOD
+    quint32 nApplicationBaud;                //APPLICATION_BAUD
+    bool    bEntranceWarningsDisabled;       //BOOTLOADER_ENTRANCE_WARNINGS_DISABLED
+    bool    bEntranceErrorsDisabled;         //BOOTLOADER_ENTRANCE_ERRORS_DISABLED
+    quint8  nUartVerbosity;                  //UART_VERBOSITY
+    bool    bNativeSerial;                   //NATIVE_SERIAL
+    quint32 nReplayDelayPercent;             //REPLAY_DELAY_PERCENT
+    quint8  nVerifyPipelineDepth;            //VERIFY_PIPELINE_DEPTH
+} SessionConfigStruct;
+
 /******************************************************************************/
 // Constants
 /******************************************************************************/
@@ -104,6 +179,40 @@ const QString    DEFAULT_CONFIG_UPDATE_SERVER_HOST                        = "uwt
 const bool       DEFAULT_CONFIG_BOOTLOADER_ENTRANCE_WARNINGS_DISABLED     = false;
 const bool       DEFAULT_CONFIG_BOOTLOADER_ENTRANCE_ERRORS_DISABLED       = false;
 const bool       DEFAULT_CONFIG_VALIDATE_UWF                              = true;
+const bool       DEFAULT_CONFIG_BOOTLOADER_PROBE_FIRST                    = false;
+const QString    DEFAULT_CONFIG_FIRMWARE_MANIFEST                         = "";
+const bool       DEFAULT_CONFIG_SKIP_ERASED_CHUNKS                        = false;
+const quint32    DEFAULT_CONFIG_WRITE_PAGE_SIZE                           = 0;
+const bool       DEFAULT_CONFIG_ALIGN_WRITES                              = false;
+const quint8     DEFAULT_CONFIG_VERIFY_STRATEGY                           = 0;
+const QString    DEFAULT_CONFIG_READBACK_FILE                             = "";
+const QString    DEFAULT_CONFIG_READBACK_RANGE                            = "";
+const bool       DEFAULT_CONFIG_READBACK_COMPARE                          = false;
+const bool       DEFAULT_CONFIG_FIXTURE_MODE                              = false;
+const quint8     DEFAULT_CONFIG_FIXTURE_DETECT                            = 0;
+const quint32    DEFAULT_CONFIG_FIXTURE_SETTLE_MS                         = 500;
+const bool       DEFAULT_CONFIG_STATION_MODE                              = false;
+const QString    DEFAULT_CONFIG_STATION_MATCH                             = "";
+const QString    DEFAULT_CONFIG_STATION_SERIAL                            = "";
+const quint8     DEFAULT_CONFIG_FTDI_LATENCY_TIMER                        = 0;
+const bool       DEFAULT_CONFIG_NATIVE_SERIAL                             = false;
+const QString    DEFAULT_CONFIG_TRACE_FILE                                = "";
+const QString    DEFAULT_CONFIG_CAPTURE_FILE                              = "";
+const quint32    DEFAULT_CONFIG_REPLAY_DELAY_PERCENT                      = 100;
+const bool       DEFAULT_CONFIG_LINK_HEALTH                               = false;
+const QString    DEFAULT_CONFIG_METRICS_FILE                              = "";
+const quint32    DEFAULT_CONFIG_METRICS_PORT                              = 0;
+const bool       DEFAULT_CONFIG_DRY_RUN                                   = false;
+const quint32    DEFAULT_CONFIG_DRY_RUN_WRITE_SIZE                        = 0;
+const quint8     DEFAULT_CONFIG_DRY_RUN_CHECKSUM_LENGTH                   = 1;
+const QString    DEFAULT_CONFIG_DRY_RUN_ERASE_SIZES                       = "";
+const quint32    DEFAULT_CONFIG_DRY_RUN_ROUND_TRIP_US                     = 1000;
+const quint32    DEFAULT_CONFIG_UWF_MAX_SIZE_MB                           = 1024;
+const QString    DEFAULT_CONFIG_METRICS_ADDRESS                           = "127.0.0.1";
+const quint8     DEFAULT_CONFIG_DRY_RUN_BITS_PER_BYTE                     = 10;
+const quint32    DEFAULT_CONFIG_DRY_RUN_ERASE_US_PER_KB                   = 21250;
+const quint32    DEFAULT_CONFIG_DRY_RUN_PROGRAM_US_PER_KB                 = 10500;
+const quint8     DEFAULT_CONFIG_VERIFY_PIPELINE_DEPTH                     = 1;
 
 /******************************************************************************/
 // Class definitions
@@ -178,9 +287,50 @@ public:
     ErasePersistentConfig(
         bool bEraseFile
         );
+    qint16
+    SetConfigOptionFromString(
+        CONFIG_TYPES cnfType,
+        QString strValue
+        );
+    static
+    bool
+    ConfigTypeFromName(
+        QString strName,
+        CONFIG_TYPES *pType
+        );
+    qint16
+    SetPortConfigOption(
+        QString strPort,
+        CONFIG_TYPES cnfType,
+        QVariant varValue
+        );
+    void
+    ClearPortConfigOption(
+        QString strPort,
+        CONFIG_TYPES cnfType
+        );
+    void
+    ClearPortConfigOptions(
+        QString strPort
+        );
+    void
+    CopyPortConfigOptions(
+        LrdSettings *pSource
+        );
+    QSharedPointer<const SessionConfigStruct>
+    CreateSessionConfig(
+        QString strPort
+        );
 
 private:
+    QVariant
+    GetPortConfigOption(
+        QString strPort,
+        CONFIG_TYPES cnfType
+        );
+
     QMap<qint16, QVariant> mapSettings; //Settings array object
+    QMap<QString, QMap<qint16, QVariant>> mapPortSettings; //Settings which override mapSettings for a single port
     QSettings *pSettings = NULL; //Handle to settings
 };
 
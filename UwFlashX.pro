@@ -11,7 +11,7 @@
 
 DEFINES += APP_NAME='\\"UwFlashX\\"'
 
-QT       += core serialport
+QT       += core serialport concurrent
 
 !contains(DEFINES, SKIPGUI) {
 QT       += gui
@@ -37,32 +37,27 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+#Firmware update core, shared with the library targets
+include(UwFlashXCore.pri)
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-        LrdFwUpd.cpp \
-        LrdFwUART.cpp \
-        LrdSettings.cpp \
-        LrdFwUwf.cpp \
-        LrdErr.cpp \
-        LrdFwBlEnter.cpp \
-        LrdPopup.cpp
+        LrdPopup.cpp \
+        LrdFwDaemon.cpp
 
 HEADERS += \
         mainwindow.h \
-        LrdFwUpd.h \
-        LrdFwUART.h \
-        LrdFwCommon.h \
-        LrdSettings.h \
-        LrdFwUwf.h \
-        LrdErr.h \
-        LrdFwBlEnter.h \
-        LrdPopup.h
+        LrdPopup.h \
+        LrdFwDaemon.h
 
 FORMS += \
         mainwindow.ui \
         LrdPopup.ui
 
+#Daemon mode uses local sockets from the network library
+QT += network
+
 #Application update files and network library
 !contains(DEFINES, SKIPUPDATECHECK) {
     QT      += network
@@ -74,27 +69,6 @@ FORMS += \
         LrdAppUpd.h
 }
 
-#FTDI-based bootloader entrance options
-!contains(DEFINES, SKIPFTDI) {
-    #Linux libraries
-    unix:!macx: LIBS += -lusb-1.0
-    unix:!macx: LIBS += -lftdi1
-
-    #Windows libraries
-    !contains(QMAKESPEC, g++) {
-        #MSVC build for windows
-        contains(QT_ARCH, i386) {
-            #32-bit windows
-            win32: LIBS += -L$$PWD/FTDI/Win32/ -lftd2xx
-        } else {
-            #64-bit windows
-            win32: LIBS += -L$$PWD/FTDI/Win64/ -lftd2xx
-        }
-
-        HEADERS  += FTDI/ftd2xx.h
-    }
-}
-
 #Windows application version information
 win32:RC_FILE = version.rc
 
@@ -0,0 +1,441 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  UwFlashXApi.cpp
+**
+** Notes:   All session objects live in the thread of the Qt application
+**          object, calls from other threads are marshalled to it
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "UwFlashXApi.h"
+#include "LrdFwSession.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+struct UwFlashXSession
+{
+    LrdFwSession *pSession;              //Session object, owned by the library thread
+    QMutex mtxState;                     //Protects the members below
+    QWaitCondition wcFinished;           //Signalled when an update finishes
+    bool bFinished;                      //True when the last update has finished
+    int32_t nErrorCode;                  //Result of the last update
+    UwFlashXProgressCallback fnProgress; //User progress callback
+    UwFlashXLogCallback fnLog;           //User log callback
+    UwFlashXFinishedCallback fnFinished; //User finished callback
+    void *pUserData;                     //User data passed to callbacks
+};
+
+/******************************************************************************/
+// Local Variables
+/******************************************************************************/
+static std::mutex mtxLibrary;                       //Protects library initialisation
+static uint32_t nLibraryUsers = 0;                  //Number of UwFlashX_Init() calls outstanding
+static std::thread *pLibraryThread = NULL;          //Internal thread, only used if the host has no Qt application
+static QCoreApplication *pLibraryApplication = NULL; //Application object created by the library
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+
+//=============================================================================
+// Runs a function in the thread that owns the Qt application object and waits
+// for it to complete
+//=============================================================================
+static
+void
+RunInLibraryThread(
+    std::function<void()> fnTask
+    )
+{
+    if (QThread::currentThread() == QCoreApplication::instance()->thread())
+    {
+        //Already in the correct thread
+        fnTask();
+    }
+    else
+    {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), fnTask, Qt::BlockingQueuedConnection);
+    }
+}
+
+//=============================================================================
+// Initialises the library
+//=============================================================================
+int32_t
+UwFlashX_Init(
+    void
+    )
+{
+    std::lock_guard<std::mutex> lckLibrary(mtxLibrary);
+    if (nLibraryUsers > 0)
+    {
+        //Already initialised
+        ++nLibraryUsers;
+        return EXIT_CODE_SUCCESS;
+    }
+
+    if (QCoreApplication::instance() == nullptr)
+    {
+        //Host is not a Qt application, run one on an internal thread for the sessions to use
+        std::promise<void> prmStarted;
+        std::future<void> futStarted = prmStarted.get_future();
+        pLibraryThread = new std::thread([&prmStarted]()
+        {
+            static int nArgc = 1;
+            static char strName[] = APP_NAME;
+            static char *pArgv[] = {strName, nullptr};
+            QCoreApplication appLibrary(nArgc, pArgv);
+            pLibraryApplication = &appLibrary;
+            prmStarted.set_value();
+            appLibrary.exec();
+            pLibraryApplication = NULL;
+        });
+        MallocFailCheck(pLibraryThread);
+        futStarted.wait();
+    }
+
+    ++nLibraryUsers;
+    return EXIT_CODE_SUCCESS;
+}
+
+//=============================================================================
+// Releases the library
+//=============================================================================
+void
+UwFlashX_Shutdown(
+    void
+    )
+{
+    std::lock_guard<std::mutex> lckLibrary(mtxLibrary);
+    if (nLibraryUsers == 0 || --nLibraryUsers > 0)
+    {
+        //Not initialised or still in use
+        return;
+    }
+
+    if (pLibraryThread != NULL)
+    {
+        //Stop the internal application
+        QMetaObject::invokeMethod(pLibraryApplication, []() { QCoreApplication::quit(); }, Qt::QueuedConnection);
+        pLibraryThread->join();
+        delete pLibraryThread;
+        pLibraryThread = NULL;
+    }
+}
+
+//=============================================================================
+// Returns the library version
+//=============================================================================
+const char *
+UwFlashX_Version(
+    void
+    )
+{
+    return APP_VERSION;
+}
+
+//=============================================================================
+// Returns the description of an error code
+//=============================================================================
+const char *
+UwFlashX_ErrorString(
+    int32_t nErrorCode
+    )
+{
+    static thread_local QByteArray baErrorString;
+    LrdErr errHandler;
+    baErrorString = errHandler.ErrorCodeToString(nErrorCode, false).toUtf8();
+    return baErrorString.constData();
+}
+
+//=============================================================================
+// Creates a session
+//=============================================================================
+UwFlashXSession *
+UwFlashX_SessionCreate(
+    void
+    )
+{
+    if (nLibraryUsers == 0 || QCoreApplication::instance() == nullptr)
+    {
+        //Library not initialised
+        return NULL;
+    }
+
+    UwFlashXSession *pSession = new UwFlashXSession();
+    MallocFailCheck(pSession);
+    pSession->pSession = NULL;
+    pSession->bFinished = true;
+    pSession->nErrorCode = EXIT_CODE_SUCCESS;
+    pSession->fnProgress = NULL;
+    pSession->fnLog = NULL;
+    pSession->fnFinished = NULL;
+    pSession->pUserData = NULL;
+
+    RunInLibraryThread([pSession]()
+    {
+        pSession->pSession = new LrdFwSession();
+        MallocFailCheck(pSession->pSession);
+
+        //Forward session signals to the user callbacks
+        QObject::connect(pSession->pSession, &LrdFwSession::Progress, pSession->pSession, [pSession](int8_t nCurrentTaskPercent, int8_t nOverallPercent)
+        {
+            pSession->mtxState.lock();
+            UwFlashXProgressCallback fnProgress = pSession->fnProgress;
+            void *pUserData = pSession->pUserData;
+            pSession->mtxState.unlock();
+            if (fnProgress != NULL)
+            {
+                fnProgress(pSession, nCurrentTaskPercent, nOverallPercent, pUserData);
+            }
+        });
+        QObject::connect(pSession->pSession, &LrdFwSession::Log, pSession->pSession, [pSession](QString strMessage)
+        {
+            pSession->mtxState.lock();
+            UwFlashXLogCallback fnLog = pSession->fnLog;
+            void *pUserData = pSession->pUserData;
+            pSession->mtxState.unlock();
+            if (fnLog != NULL)
+            {
+                fnLog(pSession, strMessage.toUtf8().constData(), pUserData);
+            }
+        });
+        QObject::connect(pSession->pSession, &LrdFwSession::Completed, pSession->pSession, [pSession](bool bSuccessful, int32_t nErrorCode, qint64 nUpgradeTimeMS)
+        {
+            pSession->mtxState.lock();
+            pSession->bFinished = true;
+            pSession->nErrorCode = nErrorCode;
+            UwFlashXFinishedCallback fnFinished = pSession->fnFinished;
+            void *pUserData = pSession->pUserData;
+            pSession->wcFinished.wakeAll();
+            pSession->mtxState.unlock();
+            if (fnFinished != NULL)
+            {
+                fnFinished(pSession, (bSuccessful == true ? 1 : 0), nErrorCode, nUpgradeTimeMS, pUserData);
+            }
+        });
+    });
+
+    return pSession;
+}
+
+//=============================================================================
+// Destroys a session
+//=============================================================================
+void
+UwFlashX_SessionDestroy(
+    UwFlashXSession *pSession
+    )
+{
+    if (pSession == NULL)
+    {
+        return;
+    }
+
+    RunInLibraryThread([pSession]()
+    {
+        delete pSession->pSession;
+        pSession->pSession = NULL;
+    });
+    delete pSession;
+}
+
+//=============================================================================
+// Sets a session option by name
+//=============================================================================
+int32_t
+UwFlashX_SessionSetOption(
+    UwFlashXSession *pSession,
+    const char *pName,
+    const char *pValue
+    )
+{
+    CONFIG_TYPES cnfType;
+    if (pSession == NULL || pName == NULL || pValue == NULL || LrdSettings::ConfigTypeFromName(QString::fromUtf8(pName), &cnfType) == false)
+    {
+        //Unknown setting
+        return EXIT_CODE_INVALID_SETTINGS_NAME;
+    }
+    else if (cnfType == BOOTLOADER_ENTRANCE_WARNINGS_DISABLED || cnfType == BOOTLOADER_ENTRANCE_ERRORS_DISABLED)
+    {
+        //There is no user to answer bootloader entrance prompts in a library host, so these always stay disabled
+        return EXIT_CODE_INVALID_SETTINGS_NAME;
+    }
+
+    int32_t nResult = EXIT_CODE_SUCCESS;
+    RunInLibraryThread([pSession, cnfType, pValue, &nResult]()
+    {
+        if (pSession->pSession->IsActive())
+        {
+            //Settings cannot be changed whilst an update is running
+            nResult = EXIT_CODE_SESSION_ALREADY_ACTIVE;
+            return;
+        }
+        nResult = pSession->pSession->Settings()->SetConfigOptionFromString(cnfType, QString::fromUtf8(pValue));
+    });
+
+    return nResult;
+}
+
+//=============================================================================
+// Sets the session callbacks
+//=============================================================================
+void
+UwFlashX_SessionSetCallbacks(
+    UwFlashXSession *pSession,
+    UwFlashXProgressCallback fnProgress,
+    UwFlashXLogCallback fnLog,
+    UwFlashXFinishedCallback fnFinished,
+    void *pUserData
+    )
+{
+    if (pSession == NULL)
+    {
+        return;
+    }
+
+    QMutexLocker lckState(&pSession->mtxState);
+    pSession->fnProgress = fnProgress;
+    pSession->fnLog = fnLog;
+    pSession->fnFinished = fnFinished;
+    pSession->pUserData = pUserData;
+}
+
+//=============================================================================
+// Starts an update
+//=============================================================================
+int32_t
+UwFlashX_SessionStart(
+    UwFlashXSession *pSession
+    )
+{
+    if (pSession == NULL)
+    {
+        return EXIT_CODE_LIBRARY_NOT_INITIALISED;
+    }
+
+    pSession->mtxState.lock();
+    if (pSession->bFinished == false)
+    {
+        //Previous update still running
+        pSession->mtxState.unlock();
+        return EXIT_CODE_SESSION_ALREADY_ACTIVE;
+    }
+    pSession->bFinished = false;
+    pSession->nErrorCode = EXIT_CODE_SUCCESS;
+    pSession->mtxState.unlock();
+
+    int32_t nResult = EXIT_CODE_SUCCESS;
+    RunInLibraryThread([pSession, &nResult]()
+    {
+        if (pSession->pSession->Start() == false)
+        {
+            //Completion has already been reported
+            nResult = pSession->pSession->GetLastErrorCode();
+        }
+    });
+
+    return nResult;
+}
+
+//=============================================================================
+// Waits for an update to finish
+//=============================================================================
+int
+UwFlashX_SessionWait(
+    UwFlashXSession *pSession,
+    int32_t nTimeoutMS,
+    int32_t *pErrorCode
+    )
+{
+    if (pSession == NULL)
+    {
+        return 0;
+    }
+
+    QDeadlineTimer dtTimeout = (nTimeoutMS == UWFLASHX_WAIT_FOREVER ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(nTimeoutMS));
+    QMutexLocker lckState(&pSession->mtxState);
+    if (QThread::currentThread() == QCoreApplication::instance()->thread())
+    {
+        //Called from the thread which runs the session, events must be processed for it to progress
+        while (pSession->bFinished == false && !dtTimeout.hasExpired())
+        {
+            lckState.unlock();
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            lckState.relock();
+        }
+    }
+    else
+    {
+        while (pSession->bFinished == false)
+        {
+            if (pSession->wcFinished.wait(&pSession->mtxState, dtTimeout) == false)
+            {
+                //Timed out
+                break;
+            }
+        }
+    }
+
+    if (pSession->bFinished == false)
+    {
+        return 0;
+    }
+
+    if (pErrorCode != NULL)
+    {
+        *pErrorCode = pSession->nErrorCode;
+    }
+
+    return 1;
+}
+
+//=============================================================================
+// Returns 1 if an update is in progress
+//=============================================================================
+int
+UwFlashX_SessionIsActive(
+    UwFlashXSession *pSession
+    )
+{
+    if (pSession == NULL)
+    {
+        return 0;
+    }
+
+    QMutexLocker lckState(&pSession->mtxState);
+    return (pSession->bFinished == true ? 0 : 1);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,108 @@
+/******************************************************************************
+** Copyright (C) 2020 Laird Connectivity
+**
+** Project: UwFlashX
+**
+** Module:  UwFlashXApi.h
+**
+** Notes:   C interface to the UwFlashX firmware update library, allows
+**          applications to run update sessions in-process. Callbacks are
+**          raised from the library thread.
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef UWFLASHXAPI_H
+#define UWFLASHXAPI_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <stdint.h>
+
+/******************************************************************************/
+// Defines
+/******************************************************************************/
+#if defined(_WIN32) && !defined(UWFLASHX_STATIC)
+#if defined(UWFLASHX_LIBRARY)
+#define UWFLASHX_API __declspec(dllexport)
+#else
+#define UWFLASHX_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define UWFLASHX_API __attribute__((visibility("default")))
+#else
+#define UWFLASHX_API
+#endif
+
+//Wait forever when passed to UwFlashX_SessionWait()
+#define UWFLASHX_WAIT_FOREVER -1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+// Type definitons
+/******************************************************************************/
+typedef struct UwFlashXSession UwFlashXSession;
+
+typedef void (*UwFlashXProgressCallback)(UwFlashXSession *pSession, int8_t nCurrentTaskPercent, int8_t nOverallPercent, void *pUserData);
+typedef void (*UwFlashXLogCallback)(UwFlashXSession *pSession, const char *pMessage, void *pUserData);
+typedef void (*UwFlashXFinishedCallback)(UwFlashXSession *pSession, int bSuccessful, int32_t nErrorCode, int64_t nUpgradeTimeMS, void *pUserData);
+
+/******************************************************************************/
+// Functions
+/******************************************************************************/
+//Initialises the library, if the host has no Qt application object then one is created and run on an internal thread. Returns 0 on success
+UWFLASHX_API int32_t UwFlashX_Init(void);
+
+//Releases the library, must be called once for each successful UwFlashX_Init() call after all sessions have been destroyed
+UWFLASHX_API void UwFlashX_Shutdown(void);
+
+//Returns the library version string
+UWFLASHX_API const char *UwFlashX_Version(void);
+
+//Returns the description of an error code, valid until the next call from the same thread
+UWFLASHX_API const char *UwFlashX_ErrorString(int32_t nErrorCode);
+
+//Creates a session with default settings, returns NULL if the library is not initialised
+UWFLASHX_API UwFlashXSession *UwFlashX_SessionCreate(void);
+
+//Destroys a session, an update in progress is aborted
+UWFLASHX_API void UwFlashX_SessionDestroy(UwFlashXSession *pSession);
+
+//Sets an option by setting name (e.g. "OUTPUT_DEVICE", "FIRMWARE_FILE", "BOOTLOADER_BAUD", "VERIFY_DATA"), values are converted to the setting type. The bootloader entrance dialog settings cannot be changed as there is no user to answer them. Returns 0 on success
+UWFLASHX_API int32_t UwFlashX_SessionSetOption(UwFlashXSession *pSession, const char *pName, const char *pValue);
+
+//Sets the callbacks for a session, any can be NULL
+UWFLASHX_API void UwFlashX_SessionSetCallbacks(UwFlashXSession *pSession, UwFlashXProgressCallback fnProgress, UwFlashXLogCallback fnLog, UwFlashXFinishedCallback fnFinished, void *pUserData);
+
+//Starts an update, returns 0 if it started. The finished callback is raised on completion, including when it fails to start
+UWFLASHX_API int32_t UwFlashX_SessionStart(UwFlashXSession *pSession);
+
+//Waits for an update to finish, returns 1 if finished (with the result in pErrorCode if not NULL) or 0 on timeout
+UWFLASHX_API int UwFlashX_SessionWait(UwFlashXSession *pSession, int32_t nTimeoutMS, int32_t *pErrorCode);
+
+//Returns 1 if an update is in progress
+UWFLASHX_API int UwFlashX_SessionIsActive(UwFlashXSession *pSession);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UWFLASHXAPI_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,30 @@
+#UwFlashX update engine benchmark qmake file, builds a console application
+#which times the per packet code paths of the update core and writes the
+#results as CSV. Usage: UwFlashXBenchmark <results CSV file>
+
+#Uncomment to exclude FTDI-specific bootloader entrance methods
+#DEFINES += "SKIPFTDI"
+
+DEFINES += APP_NAME='\\"UwFlashX\\"'
+
+QT       += core
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = UwFlashXBenchmark
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+#Gives the benchmark access to the update core internals, this is never set for the application or library
+DEFINES += UWFLASHX_BENCHMARK
+
+#Firmware update core
+include(UwFlashXCore.pri)
+
+SOURCES += \
+        LrdFwBenchmark.cpp \
+        LrdFwBenchmarkMain.cpp
+
+HEADERS += \
+        LrdFwBenchmark.h
@@ -0,0 +1,71 @@
+#UwFlashX firmware update core qmake include, used by the application and
+#library targets
+
+#The core has no widgets, bootloader entrance prompts are shown by whatever
+#is connected to LrdFwUpd::BootloaderEntrancePrompt()
+QT       += core serialport concurrent network
+
+SOURCES += \
+        $$PWD/LrdFwUpd.cpp \
+        $$PWD/LrdFwUART.cpp \
+        $$PWD/LrdSettings.cpp \
+        $$PWD/LrdFwUwf.cpp \
+        $$PWD/LrdErr.cpp \
+        $$PWD/LrdFwBlEnter.cpp \
+        $$PWD/LrdFwSession.cpp \
+        $$PWD/LrdFwImageCache.cpp \
+        $$PWD/LrdFwFixture.cpp \
+        $$PWD/LrdFwStation.cpp \
+        $$PWD/LrdFwTransportSerial.cpp \
+        $$PWD/LrdFwTransportNetwork.cpp \
+        $$PWD/LrdFwTrace.cpp \
+        $$PWD/LrdFwTransportReplay.cpp \
+        $$PWD/LrdFwLinkHealth.cpp \
+        $$PWD/LrdFwMetrics.cpp
+
+HEADERS += \
+        $$PWD/LrdFwUpd.h \
+        $$PWD/LrdFwUART.h \
+        $$PWD/LrdFwCommon.h \
+        $$PWD/LrdSettings.h \
+        $$PWD/LrdFwUwf.h \
+        $$PWD/LrdErr.h \
+        $$PWD/LrdFwBlEnter.h \
+        $$PWD/LrdFwSession.h \
+        $$PWD/LrdFwImageCache.h \
+        $$PWD/LrdFwFixture.h \
+        $$PWD/LrdFwStation.h \
+        $$PWD/LrdFwTransport.h \
+        $$PWD/LrdFwTransportSerial.h \
+        $$PWD/LrdFwTransportNetwork.h \
+        $$PWD/LrdFwTrace.h \
+        $$PWD/LrdFwTransportReplay.h \
+        $$PWD/LrdFwLinkHealth.h \
+        $$PWD/LrdFwMetrics.h
+
+#Native serial backend (Linux only)
+unix:!macx {
+    SOURCES += $$PWD/LrdFwTransportTermios.cpp
+    HEADERS += $$PWD/LrdFwTransportTermios.h
+}
+
+#FTDI-based bootloader entrance options
+!contains(DEFINES, SKIPFTDI) {
+    #Linux libraries
+    unix:!macx: LIBS += -lusb-1.0
+    unix:!macx: LIBS += -lftdi1
+
+    #Windows libraries
+    !contains(QMAKESPEC, g++) {
+        #MSVC build for windows
+        contains(QT_ARCH, i386) {
+            #32-bit windows
+            win32: LIBS += -L$$PWD/FTDI/Win32/ -lftd2xx
+        } else {
+            #64-bit windows
+            win32: LIBS += -L$$PWD/FTDI/Win64/ -lftd2xx
+        }
+
+        HEADERS  += $$PWD/FTDI/ftd2xx.h
+    }
+}
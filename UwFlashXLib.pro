@@ -0,0 +1,32 @@
+#UwFlashX firmware update library qmake file, builds the update core with a C
+#API (UwFlashXApi.h) for in-process use by other applications
+
+#Uncomment to have extra malloc failure debugging
+#DEFINES += MALLOC_DEBUGGING
+#Uncomment to exclude FTDI-specific bootloader entrance methods
+#DEFINES += "SKIPFTDI"
+
+DEFINES += APP_NAME='\\"UwFlashX\\"'
+DEFINES += UWFLASHX_LIBRARY
+
+#LrdFwCommon.h includes the network module headers
+QT       += core network
+
+TARGET = UwFlashX
+TEMPLATE = lib
+CONFIG += shared
+VERSION = 1.0.2
+
+#Only the C API is exported from the shared library
+CONFIG += hide_symbols
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+#Firmware update core
+include(UwFlashXCore.pri)
+
+SOURCES += \
+        UwFlashXApi.cpp
+
+HEADERS += \
+        UwFlashXApi.h
@@ -0,0 +1,10 @@
+#UwFlashX firmware update static library qmake file, applications linking
+#against it must define UWFLASHX_STATIC and link the same Qt modules and
+#FTDI libraries
+
+include(UwFlashXLib.pro)
+
+TARGET = UwFlashXStatic
+CONFIG -= shared
+CONFIG += staticlib
+DEFINES += UWFLASHX_STATIC
@@ -29,7 +29,9 @@
 // Include Files
 /******************************************************************************/
 #include "mainwindow.h"
+#include "LrdFwDaemon.h"
 #include <QApplication>
+#include <QCoreApplication>
 
 //=============================================================================
 //=============================================================================
@@ -39,6 +41,26 @@ main(
     char *argv[]
     )
 {
+    //Check if running as a daemon, which has no GUI and accepts jobs over a local socket
+    int i = 1;
+    while (i < argc)
+    {
+        QString strArg = QString::fromLocal8Bit(argv[i]);
+        if (strArg.length() > (strOptionDaemon.length() + strOptionSeperateCharacter.length()) && strArg.left(strOptionDaemon.length()).toUpper() == strOptionDaemon && strArg.mid(strOptionDaemon.length(), strOptionSeperateCharacter.length()) == strOptionSeperateCharacter)
+        {
+            QCoreApplication a(argc, argv);
+            LrdFwDaemon dmnServer;
+            if (dmnServer.Listen(strArg.mid(strOptionDaemon.length() + strOptionSeperateCharacter.length())) == false)
+            {
+                //Socket could not be created
+                return EXIT_CODE_DAEMON_LISTEN_FAILED;
+            }
+
+            return a.exec();
+        }
+        ++i;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -29,6 +29,7 @@
 #include <QComboBox>
 #include <QString>
 #include <QDesktopServices>
+#include <QMessageBox>
 
 /******************************************************************************/
 // Local Functions or Private Members
@@ -60,6 +61,14 @@ MainWindow::MainWindow(
     MallocFailCheck(pFwUpd);
     pFwUpd->SetSettingsObject(pSettingsHandle);
 
+    //Create fixture loop object, only used in fixture mode
+    pFixture = new LrdFwFixture(pFwUpd, pSettingsHandle);
+    MallocFailCheck(pFixture);
+
+    //Create station object, only used in station mode
+    pStation = new LrdFwStation(pSettingsHandle);
+    MallocFailCheck(pStation);
+
     //Initialise popup message
     gpmErrorForm = new LrdPopupMessage(this);
     MallocFailCheck(gpmErrorForm);
@@ -73,6 +82,9 @@ MainWindow::MainWindow(
 #ifdef __linux__
     connect(pFwUpd, SIGNAL(SerialPortNameChanged(QString*)), this, SLOT(SerialPortNameChanged(QString*)));
 #endif
+    connect(pFwUpd, SIGNAL(BootloaderEntrancePrompt(uint8_t,QString,QString,bool*)), this, SLOT(BootloaderEntrancePrompt(uint8_t,QString,QString,bool*)), Qt::DirectConnection);
+    connect(pFixture, SIGNAL(Status(QString)), this, SLOT(ModeStatus(QString)));
+    connect(pStation, SIGNAL(Status(QString)), this, SLOT(ModeStatus(QString)));
 
     //Create error object
     pErrHandler = new LrdErr();
@@ -226,6 +238,244 @@ MainWindow::MainWindow(
             ui->check_Bootloader_Enter_Warning_Disable->setChecked(true);
             ui->check_Bootloader_Enter_Error_Disable->setChecked(true);
         }
+        else if (slArgs[chi].length() > (strOptionProbe.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionProbe.length()).toUpper() == strOptionProbe &&
+                 slArgs[chi].mid(strOptionProbe.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Probe if module is already in bootloader mode before entering it
+            pSettingsHandle->SetConfigOption(BOOTLOADER_PROBE_FIRST, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionManifest.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionManifest.length()).toUpper() == strOptionManifest &&
+                 slArgs[chi].mid(strOptionManifest.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Multi-image job manifest, written in a single bootloader session
+            pSettingsHandle->SetConfigOption(FIRMWARE_MANIFEST, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionSkipErased.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionSkipErased.length()).toUpper() == strOptionSkipErased &&
+                 slArgs[chi].mid(strOptionSkipErased.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Skip writing chunks which only contain erased data to freshly erased flash
+            pSettingsHandle->SetConfigOption(SKIP_ERASED_CHUNKS, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionPageSize.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionPageSize.length()).toUpper() == strOptionPageSize &&
+                 slArgs[chi].mid(strOptionPageSize.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Flash page size that write commands are aligned to (0 to use the sector map, decimal or 0x prefixed hex)
+            pSettingsHandle->SetConfigOption(WRITE_PAGE_SIZE, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt(nullptr, 0));
+        }
+        else if (slArgs[chi].length() > (strOptionAlignWrites.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionAlignWrites.length()).toUpper() == strOptionAlignWrites &&
+                 slArgs[chi].mid(strOptionAlignWrites.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Align write commands to flash page boundaries
+            pSettingsHandle->SetConfigOption(ALIGN_WRITES, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionVerifyStrategy.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionVerifyStrategy.length()).toUpper() == strOptionVerifyStrategy &&
+                 slArgs[chi].mid(strOptionVerifyStrategy.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Verification strategy (0 = interleaved with writes, 1 = deferred until all writes are complete)
+            pSettingsHandle->SetConfigOption(VERIFY_STRATEGY, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionReadback.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionReadback.length()).toUpper() == strOptionReadback &&
+                 slArgs[chi].mid(strOptionReadback.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Read flash back from the module into this file instead of upgrading it
+            pSettingsHandle->SetConfigOption(READBACK_FILE, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionReadbackRange.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionReadbackRange.length()).toUpper() == strOptionReadbackRange &&
+                 slArgs[chi].mid(strOptionReadbackRange.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Address range to read back (start:size or start-end), defaults to the write ranges of the upgrade file
+            pSettingsHandle->SetConfigOption(READBACK_RANGE, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionReadbackCompare.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionReadbackCompare.length()).toUpper() == strOptionReadbackCompare &&
+                 slArgs[chi].mid(strOptionReadbackCompare.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Compare data read back with the upgrade file
+            pSettingsHandle->SetConfigOption(READBACK_COMPARE, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionFixture.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionFixture.length()).toUpper() == strOptionFixture &&
+                 slArgs[chi].mid(strOptionFixture.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Fixture loop mode, after an update the next module placed on the same port is updated automatically
+            pSettingsHandle->SetConfigOption(FIXTURE_MODE, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionFixtureDetect.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionFixtureDetect.length()).toUpper() == strOptionFixtureDetect &&
+                 slArgs[chi].mid(strOptionFixtureDetect.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Fixture module detection method: 0 = CTS, 1 = DSR, 2 = poll with version request
+            pSettingsHandle->SetConfigOption(FIXTURE_DETECT, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionFixtureSettle.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionFixtureSettle.length()).toUpper() == strOptionFixtureSettle &&
+                 slArgs[chi].mid(strOptionFixtureSettle.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Time in ms that a module must be present or absent for before it is treated as placed or removed
+            pSettingsHandle->SetConfigOption(FIXTURE_SETTLE_MS, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionStation.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionStation.length()).toUpper() == strOptionStation &&
+                 slArgs[chi].mid(strOptionStation.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Station mode, USB serial devices which are plugged in and match the station filters are updated automatically
+            pSettingsHandle->SetConfigOption(STATION_MODE, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionStationMatch.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionStationMatch.length()).toUpper() == strOptionStationMatch &&
+                 slArgs[chi].mid(strOptionStationMatch.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //USB VID:PID (hexadecimal) pairs of devices to update in station mode, comma separated
+            pSettingsHandle->SetConfigOption(STATION_MATCH, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionStationSerial.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionStationSerial.length()).toUpper() == strOptionStationSerial &&
+                 slArgs[chi].mid(strOptionStationSerial.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Regular expression which USB serial numbers must match to be updated in station mode
+            pSettingsHandle->SetConfigOption(STATION_SERIAL, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionFtdiLatency.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionFtdiLatency.length()).toUpper() == strOptionFtdiLatency &&
+                 slArgs[chi].mid(strOptionFtdiLatency.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //FTDI latency timer (ms) to use for the update, 0 to leave unchanged
+            pSettingsHandle->SetConfigOption(FTDI_LATENCY_TIMER, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionNativeSerial.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionNativeSerial.length()).toUpper() == strOptionNativeSerial &&
+                 slArgs[chi].mid(strOptionNativeSerial.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Use the native (termios) serial backend on Linux
+            pSettingsHandle->SetConfigOption(NATIVE_SERIAL, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionTraceFile.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionTraceFile.length()).toUpper() == strOptionTraceFile &&
+                 slArgs[chi].mid(strOptionTraceFile.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Write a timeline of the session to a trace file
+            pSettingsHandle->SetConfigOption(TRACE_FILE, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionCaptureFile.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionCaptureFile.length()).toUpper() == strOptionCaptureFile &&
+                 slArgs[chi].mid(strOptionCaptureFile.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Record all serial traffic of the session to a capture file
+            pSettingsHandle->SetConfigOption(CAPTURE_FILE, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionReplayDelay.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionReplayDelay.length()).toUpper() == strOptionReplayDelay &&
+                 slArgs[chi].mid(strOptionReplayDelay.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Percentage of the captured response delays to use when replaying a capture (0 for no delays)
+            pSettingsHandle->SetConfigOption(REPLAY_DELAY_PERCENT, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionLinkHealth.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionLinkHealth.length()).toUpper() == strOptionLinkHealth &&
+                 slArgs[chi].mid(strOptionLinkHealth.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Scores each session and warns when the link of the port degrades from its baseline
+            pSettingsHandle->SetConfigOption(LINK_HEALTH, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionMetricsFile.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionMetricsFile.length()).toUpper() == strOptionMetricsFile &&
+                 slArgs[chi].mid(strOptionMetricsFile.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Prometheus text file to write update metrics to (e.g. for the node exporter textfile collector)
+            pSettingsHandle->SetConfigOption(METRICS_FILE, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionMetricsPort.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionMetricsPort.length()).toUpper() == strOptionMetricsPort &&
+                 slArgs[chi].mid(strOptionMetricsPort.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //TCP port to serve update metrics on at /metrics (0 to disable)
+            pSettingsHandle->SetConfigOption(METRICS_PORT, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionDryRun.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRun.length()).toUpper() == strOptionDryRun &&
+                 slArgs[chi].mid(strOptionDryRun.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Estimate the update time and commands without opening the port
+            pSettingsHandle->SetConfigOption(DRY_RUN, (slArgs[chi][slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()] == '0' ? false : true));
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunWriteSize.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunWriteSize.length()).toUpper() == strOptionDryRunWriteSize &&
+                 slArgs[chi].mid(strOptionDryRunWriteSize.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Write size for the dry run estimate (0 for the bootloader default)
+            pSettingsHandle->SetConfigOption(DRY_RUN_WRITE_SIZE, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunChecksum.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunChecksum.length()).toUpper() == strOptionDryRunChecksum &&
+                 slArgs[chi].mid(strOptionDryRunChecksum.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Write checksum width in bytes (1, 2 or 4) for the dry run estimate
+            pSettingsHandle->SetConfigOption(DRY_RUN_CHECKSUM_LENGTH, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunEraseSizes.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunEraseSizes.length()).toUpper() == strOptionDryRunEraseSizes &&
+                 slArgs[chi].mid(strOptionDryRunEraseSizes.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Comma separated erase sizes per command for the dry run estimate (empty for the classic one sector erase command)
+            pSettingsHandle->SetConfigOption(DRY_RUN_ERASE_SIZES, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunRoundTrip.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunRoundTrip.length()).toUpper() == strOptionDryRunRoundTrip &&
+                 slArgs[chi].mid(strOptionDryRunRoundTrip.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Command round trip latency in microseconds for the dry run estimate
+            pSettingsHandle->SetConfigOption(DRY_RUN_ROUND_TRIP_US, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionMaxUwfSize.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionMaxUwfSize.length()).toUpper() == strOptionMaxUwfSize &&
+                 slArgs[chi].mid(strOptionMaxUwfSize.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Maximum size of an upgrade file in MB, larger files are rejected
+            pSettingsHandle->SetConfigOption(UWF_MAX_SIZE_MB, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionMetricsAddress.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionMetricsAddress.length()).toUpper() == strOptionMetricsAddress &&
+                 slArgs[chi].mid(strOptionMetricsAddress.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Address to serve update metrics on (defaults to localhost only)
+            pSettingsHandle->SetConfigOption(METRICS_ADDRESS, slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()));
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunBitsPerByte.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunBitsPerByte.length()).toUpper() == strOptionDryRunBitsPerByte &&
+                 slArgs[chi].mid(strOptionDryRunBitsPerByte.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Bits sent on the link for each byte (including start, parity and stop bits) for the dry run estimate
+            pSettingsHandle->SetConfigOption(DRY_RUN_BITS_PER_BYTE, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunEraseTime.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunEraseTime.length()).toUpper() == strOptionDryRunEraseTime &&
+                 slArgs[chi].mid(strOptionDryRunEraseTime.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Flash erase time in microseconds per KB of the target for the dry run estimate
+            pSettingsHandle->SetConfigOption(DRY_RUN_ERASE_US_PER_KB, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionDryRunProgramTime.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionDryRunProgramTime.length()).toUpper() == strOptionDryRunProgramTime &&
+                 slArgs[chi].mid(strOptionDryRunProgramTime.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Flash program time in microseconds per KB of the target for the dry run estimate
+            pSettingsHandle->SetConfigOption(DRY_RUN_PROGRAM_US_PER_KB, (quint32)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
+        else if (slArgs[chi].length() > (strOptionVerifyPipelineDepth.length() + strOptionSeperateCharacter.length()) &&
+                 slArgs[chi].left(strOptionVerifyPipelineDepth.length()).toUpper() == strOptionVerifyPipelineDepth &&
+                 slArgs[chi].mid(strOptionVerifyPipelineDepth.length(), strOptionSeperateCharacter.length()).toUpper() == strOptionSeperateCharacter)
+        {
+            //Number of deferred verify commands sent before waiting for a response (1 for bootloaders which handle one command at a time)
+            pSettingsHandle->SetConfigOption(VERIFY_PIPELINE_DEPTH, (quint8)slArgs[chi].mid(slArgs[chi].indexOf(strOptionSeperateCharacter)+strOptionSeperateCharacter.length()).toUInt());
+        }
         ++chi;
     }
 
@@ -258,8 +508,13 @@ MainWindow::~MainWindow(
 #ifdef __linux__
     disconnect(this, SLOT(SerialPortNameChanged(QString*)));
 #endif
+    disconnect(this, SLOT(BootloaderEntrancePrompt(uint8_t,QString,QString,bool*)));
 
-    //Delete objects
+    disconnect(this, SLOT(ModeStatus(QString)));
+
+    //Delete objects, the fixture object uses the update object
+    delete pStation;
+    delete pFixture;
     delete pFwUpd;
     delete pSettingsHandle;
     delete pErrHandler;
@@ -403,6 +658,18 @@ void
 MainWindow::on_btn_Go_clicked(
     )
 {
+    if (pFixture->IsRunning())
+    {
+        //Restart the fixture loop with the new settings
+        pFixture->Stop();
+    }
+
+    if (pStation->IsRunning())
+    {
+        //Stop station mode, it is restarted below with the new settings if still enabled
+        pStation->Stop();
+    }
+
     StartStopUpgrade(true);
     ui->statusBar->clearMessage();
 
@@ -433,8 +700,23 @@ MainWindow::on_btn_Go_clicked(
     //Change status text
     ui->label_UpgradeStatus->setText("Updating...");
 
-    //Send the command to enter the bootloader
-    if (pFwUpd->StartUpdate() == false)
+    if (pSettingsHandle->GetConfigOption(STATION_MODE).toBool() == true)
+    {
+        //Devices are updated in the background as they are plugged in, the settings can be changed and Go clicked again to restart it
+        ui->label_UpgradeStatus->setText(pStation->Start() == true ? "Station mode running." : "Station mode failed to start.");
+        StartStopUpgrade(false);
+    }
+    else if (pSettingsHandle->GetConfigOption(FIXTURE_MODE).toBool() == true)
+    {
+        //Update this module and then each module placed on the port afterwards
+        pFixture->Start();
+        if (!pFwUpd->IsUpdateInProgress())
+        {
+            //First module failed to start, the fixture loop carries on waiting
+            StartStopUpgrade(false);
+        }
+    }
+    else if (pFwUpd->StartUpdate() == false)
     {
         //Firmware update failed to start
         StartStopUpgrade(false);
@@ -523,7 +805,7 @@ MainWindow::StartStopUpgrade(
     }
     else
     {
-        if (bArgAutoexit == true && nErrorCode != EXIT_CODE_SUCCESS)
+        if (bArgAutoexit == true && nErrorCode != EXIT_CODE_SUCCESS && !pFixture->IsRunning())
         {
             //Exit application
             QApplication::exit(nErrorCode);
@@ -715,13 +997,25 @@ MainWindow::UpgradeFinished(
         ui->label_UpgradeStatus->setText(QString("Failed with error code ").append(QString::number(nErrorCode)).append(" (").append(pErrHandler->ErrorCodeToString(nErrorCode, false)).append(") after ").append(QString::number(nUpgradeTimeMS)).append("ms!"));
     }
 
-    if (bArgAutoexit == true)
+    if (bArgAutoexit == true && !pFixture->IsRunning())
     {
-        //Exit application
+        //Exit application, fixture mode keeps running until the application is closed
         QApplication::exit((bSuccess == true ? EXIT_CODE_SUCCESS : nErrorCode));
     }
 }
 
+//=============================================================================
+// Slot for fixture and station mode status messages
+//=============================================================================
+void
+MainWindow::ModeStatus(
+    QString strMessage
+    )
+{
+    ui->text_Log->appendPlainText(strMessage);
+    ui->statusBar->showMessage(strMessage);
+}
+
 //=============================================================================
 // When tab selection is changed
 //=============================================================================
@@ -1280,6 +1574,36 @@ MainWindow::SerialPortNameChanged(
 }
 #endif
 
+//=============================================================================
+// Shows the bootloader entrance confirmation and setup messages, the update
+// core has no GUI so these are passed up to be shown here
+//=============================================================================
+void
+MainWindow::BootloaderEntrancePrompt(
+    uint8_t nType,
+    QString strTitle,
+    QString strMessage,
+    bool *pbAccepted
+    )
+{
+    if (nType == ENTER_BOOTLOADER_PROMPT_QUESTION)
+    {
+        *pbAccepted = (QMessageBox::question(this, strTitle, strMessage, QMessageBox::Yes, QMessageBox::No) == QMessageBox::Yes);
+    }
+    else if (nType == ENTER_BOOTLOADER_PROMPT_WARNING)
+    {
+        *pbAccepted = (QMessageBox::warning(this, strTitle, strMessage, QMessageBox::Yes, QMessageBox::No) == QMessageBox::Yes);
+    }
+    else if (nType == ENTER_BOOTLOADER_PROMPT_ERROR)
+    {
+        QMessageBox::critical(this, strTitle, strMessage, QMessageBox::Ok);
+    }
+    else
+    {
+        QMessageBox::information(this, strTitle, strMessage, QMessageBox::Ok);
+    }
+}
+
 //=============================================================================
 // Open the help file if it exists, or browse to it online if not
 //=============================================================================
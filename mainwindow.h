@@ -41,12 +41,13 @@
 #endif
 #include "LrdFwBlEnter.h"
 #include "LrdPopup.h"
+#include "LrdFwFixture.h"
+#include "LrdFwStation.h"
 
 /******************************************************************************/
 // Defines
 /******************************************************************************/
 #define APP_NAME                                      "UwFlashX"            //Application name
-#define APP_VERSION                                   "1.02"                //Application version
 
 /******************************************************************************/
 // Constants
@@ -70,6 +71,41 @@ const QString strOptionUARTBREAK                    = "UARTBREAK";
 const QString strOptionDTS                          = "DTS";
 const QString strOptionEntrance                     = "ENTRANCE";
 const QString strOptionNoPrompts                    = "NOPROMPTS";
+const QString strOptionProbe                        = "PROBE";
+const QString strOptionManifest                     = "MANIFEST";
+const QString strOptionSkipErased                   = "SKIPERASED";
+const QString strOptionPageSize                     = "PAGESIZE";
+const QString strOptionAlignWrites                  = "ALIGNWRITES";
+const QString strOptionVerifyStrategy               = "VERIFYSTRATEGY";
+const QString strOptionReadback                     = "READBACK";
+const QString strOptionReadbackRange                = "READBACKRANGE";
+const QString strOptionReadbackCompare              = "READBACKCOMPARE";
+const QString strOptionDaemon                        = "DAEMON";
+const QString strOptionFixture                      = "FIXTURE";
+const QString strOptionFixtureDetect                = "FIXTUREDETECT";
+const QString strOptionFixtureSettle                = "FIXTURESETTLE";
+const QString strOptionStation                      = "STATION";
+const QString strOptionStationMatch                 = "STATIONMATCH";
+const QString strOptionStationSerial                = "STATIONSERIAL";
+const QString strOptionFtdiLatency                  = "FTDILATENCY";
+const QString strOptionNativeSerial                 = "NATIVESERIAL";
+const QString strOptionTraceFile                    = "TRACEFILE";
+const QString strOptionCaptureFile                  = "CAPTUREFILE";
+const QString strOptionReplayDelay                  = "REPLAYDELAY";
+const QString strOptionLinkHealth                   = "LINKHEALTH";
+const QString strOptionMetricsFile                  = "METRICSFILE";
+const QString strOptionMetricsPort                  = "METRICSPORT";
+const QString strOptionDryRun                       = "DRYRUN";
+const QString strOptionDryRunWriteSize              = "DRYRUNWRITESIZE";
+const QString strOptionDryRunChecksum               = "DRYRUNCHECKSUM";
+const QString strOptionDryRunEraseSizes             = "DRYRUNERASESIZES";
+const QString strOptionDryRunRoundTrip              = "DRYRUNROUNDTRIP";
+const QString strOptionMaxUwfSize                   = "MAXUWFSIZE";
+const QString strOptionMetricsAddress               = "METRICSADDRESS";
+const QString strOptionDryRunBitsPerByte            = "DRYRUNBITSPERBYTE";
+const QString strOptionDryRunEraseTime              = "DRYRUNERASETIME";
+const QString strOptionDryRunProgramTime            = "DRYRUNPROGRAMTIME";
+const QString strOptionVerifyPipelineDepth          = "VERIFYPIPELINEDEPTH";
 const QString strOptionSeperateCharacter            = "=";
 
 /******************************************************************************/
@@ -152,6 +188,10 @@ private slots:
         qint64 nUpgradeTimeMS
         );
     void
+    ModeStatus(
+        QString strMessage
+        );
+    void
     on_tab_Selector_currentChanged(
         int
         );
@@ -180,6 +220,13 @@ private slots:
         );
 #endif
     void
+    BootloaderEntrancePrompt(
+        uint8_t nType,
+        QString strTitle,
+        QString strMessage,
+        bool *pbAccepted
+        );
+    void
     on_btn_Help_clicked(
         );
     void
@@ -206,6 +253,8 @@ private:
     LrdFwUpd        *pFwUpd = NULL;                     //Firmware update object
     LrdSettings     *pSettingsHandle = NULL;            //Settings object
     LrdErr          *pErrHandler = NULL;                //Error handler object
+    LrdFwFixture    *pFixture = NULL;                   //Fixture loop object
+    LrdFwStation    *pStation = NULL;                   //Station mode object
 #ifndef SKIPUPDATECHECK
     LrdAppUpd       *pAppUpdate = NULL;                 //Application update check object
 #endif